@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench_main.cpp
+/// @brief The via-httplib-bench command line.
+//////////////////////////////////////////////////////////////////////////////
+#include "benchmark.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace
+{
+  /// Output the command line usage.
+  void usage(const char* app_name)
+  {
+    std::cerr << "Usage: " << app_name << " [options]\n"
+              << "  --iterations N   microbenchmark iterations, default 200000\n"
+              << "  --connections N  loopback client connections, default 64\n"
+              << "  --requests N     total loopback requests, default 100000\n"
+              << "  --port N         loopback server port, default 8888\n"
+              << "  --micro          only run the microbenchmarks\n"
+              << "  --loopback       only run the loopback benchmark\n"
+              << "Results are written to stdout as JSON objects, one per line."
+              << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  via::bench::options bench_options;
+  bench_options.iterations   = 200000;
+  bench_options.connections  = 64;
+  bench_options.requests     = 100000;
+  bench_options.port         = 8888;
+  bench_options.run_micro    = true;
+  bench_options.run_loopback = true;
+
+  for (int i(1); i < argc; ++i)
+  {
+    const char* arg(argv[i]);
+    bool const has_value(i + 1 < argc);
+    if (!std::strcmp(arg, "--iterations") && has_value)
+      bench_options.iterations = std::strtoul(argv[++i], 0, 10);
+    else if (!std::strcmp(arg, "--connections") && has_value)
+      bench_options.connections = std::strtoul(argv[++i], 0, 10);
+    else if (!std::strcmp(arg, "--requests") && has_value)
+      bench_options.requests = std::strtoul(argv[++i], 0, 10);
+    else if (!std::strcmp(arg, "--port") && has_value)
+      bench_options.port =
+          static_cast<unsigned short>(std::strtoul(argv[++i], 0, 10));
+    else if (!std::strcmp(arg, "--micro"))
+      bench_options.run_loopback = false;
+    else if (!std::strcmp(arg, "--loopback"))
+      bench_options.run_micro = false;
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  try
+  {
+    if (bench_options.run_micro)
+      via::bench::run_micro_benchmarks(std::cout, bench_options);
+
+    if (bench_options.run_loopback &&
+        !via::bench::run_loopback_benchmark(std::cout, bench_options))
+      return 1;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Exception:"  << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
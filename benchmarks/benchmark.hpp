@@ -0,0 +1,122 @@
+#ifndef BENCHMARK_HPP_VIA_HTTPLIB_
+#define BENCHMARK_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file benchmark.hpp
+/// @brief A minimal timing harness for the via-httplib benchmarks.
+/// The results are written as JSON objects, one per line, so that they can
+/// be compared between builds by a script.
+//////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace via
+{
+  namespace bench
+  {
+    /// The clock used to time the benchmarks.
+    typedef std::chrono::steady_clock clock_type;
+
+    /// The benchmark options, set from the command line.
+    struct options
+    {
+      size_t iterations;      ///< the number of iterations of each microbenchmark
+      size_t connections;     ///< the number of loopback client connections
+      size_t requests;        ///< the total number of loopback requests
+      unsigned short port;    ///< the loopback server port
+      bool run_micro;         ///< run the microbenchmarks
+      bool run_loopback;      ///< run the loopback benchmark
+    };
+
+    /// Prevent the compiler from optimising away a benchmark result.
+    /// @param value the result.
+    template <typename T>
+    inline void keep(T const& value)
+    {
+#if defined(__GNUC__)
+      asm volatile("" : : "r"(&value) : "memory");
+#else
+      static const void* volatile sink(0);
+      sink = &value;
+#endif
+    }
+
+    /// Time a function over a number of iterations, after a short warm up.
+    /// @param iterations the number of times to call the function.
+    /// @param function the function to call.
+    /// @return the mean time of a call in nanoseconds.
+    template <typename Function>
+    double time_per_op(size_t iterations, Function function)
+    {
+      for (size_t i(0); i < iterations / 10; ++i)
+        function();
+
+      clock_type::time_point const start(clock_type::now());
+      for (size_t i(0); i < iterations; ++i)
+        function();
+      clock_type::duration const elapsed(clock_type::now() - start);
+
+      return std::chrono::duration<double, std::nano>(elapsed).count()
+                / static_cast<double>(iterations ? iterations : 1);
+    }
+
+    /// Write a microbenchmark result as a JSON object.
+    /// @param os the output stream.
+    /// @param name the name of the benchmark.
+    /// @param iterations the number of iterations.
+    /// @param ns_per_op the mean time of an iteration in nanoseconds.
+    inline void write_result(std::ostream& os, std::string const& name,
+                             size_t iterations, double ns_per_op)
+    {
+      os << "{\"benchmark\":\"" << name
+         << "\",\"iterations\":" << iterations
+         << ",\"ns_per_op\":" << ns_per_op
+         << ",\"ops_per_s\":" << (ns_per_op > 0.0 ? 1.0e9 / ns_per_op : 0.0)
+         << "}" << std::endl;
+    }
+
+    /// Calculate a percentile of a set of samples.
+    /// @param sorted_samples the samples, in ascending order.
+    /// @param fraction the percentile as a fraction, e.g. 0.99.
+    /// @return the sample at the percentile, zero if there are no samples.
+    inline double percentile(std::vector<double> const& sorted_samples,
+                             double fraction)
+    {
+      if (sorted_samples.empty())
+        return 0.0;
+
+      size_t index(static_cast<size_t>
+                    (std::ceil(fraction * sorted_samples.size())));
+      index = std::min(std::max(index, static_cast<size_t>(1)),
+                       sorted_samples.size());
+      return sorted_samples[index - 1];
+    }
+
+    /// Run the microbenchmarks of the HTTP parsers, router and encoder.
+    /// @param os the output stream.
+    /// @param bench_options the benchmark options.
+    void run_micro_benchmarks(std::ostream& os, options const& bench_options);
+
+    /// Run the in-process loopback benchmark of the http_server driven by
+    /// concurrent keep-alive http_clients.
+    /// @param os the output stream.
+    /// @param bench_options the benchmark options.
+    /// @return true if the benchmark completed, false otherwise.
+    bool run_loopback_benchmark(std::ostream& os, options const& bench_options);
+  }
+}
+
+#endif
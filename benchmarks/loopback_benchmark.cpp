@@ -0,0 +1,177 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file loopback_benchmark.cpp
+/// @brief An in-process benchmark of an http_server driven by concurrent
+/// keep-alive http_clients over the loopback interface.
+//////////////////////////////////////////////////////////////////////////////
+#include "benchmark.hpp"
+#include "via/comms/tcp_adaptor.hpp"
+#include "via/http_server.hpp"
+#include "via/http_client.hpp"
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+  /// The server and client types, using std::string to store message bodies.
+  typedef via::http_server<via::comms::tcp_adaptor, std::string>
+    http_server_type;
+  typedef via::http_client<via::comms::tcp_adaptor, std::string>
+    http_client_type;
+
+  /// The body of the benchmark response.
+  const std::string RESPONSE_BODY("Hello, World!");
+
+  /// The state of the loopback clients.
+  /// Note: it's only accessed by the client io_service thread.
+  struct loopback_clients
+  {
+    /// A client connection and its request timing.
+    struct client
+    {
+      http_client_type::shared_pointer http_client; ///< the http_client
+      size_t remaining;                             ///< requests to send
+      via::bench::clock_type::time_point sent;      ///< last request time
+    };
+
+    std::vector<client> clients;   ///< the clients
+    std::vector<double> latencies; ///< the request latencies in microseconds
+    size_t failures;               ///< the number of failed requests
+
+    /// Send the next request from a client, or disconnect it.
+    /// @param index the index of the client.
+    void send_next(size_t index)
+    {
+      client& the_client(clients[index]);
+      if (the_client.remaining == 0)
+      {
+        the_client.http_client->disconnect();
+        return;
+      }
+
+      --the_client.remaining;
+      the_client.sent = via::bench::clock_type::now();
+      via::http::tx_request request(via::http::request_method::id::GET,
+                                    "/hello");
+      if (!the_client.http_client->send(request))
+      {
+        failures += the_client.remaining + 1;
+        the_client.remaining = 0;
+        the_client.http_client->disconnect();
+      }
+    }
+
+    /// Record the latency of a response and send the next request.
+    /// @param index the index of the client.
+    /// @param response the response received.
+    void response_received(size_t index, via::http::rx_response const& response)
+    {
+      std::chrono::duration<double, std::micro> const latency
+        (via::bench::clock_type::now() - clients[index].sent);
+      latencies.push_back(latency.count());
+      if (response.status() != static_cast<int>
+                                 (via::http::response_status::code::OK))
+        ++failures;
+
+      send_next(index);
+    }
+  };
+
+  /// The benchmark route handler.
+  via::http::tx_response hello_handler(via::http::rx_request const&,
+                                       via::http::Parameters const&,
+                                       std::string const&,
+                                       std::string& response_body)
+  {
+    response_body = RESPONSE_BODY;
+    return via::http::tx_response(via::http::response_status::code::OK);
+  }
+}
+
+namespace via
+{
+  namespace bench
+  {
+    bool run_loopback_benchmark(std::ostream& os, options const& bench_options)
+    {
+      size_t const connections(std::max(bench_options.connections,
+                                         static_cast<size_t>(1)));
+      size_t const requests(std::max(bench_options.requests, connections));
+      std::string const port_name
+        (boost::lexical_cast<std::string>(bench_options.port));
+
+      // Run the server in its own thread
+      boost::asio::io_service server_io_service;
+      http_server_type http_server(server_io_service);
+      http_server.request_router().add_method("GET", "/hello", hello_handler);
+      boost::system::error_code error
+        (http_server.accept_connections(bench_options.port, true));
+      if (error)
+      {
+        std::cerr << "Error: " << error.message() << std::endl;
+        return false;
+      }
+      std::thread server_thread([&server_io_service]
+        { server_io_service.run(); });
+
+      // Create the clients and share the requests between them
+      boost::asio::io_service client_io_service;
+      loopback_clients state;
+      state.failures = 0;
+      state.latencies.reserve(requests);
+      state.clients.resize(connections);
+      for (size_t i(0); i < connections; ++i)
+      {
+        loopback_clients::client& the_client(state.clients[i]);
+        the_client.remaining = requests / connections
+                             + ((i < requests % connections) ? 1 : 0);
+        the_client.http_client = http_client_type::create(client_io_service,
+          [&state, i](via::http::rx_response const& response, std::string const&)
+            { state.response_received(i, response); },
+          [](http_client_type::chunk_type const&, std::string const&) {});
+        the_client.http_client->connected_event([&state, i]
+          { state.send_next(i); });
+      }
+
+      clock_type::time_point const start(clock_type::now());
+      for (size_t i(0); i < connections; ++i)
+      {
+        if (!state.clients[i].http_client->connect("127.0.0.1", port_name))
+        {
+          state.failures += state.clients[i].remaining;
+          state.clients[i].remaining = 0;
+        }
+      }
+      client_io_service.run();
+      std::chrono::duration<double> const elapsed(clock_type::now() - start);
+
+      state.clients.clear();
+      server_io_service.stop();
+      server_thread.join();
+
+      std::vector<double>& latencies(state.latencies);
+      std::sort(latencies.begin(), latencies.end());
+      double const seconds(elapsed.count());
+      os << "{\"benchmark\":\"loopback\""
+         << ",\"connections\":" << connections
+         << ",\"requests\":" << latencies.size()
+         << ",\"failures\":" << state.failures
+         << ",\"seconds\":" << seconds
+         << ",\"req_per_s\":"
+         << (seconds > 0.0 ? latencies.size() / seconds : 0.0)
+         << ",\"p50_us\":" << percentile(latencies, 0.50)
+         << ",\"p99_us\":" << percentile(latencies, 0.99)
+         << ",\"p999_us\":" << percentile(latencies, 0.999)
+         << "}" << std::endl;
+
+      return state.failures == 0;
+    }
+  }
+}
@@ -0,0 +1,275 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file micro_benchmarks.cpp
+/// @brief Microbenchmarks of the HTTP parsers, router and encoder.
+//////////////////////////////////////////////////////////////////////////////
+#include "benchmark.hpp"
+#include "via/http/request.hpp"
+#include "via/http/response.hpp"
+#include "via/http/chunk.hpp"
+#include "via/http/headers.hpp"
+#include "via/http/request_router.hpp"
+#include <stdexcept>
+
+using namespace via::http;
+
+namespace
+{
+  typedef request_receiver<std::string> request_receiver_type;
+  typedef request_router<std::string>   request_router_type;
+
+  /// A typical browser GET request.
+  const std::string GET_REQUEST
+    ("GET /api/v1/users/42/orders?limit=10 HTTP/1.1\r\n"
+     "Host: www.example.com\r\n"
+     "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:40.0) Gecko/20100101\r\n"
+     "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+     "Accept-Language: en-GB,en;q=0.5\r\n"
+     "Accept-Encoding: gzip, deflate\r\n"
+     "Cookie: session=0123456789abcdef; theme=dark\r\n"
+     "Connection: keep-alive\r\n"
+     "\r\n");
+
+  /// A POST request with a small body.
+  const std::string POST_REQUEST
+    ("POST /api/v1/users HTTP/1.1\r\n"
+     "Host: www.example.com\r\n"
+     "Content-Type: application/json\r\n"
+     "Content-Length: 27\r\n"
+     "\r\n"
+     "{\"name\":\"via\",\"age\":2015}\r\n");
+
+  /// A response with a body.
+  const std::string RESPONSE
+    ("HTTP/1.1 200 OK\r\n"
+     "Server: Via-httplib/1.2.0\r\n"
+     "Date: Thu, 01 Oct 2015 12:00:00 GMT\r\n"
+     "Content-Type: text/plain\r\n"
+     "Content-Length: 13\r\n"
+     "\r\n"
+     "Hello, World!");
+
+  /// A data chunk.
+  const std::string CHUNK("1a;name=value\r\nabcdefghijklmnopqrstuvwxyz\r\n");
+
+  /// The header fields of GET_REQUEST, after the request line.
+  const std::string FIELDS(GET_REQUEST.substr(GET_REQUEST.find('\n') + 1));
+
+  /// Construct a request_receiver with the default parameters.
+  request_receiver_type make_request_receiver()
+  {
+    return request_receiver_type(false,
+      request_receiver_type::DEFAULT_MAX_WHITESPACE_CHARS,
+      request_receiver_type::DEFAULT_MAX_METHOD_LENGTH,
+      request_receiver_type::DEFAULT_MAX_URI_LENGTH,
+      request_receiver_type::DEFAULT_MAX_LINE_LENGTH,
+      request_receiver_type::DEFAULT_MAX_HEADER_NUMBER,
+      request_receiver_type::DEFAULT_MAX_HEADER_LENGTH,
+      request_receiver_type::DEFAULT_MAX_BODY_SIZE,
+      request_receiver_type::DEFAULT_MAX_CHUNK_SIZE);
+  }
+
+  /// Construct an rx_request with the default parameters.
+  rx_request make_rx_request()
+  {
+    return rx_request(false,
+      request_receiver_type::DEFAULT_MAX_WHITESPACE_CHARS,
+      request_receiver_type::DEFAULT_MAX_METHOD_LENGTH,
+      request_receiver_type::DEFAULT_MAX_URI_LENGTH,
+      request_receiver_type::DEFAULT_MAX_LINE_LENGTH,
+      request_receiver_type::DEFAULT_MAX_HEADER_NUMBER,
+      request_receiver_type::DEFAULT_MAX_HEADER_LENGTH);
+  }
+
+  /// Receive a complete request, throw if it's not valid.
+  void receive_request(request_receiver_type& receiver,
+                       std::string const& data)
+  {
+    receiver.clear();
+    std::string::const_iterator next(data.begin());
+    if (receiver.receive(next, data.end()) != RX_VALID)
+      throw std::runtime_error("request_receiver::receive failed");
+    via::bench::keep(receiver.body());
+  }
+
+  /// A route handler that returns an empty response.
+  tx_response route_handler(rx_request const&, Parameters const& parameters,
+                            std::string const&, std::string& response_body)
+  {
+    response_body = parameters.empty() ? "" : parameters.begin()->second;
+    return tx_response(response_status::code::OK);
+  }
+}
+
+namespace via
+{
+  namespace bench
+  {
+    void run_micro_benchmarks(std::ostream& os, options const& bench_options)
+    {
+      size_t const iterations(bench_options.iterations);
+
+      // request_receiver::receive
+      {
+        request_receiver_type receiver(make_request_receiver());
+        write_result(os, "request_receiver.receive.get", iterations,
+          time_per_op(iterations, [&]{ receive_request(receiver, GET_REQUEST); }));
+        write_result(os, "request_receiver.receive.post", iterations,
+          time_per_op(iterations, [&]{ receive_request(receiver, POST_REQUEST); }));
+      }
+
+      // response_receiver::receive
+      {
+        response_receiver<std::string> receiver;
+        write_result(os, "response_receiver.receive", iterations,
+          time_per_op(iterations, [&]
+          {
+            receiver.clear();
+            std::string::const_iterator next(RESPONSE.begin());
+            if (receiver.receive(next, RESPONSE.end()) != RX_VALID)
+              throw std::runtime_error("response_receiver::receive failed");
+            keep(receiver.body());
+          }));
+      }
+
+      // rx_chunk::parse
+      {
+        rx_chunk<std::string> chunk(false,
+          request_receiver_type::DEFAULT_MAX_WHITESPACE_CHARS,
+          request_receiver_type::DEFAULT_MAX_LINE_LENGTH,
+          request_receiver_type::DEFAULT_MAX_CHUNK_SIZE,
+          request_receiver_type::DEFAULT_MAX_HEADER_NUMBER,
+          request_receiver_type::DEFAULT_MAX_HEADER_LENGTH);
+        write_result(os, "rx_chunk.parse", iterations,
+          time_per_op(iterations, [&]
+          {
+            chunk.clear();
+            std::string::const_iterator next(CHUNK.begin());
+            if (!chunk.parse(next, CHUNK.end()))
+              throw std::runtime_error("rx_chunk::parse failed");
+            keep(chunk.data());
+          }));
+      }
+
+      // message_headers::parse
+      {
+        message_headers headers(false,
+          request_receiver_type::DEFAULT_MAX_WHITESPACE_CHARS,
+          request_receiver_type::DEFAULT_MAX_LINE_LENGTH,
+          request_receiver_type::DEFAULT_MAX_HEADER_NUMBER,
+          request_receiver_type::DEFAULT_MAX_HEADER_LENGTH);
+        write_result(os, "message_headers.parse", iterations,
+          time_per_op(iterations, [&]
+          {
+            headers.clear();
+            std::string::const_iterator next(FIELDS.begin());
+            if (!headers.parse(next, FIELDS.end()))
+              throw std::runtime_error("message_headers::parse failed");
+            keep(headers.content_length());
+          }));
+      }
+
+      // request_router::handle_request
+      {
+        request_router_type router;
+        router.add_method("GET", "/", route_handler);
+        router.add_method("GET", "/index.html", route_handler);
+        router.add_method("GET", "/api/v1/users", route_handler);
+        router.add_method("POST", "/api/v1/users", route_handler);
+        router.add_method("GET", "/api/v1/users/:id", route_handler);
+        router.add_method("PUT", "/api/v1/users/:id", route_handler);
+        router.add_method("GET", "/api/v1/users/:id/orders", route_handler);
+
+        rx_request request(make_rx_request());
+        std::string::const_iterator next(GET_REQUEST.begin());
+        if (!request.parse(next, GET_REQUEST.end()))
+          throw std::runtime_error("rx_request::parse failed");
+
+        std::string const request_body;
+        std::string response_body;
+        write_result(os, "request_router.handle_request", iterations,
+          time_per_op(iterations, [&]
+          {
+            tx_response response
+              (router.handle_request(request, request_body, response_body));
+            keep(response);
+          }));
+      }
+
+      // request_router::handle_request with many routes
+      {
+        request_router_type router;
+        for (int i(0); i < 1000; ++i)
+        {
+          std::string const path("/api/v1/resource" + std::to_string(i));
+          router.add_method("GET", path, route_handler);
+          router.add_method("GET", path + "/:id/orders", route_handler);
+        }
+
+        std::string const request_data
+          ("GET /api/v1/resource999/42/orders HTTP/1.1\r\n"
+           "Host: www.example.com\r\n\r\n");
+        rx_request request(make_rx_request());
+        std::string::const_iterator next(request_data.begin());
+        if (!request.parse(next, request_data.end()))
+          throw std::runtime_error("rx_request::parse failed");
+
+        std::string const request_body;
+        std::string response_body;
+        write_result(os, "request_router.handle_request.2000_routes", iterations,
+          time_per_op(iterations, [&]
+          {
+            tx_response response
+              (router.handle_request(request, request_body, response_body));
+            keep(response);
+          }));
+      }
+
+      // header_field::append_date_header
+      {
+        std::string header_string;
+        write_result(os, "header_field.append_date_header", iterations,
+          time_per_op(iterations, [&]
+          {
+            header_string.clear();
+            header_field::append_date_header(header_string);
+            keep(header_string);
+          }));
+      }
+
+      // tx_response::message
+      {
+        write_result(os, "tx_response.message", iterations,
+          time_per_op(iterations, []
+          {
+            tx_response response(response_status::code::OK);
+            response.add_server_header();
+            response.add_header(header_field::id::CONTENT_TYPE, "text/plain");
+            std::string const message(response.message(13));
+            keep(message);
+          }));
+      }
+
+      // response_template::dynamic_header
+      {
+        tx_response response(response_status::code::OK);
+        response.add_server_header();
+        response.add_header(header_field::id::CONTENT_TYPE, "text/plain");
+        response_template const preformatted(response);
+        write_result(os, "response_template.dynamic_header", iterations,
+          time_per_op(iterations, [&]
+          {
+            std::string const header(preformatted.dynamic_header(13));
+            keep(preformatted.header());
+            keep(header);
+          }));
+      }
+    }
+  }
+}
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file multi_reactor_http_server.cpp
+/// @brief An example HTTP server using an io_service per thread, each with
+/// its own http_server listening on the same port.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/tcp_adaptor.hpp"
+#include "via/comms/multi_reactor_server.hpp"
+#include "via/http_server.hpp"
+#include <iostream>
+
+/// Define an HTTP server using std::string to store message bodies.
+/// A strand is not required since each io_service is run by one thread.
+typedef via::http_server<via::comms::tcp_adaptor, std::string> http_server_type;
+typedef http_server_type::http_connection_type http_connection;
+typedef via::comms::multi_reactor_server<http_server_type> multi_server_type;
+
+namespace
+{
+  /// The handler for HTTP requests.
+  /// Responds with 200 OK with the client address in the body.
+  void request_handler(http_connection::weak_pointer weak_ptr,
+                       via::http::rx_request const&, // request,
+                       std::string const&) // body
+  {
+    http_connection::shared_pointer connection(weak_ptr.lock());
+    if (connection)
+    {
+      via::http::tx_response response(via::http::response_status::code::OK);
+      response.add_server_header();
+      response.add_date_header();
+
+      // respond with the client's address
+      std::string response_body("Hello, ");
+      response_body += connection->remote_address();
+      connection->send(std::move(response), std::move(response_body));
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::string app_name(argv[0]);
+  unsigned short port_number(via::comms::tcp_adaptor::DEFAULT_HTTP_PORT);
+
+  // Get a port number from the user (the default is 80)
+  if (argc > 2)
+  {
+    std::cerr << "Usage: " << app_name << " [port number]\n"
+              << "E.g. "   << app_name << " " << port_number
+              << std::endl;
+    return 1;
+  }
+  else if (argc == 2)
+  {
+    std::string port(argv[1]);
+    port_number = atoi(port.c_str());
+  }
+
+  std::cout << app_name << ": " << port_number << std::endl;
+
+  try
+  {
+    // Create an http_server per thread supported and attach the handler
+    multi_server_type multi_server;
+    multi_server.for_each([](http_server_type& http_server)
+      { http_server.request_received_event(request_handler); });
+    std::cout << "No of reactors: " << multi_server.size() << std::endl;
+
+    // Accept connections on the port in every reactor
+    boost::system::error_code error
+        (multi_server.accept_connections(port_number));
+    if (error)
+    {
+      std::cerr << "Error: "  << error.message() << std::endl;
+      return 1;
+    }
+
+    // The signal set is used to register for termination notifications
+    boost::asio::signal_set signals_(multi_server.io_service(0));
+    signals_.add(SIGINT);
+    signals_.add(SIGTERM);
+#if defined(SIGQUIT)
+    signals_.add(SIGQUIT);
+#endif // #if defined(SIGQUIT)
+
+    // shutdown all of the servers when a signal is received
+    signals_.async_wait([&multi_server]
+      (boost::system::error_code const&, int) // error, signal_number
+    {
+      std::cout << "Shutting down" << std::endl;
+      multi_server.shutdown();
+    });
+
+    // Run the io_services, one per thread
+    multi_server.run();
+
+    std::cout << "io_services run, all work has finished" << std::endl;
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Exception:"  << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+#ifndef BUFFER_POOL_HPP_VIA_HTTPLIB_
+#define BUFFER_POOL_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file buffer_pool.hpp
+/// @brief The rx_buffer_pool template class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class rx_buffer_pool
+    /// A pool of receive buffers shared by the connections of a server.
+    /// Buffers are held in size classes of powers of two, from
+    /// MIN_BUFFER_SIZE upwards. A connection borrows a buffer when it has
+    /// data to read and returns it after the data has been processed, so
+    /// idle connections do not hold a receive buffer.
+    /// The class is thread safe, so that it may be shared by connections
+    /// running in a thread pool.
+    /// Any class providing the acquire and release functions below may be
+    /// used in its place as the RxBufferPool template parameter of a
+    /// connection or server.
+    /// @see connection
+    /// @see server
+    /// @param Container the container to use for the rx buffers,
+    /// std::vector<char> or std::string.
+    //////////////////////////////////////////////////////////////////////////
+    template <typename Container>
+    class rx_buffer_pool
+    {
+    public:
+
+      /// A shared pointer to a receive buffer.
+      typedef std::shared_ptr<Container> buffer_pointer;
+
+      /// The size of the smallest size class.
+      static const size_t MIN_BUFFER_SIZE = 512;
+
+      /// The number of size classes: 512 bytes to 16MB.
+      static const size_t NUMBER_OF_SIZE_CLASSES = 16;
+
+      /// The default maximum number of free buffers held in each size class.
+      static const size_t DEFAULT_MAX_POOLED_BUFFERS = 1024;
+
+    private:
+
+      /// The free buffers in each size class.
+      std::vector<buffer_pointer> free_lists_[NUMBER_OF_SIZE_CLASSES];
+      /// The maximum number of free buffers held in each size class.
+      size_t max_pooled_buffers_;
+      /// Mutex to protect the free lists.
+      mutable std::mutex mutex_;
+
+      /// The size of the buffers in the given size class.
+      /// @param index the size class index.
+      /// @return the size of the buffers in the size class.
+      static size_t class_size(size_t index) NOEXCEPT
+      { return MIN_BUFFER_SIZE << index; }
+
+      /// The size class for a requested buffer size.
+      /// @param size the requested size of the buffer.
+      /// @return the index of the smallest size class that can hold size,
+      /// NUMBER_OF_SIZE_CLASSES if it's too big for the pool.
+      static size_t acquire_class(size_t size) NOEXCEPT
+      {
+        size_t index(0);
+        while ((index < NUMBER_OF_SIZE_CLASSES) && (class_size(index) < size))
+          ++index;
+        return index;
+      }
+
+      /// The size class for a returned buffer.
+      /// @param capacity the capacity of the buffer.
+      /// @return the index of the largest size class that the buffer can
+      /// serve, NUMBER_OF_SIZE_CLASSES if it's too small or too big.
+      static size_t release_class(size_t capacity) NOEXCEPT
+      {
+        if (capacity < MIN_BUFFER_SIZE)
+          return NUMBER_OF_SIZE_CLASSES;
+
+        size_t index(0);
+        while ((index + 1 < NUMBER_OF_SIZE_CLASSES) &&
+               (class_size(index + 1) <= capacity))
+          ++index;
+
+        return (capacity < (class_size(index) << 1)) ? index
+                                                     : NUMBER_OF_SIZE_CLASSES;
+      }
+
+    public:
+
+      /// Copy constructor deleted to disable copying.
+      rx_buffer_pool(rx_buffer_pool const&) = delete;
+
+      /// Assignment operator deleted to disable copying.
+      rx_buffer_pool& operator=(rx_buffer_pool) = delete;
+
+      /// Constructor.
+      /// @param max_pooled_buffers the maximum number of free buffers to
+      /// hold in each size class, default DEFAULT_MAX_POOLED_BUFFERS.
+      explicit rx_buffer_pool
+          (size_t max_pooled_buffers = DEFAULT_MAX_POOLED_BUFFERS) :
+        free_lists_(),
+        max_pooled_buffers_(max_pooled_buffers),
+        mutex_()
+      {}
+
+      /// @fn acquire
+      /// Borrow a buffer from the pool.
+      /// @param size the required size of the buffer.
+      /// @return a shared pointer to a buffer of the requested size.
+      buffer_pointer acquire(size_t size)
+      {
+        size_t index(acquire_class(size));
+        if (index < NUMBER_OF_SIZE_CLASSES)
+        {
+          buffer_pointer buffer;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<buffer_pointer>& free_list(free_lists_[index]);
+            if (!free_list.empty())
+            {
+              buffer.swap(free_list.back());
+              free_list.pop_back();
+            }
+          }
+
+          if (!buffer)
+          {
+            buffer = std::make_shared<Container>(class_size(index), 0);
+            buffer->resize(size);
+          }
+          else
+            buffer->resize(size, 0);
+          return buffer;
+        }
+        else
+          return std::make_shared<Container>(size, 0);
+      }
+
+      /// @fn release
+      /// Return a buffer to the pool.
+      /// Buffers that don't fit a size class or that would exceed the
+      /// maximum number of free buffers are deleted instead.
+      /// @pre the buffer must not be used by a pending read.
+      /// @param buffer the buffer to return.
+      void release(buffer_pointer buffer)
+      {
+        if (!buffer)
+          return;
+
+        size_t index(release_class(buffer->capacity()));
+        if (index < NUMBER_OF_SIZE_CLASSES)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          std::vector<buffer_pointer>& free_list(free_lists_[index]);
+          if (free_list.size() < max_pooled_buffers_)
+            free_list.push_back(std::move(buffer));
+        }
+      }
+
+      /// The number of free buffers held by the pool.
+      /// @return the total number of free buffers in all size classes.
+      size_t size() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t total(0);
+        for (auto const& free_list : free_lists_)
+          total += free_list.size();
+        return total;
+      }
+
+      /// Delete all of the free buffers held by the pool.
+      void clear()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& free_list : free_lists_)
+          std::vector<buffer_pointer>().swap(free_list);
+      }
+    };
+  }
+}
+
+#endif
@@ -15,15 +15,40 @@
 /// @brief The connection template class.
 //////////////////////////////////////////////////////////////////////////////
 #include "socket_adaptor.hpp"
+#include "buffer_pool.hpp"
+#include "file_handle.hpp"
+#include "shared_buffer.hpp"
+#include "slot_map.hpp"
+#include "via/metrics.hpp"
 #include "via/no_except.hpp"
 #include <boost/system/error_code.hpp>
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace via
 {
   namespace comms
   {
+    /// @fn to_container
+    /// Convert a string, e.g. an HTTP header, into a Container for the
+    /// connection transmit queue.
+    /// @param packet the string to convert.
+    /// @return a Container holding the contents of packet.
+    template <typename Container>
+    inline Container to_container(std::string packet)
+    { return Container(packet.begin(), packet.end()); }
+
+    /// @fn to_container
+    /// Specialisation for std::string containers, it just moves the string.
+    /// @param packet the string to convert.
+    /// @return the packet.
+    template <>
+    inline std::string to_container<std::string>(std::string packet)
+    { return packet; }
+
     //////////////////////////////////////////////////////////////////////////
     /// @class connection
     /// A template class that buffers tcp or ssl comms sockets.
@@ -41,29 +66,44 @@ namespace via
     /// std::array<char, size>
     /// @param use_strand if true use an asio::strand to wrap the handlers,
     /// default false.
+    /// @param RxBufferPool the pool to borrow receive buffers from,
+    /// default rx_buffer_pool<Container>.
     //////////////////////////////////////////////////////////////////////////
     template <typename SocketAdaptor, typename Container = std::vector<char>,
-              bool use_strand = false>
+              bool use_strand = false,
+              typename RxBufferPool = rx_buffer_pool<Container> >
     class connection : public SocketAdaptor,
         public std::enable_shared_from_this
-            <connection<SocketAdaptor, Container, use_strand> >
+            <connection<SocketAdaptor, Container, use_strand, RxBufferPool> >
     {
     public:
 
 
       /// A weak pointer to a connection.
       typedef typename std::weak_ptr<connection<SocketAdaptor, Container,
-                                                  use_strand> >
+                                                  use_strand, RxBufferPool> >
          weak_pointer;
 
       /// A shared pointer to a connection.
       typedef typename std::shared_ptr<connection<SocketAdaptor, Container,
-                                                    use_strand> >
+                                                    use_strand, RxBufferPool> >
          shared_pointer;
 
       /// The enable_shared_from_this type of this class.
       typedef typename std::enable_shared_from_this
-                  <connection<SocketAdaptor, Container, use_strand> > enable;
+        <connection<SocketAdaptor, Container, use_strand, RxBufferPool> > enable;
+
+      /// A shared pointer to the receive buffer pool.
+      typedef typename std::shared_ptr<RxBufferPool> rx_buffer_pool_pointer;
+
+      /// A shared pointer to the SocketAdaptor's context, e.g. an SSL context.
+      typedef typename SocketAdaptor::context_pointer context_pointer;
+
+      /// The default maximum number of buffers in a single write.
+      static const size_t DEFAULT_MAX_TX_BUFFERS = 64;
+
+      /// The default maximum number of bytes in a single write.
+      static const size_t DEFAULT_MAX_TX_BYTES = 256 * 1024;
 
       /// The resolver_iterator type of the SocketAdaptor
       typedef typename boost::asio::ip::tcp::resolver::iterator resolver_iterator;
@@ -77,12 +117,36 @@ namespace via
 
     private:
 
+      /// A buffer waiting in the transmit queue.
+      struct tx_buffer
+      {
+        boost::asio::const_buffer buffer; ///< The data to send.
+        bool is_packet; ///< Whether the data is a packet in the tx_queue_.
+        file_segment file; ///< A file segment to send instead of the buffer.
+        std::shared_ptr<void const> owner; ///< The owner of shared data.
+      };
+
+      /// The asio io_service used to schedule writes.
+      boost::asio::io_service& io_service_;
       /// Strand to ensure the connection's handlers are not called concurrently.
       boost::asio::io_service::strand strand_;
       size_t rx_buffer_size_;              ///< The receive buffer size.
-      std::shared_ptr<Container> rx_buffer_; ///< The receive buffer.
-      std::shared_ptr<std::deque<Container> > tx_queue_; ///< The transmit queue.
-      ConstBuffers tx_buffers_;            ///< The transmit buffers.
+      rx_buffer_pool_pointer rx_buffer_pool_; ///< The receive buffer pool.
+      /// The receive buffer, only held while a read is in progress.
+      std::shared_ptr<Container> rx_buffer_;
+      /// The packets queued for transmission, including those being sent.
+      std::shared_ptr<std::deque<Container> > tx_queue_;
+      std::deque<tx_buffer> tx_pending_;   ///< The buffers waiting to be sent.
+      ConstBuffers tx_buffers_;            ///< The buffers being sent.
+      size_t tx_packets_sending_;          ///< The tx_queue_ packets being sent.
+      /// The owners of the shared data being sent.
+      std::shared_ptr<std::vector<std::shared_ptr<void const> > > tx_owners_;
+      size_t max_tx_buffers_;              ///< The max buffers in a write.
+      size_t max_tx_bytes_;                ///< The max bytes in a write.
+      file_segment tx_file_;               ///< The file segment being sent.
+      std::uint64_t tx_file_sent_;         ///< The bytes of tx_file_ sent.
+      /// The bytes sent, including the parts of file segments.
+      std::uint64_t tx_progress_;
       event_callback_type event_callback_; ///< The event callback function.
       error_callback_type error_callback_; ///< The error callback function.
       /// The send and receive timeouts, in milliseconds, zero is disabled.
@@ -91,10 +155,13 @@ namespace via
       int send_buffer_size_;    ///< The socket send buffer size.
       bool receiving_;          ///< Whether a read's in progress
       bool transmitting_;       ///< Whether a write's in progress
+      bool write_scheduled_;    ///< Whether a write has been scheduled
       bool no_delay_;           ///< The tcp no delay status.
       bool keep_alive_;         ///< The tcp keep alive status.
       bool connected_;          ///< If the socket is connected.
       bool disconnect_pending_; ///< Shutdown the socket after the next write.
+      bool reception_paused_;   ///< Don't read until reception is resumed.
+      slot_handle handle_;      ///< The handle of the connection in a server.
 
       /// @fn weak_from_this
       /// Get a weak_pointer to this instance.
@@ -102,19 +169,186 @@ namespace via
       weak_pointer weak_from_this()
       { return weak_pointer(enable::shared_from_this()); }
 
+      /// The ids of the connection metrics in the metrics_registry.
+      struct metric_ids
+      {
+        size_t reads;          ///< The number of reads.
+        size_t bytes_received; ///< The number of bytes read.
+        size_t writes;         ///< The number of writes.
+        size_t bytes_sent;     ///< The number of bytes written.
+        size_t tx_queue_depth; ///< The buffers waiting to be written.
+
+        metric_ids() :
+          reads         (metrics_registry::instance().
+                           counter("via_comms_reads_total")),
+          bytes_received(metrics_registry::instance().
+                           counter("via_comms_bytes_received_total")),
+          writes        (metrics_registry::instance().
+                           counter("via_comms_writes_total")),
+          bytes_sent    (metrics_registry::instance().
+                           counter("via_comms_bytes_sent_total")),
+          tx_queue_depth(metrics_registry::instance().
+                           histogram("via_comms_tx_queue_depth"))
+        {}
+      };
+
+      /// @fn metrics
+      /// The ids of the connection metrics, registered on first use.
+      static metric_ids const& metrics()
+      {
+        static const metric_ids ids;
+        return ids;
+      }
+
+      /// @fn count_transfer
+      /// Count a read or write in the metrics_registry.
+      /// @param transfers the id of the read or write counter.
+      /// @param bytes the id of the bytes received or sent counter.
+      /// @param bytes_transferred the number of bytes read or written.
+      static void count_transfer(size_t transfers, size_t bytes,
+                                 size_t bytes_transferred)
+      {
+        metrics_registry& registry(metrics_registry::instance());
+        registry.add(transfers);
+        registry.add(bytes, static_cast<long long>(bytes_transferred));
+      }
+
       /// @fn write_data
-      /// Write data via the socket adaptor.
-      /// @param buffers the buffer(s) containing the message.
-      /// @return true if connected, false otherwise.
-      bool write_data(ConstBuffers buffers)
+      /// Write the buffers waiting in the transmit queue via the socket
+      /// adaptor in a single (gather) write, up to max_tx_buffers_ buffers
+      /// and max_tx_bytes_ bytes. It always writes at least one buffer.
+      /// @return true if a write was started, false otherwise.
+      bool write_data()
       {
-        tx_buffers_.swap(buffers);
+        if (transmitting_ || !connected_ || tx_pending_.empty())
+          return false;
 
-        if (connected_)
+        metrics_registry::instance().observe(metrics().tx_queue_depth,
+                                             tx_pending_.size());
+        if (tx_pending_.front().file.file)
+        {
+          write_file();
+          return true;
+        }
+
+        tx_buffers_.clear();
+        size_t tx_bytes(0);
+        while (!tx_pending_.empty() &&
+               (tx_buffers_.empty() || (tx_buffers_.size() < max_tx_buffers_)))
+        {
+          tx_buffer& next(tx_pending_.front());
+          if (next.file.file)
+            break;
+
+          size_t size(boost::asio::buffer_size(next.buffer));
+          if (!tx_buffers_.empty() && (tx_bytes + size > max_tx_bytes_))
+            break;
+
+          tx_bytes += size;
+          tx_buffers_.push_back(next.buffer);
+          if (next.is_packet)
+            ++tx_packets_sending_;
+          if (next.owner)
+            tx_owners_->push_back(std::move(next.owner));
+          tx_pending_.pop_front();
+        }
+        transmitting_ = true;
+
+        // local copies for lambdas
+        weak_pointer weak_ptr(weak_from_this());
+        std::shared_ptr<std::deque<Container> > tx_queue(tx_queue_);
+        std::shared_ptr<std::vector<std::shared_ptr<void const> > >
+          tx_owners(tx_owners_);
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          SocketAdaptor::write(tx_buffers_,
+             strand_.wrap([weak_ptr, tx_queue, tx_owners]
+                          (boost::system::error_code const& error,
+                           size_t bytes_transferred)
+          { write_callback(weak_ptr, error, bytes_transferred, tx_queue); }));
+        else
+          SocketAdaptor::write(tx_buffers_,
+            [weak_ptr, tx_queue, tx_owners]
+                          (boost::system::error_code const& error,
+                           size_t bytes_transferred)
+          { write_callback(weak_ptr, error, bytes_transferred, tx_queue); });
+
+        return true;
+      }
+
+      /// @fn write_file
+      /// Start sending the file segment at the front of the transmit queue.
+      /// The segment is sent by write_file_data, called from the
+      /// connection's handlers, so that the SENT event is never signalled
+      /// from within a send function.
+      void write_file()
+      {
+        tx_file_ = std::move(tx_pending_.front().file);
+        tx_pending_.pop_front();
+        tx_file_sent_ = 0;
+        transmitting_ = true;
+
+        weak_pointer weak_ptr(weak_from_this());
+        boost::system::error_code const success;
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          strand_.post([weak_ptr, success]
+                       { write_file_callback(weak_ptr, success, 0); });
+        else
+          io_service_.post([weak_ptr, success]
+                           { write_file_callback(weak_ptr, success, 0); });
+      }
+
+      /// @fn write_file_data
+      /// Send the rest of the file segment being sent, or complete the
+      /// write if it has all been sent.
+      /// Calls the overload selected by SocketAdaptor::SEND_FILE.
+      void write_file_data()
+      {
+        if (tx_file_sent_ < tx_file_.length)
+          write_file_data
+            (std::integral_constant<bool, SocketAdaptor::SEND_FILE>());
+        else
+        {
+          size_t const bytes_transferred(static_cast<size_t>(tx_file_sent_));
+          tx_file_ = file_segment();
+          write_handler(bytes_transferred);
+        }
+      }
+
+      /// @fn write_file_data(std::true_type)
+      /// Send data directly from the file to the socket adaptor, e.g. with
+      /// sendfile(2), so that it isn't copied through userspace.
+      /// Waits until the socket adaptor is writable before sending more.
+      void write_file_data(std::true_type)
+      {
+        boost::system::error_code error;
+        size_t const sent(SocketAdaptor::send_file
+            (tx_file_.file->native_handle(), tx_file_.offset + tx_file_sent_,
+             tx_file_.length - tx_file_sent_, error));
+        tx_file_sent_ += sent;
+        tx_progress_  += sent;
+        if (error && (error != boost::asio::error::would_block))
         {
-          // local copies for lambdas
+          clear_tx_queue();
+          signal_error(error);
+        }
+        else if (tx_file_sent_ < tx_file_.length)
+        {
+          // local copy for lambdas
           weak_pointer weak_ptr(weak_from_this());
-          std::shared_ptr<std::deque<Container> > tx_queue(tx_queue_);
 #ifdef _MSC_VER
 #pragma warning( push )
 #pragma warning( disable : 4127 ) // conditional expression is constant
@@ -123,25 +357,176 @@ namespace via
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
-            SocketAdaptor::write(tx_buffers_,
-               strand_.wrap([weak_ptr, tx_queue]
-                            (boost::system::error_code const& error,
-                             size_t bytes_transferred)
-            { write_callback(weak_ptr, error, bytes_transferred, tx_queue); }));
+            SocketAdaptor::wait_writable(
+                strand_.wrap([weak_ptr](boost::system::error_code const& error,
+                                        size_t) // bytes_transferred
+             { write_file_callback(weak_ptr, error, 0); }));
           else
-            SocketAdaptor::write(tx_buffers_,
-              [weak_ptr, tx_queue](boost::system::error_code const& error,
-                                   size_t bytes_transferred)
-            { write_callback(weak_ptr, error, bytes_transferred, tx_queue); });
+            SocketAdaptor::wait_writable(
+              [weak_ptr](boost::system::error_code const& error,
+                         size_t) // bytes_transferred
+             { write_file_callback(weak_ptr, error, 0); });
         }
+        else
+          write_file_data();
+      }
 
-        return connected_;
+      /// @fn write_file_data(std::false_type)
+      /// Read data from the file into a buffer, up to max_tx_bytes_ bytes,
+      /// and write it via the socket adaptor, e.g. for ssl sockets.
+      void write_file_data(std::false_type)
+      {
+        size_t const size(static_cast<size_t>(std::min<std::uint64_t>
+            (tx_file_.length - tx_file_sent_, std::max<size_t>(max_tx_bytes_, 1))));
+        std::shared_ptr<Container> tx_file_buffer(new Container(size, '\0'));
+
+        boost::system::error_code error;
+        size_t const bytes(tx_file_.file->read(&(*tx_file_buffer)[0], size,
+                             tx_file_.offset + tx_file_sent_, error));
+        if (!error && (bytes == 0)) // the file is shorter than the segment
+          error = boost::asio::error::eof;
+        if (error)
+        {
+          clear_tx_queue();
+          signal_error(error);
+          return;
+        }
+
+        tx_buffers_.clear();
+        tx_buffers_.push_back(boost::asio::buffer(&(*tx_file_buffer)[0], bytes));
+
+        // local copies for lambdas
+        weak_pointer weak_ptr(weak_from_this());
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          SocketAdaptor::write(tx_buffers_,
+             strand_.wrap([weak_ptr, tx_file_buffer]
+                          (boost::system::error_code const& error,
+                           size_t bytes_transferred)
+          { write_file_callback(weak_ptr, error, bytes_transferred); }));
+        else
+          SocketAdaptor::write(tx_buffers_,
+            [weak_ptr, tx_file_buffer](boost::system::error_code const& error,
+                                       size_t bytes_transferred)
+          { write_file_callback(weak_ptr, error, bytes_transferred); });
+      }
+
+      /// @fn schedule_write
+      /// Schedule a write of the transmit queue, if one isn't in progress.
+      /// The write is posted to the io_service so that all of the data
+      /// queued by the current handler is sent in a single write.
+      void schedule_write()
+      {
+        if (transmitting_ || write_scheduled_ || !connected_ ||
+            tx_pending_.empty())
+          return;
+
+        write_scheduled_ = true;
+        weak_pointer weak_ptr(weak_from_this());
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          strand_.post([weak_ptr]{ scheduled_write_callback(weak_ptr); });
+        else
+          io_service_.post([weak_ptr]{ scheduled_write_callback(weak_ptr); });
+      }
+
+      /// @fn scheduled_write_callback
+      /// The function called to write the transmit queue after a write has
+      /// been scheduled. It ensures that the connection still exists.
+      /// @param ptr a weak pointer to the connection
+      static void scheduled_write_callback(weak_pointer ptr)
+      {
+        shared_pointer pointer(ptr.lock());
+        if (pointer)
+        {
+          pointer->write_scheduled_ = false;
+          pointer->write_data();
+        }
+      }
+
+      /// @fn clear_tx_queue
+      /// Discard all of the data in the transmit queue.
+      void clear_tx_queue()
+      {
+        tx_pending_.clear();
+        tx_queue_->clear();
+        tx_owners_->clear();
+        tx_file_ = file_segment();
+        tx_packets_sending_ = 0;
+        transmitting_ = false;
+      }
+
+      /// @fn acquire_rx_buffer
+      /// Borrow a receive buffer from the pool, if one isn't already held.
+      void acquire_rx_buffer()
+      {
+        if (rx_buffer_)
+          rx_buffer_->resize(rx_buffer_size_);
+        else
+          rx_buffer_ = rx_buffer_pool_->acquire(rx_buffer_size_);
+      }
+
+      /// @fn release_rx_buffer
+      /// Return the receive buffer (if any) to the pool.
+      void release_rx_buffer()
+      {
+        if (rx_buffer_)
+        {
+          rx_buffer_pool_->release(rx_buffer_);
+          rx_buffer_.reset();
+        }
       }
 
       /// @fn read_data
       /// Read data via the socket adaptor.
+      /// Calls the overload selected by SocketAdaptor::WAIT_READABLE.
       void read_data()
+      { read_data(std::integral_constant<bool, SocketAdaptor::WAIT_READABLE>()); }
+
+      /// @fn read_data(std::true_type)
+      /// Wait for the socket adaptor to become readable before borrowing
+      /// a receive buffer, so that an idle connection doesn't hold one.
+      void read_data(std::true_type)
       {
+        // local copy for lambdas
+        weak_pointer weak_ptr(weak_from_this());
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          SocketAdaptor::wait_readable(
+              strand_.wrap([weak_ptr](boost::system::error_code const& error,
+                                      size_t) // bytes_transferred
+           { readable_callback(weak_ptr, error); }));
+        else
+          SocketAdaptor::wait_readable(
+            [weak_ptr](boost::system::error_code const& error,
+                       size_t) // bytes_transferred
+           { readable_callback(weak_ptr, error); });
+      }
+
+      /// @fn read_data(std::false_type)
+      /// Borrow a receive buffer and read data into it via the socket adaptor.
+      void read_data(std::false_type)
+      {
+        acquire_rx_buffer();
+
         // local copies for lambdas
         weak_pointer weak_ptr(weak_from_this());
         std::shared_ptr<Container> rx_buffer(rx_buffer_);
@@ -229,7 +614,60 @@ namespace via
           if (error)
             pointer->signal_error(error);
           else
+          {
+            count_transfer(metrics().reads, metrics().bytes_received,
+                           bytes_transferred);
             pointer->read_handler(bytes_transferred);
+          }
+        }
+      }
+
+      /// @fn readable_callback
+      /// The function called whenever a socket adaptor has data to read.
+      /// It ensures that the connection still exists and the event is valid.
+      /// If there was an error it calls the connection's signal_error
+      /// function, otherwise it calls the connection's readable_handler.
+      /// @param ptr a weak pointer to the connection
+      /// @param error the boost asio error (if any).
+      static void readable_callback(weak_pointer ptr,
+                                    boost::system::error_code const& error)
+      {
+        shared_pointer pointer(ptr.lock());
+        if (pointer && (boost::asio::error::operation_aborted != error))
+        {
+          if (error)
+            pointer->signal_error(error);
+          else
+            pointer->readable_handler();
+        }
+      }
+
+      /// @fn readable_handler
+      /// The function called whenever the socket adaptor has data to read.
+      /// It borrows a receive buffer and reads the available data into it.
+      /// If no data could be read, it returns the buffer and waits again.
+      void readable_handler()
+      {
+        acquire_rx_buffer();
+        boost::system::error_code error;
+        size_t bytes_transferred(SocketAdaptor::read_available
+                                 (&(*rx_buffer_)[0], rx_buffer_->size(), error));
+        if ((boost::asio::error::would_block == error) ||
+            (boost::asio::error::try_again == error))
+        {
+          release_rx_buffer();
+          read_data(std::true_type());
+        }
+        else if (error)
+        {
+          release_rx_buffer();
+          signal_error(error);
+        }
+        else
+        {
+          count_transfer(metrics().reads, metrics().bytes_received,
+                         bytes_transferred);
+          read_handler(bytes_transferred);
         }
       }
 
@@ -237,14 +675,34 @@ namespace via
       /// The function called whenever a data packet has been received.
       /// It resizes the receive buffer to the size of the received packet,
       /// signals that a packet has been received and then calls
-      /// enable_reception to listen for the next packet.
+      /// enable_reception to listen for the next packet, unless reception
+      /// was paused by the event handler.
       /// @param bytes_transferred the size of the received data packet.
       void read_handler(size_t bytes_transferred)
       {
         receiving_ = false;
         rx_buffer_->resize(bytes_transferred);
         event_callback_(RECEIVED, weak_from_this());
-        enable_reception();
+        if (!reception_paused_)
+          enable_reception();
+      }
+
+      /// @fn resume_callback
+      /// The function called after reception has been resumed.
+      /// If the receive buffer was kept when reception was paused, it
+      /// signals that it has been received again, otherwise it calls
+      /// enable_reception to listen for the next packet.
+      /// @param ptr a weak pointer to the connection
+      static void resume_callback(weak_pointer ptr)
+      {
+        shared_pointer pointer(ptr.lock());
+        if (pointer && !pointer->reception_paused_)
+        {
+          if (pointer->rx_buffer_ && !pointer->receiving_)
+            pointer->read_handler(pointer->rx_buffer_->size());
+          else
+            pointer->enable_reception();
+        }
       }
 
       /// @fn write_callback
@@ -267,36 +725,71 @@ namespace via
         {
           if (error)
           {
-            pointer->tx_queue_->clear();
+            pointer->clear_tx_queue();
             pointer->signal_error(error);
           }
           else
           {
-            if (pointer->disconnect_pending_)
-              pointer->shutdown();
-            else
-              pointer->write_handler(bytes_transferred);
+            pointer->tx_progress_ += bytes_transferred;
+            pointer->write_handler(bytes_transferred);
+          }
+        }
+      }
+
+      /// @fn write_file_callback
+      /// The function called whenever a socket adaptor has sent part of a
+      /// file segment or become writable.
+      /// It ensures that the connection still exists and the event is valid.
+      /// If there was an error it calls the connection's signal_error
+      /// function, otherwise it continues sending the file segment.
+      /// @param ptr a weak pointer to the connection
+      /// @param error the boost asio error (if any).
+      /// @param bytes_transferred the number of bytes of the file sent.
+      static void write_file_callback(weak_pointer ptr,
+                                      boost::system::error_code const& error,
+                                      size_t bytes_transferred)
+      {
+        shared_pointer pointer(ptr.lock());
+        if (pointer && (boost::asio::error::operation_aborted != error) &&
+            pointer->tx_file_.file)
+        {
+          if (error)
+          {
+            pointer->clear_tx_queue();
+            pointer->signal_error(error);
+          }
+          else
+          {
+            pointer->tx_file_sent_ += bytes_transferred;
+            pointer->tx_progress_  += bytes_transferred;
+            pointer->write_file_data();
           }
         }
       }
 
       /// @fn write_handler
-      /// The function called whenever a data packet has been sent.
-      /// It removes the data packet at the front of the transmit queue, sends
-      /// the next packet in the queue (if any) and signals that that a packet
-      /// has been sent.
-      /// @param bytes_transferred the size of the sent data packet.
-      void write_handler(size_t) // bytes_transferred
+      /// The function called whenever a write has completed.
+      /// It removes the sent packets from the front of the transmit queue
+      /// and writes the data that was queued during the write (if any).
+      /// If the queue is empty and a disconnect is pending it shuts down
+      /// the socket, otherwise it signals that the data has been sent.
+      /// @param bytes_transferred the size of the sent data.
+      void write_handler(size_t bytes_transferred)
       {
-        if (!transmitting_ && !tx_queue_->empty())
+        count_transfer(metrics().writes, metrics().bytes_sent,
+                       bytes_transferred);
+        for (; tx_packets_sending_ > 0; --tx_packets_sending_)
           tx_queue_->pop_front();
-
+        tx_owners_->clear();
         transmitting_ = false;
 
-        if (!tx_queue_->empty())
-          write_data(ConstBuffers(1, boost::asio::buffer(tx_queue_->front())));
-
-        event_callback_(SENT, weak_from_this());
+        if (!write_data() && disconnect_pending_)
+        {
+          disconnect_pending_ = false;
+          shutdown();
+        }
+        else
+          event_callback_(SENT, weak_from_this());
       }
 
       /// @fn handshake_callback
@@ -318,9 +811,7 @@ namespace via
           {
             pointer->connected_ = true;
             pointer->set_socket_options();
-            if (!pointer->tx_queue_->empty())
-              pointer->write_data
-          (ConstBuffers(1, boost::asio::buffer(pointer->tx_queue_->front())));
+            pointer->write_data();
             pointer->receiving_ = false;
             pointer->enable_reception();
             pointer->event_callback_(CONNECTED, ptr);
@@ -380,16 +871,33 @@ namespace via
       /// @param event_callback the event callback function.
       /// @param error_callback the error callback function.
       /// @param rx_buffer_size the size of the receive_buffer.
+      /// @param rx_buffer_pool the pool to borrow receive buffers from,
+      /// if null the connection creates its own pool.
+      /// @param context the SocketAdaptor's context,
+      /// if null the SocketAdaptor uses its default context.
       explicit connection(boost::asio::io_service& io_service,
                           event_callback_type event_callback,
                           error_callback_type error_callback,
-                          size_t rx_buffer_size) :
-        SocketAdaptor(io_service),
+                          size_t rx_buffer_size,
+                          rx_buffer_pool_pointer rx_buffer_pool,
+                          context_pointer context) :
+        SocketAdaptor(io_service, context),
+        io_service_(io_service),
         strand_(io_service),
         rx_buffer_size_(rx_buffer_size),
-        rx_buffer_(new Container(rx_buffer_size_, 0)),
+        rx_buffer_pool_(rx_buffer_pool ? rx_buffer_pool
+                                       : std::make_shared<RxBufferPool>()),
+        rx_buffer_(),
         tx_queue_(new std::deque<Container>()),
+        tx_pending_(),
         tx_buffers_(),
+        tx_packets_sending_(0),
+        tx_owners_(new std::vector<std::shared_ptr<void const> >()),
+        max_tx_buffers_(DEFAULT_MAX_TX_BUFFERS),
+        max_tx_bytes_(DEFAULT_MAX_TX_BYTES),
+        tx_file_(),
+        tx_file_sent_(0),
+        tx_progress_(0),
         event_callback_(event_callback),
         error_callback_(error_callback),
         timeout_(0),
@@ -397,10 +905,13 @@ namespace via
         send_buffer_size_(0),
         receiving_(false),
         transmitting_(false),
+        write_scheduled_(false),
         no_delay_(false),
         keep_alive_(false),
         connected_(false),
-        disconnect_pending_(false)
+        disconnect_pending_(false),
+        reception_paused_(false),
+        handle_()
       {}
 
       /// Constructor for client connections.
@@ -410,14 +921,27 @@ namespace via
       /// @param io_service the boost asio io_service used by the underlying
       /// socket adaptor.
       /// @param rx_buffer_size the size of the receive_buffer.
+      /// @param context the SocketAdaptor's context,
+      /// if null the SocketAdaptor uses its default context.
       explicit connection(boost::asio::io_service& io_service,
-                          size_t rx_buffer_size) :
-        SocketAdaptor(io_service),
+                          size_t rx_buffer_size,
+                          context_pointer context) :
+        SocketAdaptor(io_service, context),
+        io_service_(io_service),
         strand_(io_service),
         rx_buffer_size_(rx_buffer_size),
-        rx_buffer_(new Container(rx_buffer_size_, 0)),
+        rx_buffer_pool_(std::make_shared<RxBufferPool>()),
+        rx_buffer_(),
         tx_queue_(new std::deque<Container>()),
+        tx_pending_(),
         tx_buffers_(),
+        tx_packets_sending_(0),
+        tx_owners_(new std::vector<std::shared_ptr<void const> >()),
+        max_tx_buffers_(DEFAULT_MAX_TX_BUFFERS),
+        max_tx_bytes_(DEFAULT_MAX_TX_BYTES),
+        tx_file_(),
+        tx_file_sent_(0),
+        tx_progress_(0),
         event_callback_(),
         error_callback_(),
         timeout_(0),
@@ -425,10 +949,13 @@ namespace via
         send_buffer_size_(0),
         receiving_(false),
         transmitting_(false),
+        write_scheduled_(false),
         no_delay_(false),
         keep_alive_(false),
         connected_(false),
-        disconnect_pending_(false)
+        disconnect_pending_(false),
+        reception_paused_(false),
+        handle_()
       {}
 
       /// Set the socket's tcp no delay status.
@@ -533,22 +1060,35 @@ namespace via
       /// @param error_callback the error callback function.
       /// @param rx_buffer_size the size of the receive_buffer,
       /// default SocketAdaptor::DEFAULT_RX_BUFFER_SIZE.
+      /// @param rx_buffer_pool the pool to borrow receive buffers from,
+      /// default null: the connection creates its own pool.
+      /// @param context the SocketAdaptor's context, e.g. an SSL context,
+      /// default null: the SocketAdaptor's default context.
       static shared_pointer create(boost::asio::io_service& io_service,
                                    event_callback_type event_callback,
                                    error_callback_type error_callback,
-               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE)
+               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE,
+               rx_buffer_pool_pointer rx_buffer_pool = rx_buffer_pool_pointer(),
+               context_pointer context = context_pointer())
       {
         return shared_pointer(new connection(io_service, event_callback,
-                                             error_callback, rx_buffer_size));
+                                             error_callback, rx_buffer_size,
+                                             rx_buffer_pool, context));
       }
 
       /// The factory function to create client connections.
       /// @param io_service the boost asio io_service for the socket adaptor.
       /// @param rx_buffer_size the size of the receive_buffer,
       /// default SocketAdaptor::DEFAULT_RX_BUFFER_SIZE.
+      /// @param context the SocketAdaptor's context, e.g. an SSL context,
+      /// default null: the SocketAdaptor's default context.
       static shared_pointer create(boost::asio::io_service& io_service,
-               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE)
-      { return shared_pointer(new connection(io_service, rx_buffer_size)); }
+               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE,
+               context_pointer context = context_pointer())
+      {
+        return shared_pointer(new connection(io_service, rx_buffer_size,
+                                             context));
+      }
 
       /// @fn set_event_callback
       /// Function to set the event callback function.
@@ -570,6 +1110,17 @@ namespace via
       void set_rx_buffer_size(size_t rx_buffer_size)
       { rx_buffer_size_ = rx_buffer_size; }
 
+      /// Set the maximum number of buffers to send in a single write.
+      /// @param max_tx_buffers the maximum number of buffers.
+      void set_max_tx_buffers(size_t max_tx_buffers) NOEXCEPT
+      { max_tx_buffers_ = max_tx_buffers; }
+
+      /// Set the maximum number of bytes to send in a single write.
+      /// Note: a buffer larger than this is sent in a write on its own.
+      /// @param max_tx_bytes the maximum number of bytes.
+      void set_max_tx_bytes(size_t max_tx_bytes) NOEXCEPT
+      { max_tx_bytes_ = max_tx_bytes; }
+
       /// @fn connect
       /// Connect the underlying socket adaptor to the given host name and
       /// port.
@@ -615,7 +1166,7 @@ namespace via
       void disconnect()
       {
         // If nothing is currently being sent
-        if (!transmitting_ && tx_queue_->empty())
+        if (!transmitting_ && tx_pending_.empty())
           shutdown();
         else // shutdown the socekt in the write callback
           disconnect_pending_ = true;
@@ -642,18 +1193,92 @@ namespace via
       { SocketAdaptor::close(); }
 
       /// @fn enable_reception
-      /// This function prepares the receive buffer and calls the
+      /// This function returns the receive buffer to the pool and calls the
       /// socket adaptor read function to listen for the next data packet.
+      /// A receive buffer is borrowed from the pool when data is read.
       void enable_reception()
       {
         if (!receiving_)
         {
           receiving_ = true;
-          rx_buffer_->resize(rx_buffer_size_);
+          release_rx_buffer();
           read_data();
         }
       }
 
+      /// @fn pause_reception
+      /// Stop reading from the socket, e.g. while the application processes
+      /// the data that it has received. If it's called by the RECEIVED
+      /// event handler, the receive buffer is kept until reception is
+      /// resumed.
+      void pause_reception() NOEXCEPT
+      { reception_paused_ = true; }
+
+      /// @fn resume_reception
+      /// Resume reading from the socket after pause_reception.
+      /// If the receive buffer was kept when reception was paused, the
+      /// RECEIVED event is signalled again with the same buffer (so that
+      /// the application can process the data it didn't consume) before the
+      /// next packet is read.
+      /// The event is posted, so it's not signalled within this call.
+      void resume_reception()
+      {
+        if (!reception_paused_)
+          return;
+
+        reception_paused_ = false;
+        weak_pointer weak_ptr(weak_from_this());
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          strand_.post([weak_ptr]{ resume_callback(weak_ptr); });
+        else
+          io_service_.post([weak_ptr]{ resume_callback(weak_ptr); });
+      }
+
+      /// Dispatch a handler to the connection's io_service, e.g. to
+      /// send data from another thread.
+      /// The handler is called within this function if the calling thread
+      /// is running the io_service (and it's in the connection's strand if
+      /// use_strand), otherwise it's posted to the io_service.
+      /// @param handler the handler to call.
+      template <typename Handler>
+      void dispatch(Handler handler)
+      {
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable : 4127 ) // conditional expression is constant
+#endif
+        if (use_strand)
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+          strand_.dispatch(std::move(handler));
+        else
+          io_service_.dispatch(std::move(handler));
+      }
+
+      /// Accessor for the reception_paused_ flag.
+      /// @return true if reception has been paused, false otherwise.
+      bool reception_paused() const NOEXCEPT
+      { return reception_paused_; }
+
+      /// Whether data is being sent or is waiting to be sent.
+      /// @return true if the transmit queue isn't empty, false otherwise.
+      bool is_transmitting() const NOEXCEPT
+      { return transmitting_ || !tx_pending_.empty(); }
+
+      /// The number of bytes sent by the connection, including the parts
+      /// of file segments, e.g. to detect that a long write is progressing.
+      /// @return the number of bytes sent.
+      std::uint64_t tx_progress() const NOEXCEPT
+      { return tx_progress_; }
+
       /// Accessor for the receive buffer.
       /// Swaps the contents of the receive buffer with the rx_buffer parameter
       /// and re-enables the receiver.
@@ -664,10 +1289,30 @@ namespace via
       /// @retval the receive buffer.
       void read_rx_buffer(Container& rx_buffer)
       {
-        rx_buffer_->swap(rx_buffer);
+        if (rx_buffer_)
+          rx_buffer_->swap(rx_buffer);
+        else
+          rx_buffer.clear();
         enable_reception();
       }
 
+      /// Accessor for the receive buffer.
+      /// Unlike read_rx_buffer, it does not copy or swap the data, the
+      /// receive buffer is returned to the pool after the receive event
+      /// callback function returns.
+      /// @pre Only valid within the receive event callback function.
+      /// @return the receive buffer.
+      Container const& rx_buffer() const
+      {
+        static const Container EMPTY_BUFFER;
+        return rx_buffer_ ? *rx_buffer_ : EMPTY_BUFFER;
+      }
+
+      /// Accessor for the receive buffer pool.
+      /// @return a shared pointer to the receive buffer pool.
+      rx_buffer_pool_pointer rx_buffer_pool() const
+      { return rx_buffer_pool_; }
+
       /// @fn connected
       /// Accessor for the connected_ flag.
       bool connected() const NOEXCEPT
@@ -677,32 +1322,111 @@ namespace via
       void set_connected(bool enable) NOEXCEPT
       { connected_ = enable; }
 
+      /// Accessor for the handle of the connection in its server.
+      /// @return the handle, invalid for client connections.
+      slot_handle const& handle() const NOEXCEPT
+      { return handle_; }
+
+      /// Set the handle of the connection in its server.
+      /// @param handle the handle.
+      void set_handle(slot_handle const& handle) NOEXCEPT
+      { handle_ = handle; }
+
       /// @fn send_data(Container const& packet)
       /// Send a packet of data.
-      /// The packet is added to the back of the transmit queue and sent if
-      /// the queue was empty.
+      /// The packet is added to the back of the transmit queue. All of the
+      /// data in the queue is sent in a single write after the current
+      /// handler returns or the current write completes.
       /// @param packet the data packet to write.
       void send_data(Container packet)
       {
-        bool was_empty(tx_queue_->empty());
-        tx_queue_->push_back(std::move(packet));
+        if (packet.empty())
+          return;
 
-        if (!transmitting_ && was_empty)
-          write_data(ConstBuffers(1, boost::asio::buffer(tx_queue_->front())));
+        tx_queue_->push_back(std::move(packet));
+        tx_buffer next = { boost::asio::buffer(tx_queue_->back()), true,
+                           file_segment(), std::shared_ptr<void const>() };
+        tx_pending_.push_back(std::move(next));
+        schedule_write();
       }
 
       /// Send the data in the buffers.
+      /// The buffers are added to the back of the transmit queue, in the
+      /// same way as send_data(Container packet).
+      /// @pre The contents of the buffers are NOT buffered.
+      /// Their lifetime MUST exceed that of the write.
       /// @param buffers the data to write.
-      /// @return true if the buffers are being sent, false otherwise.
+      /// @return true if connected, false otherwise.
       bool send_data(ConstBuffers buffers)
       {
-        if (!transmitting_ && tx_queue_->empty())
+        for (auto const& buffer : buffers)
         {
-          transmitting_ = write_data(std::move(buffers));
-          return transmitting_;
+          if (boost::asio::buffer_size(buffer) > 0)
+          {
+            tx_buffer next = { buffer, false, file_segment(),
+                               std::shared_ptr<void const>() };
+            tx_pending_.push_back(std::move(next));
+          }
         }
-        else
-          return false;
+        schedule_write();
+        return connected_;
+      }
+
+      /// Send the data in a buffer.
+      /// The buffer is added to the back of the transmit queue, in the
+      /// same way as send_data(Container packet).
+      /// @pre The contents of the buffer are NOT buffered.
+      /// Their lifetime MUST exceed that of the write.
+      /// @param buffer the data to write.
+      /// @return true if connected, false otherwise.
+      bool send_data(boost::asio::const_buffer buffer)
+      {
+        if (boost::asio::buffer_size(buffer) > 0)
+        {
+          tx_buffer next = { buffer, false, file_segment(),
+                             std::shared_ptr<void const>() };
+          tx_pending_.push_back(std::move(next));
+          schedule_write();
+        }
+        return connected_;
+      }
+
+      /// Send a segment of a file.
+      /// The segment is added to the back of the transmit queue, in the
+      /// same way as send_data(Container packet). If the SocketAdaptor
+      /// supports SEND_FILE, it's sent directly from the file to the socket,
+      /// e.g. with sendfile(2), otherwise it's read and written in buffers
+      /// of up to max_tx_bytes_ bytes.
+      /// @param file the file segment to write.
+      /// @return true if connected, false otherwise.
+      bool send_data(file_segment file)
+      {
+        if (file.file && (file.length > 0))
+        {
+          tx_buffer next = { boost::asio::const_buffer(), false,
+                             std::move(file), std::shared_ptr<void const>() };
+          tx_pending_.push_back(std::move(next));
+          schedule_write();
+        }
+        return connected_;
+      }
+
+      /// Send the data in a shared_buffer.
+      /// The buffer is added to the back of the transmit queue, in the
+      /// same way as send_data(Container packet), but the data is not
+      /// copied: the connection shares its ownership until it's been sent.
+      /// @param buffer the data to write.
+      /// @return true if connected, false otherwise.
+      bool send_data(shared_buffer buffer)
+      {
+        if (!buffer.empty())
+        {
+          tx_buffer next = { buffer.buffer(), false, file_segment(),
+                             buffer.owner() };
+          tx_pending_.push_back(std::move(next));
+          schedule_write();
+        }
+        return connected_;
       }
 
       /// @fn set_no_delay
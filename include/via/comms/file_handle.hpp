@@ -0,0 +1,374 @@
+#ifndef FILE_HANDLE_HPP_VIA_HTTPLIB_
+#define FILE_HANDLE_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file file_handle.hpp
+/// @brief Contains the file_handle and file_cache classes.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <boost/system/error_code.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class file_handle
+    /// An open, read only, file descriptor. The file is closed when the
+    /// last shared pointer to its file_handle is released.
+    /// Its identity, size and modification time are read when it's opened.
+    /// @see file_segment
+    /// @see file_cache
+    //////////////////////////////////////////////////////////////////////////
+    class file_handle
+    {
+      int fd_;                     ///< The file descriptor.
+      std::uint64_t device_;       ///< The device containing the file.
+      std::uint64_t inode_;        ///< The inode of the file.
+      std::uint64_t size_;         ///< The size of the file.
+      std::time_t last_modified_;  ///< The time the file was last modified.
+
+      /// Constructor.
+      /// @param fd the file descriptor.
+      /// @param device the device containing the file.
+      /// @param inode the inode of the file.
+      /// @param size the size of the file.
+      /// @param last_modified the time the file was last modified.
+      file_handle(int fd, std::uint64_t device, std::uint64_t inode,
+                  std::uint64_t size, std::time_t last_modified) :
+        fd_(fd),
+        device_(device),
+        inode_(inode),
+        size_(size),
+        last_modified_(last_modified)
+      {}
+
+      file_handle(file_handle const&) = delete;
+      file_handle& operator=(file_handle const&) = delete;
+
+    public:
+
+      /// Open a regular file for reading.
+      /// @param path the path of the file.
+      /// @retval error the error, if the file could not be opened or it's
+      /// not a regular file.
+      /// @return a shared pointer to the file_handle, nullptr on error.
+      static std::shared_ptr<file_handle> open(std::string const& path,
+                                               boost::system::error_code& error)
+      {
+        error = boost::system::error_code();
+#ifdef _WIN32
+        int const fd(::_open(path.c_str(), _O_RDONLY | _O_BINARY));
+        struct ::_stat64 status;
+        if ((fd < 0) || (::_fstat64(fd, &status) != 0))
+#else
+        int const fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        struct ::stat status;
+        if ((fd < 0) || (::fstat(fd, &status) != 0))
+#endif
+          error = boost::system::error_code(errno,
+                                            boost::system::system_category());
+        else if ((status.st_mode & S_IFMT) == S_IFDIR)
+          error = boost::system::errc::make_error_code
+                    (boost::system::errc::is_a_directory);
+        else if ((status.st_mode & S_IFMT) != S_IFREG)
+          error = boost::system::errc::make_error_code
+                    (boost::system::errc::permission_denied);
+        else
+          return std::shared_ptr<file_handle>(new file_handle(fd,
+                     static_cast<std::uint64_t>(status.st_dev),
+                     static_cast<std::uint64_t>(status.st_ino),
+                     static_cast<std::uint64_t>(status.st_size),
+                     static_cast<std::time_t>(status.st_mtime)));
+
+        if (fd >= 0)
+#ifdef _WIN32
+          ::_close(fd);
+#else
+          ::close(fd);
+#endif
+        return std::shared_ptr<file_handle>();
+      }
+
+      /// The destructor closes the file.
+      ~file_handle()
+      {
+#ifdef _WIN32
+        ::_close(fd_);
+#else
+        ::close(fd_);
+#endif
+      }
+
+      /// Accessor for the file descriptor.
+      int native_handle() const NOEXCEPT
+      { return fd_; }
+
+      /// Accessor for the device containing the file.
+      std::uint64_t device() const NOEXCEPT
+      { return device_; }
+
+      /// Accessor for the inode of the file.
+      /// With the device, it identifies the file.
+      std::uint64_t inode() const NOEXCEPT
+      { return inode_; }
+
+      /// Accessor for the size of the file when it was opened.
+      std::uint64_t size() const NOEXCEPT
+      { return size_; }
+
+      /// Accessor for the time that the file was last modified when it was
+      /// opened.
+      std::time_t last_modified() const NOEXCEPT
+      { return last_modified_; }
+
+      /// Read data from the file at the given position.
+      /// It doesn't change the file position, so it may be called
+      /// concurrently by connections sharing the file.
+      /// @param ptr pointer to the buffer to read into.
+      /// @param size the size of the buffer.
+      /// @param offset the position in the file to read from.
+      /// @retval error the error, if any.
+      /// @return the number of bytes read, zero at the end of the file.
+      size_t read(void* ptr, size_t size, std::uint64_t offset,
+                  boost::system::error_code& error) const
+      {
+        error = boost::system::error_code();
+#ifdef _WIN32
+        OVERLAPPED overlapped = OVERLAPPED();
+        overlapped.Offset     = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD bytes(0);
+        if (!::ReadFile(reinterpret_cast<HANDLE>(::_get_osfhandle(fd_)), ptr,
+                        static_cast<DWORD>(size), &bytes, &overlapped) &&
+            (::GetLastError() != ERROR_HANDLE_EOF))
+          error = boost::system::error_code(::GetLastError(),
+                                            boost::system::system_category());
+        return bytes;
+#else
+        ssize_t result(0);
+        do
+          result = ::pread(fd_, ptr, size, static_cast<off_t>(offset));
+        while ((result < 0) && (errno == EINTR));
+
+        if (result < 0)
+        {
+          error = boost::system::error_code(errno,
+                                            boost::system::system_category());
+          return 0;
+        }
+        return static_cast<size_t>(result);
+#endif
+      }
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @struct file_segment
+    /// A segment of a file to transmit.
+    /// The shared pointer keeps the file open until the segment is sent.
+    //////////////////////////////////////////////////////////////////////////
+    struct file_segment
+    {
+      std::shared_ptr<file_handle const> file; ///< The file, nullptr if none.
+      std::uint64_t offset; ///< The position of the segment in the file.
+      std::uint64_t length; ///< The length of the segment.
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class file_cache
+    /// A cache of open files, keyed by their paths, so that frequently
+    /// served files are not opened and closed for every request.
+    /// A cached file is revalidated with stat(2) at most once per
+    /// revalidation interval and reopened if it has been replaced or
+    /// modified. The least recently used file is closed when the cache is
+    /// full, however it remains open while a file_segment refers to it.
+    /// The class is thread safe, so that it may be shared by connections
+    /// running in a thread pool.
+    /// @see file_handle
+    //////////////////////////////////////////////////////////////////////////
+    class file_cache
+    {
+    public:
+
+      /// The default maximum number of open files in the cache.
+      static const size_t DEFAULT_MAX_FILES = 256;
+
+      /// The default revalidation interval, in milliseconds.
+      static const long DEFAULT_REVALIDATE_INTERVAL = 1000;
+
+    private:
+
+      typedef std::chrono::steady_clock clock_type;
+
+      /// A cached file.
+      struct entry
+      {
+        std::shared_ptr<file_handle const> file; ///< The open file.
+        clock_type::time_point checked; ///< When the file was last checked.
+        std::list<std::string>::iterator lru; ///< Position in lru_.
+      };
+
+      /// The cached files, keyed by path.
+      std::map<std::string, entry> files_;
+      /// The paths of the cached files, most recently used first.
+      std::list<std::string> lru_;
+      size_t max_files_; ///< The maximum number of open files.
+      /// The revalidation interval.
+      std::chrono::milliseconds revalidate_interval_;
+      /// Mutex to protect the files.
+      mutable std::mutex mutex_;
+
+      file_cache(file_cache const&) = delete;
+      file_cache& operator=(file_cache const&) = delete;
+
+      /// Whether the file at a path is the same as an open file.
+      /// @param path the path of the file.
+      /// @param file the open file.
+      /// @return true if the file has not been replaced or modified.
+      static bool is_unchanged(std::string const& path,
+                               file_handle const& file)
+      {
+#ifdef _WIN32
+        struct ::_stat64 path_status;
+        if (::_stat64(path.c_str(), &path_status) != 0)
+#else
+        struct ::stat path_status;
+        if (::stat(path.c_str(), &path_status) != 0)
+#endif
+          return false;
+
+        return (static_cast<std::uint64_t>(path_status.st_dev) ==
+                  file.device()) &&
+               (static_cast<std::uint64_t>(path_status.st_ino) ==
+                  file.inode()) &&
+               (static_cast<std::uint64_t>(path_status.st_size) == file.size()) &&
+               (static_cast<std::time_t>(path_status.st_mtime) ==
+                  file.last_modified());
+      }
+
+      /// Remove a cached file.
+      /// @param iter the file's position in files_.
+      void erase(std::map<std::string, entry>::iterator iter)
+      {
+        lru_.erase(iter->second.lru);
+        files_.erase(iter);
+      }
+
+    public:
+
+      /// Constructor.
+      /// @param max_files the maximum number of open files,
+      /// default DEFAULT_MAX_FILES.
+      explicit file_cache(size_t max_files = DEFAULT_MAX_FILES) :
+        files_(),
+        lru_(),
+        max_files_(max_files),
+        revalidate_interval_(static_cast<long>(DEFAULT_REVALIDATE_INTERVAL)),
+        mutex_()
+      {}
+
+      /// Set the maximum number of open files in the cache.
+      /// Zero disables the cache.
+      /// @param max_files the maximum number of open files.
+      void set_max_files(size_t max_files)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_files_ = max_files;
+        while (files_.size() > max_files_)
+          erase(files_.find(lru_.back()));
+      }
+
+      /// Set the interval between checks that a cached file is unchanged.
+      /// @param milliseconds the revalidation interval, zero checks a
+      /// cached file every time that it's opened.
+      void set_revalidate_interval(long milliseconds)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        revalidate_interval_ = std::chrono::milliseconds(milliseconds);
+      }
+
+      /// Open a file, from the cache if possible.
+      /// @param path the path of the file.
+      /// @retval error the error, if the file could not be opened.
+      /// @return a shared pointer to the file, nullptr on error.
+      std::shared_ptr<file_handle const> open(std::string const& path,
+                                              boost::system::error_code& error)
+      {
+        error = boost::system::error_code();
+        clock_type::time_point const now(clock_type::now());
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, entry>::iterator iter(files_.find(path));
+        if (iter != files_.end())
+        {
+          // Only a successful check restarts the revalidation interval
+          entry& cached(iter->second);
+          bool const revalidate(now - cached.checked >= revalidate_interval_);
+          if (!revalidate || is_unchanged(path, *cached.file))
+          {
+            if (revalidate)
+              cached.checked = now;
+            lru_.splice(lru_.begin(), lru_, cached.lru);
+            return cached.file;
+          }
+          erase(iter);
+        }
+
+        std::shared_ptr<file_handle const> file(file_handle::open(path, error));
+        if (file && (max_files_ > 0))
+        {
+          if (files_.size() >= max_files_)
+            erase(files_.find(lru_.back()));
+
+          lru_.push_front(path);
+          entry const cached = { file, now, lru_.begin() };
+          files_.insert(std::make_pair(path, cached));
+        }
+        return file;
+      }
+
+      /// Close all of the cached files.
+      void clear()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.clear();
+        lru_.clear();
+      }
+
+      /// The number of open files in the cache.
+      size_t size() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_.size();
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef MULTI_REACTOR_SERVER_HPP_VIA_HTTPLIB_
+#define MULTI_REACTOR_SERVER_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file multi_reactor_server.hpp
+/// @brief The multi_reactor_server template class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class multi_reactor_server
+    /// A template class that runs a number of servers, each with its own
+    /// io_service (reactor), listening socket and set of connections.
+    /// The servers listen on the same port using SO_REUSEPORT, so the
+    /// operating system distributes the incoming connections between them.
+    /// Each io_service is run by a single thread, so a connection is pinned
+    /// to a thread and its handlers don't need an asio::strand.
+    /// Note: the handlers registered with the servers are called from
+    /// all of the threads, so any data that they share must be protected.
+    /// @see server
+    /// @see http_server
+    /// @param Server the type of server, e.g. http_server or comms::server.
+    /// It should be instantiated with use_strand false.
+    //////////////////////////////////////////////////////////////////////////
+    template <typename Server>
+    class multi_reactor_server
+    {
+    public:
+
+      /// The type of the servers.
+      typedef Server server_type;
+
+      /// A function to configure a server.
+      typedef std::function<void (server_type&)> server_function;
+
+    private:
+
+      /// The io_services, one per reactor.
+      std::vector<std::shared_ptr<boost::asio::io_service> > io_services_;
+
+      /// The servers, one per reactor.
+      std::vector<std::shared_ptr<server_type> > servers_;
+
+      /// The threads running the io_services, excluding the calling thread.
+      std::vector<std::shared_ptr<std::thread> > threads_;
+
+    public:
+
+      /// Copy constructor deleted to disable copying.
+      multi_reactor_server(multi_reactor_server const&) = delete;
+
+      /// Assignment operator deleted to disable copying.
+      multi_reactor_server& operator=(multi_reactor_server) = delete;
+
+      /// Constructor, creates the io_services and servers.
+      /// @param number_of_reactors the number of io_services and servers,
+      /// default (or zero) the number of concurrent threads supported.
+      explicit multi_reactor_server(size_t number_of_reactors = 0) :
+        io_services_(),
+        servers_(),
+        threads_()
+      {
+        if (number_of_reactors == 0)
+          number_of_reactors = std::thread::hardware_concurrency();
+        if (number_of_reactors == 0)
+          number_of_reactors = 1;
+
+        for (size_t i(0); i < number_of_reactors; ++i)
+        {
+          // Each io_service is only run by one thread.
+          std::shared_ptr<boost::asio::io_service> io_service
+              (std::make_shared<boost::asio::io_service>(1));
+          io_services_.push_back(io_service);
+          servers_.push_back(std::make_shared<server_type>(*io_service));
+        }
+      }
+
+      /// Destructor, waits for the threads to finish.
+      ~multi_reactor_server()
+      {
+        stop();
+        join();
+      }
+
+      /// The number of reactors.
+      /// @return the number of io_services and servers.
+      size_t size() const NOEXCEPT
+      { return servers_.size(); }
+
+      /// Accessor for a server.
+      /// @pre index < size()
+      /// @param index the index of the server.
+      /// @return a reference to the server.
+      server_type& server(size_t index)
+      { return *servers_[index]; }
+
+      /// Accessor for an io_service.
+      /// @pre index < size()
+      /// @param index the index of the io_service.
+      /// @return a reference to the io_service.
+      boost::asio::io_service& io_service(size_t index)
+      { return *io_services_[index]; }
+
+      /// Call a function on each of the servers, e.g. to register the
+      /// handlers and routes or to set the server options.
+      /// @pre the servers must not be running.
+      /// @param function the function to call.
+      void for_each(server_function function)
+      {
+        for (auto& server : servers_)
+          function(*server);
+      }
+
+      /// @fn accept_connections
+      /// Enable SO_REUSEPORT on each server and start accepting connections.
+      /// @param port the port number to serve.
+      /// @param ipv4_only whether an IPV4 only server is required.
+      /// @return the boost error code, false if no error occured
+      boost::system::error_code accept_connections(unsigned short port,
+                                                   bool ipv4_only = false)
+      {
+        boost::system::error_code ec;
+        for (auto& server : servers_)
+        {
+          server->set_reuse_port(true);
+          ec = server->accept_connections(port, ipv4_only);
+          if (ec)
+            break;
+        }
+        return ec;
+      }
+
+      /// @fn start
+      /// Run each io_service in its own thread.
+      void start()
+      {
+        for (auto& io_service : io_services_)
+        {
+          std::shared_ptr<boost::asio::io_service> service(io_service);
+          threads_.push_back(std::make_shared<std::thread>
+                               ([service](){ service->run(); }));
+        }
+      }
+
+      /// @fn run
+      /// Run the first io_service in the calling thread and the others in
+      /// their own threads. Returns when all of the io_services have
+      /// finished.
+      void run()
+      {
+        for (size_t i(1); i < io_services_.size(); ++i)
+        {
+          std::shared_ptr<boost::asio::io_service> service(io_services_[i]);
+          threads_.push_back(std::make_shared<std::thread>
+                               ([service](){ service->run(); }));
+        }
+
+        io_services_.front()->run();
+        join();
+      }
+
+      /// @fn join
+      /// Wait for the threads running the io_services to finish.
+      void join()
+      {
+        for (auto& thread : threads_)
+        {
+          if (thread->joinable())
+            thread->join();
+        }
+        threads_.clear();
+      }
+
+      /// @fn shutdown
+      /// Shutdown each server in its own thread.
+      /// @pre server_type has a shutdown function, e.g. http_server.
+      void shutdown()
+      {
+        for (size_t i(0); i < servers_.size(); ++i)
+        {
+          std::shared_ptr<server_type> server(servers_[i]);
+          io_services_[i]->post([server](){ server->shutdown(); });
+        }
+      }
+
+      /// @fn stop
+      /// Stop all of the io_services.
+      void stop()
+      {
+        for (auto& io_service : io_services_)
+          io_service->stop();
+      }
+    };
+  }
+}
+
+#endif
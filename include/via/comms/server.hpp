@@ -18,14 +18,27 @@
 #ifdef HTTP_SSL
   #include <boost/asio/ssl/context.hpp>
 #endif
-#include <set>
+#include "slot_map.hpp"
+#include "timer_wheel.hpp"
+#include "via/metrics.hpp"
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <vector>
 
 namespace via
 {
   namespace comms
   {
+    /// @enum timeout_type the timeouts that a server applies to its
+    /// connections.
+    enum timeout_type
+    {
+      IDLE_TIMEOUT,   ///< Nothing received, e.g. between requests.
+      HEADER_TIMEOUT, ///< A deadline to receive a whole message header.
+      BODY_TIMEOUT    ///< Nothing received while receiving a message body.
+    };
+
     //////////////////////////////////////////////////////////////////////////
     /// @class server
     /// A template class for implementing a tcp or ssl server using buffered
@@ -43,21 +56,42 @@ namespace via
     /// std::array<char, size>
     /// @param use_strand if true use an asio::strand to wrap the handlers,
     /// default false.
+    /// @param RxBufferPool the pool that the connections borrow receive
+    /// buffers from, default rx_buffer_pool<Container>.
     //////////////////////////////////////////////////////////////////////////
     template <typename SocketAdaptor, typename Container = std::vector<char>,
-              bool use_strand = false>
+              bool use_strand = false,
+              typename RxBufferPool = rx_buffer_pool<Container> >
     class server
     {
     public:
 
       /// The connection type used by this server.
-      typedef connection<SocketAdaptor, Container, use_strand> connection_type;
+      typedef connection<SocketAdaptor, Container, use_strand, RxBufferPool>
+                                                              connection_type;
 
-      /// A set of connections.
-      typedef std::set<std::shared_ptr<connection_type> > connections;
+      /// A shared pointer to the receive buffer pool.
+      typedef typename connection_type::rx_buffer_pool_pointer
+                                                       rx_buffer_pool_pointer;
+
+      /// A shared pointer to the connections' context, e.g. an SSL context.
+      typedef typename connection_type::context_pointer context_pointer;
+
+      /// A connection and the application data associated with it,
+      /// e.g. the http_connection of an http_server.
+      /// Note: data is declared after connection so that it's destroyed first.
+      struct connection_slot
+      {
+        std::shared_ptr<connection_type> connection; ///< The connection.
+        std::shared_ptr<void> data; ///< The application data.
+        timeout_type timeout; ///< The type of timeout last armed.
+        /// The connection's tx_progress when its timer was armed.
+        std::uint64_t tx_progress;
+        bool timed_out;       ///< Whether the connection has timed out.
+      };
 
-      /// An iterator to the connections;
-      typedef typename connections::iterator connections_iterator;
+      /// The connections, keyed by the handle in each connection.
+      typedef slot_map<connection_slot> connections;
 
       /// Event callback function type.
       typedef typename connection_type::event_callback_type event_callback_type;
@@ -81,14 +115,79 @@ namespace via
       /// The connections established with this server.
       connections connections_;
 
+      /// Guards connections_, timer_wheel_ and ticking_, since they are
+      /// shared by the connections' strands in a thread pool.
+      mutable std::mutex mutex_;
+
+      /// Whether the server is shutting down.
+      bool shutting_down_;
+
+      /// The connection timers.
+      timer_wheel timer_wheel_;
+
+      /// The timer that ticks the timer_wheel_.
+      boost::asio::deadline_timer tick_timer_;
+
+      /// Whether the tick_timer_ is running.
+      bool ticking_;
+
+      /// The period of the tick_timer_, in milliseconds.
+      unsigned long timer_resolution_;
+
+      /// The timeouts of the connections, in milliseconds, zero is disabled.
+      /// Indexed by timeout_type.
+      unsigned long timeouts_[BODY_TIMEOUT + 1];
+
+      /// The time for a timed out connection to shutdown before it's closed,
+      /// in milliseconds, zero is disabled.
+      unsigned long shutdown_timeout_;
+
       /// The password. Only used by SSL servers.
       std::string password_;
 
+      /// The context of the connections, e.g. an SSL context.
+      /// If null the connections use the SocketAdaptor's default context.
+      context_pointer context_;
+
       event_callback_type event_callback_;   ///< The event callback function.
       error_callback_type error_callback_;   ///< The error callback function.
 
       size_t rx_buffer_size_; ///< The size of the receive buffer.
 
+      /// The ids of the server metrics in the metrics_registry.
+      struct metric_ids
+      {
+        size_t accepted;      ///< The number of accepted connections.
+        size_t accept_errors; ///< The number of accept errors.
+        size_t active;        ///< The number of connections, a gauge.
+        size_t errors;        ///< The number of connection errors.
+
+        metric_ids() :
+          accepted     (metrics_registry::instance().
+                          counter("via_comms_connections_accepted_total")),
+          accept_errors(metrics_registry::instance().
+                          counter("via_comms_accept_errors_total")),
+          active       (metrics_registry::instance().
+                          gauge("via_comms_connections_active")),
+          errors       (metrics_registry::instance().
+                          counter("via_comms_connection_errors_total"))
+        {}
+      };
+
+      /// @fn metrics
+      /// The ids of the server metrics, registered on first use.
+      static metric_ids const& metrics()
+      {
+        static const metric_ids ids;
+        return ids;
+      }
+
+      /// The receive buffer pool shared by the connections.
+      rx_buffer_pool_pointer rx_buffer_pool_;
+
+      size_t max_tx_buffers_; ///< The max number of buffers in a write.
+      size_t max_tx_bytes_;   ///< The max number of bytes in a write.
+
       // Socket parameters
 
       int receive_buffer_size_; ///< The tcp receive buffer size.
@@ -98,6 +197,137 @@ namespace via
       int timeout_;
       bool no_delay_;         ///< The tcp no delay status.
       bool keep_alive_;       ///< The tcp keep alive status.
+      bool reuse_port_;       ///< Whether to set SO_REUSEPORT on the acceptors.
+
+      /// @fn set_reuse_port_option
+      /// Set SO_REUSEPORT on an acceptor, if it's enabled.
+      /// @param acceptor the acceptor.
+      /// @param ec the boost error code, operation_not_supported if
+      /// SO_REUSEPORT isn't supported on this platform.
+      void set_reuse_port_option(boost::asio::ip::tcp::acceptor& acceptor,
+                                 boost::system::error_code& ec)
+      {
+        if (!reuse_port_)
+          return;
+#ifdef SO_REUSEPORT
+        acceptor.set_option(boost::asio::detail::socket_option::
+                            boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+#else
+        (void)acceptor;
+        ec = boost::asio::error::operation_not_supported;
+#endif
+      }
+
+      /// @fn arm_timer
+      /// Arm the timer of a connection, starting the tick_timer_ if required.
+      /// @pre mutex_ must be locked.
+      /// @param handle the handle of the connection.
+      /// @param timeout the timeout in milliseconds.
+      void arm_timer(slot_handle const& handle, unsigned long timeout)
+      {
+        // round up and add a tick, since the current tick is part way through
+        timer_wheel_.arm(handle, 1 + (timeout + timer_resolution_ - 1)
+                                     / timer_resolution_);
+        if (!ticking_)
+        {
+          ticking_ = true;
+          start_tick_timer();
+        }
+      }
+
+      /// @fn start_tick_timer
+      /// Wait for the next tick of the timer_wheel_.
+      /// @pre mutex_ must be locked.
+      void start_tick_timer()
+      {
+        tick_timer_.expires_from_now
+            (boost::posix_time::milliseconds(timer_resolution_));
+        tick_timer_.async_wait([this](boost::system::error_code const& error)
+        {
+          if (boost::asio::error::operation_aborted != error)
+            tick_handler();
+        });
+      }
+
+      /// @fn tick_handler
+      /// Advance the timer_wheel_ and handle the connections that have
+      /// timed out, in their strands. Stops ticking when no timers are armed.
+      void tick_handler()
+      {
+        std::vector<std::shared_ptr<connection_type>> expired;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          timer_wheel_.tick([this, &expired](slot_handle const& handle)
+          {
+            connection_slot const* slot(connections_.find(handle));
+            if (slot)
+              expired.push_back(slot->connection);
+          });
+
+          ticking_ = !timer_wheel_.empty();
+          if (ticking_)
+            start_tick_timer();
+        }
+
+        for (auto const& connection : expired)
+        {
+          std::weak_ptr<connection_type> weak_ptr(connection);
+          connection->dispatch([this, weak_ptr]
+          {
+            if (std::shared_ptr<connection_type> pointer = weak_ptr.lock())
+              timeout_handler(pointer);
+          });
+        }
+      }
+
+      /// @fn timeout_handler
+      /// Handle a connection whose timer has expired, in its strand.
+      /// An idle timer is extended while the connection is sending data,
+      /// provided that it has sent some since the timer was armed, so that
+      /// a long transfer, e.g. a large file, isn't timed out.
+      /// Otherwise, the first time it shuts the connection down and waits
+      /// shutdown_timeout_ for it to disconnect. If it's still connected
+      /// after that, it closes the connection and signals that it has
+      /// disconnected.
+      /// @param connection the connection.
+      void timeout_handler(std::shared_ptr<connection_type> const& connection)
+      {
+        slot_handle const handle(connection->handle());
+        bool close(false);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          connection_slot* slot(connections_.find(handle));
+          // Ignore the timer if it was started again after it expired
+          if (!slot || timer_wheel_.is_armed(handle))
+            return;
+
+          close = slot->timed_out;
+          if (!close)
+          {
+            if ((slot->timeout == IDLE_TIMEOUT) &&
+                connection->is_transmitting() &&
+                (connection->tx_progress() != slot->tx_progress))
+            {
+              slot->tx_progress = connection->tx_progress();
+              if (timeouts_[IDLE_TIMEOUT] > 0)
+                arm_timer(handle, timeouts_[IDLE_TIMEOUT]);
+              return;
+            }
+
+            slot->timed_out = true;
+            if (shutdown_timeout_ > 0)
+              arm_timer(handle, shutdown_timeout_);
+          }
+        }
+
+        if (close)
+        {
+          connection->close();
+          event_handler(DISCONNECTED, connection);
+        }
+        else
+          connection->shutdown();
+      }
 
       /// @accept_handler
       /// The callback function called by the acceptor when it accepts a
@@ -114,13 +344,29 @@ namespace via
             (boost::asio::error::operation_aborted != error))
         {
           if (error)
+          {
+            metrics_registry::instance().add(metrics().accept_errors);
             error_callback_(error, next_connection_);
+          }
           else
           {
-            next_connection_->start(no_delay_, keep_alive_, timeout_,
-                                    receive_buffer_size_, send_buffer_size_);
-            connections_.insert(next_connection_);
-            next_connection_.reset();
+            metrics_registry::instance().add(metrics().accepted);
+            metrics_registry::instance().add(metrics().active);
+            // Add the connection before starting it, since it may signal
+            // that it's connected from start.
+            std::shared_ptr<connection_type> connection;
+            connection.swap(next_connection_);
+            connection_slot new_slot =
+              { connection, std::shared_ptr<void>(), IDLE_TIMEOUT, 0, false };
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              connection->set_handle(connections_.insert(std::move(new_slot)));
+              start_timer_locked(connection->handle(), IDLE_TIMEOUT);
+            }
+            connection->set_max_tx_buffers(max_tx_buffers_);
+            connection->set_max_tx_bytes(max_tx_bytes_);
+            connection->start(no_delay_, keep_alive_, timeout_,
+                              receive_buffer_size_, send_buffer_size_);
           }
 
           start_accept();
@@ -128,22 +374,50 @@ namespace via
       }
 
       /// @fn event_handler.
-      /// It forwards the connection's event signal.
-      /// For a disconnected event, it deletes the connection.
+      /// It re-arms the connection's idle timer on activity, unless another
+      /// timer has been started, and forwards the connection's event signal.
+      /// For a disconnected event, it deletes the connection and closes the
+      /// server if it's shutting down and this was the last connection.
       /// @param event the event, @see event_type.
       /// @param connection a weak_pointer to the connection that sent the
       /// event.
       void event_handler(int event, std::weak_ptr<connection_type> ptr)
       {
+        if ((event == RECEIVED) || (event == SENT))
+        {
+          if (std::shared_ptr<connection_type> connection = ptr.lock())
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connection_slot const* slot(connections_.find(connection->handle()));
+            if (slot && (slot->timeout == IDLE_TIMEOUT))
+              start_timer_locked(connection->handle(), IDLE_TIMEOUT);
+          }
+        }
+
         event_callback_(event, ptr);
         if (event == DISCONNECTED)
         {
           if (std::shared_ptr<connection_type> connection = ptr.lock())
           {
-            // search for the connection to delete
-            connections_iterator iter(connections_.find(connection));
-            if (iter != connections_.end())
-              connections_.erase(iter);
+            // The slot is destroyed after the mutex is unlocked, since its
+            // data may be the last reference to an application object.
+            connection_slot erased =
+              { nullptr, std::shared_ptr<void>(), IDLE_TIMEOUT, 0, false };
+            bool last_connection(false);
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              timer_wheel_.cancel(connection->handle());
+              if (connection_slot* slot
+                    = connections_.find(connection->handle()))
+              {
+                std::swap(erased, *slot);
+                connections_.erase(connection->handle());
+                metrics_registry::instance().add(metrics().active, -1);
+              }
+              last_connection = shutting_down_ && connections_.empty();
+            }
+            if (last_connection)
+              close();
           }
         }
       }
@@ -155,7 +429,10 @@ namespace via
       /// error.
       void error_handler(const boost::system::error_code& error,
                          std::weak_ptr<connection_type> connection)
-      { error_callback_(error, connection); }
+      {
+        metrics_registry::instance().add(metrics().errors);
+        error_callback_(error, connection);
+      }
 
       /// @fn start_accept
       /// Wait for connections.
@@ -166,7 +443,8 @@ namespace via
             { event_handler(event, ptr); },
           [this](boost::system::error_code const& error,
                  std::weak_ptr<connection_type> ptr)
-            { error_handler(error, ptr); });
+            { error_handler(error, ptr); },
+          rx_buffer_size_, rx_buffer_pool_, context_);
 
         if (acceptor_v6_.is_open())
           acceptor_v6_.async_accept(next_connection_->socket(),
@@ -180,6 +458,14 @@ namespace via
 
     public:
 
+      /// The default period of the timer that times the connections, in
+      /// milliseconds.
+      static const unsigned long DEFAULT_TIMER_RESOLUTION = 250;
+
+      /// The default time for a timed out connection to shutdown before
+      /// it's closed, in milliseconds.
+      static const unsigned long DEFAULT_SHUTDOWN_TIMEOUT = 5000;
+
       /// Copy constructor deleted to disable copying.
       server(server const&) = delete;
 
@@ -199,15 +485,28 @@ namespace via
         acceptor_v4_(io_service),
         next_connection_(),
         connections_(),
+        mutex_(),
+        shutting_down_(false),
+        timer_wheel_(),
+        tick_timer_(io_service),
+        ticking_(false),
+        timer_resolution_(DEFAULT_TIMER_RESOLUTION),
+        timeouts_(),
+        shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
         password_(),
+        context_(),
         event_callback_(),
         error_callback_(),
         rx_buffer_size_(SocketAdaptor::DEFAULT_RX_BUFFER_SIZE),
+        rx_buffer_pool_(std::make_shared<RxBufferPool>()),
+        max_tx_buffers_(connection_type::DEFAULT_MAX_TX_BUFFERS),
+        max_tx_bytes_(connection_type::DEFAULT_MAX_TX_BYTES),
         receive_buffer_size_(0),
         send_buffer_size_(0),
         timeout_(0),
         no_delay_(false),
-        keep_alive_(false)
+        keep_alive_(false),
+        reuse_port_(false)
       {}
 
       /// The server constructor.
@@ -226,12 +525,28 @@ namespace via
         acceptor_v4_(io_service),
         next_connection_(),
         connections_(),
+        mutex_(),
+        shutting_down_(false),
+        timer_wheel_(),
+        tick_timer_(io_service),
+        ticking_(false),
+        timer_resolution_(DEFAULT_TIMER_RESOLUTION),
+        timeouts_(),
+        shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
         password_(),
+        context_(),
         event_callback_(event_callback),
         error_callback_(error_callback),
+        rx_buffer_size_(SocketAdaptor::DEFAULT_RX_BUFFER_SIZE),
+        rx_buffer_pool_(std::make_shared<RxBufferPool>()),
+        max_tx_buffers_(connection_type::DEFAULT_MAX_TX_BUFFERS),
+        max_tx_bytes_(connection_type::DEFAULT_MAX_TX_BYTES),
+        receive_buffer_size_(0),
+        send_buffer_size_(0),
         timeout_(0),
         no_delay_(false),
-        keep_alive_(false)
+        keep_alive_(false),
+        reuse_port_(false)
       {}
 
       /// Destructor, close the connections.
@@ -279,6 +594,9 @@ namespace via
             acceptor_v6_.get_option(ipv6_only);
             acceptor_v6_.set_option
               (boost::asio::ip::tcp::acceptor::reuse_address(true));
+            set_reuse_port_option(acceptor_v6_, ec);
+            if (ec)
+              return ec;
             acceptor_v6_.bind
               (boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port));
             acceptor_v6_.listen();
@@ -294,6 +612,9 @@ namespace via
           {
             acceptor_v4_.set_option
                 (boost::asio::ip::tcp::acceptor::reuse_address(true));
+            set_reuse_port_option(acceptor_v4_, ec);
+            if (ec)
+              return ec;
             acceptor_v4_.bind
               (boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port));
             acceptor_v4_.listen();
@@ -321,7 +642,9 @@ namespace via
       void set_password(std::string const& password)
       {
         password_ = password;
-        connection_type::ssl_context().set_password_callback
+        boost::asio::ssl::context& ssl_context
+          (context_ ? *context_ : connection_type::ssl_context());
+        ssl_context.set_password_callback
             ([this](std::size_t max_length,
                     boost::asio::ssl::context::password_purpose purpose)
         { return server::password(max_length, purpose); });
@@ -333,6 +656,165 @@ namespace via
       void set_rx_buffer_size(size_t size) NOEXCEPT
       { rx_buffer_size_ = size; }
 
+      /// Set the receive buffer pool for all future connections.
+      /// E.g. to share a pool between servers.
+      /// @param rx_buffer_pool the receive buffer pool, must not be null.
+      void set_rx_buffer_pool(rx_buffer_pool_pointer rx_buffer_pool) NOEXCEPT
+      { rx_buffer_pool_ = rx_buffer_pool; }
+
+      /// Accessor for the receive buffer pool.
+      /// @return a shared pointer to the receive buffer pool.
+      rx_buffer_pool_pointer rx_buffer_pool() const NOEXCEPT
+      { return rx_buffer_pool_; }
+
+      /// Set the context for all future connections, e.g. the SSL context
+      /// containing this server's certificate.
+      /// @param context the context, null for the SocketAdaptor's default.
+      void set_context(context_pointer context) NOEXCEPT
+      { context_ = context; }
+
+      /// Accessor for the context of the connections.
+      /// @return a shared pointer to the context, null if the connections
+      /// use the SocketAdaptor's default context.
+      context_pointer context() const NOEXCEPT
+      { return context_; }
+
+      /// Set the maximum number of buffers that a connection sends in a
+      /// single write, for all future connections.
+      /// @param max_tx_buffers the maximum number of buffers.
+      void set_max_tx_buffers(size_t max_tx_buffers) NOEXCEPT
+      { max_tx_buffers_ = max_tx_buffers; }
+
+      /// Set the maximum number of bytes that a connection sends in a
+      /// single write, for all future connections.
+      /// @param max_tx_bytes the maximum number of bytes.
+      void set_max_tx_bytes(size_t max_tx_bytes) NOEXCEPT
+      { max_tx_bytes_ = max_tx_bytes; }
+
+      /// Find the application data associated with a connection.
+      /// @param handle the handle of the connection.
+      /// @return a shared pointer to the data, null if the connection is
+      /// not found or no data has been set.
+      std::shared_ptr<void> connection_data(slot_handle const& handle) const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_slot const* slot(connections_.find(handle));
+        return slot ? slot->data : std::shared_ptr<void>();
+      }
+
+      /// Associate application data with a connection, it is deleted
+      /// when the connection is deleted.
+      /// @param handle the handle of the connection.
+      /// @param data a shared pointer to the data.
+      /// @return true if the connection was found, false otherwise.
+      bool set_connection_data(slot_handle const& handle,
+                               std::shared_ptr<void> data)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_slot* slot(connections_.find(handle));
+        if (slot)
+          slot->data.swap(data);
+        return slot != nullptr;
+      }
+
+      /// @fn start_timer
+      /// Start a timer for a connection, replacing its current timer.
+      /// The idle and body timeouts are periods of inactivity, so starting
+      /// them again extends them. The header timeout is a deadline from the
+      /// start of the header, so starting it again does not extend it.
+      /// @pre it must be called in the connection's strand.
+      /// @param handle the handle of the connection.
+      /// @param timeout the type of timeout.
+      /// @return true if the connection was found, false otherwise.
+      bool start_timer(slot_handle const& handle, timeout_type timeout)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return start_timer_locked(handle, timeout);
+      }
+
+      /// @fn start_timer_locked
+      /// Start a timer for a connection, see start_timer.
+      /// @pre mutex_ must be locked.
+      /// @param handle the handle of the connection.
+      /// @param timeout the type of timeout.
+      /// @return true if the connection was found, false otherwise.
+      bool start_timer_locked(slot_handle const& handle, timeout_type timeout)
+      {
+        connection_slot* slot(connections_.find(handle));
+        if (!slot)
+          return false;
+
+        // Don't extend the shutdown of a timed out connection
+        if (slot->timed_out)
+          return true;
+
+        if ((timeout == HEADER_TIMEOUT) && (slot->timeout == HEADER_TIMEOUT) &&
+            timer_wheel_.is_armed(handle))
+          return true;
+
+        slot->timeout = timeout;
+        slot->tx_progress = slot->connection->tx_progress();
+        if (timeouts_[timeout] > 0)
+          arm_timer(handle, timeouts_[timeout]);
+        else
+          timer_wheel_.cancel(handle);
+        return true;
+      }
+
+      /// @fn cancel_timer
+      /// Cancel the timer of a connection, e.g. while it isn't waiting for
+      /// data. The timer is started again by start_timer or, for the idle
+      /// timeout, when the connection sends or receives data.
+      /// @param handle the handle of the connection.
+      /// @return true if the timer was cancelled, false otherwise.
+      bool cancel_timer(slot_handle const& handle)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_slot const* slot(connections_.find(handle));
+        return slot && !slot->timed_out && timer_wheel_.cancel(handle);
+      }
+
+      /// @fn set_connection_timeout
+      /// Set a connection timeout for all future timers.
+      /// @param timeout the type of timeout.
+      /// @param milliseconds the timeout in milliseconds, zero is disabled.
+      void set_connection_timeout(timeout_type timeout,
+                                  unsigned long milliseconds) NOEXCEPT
+      { timeouts_[timeout] = milliseconds; }
+
+      /// Accessor for a connection timeout.
+      /// @param timeout the type of timeout.
+      /// @return the timeout in milliseconds, zero is disabled.
+      unsigned long connection_timeout(timeout_type timeout) const NOEXCEPT
+      { return timeouts_[timeout]; }
+
+      /// Set the period of the timer that times the connections.
+      /// The connection timeouts are accurate to this period.
+      /// @param milliseconds the period in milliseconds, min 1.
+      void set_timer_resolution(unsigned long milliseconds) NOEXCEPT
+      { timer_resolution_ = milliseconds ? milliseconds : 1; }
+
+      /// Set the time for a timed out connection to shutdown before it's
+      /// closed.
+      /// @param milliseconds the timeout in milliseconds, zero is disabled.
+      void set_shutdown_timeout(unsigned long milliseconds) NOEXCEPT
+      { shutdown_timeout_ = milliseconds; }
+
+      /// Accessor for the connections.
+      /// @pre the connections must not be running in other threads, e.g.
+      /// use connection_data in a thread pool.
+      /// @return a reference to the connections.
+      connections const& connections_map() const NOEXCEPT
+      { return connections_; }
+
+      /// @fn set_reuse_port
+      /// Set SO_REUSEPORT on the acceptors, so that more than one server
+      /// can listen on the same port, e.g. in a multi_reactor_server.
+      /// @pre must be called before accept_connections.
+      /// @param enable enable/disable SO_REUSEPORT.
+      void set_reuse_port(bool enable) NOEXCEPT
+      { reuse_port_ = enable; }
+
       /// @fn set_timeout
       /// Set the send and receive timeouts value for all future connections.
       /// @pre sockets may remain open forever
@@ -374,7 +856,48 @@ namespace via
         if (acceptor_v4_.is_open())
           acceptor_v4_.close();
 
-        connections_.clear();
+        // The slots are destroyed after the mutex is unlocked, since their
+        // data may be the last references to application objects.
+        std::vector<connection_slot> erased;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          timer_wheel_.clear();
+          if (ticking_)
+          {
+            ticking_ = false;
+            boost::system::error_code ignoredEc;
+            tick_timer_.cancel(ignoredEc);
+          }
+          if (!connections_.empty())
+          {
+            metrics_registry::instance().add(metrics().active,
+                              -static_cast<long long>(connections_.size()));
+            connections_.clear(erased);
+          }
+        }
+      }
+
+      /// @fn shutdown
+      /// Disconnect all of the connections and close the server after
+      /// the last connection has disconnected.
+      void shutdown()
+      {
+        // local copies, the slots may be erased by disconnect
+        std::vector<std::shared_ptr<connection_type>> connections;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          shutting_down_ = !connections_.empty();
+          connections_.for_each([&connections](connection_slot& slot)
+            { connections.push_back(slot.connection); });
+        }
+
+        if (connections.empty())
+          close();
+        else
+        {
+          for (auto const& connection : connections)
+            connection->disconnect();
+        }
       }
     };
   }
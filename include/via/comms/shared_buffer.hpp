@@ -0,0 +1,169 @@
+#ifndef SHARED_BUFFER_HPP_VIA_HTTPLIB_
+#define SHARED_BUFFER_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file shared_buffer.hpp
+/// @brief Contains the shared_buffer class.
+//////////////////////////////////////////////////////////////////////////////
+#include "file_handle.hpp"
+#include "via/no_except.hpp"
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class shared_buffer
+    /// An immutable buffer that shares the ownership of its data, so that
+    /// the same data can be sent on many connections without copying it.
+    /// A connection holds the shared_buffer until the data has been
+    /// written, so the data remains valid even if the application releases
+    /// its shared_buffer first.
+    /// The data may be a Container moved into the buffer, a memory mapped
+    /// file, or any other data owned by a shared pointer.
+    /// @see connection::send_data
+    //////////////////////////////////////////////////////////////////////////
+    class shared_buffer
+    {
+      std::shared_ptr<void const> owner_; ///< Owns the data.
+      boost::asio::const_buffer buffer_;  ///< The data.
+
+#ifndef _WIN32
+      /// A memory mapped region, unmapped by its destructor.
+      struct mapped_region
+      {
+        void* data;  ///< The start of the region.
+        size_t size; ///< The size of the region.
+
+        mapped_region(void* ptr, size_t length) :
+          data(ptr),
+          size(length)
+        {}
+
+        ~mapped_region()
+        { ::munmap(data, size); }
+
+        mapped_region(mapped_region const&) = delete;
+        mapped_region& operator=(mapped_region const&) = delete;
+      };
+#endif
+
+    public:
+
+      /// Default constructor, an empty buffer.
+      shared_buffer() :
+        owner_(),
+        buffer_()
+      {}
+
+      /// Constructor.
+      /// @param owner a shared pointer that owns the data.
+      /// @param buffer the data.
+      shared_buffer(std::shared_ptr<void const> owner,
+                    boost::asio::const_buffer buffer) :
+        owner_(std::move(owner)),
+        buffer_(buffer)
+      {}
+
+      /// Create a shared_buffer by moving a Container into it.
+      /// @param data the data, it must contain a contiguous array of bytes.
+      /// @return the shared_buffer.
+      template <typename Container>
+      static shared_buffer share(Container data)
+      {
+        std::shared_ptr<Container const> owner
+          (std::make_shared<Container>(std::move(data)));
+        return shared_buffer(owner, boost::asio::buffer(*owner));
+      }
+
+      /// Create a shared_buffer of a read only memory mapped file.
+      /// Note: the file must not be truncated while it is mapped.
+      /// On Windows the file is read into memory instead.
+      /// @param path the path of the file.
+      /// @retval error the error, if the file could not be mapped.
+      /// @return the shared_buffer, empty on error or if the file is empty.
+      static shared_buffer map_file(std::string const& path,
+                                    boost::system::error_code& error)
+      {
+        std::shared_ptr<file_handle> file(file_handle::open(path, error));
+        if (!file || (file->size() == 0))
+          return shared_buffer();
+
+        size_t const size(static_cast<size_t>(file->size()));
+#ifdef _WIN32
+        std::vector<char> data(size);
+        if (file->read(&data[0], size, 0, error) != size)
+        {
+          if (!error)
+            error = boost::asio::error::eof;
+          return shared_buffer();
+        }
+        return share(std::move(data));
+#else
+        void* ptr(::mmap(nullptr, size, PROT_READ, MAP_SHARED,
+                         file->native_handle(), 0));
+        if (ptr == MAP_FAILED)
+        {
+          error = boost::system::error_code(errno,
+                                            boost::system::system_category());
+          return shared_buffer();
+        }
+
+        // The mapping remains valid after the file is closed
+        std::shared_ptr<mapped_region const> owner
+          (std::make_shared<mapped_region>(ptr, size));
+        return shared_buffer(owner, boost::asio::buffer(ptr, size));
+#endif
+      }
+
+      /// A part of the buffer, sharing the ownership of the data.
+      /// @param offset the start of the part, it's truncated to the size.
+      /// @param length the maximum length of the part.
+      /// @return the part of the buffer.
+      shared_buffer slice(size_t offset, size_t length) const
+      {
+        boost::asio::const_buffer const part(buffer_ + offset);
+        return shared_buffer(owner_, boost::asio::buffer(part, length));
+      }
+
+      /// Accessor for the data.
+      boost::asio::const_buffer const& buffer() const NOEXCEPT
+      { return buffer_; }
+
+      /// Accessor for the owner of the data.
+      std::shared_ptr<void const> const& owner() const NOEXCEPT
+      { return owner_; }
+
+      /// A pointer to the data.
+      char const* data() const NOEXCEPT
+      { return boost::asio::buffer_cast<char const*>(buffer_); }
+
+      /// The size of the data.
+      size_t size() const NOEXCEPT
+      { return boost::asio::buffer_size(buffer_); }
+
+      /// Whether the buffer is empty.
+      bool empty() const NOEXCEPT
+      { return size() == 0; }
+    };
+  }
+}
+
+#endif
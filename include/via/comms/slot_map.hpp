@@ -0,0 +1,237 @@
+#ifndef SLOT_MAP_HPP_VIA_HTTPLIB_
+#define SLOT_MAP_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file slot_map.hpp
+/// @brief The slot_handle struct and the slot_map template class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @struct slot_handle
+    /// A handle to a value in a slot_map: the index of the slot and the
+    /// generation of the slot when the value was inserted.
+    /// A default constructed handle is never valid.
+    //////////////////////////////////////////////////////////////////////////
+    struct slot_handle
+    {
+      std::uint32_t index;      ///< The index of the slot.
+      std::uint32_t generation; ///< The generation of the slot.
+
+      /// Default constructor, an invalid handle.
+      slot_handle() NOEXCEPT :
+        index(0),
+        generation(0)
+      {}
+
+      /// Constructor.
+      /// @param idx the index of the slot.
+      /// @param gen the generation of the slot.
+      slot_handle(std::uint32_t idx, std::uint32_t gen) NOEXCEPT :
+        index(idx),
+        generation(gen)
+      {}
+
+      /// Equality operator.
+      bool operator==(slot_handle const& other) const NOEXCEPT
+      { return (index == other.index) && (generation == other.generation); }
+
+      /// Inequality operator.
+      bool operator!=(slot_handle const& other) const NOEXCEPT
+      { return !(*this == other); }
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class slot_map
+    /// A container that stores values in a vector of slots and returns a
+    /// slot_handle for each value inserted.
+    /// Values are found and erased in O(1) by handle. When a value is erased
+    /// the generation of its slot is incremented, so that old handles to
+    /// the slot are no longer valid and the slot can be reused.
+    /// Erasing a value does not move the other values, so values may be
+    /// erased within for_each.
+    /// @param T the type of the values, it must be default constructible
+    /// and movable.
+    //////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    class slot_map
+    {
+      /// A slot for a value.
+      struct slot
+      {
+        T value;                  ///< The value.
+        std::uint32_t generation; ///< The generation of the slot.
+        bool occupied;            ///< Whether the slot holds a value.
+      };
+
+      std::vector<slot> slots_;               ///< The slots.
+      std::vector<std::uint32_t> free_slots_; ///< The indices of free slots.
+      size_t size_;                           ///< The number of values.
+
+      /// Get the slot for a handle.
+      /// @param handle the handle.
+      /// @return a pointer to the slot if the handle is valid, else nullptr.
+      slot const* get_slot(slot_handle const& handle) const NOEXCEPT
+      {
+        if (handle.index < slots_.size())
+        {
+          slot const& s(slots_[handle.index]);
+          if (s.occupied && (s.generation == handle.generation))
+            return &s;
+        }
+        return nullptr;
+      }
+
+    public:
+
+      /// Default constructor.
+      slot_map() :
+        slots_(),
+        free_slots_(),
+        size_(0)
+      {}
+
+      /// @fn insert
+      /// Insert a value into a free slot.
+      /// @param value the value to insert.
+      /// @return the handle of the value.
+      slot_handle insert(T value)
+      {
+        std::uint32_t index(0);
+        if (free_slots_.empty())
+        {
+          index = static_cast<std::uint32_t>(slots_.size());
+          slot new_slot = { T(), 1, false };
+          slots_.push_back(std::move(new_slot));
+        }
+        else
+        {
+          index = free_slots_.back();
+          free_slots_.pop_back();
+        }
+
+        slot& s(slots_[index]);
+        s.value = std::move(value);
+        s.occupied = true;
+        ++size_;
+        return slot_handle(index, s.generation);
+      }
+
+      /// @fn find
+      /// Find the value for a handle.
+      /// @param handle the handle.
+      /// @return a pointer to the value if the handle is valid, else nullptr.
+      T* find(slot_handle const& handle) NOEXCEPT
+      {
+        slot const* s(get_slot(handle));
+        return s ? &slots_[handle.index].value : nullptr;
+      }
+
+      /// @fn find
+      /// Find the value for a handle.
+      /// @param handle the handle.
+      /// @return a pointer to the value if the handle is valid, else nullptr.
+      T const* find(slot_handle const& handle) const NOEXCEPT
+      {
+        slot const* s(get_slot(handle));
+        return s ? &s->value : nullptr;
+      }
+
+      /// @fn erase
+      /// Erase the value for a handle.
+      /// The value is destroyed after it has been removed from the map.
+      /// @param handle the handle.
+      /// @return true if the handle was valid, false otherwise.
+      bool erase(slot_handle const& handle)
+      {
+        if (!get_slot(handle))
+          return false;
+
+        // swap the value out of the slot, it's destroyed on return
+        slot& s(slots_[handle.index]);
+        T value = T();
+        std::swap(value, s.value);
+        s.occupied = false;
+        ++s.generation;
+        free_slots_.push_back(handle.index);
+        --size_;
+        return true;
+      }
+
+      /// @fn clear
+      /// Erase all of the values.
+      /// The generations are kept, so that old handles remain invalid.
+      /// The values are destroyed after they have been removed from the map.
+      void clear()
+      {
+        std::vector<T> values;
+        clear(values);
+      }
+
+      /// @fn clear
+      /// Erase all of the values, moving them into a vector so that the
+      /// caller can destroy them later, e.g. after unlocking a mutex.
+      /// The generations are kept, so that old handles remain invalid.
+      /// @retval values the erased values are appended to it.
+      void clear(std::vector<T>& values)
+      {
+        for (std::uint32_t i(0); i < slots_.size(); ++i)
+        {
+          slot& s(slots_[i]);
+          if (s.occupied)
+          {
+            values.push_back(std::move(s.value));
+            s.value = T();
+            s.occupied = false;
+            ++s.generation;
+            free_slots_.push_back(i);
+          }
+        }
+        size_ = 0;
+      }
+
+      /// @fn for_each
+      /// Call a function for each value in the map.
+      /// The function may erase values, but the reference to the value that
+      /// it was called with is invalid after it has been erased.
+      /// Values inserted by the function may or may not be visited.
+      /// @param function the function to call with a reference to a value.
+      template <typename Function>
+      void for_each(Function function)
+      {
+        for (size_t i(0); i < slots_.size(); ++i)
+        {
+          if (slots_[i].occupied)
+            function(slots_[i].value);
+        }
+      }
+
+      /// The number of values in the map.
+      size_t size() const NOEXCEPT
+      { return size_; }
+
+      /// Whether the map is empty.
+      bool empty() const NOEXCEPT
+      { return size_ == 0; }
+    };
+  }
+}
+
+#endif
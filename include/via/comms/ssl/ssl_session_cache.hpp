@@ -0,0 +1,215 @@
+#ifndef SSL_SESSION_CACHE_HPP_VIA_HTTPLIB_
+#define SSL_SESSION_CACHE_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file ssl_session_cache.hpp
+/// @brief Contains the ssl_session_cache class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <boost/asio/ssl.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace via
+{
+  namespace comms
+  {
+    namespace ssl
+    {
+      ////////////////////////////////////////////////////////////////////////
+      /// @class ssl_session_cache
+      /// A cache of the SSL sessions of client connections, keyed by the
+      /// host:port that they connected to, so that a client reconnecting to
+      /// a server can resume its session with an abbreviated handshake.
+      /// The sessions are stored serialised, since OpenSSL marks a session
+      /// as not resumable if its connection is closed without an SSL
+      /// shutdown.
+      /// It also counts the handshakes that resumed a session (hits) and
+      /// the full handshakes (misses) of client and server connections.
+      /// The class is thread safe, so that it may be shared by connections
+      /// running in a thread pool.
+      /// @see ssl_tcp_adaptor
+      ////////////////////////////////////////////////////////////////////////
+      class ssl_session_cache
+      {
+      public:
+
+        /// The default maximum number of client sessions in the cache.
+        static const size_t DEFAULT_MAX_SESSIONS = 256;
+
+      private:
+
+        /// The serialised client sessions, keyed by host:port.
+        std::map<std::string, std::string> sessions_;
+        /// The maximum number of client sessions.
+        size_t max_sessions_;
+        /// Mutex to protect the sessions.
+        mutable std::mutex mutex_;
+
+        std::atomic<unsigned long> client_hits_;   ///< resumed client sessions
+        std::atomic<unsigned long> client_misses_; ///< full client handshakes
+        std::atomic<unsigned long> server_hits_;   ///< resumed server sessions
+        std::atomic<unsigned long> server_misses_; ///< full server handshakes
+
+        ssl_session_cache(ssl_session_cache const&) = delete;
+        ssl_session_cache& operator=(ssl_session_cache const&) = delete;
+
+      public:
+
+        /// Constructor.
+        /// @param max_sessions the maximum number of client sessions,
+        /// default DEFAULT_MAX_SESSIONS.
+        explicit ssl_session_cache(size_t max_sessions = DEFAULT_MAX_SESSIONS) :
+          sessions_(),
+          max_sessions_(max_sessions),
+          mutex_(),
+          client_hits_(0),
+          client_misses_(0),
+          server_hits_(0),
+          server_misses_(0)
+        {}
+
+        /// Set the maximum number of client sessions in the cache.
+        /// Zero disables client session resumption.
+        /// @param max_sessions the maximum number of client sessions.
+        void set_max_sessions(size_t max_sessions)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          max_sessions_ = max_sessions;
+          while (sessions_.size() > max_sessions_)
+            sessions_.erase(sessions_.begin());
+        }
+
+        /// Store the session of a client connection.
+        /// If the cache is full, an arbitrary session is removed.
+        /// @param key the host:port that the client connected to.
+        /// @param session the session.
+        void store(std::string const& key, SSL_SESSION* session)
+        {
+          int const length(i2d_SSL_SESSION(session, 0));
+          if (length <= 0)
+            return;
+
+          std::string data(static_cast<size_t>(length), '\0');
+          unsigned char* next(reinterpret_cast<unsigned char*>(&data[0]));
+          i2d_SSL_SESSION(session, &next);
+
+          std::lock_guard<std::mutex> lock(mutex_);
+          std::map<std::string, std::string>::iterator iter
+              (sessions_.find(key));
+          if (iter != sessions_.end())
+            iter->second.swap(data);
+          else if (max_sessions_ > 0)
+          {
+            if (sessions_.size() >= max_sessions_)
+              sessions_.erase(sessions_.begin());
+            sessions_.insert(std::make_pair(key, std::move(data)));
+          }
+        }
+
+        /// Set the session of a client connection from the cache, so that
+        /// the client attempts to resume it.
+        /// @pre the client handshake must not have started.
+        /// @param key the host:port that the client is connecting to.
+        /// @param ssl the client's SSL connection.
+        /// @return true if a session was found, false otherwise.
+        bool resume(std::string const& key, SSL* ssl)
+        {
+          SSL_SESSION* session(0);
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<std::string, std::string>::const_iterator iter
+                (sessions_.find(key));
+            if (iter == sessions_.end())
+              return false;
+
+            const unsigned char* next
+              (reinterpret_cast<const unsigned char*>(iter->second.data()));
+            session = d2i_SSL_SESSION(0, &next,
+                                      static_cast<long>(iter->second.size()));
+          }
+
+          if (!session)
+            return false;
+
+          // SSL_set_session takes its own reference to the session
+          bool const resumed(SSL_set_session(ssl, session) == 1);
+          SSL_SESSION_free(session);
+          return resumed;
+        }
+
+        /// Remove the session of a client connection.
+        /// @param key the host:port that the client connected to.
+        void remove(std::string const& key)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          sessions_.erase(key);
+        }
+
+        /// Remove all of the client sessions.
+        void clear()
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          sessions_.clear();
+        }
+
+        /// The number of client sessions in the cache.
+        size_t size() const
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          return sessions_.size();
+        }
+
+        /// Count a completed handshake.
+        /// @param is_server whether it's a server connection.
+        /// @param reused whether the handshake resumed a session.
+        void count_handshake(bool is_server, bool reused) NOEXCEPT
+        {
+          if (is_server)
+            ++(reused ? server_hits_ : server_misses_);
+          else
+            ++(reused ? client_hits_ : client_misses_);
+        }
+
+        /// The number of client handshakes that resumed a session.
+        unsigned long client_hits() const NOEXCEPT
+        { return client_hits_; }
+
+        /// The number of full client handshakes.
+        unsigned long client_misses() const NOEXCEPT
+        { return client_misses_; }
+
+        /// The number of server handshakes that resumed a session,
+        /// from either the session cache or a session ticket.
+        unsigned long server_hits() const NOEXCEPT
+        { return server_hits_; }
+
+        /// The number of full server handshakes.
+        unsigned long server_misses() const NOEXCEPT
+        { return server_misses_; }
+
+        /// Reset the hit and miss counters.
+        void reset_counters() NOEXCEPT
+        {
+          client_hits_   = 0;
+          client_misses_ = 0;
+          server_hits_   = 0;
+          server_misses_ = 0;
+        }
+      };
+    }
+  }
+}
+
+#endif
@@ -17,8 +17,14 @@
 /// is provided by the OpenSSL library which must be included with this file.
 //////////////////////////////////////////////////////////////////////////////
 #include "via/comms/socket_adaptor.hpp"
+#include "via/comms/ssl/ssl_session_cache.hpp"
 #include "via/no_except.hpp"
 #include <boost/asio/ssl.hpp>
+#include <cctype>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 // Enable SSL support.
 #ifndef HTTP_SSL
@@ -36,17 +42,34 @@ namespace via
       /// This class enables the connection class to use ssl tcp sockets.
       /// This class and tcp_adaptor provide a common interface that
       /// enables connection to be configured for either tcp or ssl sockets.
+      /// A connection uses the ssl context that it was created with or, if
+      /// none, the process-wide ssl_context.
       /// @see connection
       /// @see tcp_adaptor
       ////////////////////////////////////////////////////////////////////////
       class ssl_tcp_adaptor
       {
+      public:
+
+        /// A shared pointer to an ssl context.
+        typedef std::shared_ptr<boost::asio::ssl::context> context_pointer;
+
+        /// The ssl contexts of a server, keyed by server name.
+        typedef std::map<std::string, context_pointer> server_name_contexts;
+
+      private:
+
         /// The asio io_service.
         boost::asio::io_service& io_service_;
+        /// The ssl context, null for the process-wide ssl_context.
+        context_pointer context_;
         /// The asio SSL TCP socket.
         boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket_;
         /// The host iterator used by the resolver.
         boost::asio::ip::tcp::resolver::iterator host_iterator_;
+        /// The host:port of a client connection, its key in the
+        /// session_cache.
+        std::string session_key_;
 
         /// @fn resolve_host
         /// Resolves the host name and port.
@@ -78,14 +101,117 @@ namespace via
           return preverified;
         }
 
+        /// @fn session_key_index
+        /// The index of the session key in the ex data of an SSL connection.
+        static int session_key_index()
+        {
+          static const int index(SSL_get_ex_new_index(0, 0, 0, 0, 0));
+          return index;
+        }
+
+        /// @fn info_callback
+        /// The OpenSSL info callback.
+        /// When a handshake completes, it counts it and stores the session
+        /// of a client connection in the session_cache. The client sessions
+        /// aren't stored in the OpenSSL session cache, since it's keyed by
+        /// session id and shared with the server connections.
+        /// @param ssl the SSL connection.
+        /// @param where the state of the connection.
+        static void info_callback(const SSL* ssl, int where, int)
+        {
+          if (where & SSL_CB_HANDSHAKE_DONE)
+          {
+            bool const is_server(SSL_is_server(ssl) != 0);
+            session_cache().count_handshake(is_server,
+                          SSL_session_reused(const_cast<SSL*>(ssl)) != 0);
+
+            std::string const* key(static_cast<std::string const*>
+                                   (SSL_get_ex_data(ssl, session_key_index())));
+            SSL_SESSION* session(SSL_get_session(ssl));
+            if (!is_server && key && session)
+              session_cache().store(*key, session);
+          }
+        }
+
+        /// @fn server_names_index
+        /// The index of the server_name_contexts in the ex data of an ssl
+        /// context. The contexts are deleted with the ssl context.
+        static int server_names_index()
+        {
+          static const int index(SSL_CTX_get_ex_new_index(0, 0, 0, 0,
+            [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+              { delete static_cast<server_name_contexts*>(ptr); }));
+          return index;
+        }
+
+        /// @fn server_name_callback
+        /// The OpenSSL Server Name Indication callback.
+        /// It switches the connection to the ssl context for the server name
+        /// requested by the client, if there is one. Otherwise the
+        /// connection continues with the default context.
+        /// @param ssl the SSL connection.
+        /// @param arg the server_name_contexts of the default context.
+        /// @return SSL_TLSEXT_ERR_OK.
+        static int server_name_callback(SSL* ssl, int*, void* arg)
+        {
+          const char* name(SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name));
+          server_name_contexts const* contexts
+              (static_cast<server_name_contexts const*>(arg));
+          if (!name || !contexts)
+            return SSL_TLSEXT_ERR_OK;
+
+          std::string server_name(name);
+          for (auto& c : server_name)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+          server_name_contexts::const_iterator iter
+              (contexts->find(server_name));
+
+          // Try a wildcard for the parent domain, e.g. *.example.com
+          if (iter == contexts->end())
+          {
+            size_t const dot(server_name.find('.'));
+            if (dot != std::string::npos)
+              iter = contexts->find("*" + server_name.substr(dot));
+          }
+
+          if (iter != contexts->end())
+            SSL_set_SSL_CTX(ssl, iter->second->native_handle());
+          return SSL_TLSEXT_ERR_OK;
+        }
+
+        /// @fn configure_sessions
+        /// Enable session resumption for the client and server connections
+        /// of an ssl context.
+        /// @param context the ssl context.
+        /// @return true.
+        static bool configure_sessions(boost::asio::ssl::context& context)
+        {
+          static const unsigned char SESSION_ID_CONTEXT[] = "via-httplib";
+          SSL_CTX* ssl_ctx(context.native_handle());
+          SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_SERVER);
+          SSL_CTX_set_session_id_context(ssl_ctx, SESSION_ID_CONTEXT,
+                                         sizeof(SESSION_ID_CONTEXT) - 1);
+          SSL_CTX_set_info_callback(ssl_ctx, info_callback);
+          return true;
+        }
+
       protected:
 
         /// @fn handshake
         /// Asynchorously performs the ssl handshake.
+        /// A client connection attempts to resume its last session with the
+        /// host.
         /// @param handshake_handler the handshake callback function.
         /// @param is_server whether performing client or server handshaking
         void handshake(ErrorHandler handshake_handler, bool is_server)
         {
+          if (!is_server && !session_key_.empty())
+          {
+            SSL_set_ex_data(socket_.native_handle(), session_key_index(),
+                            &session_key_);
+            session_cache().resume(session_key_, socket_.native_handle());
+          }
+
           socket_.async_handshake(is_server ? boost::asio::ssl::stream_base::server
                                             : boost::asio::ssl::stream_base::client,
                                   handshake_handler);
@@ -105,10 +231,15 @@ namespace via
 
         /// The ssl_tcp_adaptor constructor.
         /// @param io_service the asio io_service associted with this connection
-        explicit ssl_tcp_adaptor(boost::asio::io_service& io_service) :
+        /// @param context the ssl context, default null: the connection uses
+        /// the process-wide ssl_context.
+        explicit ssl_tcp_adaptor(boost::asio::io_service& io_service,
+                                 context_pointer context = context_pointer()) :
           io_service_(io_service),
-          socket_(io_service_, ssl_context()),
-          host_iterator_()
+          context_(context),
+          socket_(io_service_, context ? *context : ssl_context()),
+          host_iterator_(),
+          session_key_()
         {}
 
       public:
@@ -123,17 +254,173 @@ namespace via
         /// The default size of the receive buffer.
         static const size_t DEFAULT_RX_BUFFER_SIZE = 8192;
 
+        /// Whether the adaptor supports wait_readable and read_available.
+        /// False: the ssl stream may hold decrypted data that the socket
+        /// does not signal, so a read always needs a receive buffer.
+        static const bool WAIT_READABLE = false;
+
+        /// Whether the adaptor supports wait_writable and send_file.
+        /// False: the data must be encrypted in userspace, so files are
+        /// read into buffers and written via the ssl stream.
+        static const bool SEND_FILE = false;
+
+        /// The default maximum number of sessions in the server cache.
+        static const long DEFAULT_SESSION_CACHE_SIZE =
+                                         SSL_SESSION_CACHE_MAX_SIZE_DEFAULT;
+
+        /// The default session timeout in seconds.
+        static const long DEFAULT_SESSION_TIMEOUT = 300;
+
         /// @fn ssl_context
         /// A static function to manage the ssl context for the ssl
         /// connections.
+        /// Session resumption is enabled for client and server connections.
         /// @return ssl_context the ssl context.
         static boost::asio::ssl::context& ssl_context()
         {
           static boost::asio::ssl::context context_
               (boost::asio::ssl::context::tlsv12);
+          static const bool sessions_configured(configure_sessions(context_));
+          (void)sessions_configured;
           return context_;
         }
 
+        /// @fn create_context
+        /// Create an ssl context for a server or client, e.g. to give a
+        /// server its own certificate.
+        /// Session resumption is enabled, as for the process-wide
+        /// ssl_context.
+        /// @param method the ssl method, default tlsv12.
+        /// @return a shared pointer to the new ssl context.
+        static context_pointer create_context(boost::asio::ssl::context::method
+                                   method = boost::asio::ssl::context::tlsv12)
+        {
+          context_pointer context
+              (std::make_shared<boost::asio::ssl::context>(method));
+          configure_sessions(*context);
+          return context;
+        }
+
+        /// @fn add_server_name_context
+        /// Add an ssl context for a server name, selected by the Server
+        /// Name Indication (SNI) of client connections.
+        /// Connections that don't request a server name, or request a server
+        /// name without a context, use the default context.
+        /// Note: the server name contexts should be added before the server
+        /// accepts connections, since the map isn't thread safe.
+        /// @throw invalid_argument if server_context is null.
+        /// @param default_context the ssl context of the server's connections.
+        /// @param server_name the server name, e.g. "www.example.com" or a
+        /// wildcard for its subdomains, e.g. "*.example.com".
+        /// @param server_context the ssl context for the server name.
+        static void add_server_name_context
+                                (boost::asio::ssl::context& default_context,
+                                 std::string server_name,
+                                 context_pointer server_context)
+        {
+          if (!server_context)
+            throw std::invalid_argument
+                ("ssl_tcp_adaptor: null context for " + server_name);
+
+          SSL_CTX* ssl_ctx(default_context.native_handle());
+          server_name_contexts* contexts(static_cast<server_name_contexts*>
+                           (SSL_CTX_get_ex_data(ssl_ctx, server_names_index())));
+          if (!contexts)
+          {
+            contexts = new server_name_contexts();
+            SSL_CTX_set_ex_data(ssl_ctx, server_names_index(), contexts);
+            SSL_CTX_set_tlsext_servername_callback(ssl_ctx,
+                                                   server_name_callback);
+            SSL_CTX_set_tlsext_servername_arg(ssl_ctx, contexts);
+          }
+
+          for (auto& c : server_name)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+          (*contexts)[server_name] = server_context;
+        }
+
+        /// @fn session_cache
+        /// A static function to manage the cache of client sessions and the
+        /// session hit and miss counters.
+        /// @return the session cache.
+        static ssl_session_cache& session_cache()
+        {
+          static ssl_session_cache session_cache_;
+          return session_cache_;
+        }
+
+        /// @fn set_session_cache
+        /// Configure session resumption for the server connections of an
+        /// ssl context, e.g. a server's own context or a server name
+        /// context.
+        /// @param context the ssl context.
+        /// @param cache_size the maximum number of sessions in the server
+        /// cache, zero disables the server cache.
+        /// @param timeout the session timeout in seconds.
+        /// @param session_tickets whether to issue session tickets (RFC5077),
+        /// so that clients can resume sessions without the server cache.
+        static void set_session_cache
+                          (boost::asio::ssl::context& context,
+                           long cache_size = DEFAULT_SESSION_CACHE_SIZE,
+                           long timeout = DEFAULT_SESSION_TIMEOUT,
+                           bool session_tickets = true)
+        {
+          SSL_CTX* ssl_ctx(context.native_handle());
+          SSL_CTX_set_session_cache_mode(ssl_ctx, (cache_size > 0) ?
+                                   SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+          if (cache_size > 0)
+            SSL_CTX_sess_set_cache_size(ssl_ctx, cache_size);
+          SSL_CTX_set_timeout(ssl_ctx, timeout);
+          if (session_tickets)
+            SSL_CTX_clear_options(ssl_ctx, SSL_OP_NO_TICKET);
+          else
+            SSL_CTX_set_options(ssl_ctx, SSL_OP_NO_TICKET);
+        }
+
+        /// @fn set_session_cache
+        /// Configure session resumption for the server connections of the
+        /// process-wide ssl_context.
+        /// @param cache_size the maximum number of sessions in the server
+        /// cache, zero disables the server cache.
+        /// @param timeout the session timeout in seconds.
+        /// @param session_tickets whether to issue session tickets (RFC5077),
+        /// so that clients can resume sessions without the server cache.
+        static void set_session_cache
+                          (long cache_size = DEFAULT_SESSION_CACHE_SIZE,
+                           long timeout = DEFAULT_SESSION_TIMEOUT,
+                           bool session_tickets = true)
+        { set_session_cache(ssl_context(), cache_size, timeout, session_tickets); }
+
+        /// @fn set_session_ticket_keys
+        /// Set the keys that an ssl context uses to encrypt session tickets,
+        /// e.g. so that servers in a cluster can resume each other's
+        /// sessions.
+        /// By default OpenSSL generates random keys for each context.
+        /// @throw invalid_argument if keys isn't the size required by
+        /// OpenSSL: 48 bytes for 1.0 and 80 bytes for 1.1 onwards.
+        /// @param context the ssl context.
+        /// @param keys the ticket key name, HMAC key and AES key.
+        static void set_session_ticket_keys(boost::asio::ssl::context& context,
+                                            std::string const& keys)
+        {
+          SSL_CTX* ssl_ctx(context.native_handle());
+          long const key_length(SSL_CTX_get_tlsext_ticket_keys(ssl_ctx, 0, 0));
+          if ((static_cast<long>(keys.size()) != key_length) ||
+              (SSL_CTX_set_tlsext_ticket_keys(ssl_ctx,
+                 const_cast<char*>(keys.data()), key_length) != 1))
+            throw std::invalid_argument
+                ("ssl_tcp_adaptor: invalid session ticket keys");
+        }
+
+        /// @fn set_session_ticket_keys
+        /// Set the keys that the process-wide ssl_context uses to encrypt
+        /// session tickets.
+        /// @throw invalid_argument if keys isn't the size required by
+        /// OpenSSL.
+        /// @param keys the ticket key name, HMAC key and AES key.
+        static void set_session_ticket_keys(std::string const& keys)
+        { set_session_ticket_keys(ssl_context(), keys); }
+
         /// @fn connect
         /// Connect the ssl tcp socket to the given host name and port.
         /// @pre To be called by "client" connections only.
@@ -144,7 +431,7 @@ namespace via
         bool connect(const char* host_name, const char* port_name,
                      ConnectHandler connect_handler)
         {
-          ssl_context().set_verify_mode(boost::asio::ssl::verify_peer);
+          socket_.set_verify_mode(boost::asio::ssl::verify_peer);
           socket_.set_verify_callback([]
             (bool preverified, boost::asio::ssl::verify_context& ctx)
               { return verify_certificate(preverified, ctx); });
@@ -153,6 +440,10 @@ namespace via
           if (host_iterator_ == boost::asio::ip::tcp::resolver::iterator())
             return false;
 
+          // Send the host name for Server Name Indication
+          SSL_set_tlsext_host_name(socket_.native_handle(),
+                                   const_cast<char*>(host_name));
+          session_key_ = std::string(host_name) + ":" + port_name;
           connect_socket(connect_handler, host_iterator_);
           return true;
         }
@@ -16,6 +16,13 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "socket_adaptor.hpp"
 #include "via/no_except.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#ifdef __linux__
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
 
 namespace via
 {
@@ -31,6 +38,15 @@ namespace via
     //////////////////////////////////////////////////////////////////////////
     class tcp_adaptor
     {
+    public:
+
+      /// The type of a socket's context: a void pointer, since unencrypted
+      /// sockets don't have a context.
+      /// @see ssl::ssl_tcp_adaptor::context_pointer
+      typedef std::shared_ptr<void> context_pointer;
+
+    private:
+
       boost::asio::io_service& io_service_; ///< The asio io_service.
       boost::asio::ip::tcp::socket socket_; ///< The asio TCP socket.
       /// The host iterator used by the resolver.
@@ -73,7 +89,9 @@ namespace via
 
       /// The tcp_adaptor constructor.
       /// @param io_service the asio io_service associted with this connection
-      explicit tcp_adaptor(boost::asio::io_service& io_service) :
+      // @param context unused, tcp sockets don't have a context.
+      explicit tcp_adaptor(boost::asio::io_service& io_service,
+                           context_pointer /*context*/ = context_pointer()) :
         io_service_(io_service),
         socket_(io_service_),
         host_iterator_()
@@ -91,6 +109,17 @@ namespace via
       /// The default size of the receive buffer.
       static const size_t DEFAULT_RX_BUFFER_SIZE = 8192;
 
+      /// Whether the adaptor supports wait_readable and read_available.
+      static const bool WAIT_READABLE = true;
+
+      /// Whether the adaptor supports wait_writable and send_file.
+      /// Only on Linux, where sendfile(2) can write to a socket.
+#ifdef __linux__
+      static const bool SEND_FILE = true;
+#else
+      static const bool SEND_FILE = false;
+#endif
+
       /// @fn connect
       /// Connect the tcp socket to the given host name and port.
       /// @pre To be called by "client" connections only.
@@ -120,6 +149,36 @@ namespace via
             (boost::asio::buffer(ptr, size), read_handler);
       }
 
+      /// @fn wait_readable
+      /// Wait until the tcp socket has data to read without requiring a
+      /// receive buffer, so that idle connections don't hold one.
+      /// @param read_handler the handler called when data is available.
+      void wait_readable(CommsHandler read_handler)
+      {
+        socket_.async_read_some(boost::asio::null_buffers(), read_handler);
+      }
+
+      /// @fn read_available
+      /// Read the data that is currently available on the tcp socket
+      /// without blocking.
+      /// @param ptr pointer to the receive buffer.
+      /// @param size the size of the receive buffer.
+      /// @param error the (boost) error code, would_block if no data is
+      /// available.
+      /// @return the number of bytes read.
+      size_t read_available(void* ptr, size_t size,
+                            boost::system::error_code& error)
+      {
+        if (!socket_.non_blocking())
+        {
+          socket_.non_blocking(true, error);
+          if (error)
+            return 0;
+        }
+
+        return socket_.read_some(boost::asio::buffer(ptr, size), error);
+      }
+
       /// @fn write
       /// The tcp socket write function.
       /// @param buffers the buffer(s) containing the message.
@@ -129,6 +188,59 @@ namespace via
         boost::asio::async_write(socket_, buffers, write_handler);
       }
 
+      /// @fn wait_writable
+      /// Wait until the tcp socket can be written to without blocking.
+      /// @param write_handler the handler called when the socket is writable.
+      void wait_writable(CommsHandler write_handler)
+      {
+        socket_.async_write_some(boost::asio::null_buffers(), write_handler);
+      }
+
+#ifdef __linux__
+      /// @fn send_file
+      /// Send data from a file to the tcp socket without blocking.
+      /// It uses sendfile(2), so the data is copied to the socket by the
+      /// kernel without passing through userspace.
+      /// @param fd the file descriptor.
+      /// @param offset the position of the data in the file.
+      /// @param length the number of bytes to send.
+      /// @retval error the (boost) error code, would_block if the socket is
+      /// full, eof if the file is shorter than offset + length.
+      /// @return the number of bytes sent.
+      size_t send_file(int fd, std::uint64_t offset, std::uint64_t length,
+                       boost::system::error_code& error)
+      {
+        error = boost::system::error_code();
+        if (!socket_.native_non_blocking())
+        {
+          socket_.native_non_blocking(true, error);
+          if (error)
+            return 0;
+        }
+
+        // sendfile transfers at most 0x7ffff000 bytes in a call
+        size_t const size(static_cast<size_t>
+                            (std::min<std::uint64_t>(length, 0x7ffff000)));
+        off_t position(static_cast<off_t>(offset));
+        ssize_t result(0);
+        do
+          result = ::sendfile(socket_.native_handle(), fd, &position, size);
+        while ((result < 0) && (errno == EINTR));
+
+        if (result > 0)
+          return static_cast<size_t>(result);
+
+        if (result == 0)
+          error = boost::asio::error::eof;
+        else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+          error = boost::asio::error::would_block;
+        else
+          error = boost::system::error_code(errno,
+                                            boost::system::system_category());
+        return 0;
+      }
+#endif
+
       /// @fn shutdown
       /// The tcp socket shutdown function.
       /// Disconnects the socket.
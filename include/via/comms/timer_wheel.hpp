@@ -0,0 +1,229 @@
+#ifndef TIMER_WHEEL_HPP_VIA_HTTPLIB_
+#define TIMER_WHEEL_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file timer_wheel.hpp
+/// @brief The timer_wheel class.
+//////////////////////////////////////////////////////////////////////////////
+#include "slot_map.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace via
+{
+  namespace comms
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class timer_wheel
+    /// A hashed timing wheel holding at most one timer per slot_handle.
+    /// Timers are kept in intrusive doubly linked lists, one per bucket of
+    /// the wheel, so arming, re-arming and cancelling a timer are O(1) and
+    /// don't allocate memory once the wheel has grown to hold the highest
+    /// slot index.
+    /// The owner calls tick at a fixed resolution. Each tick advances the
+    /// wheel by one bucket and expires the timers in it that are due;
+    /// timers longer than one revolution of the wheel stay in their bucket
+    /// until the revolution in which they are due.
+    /// It's a single level wheel rather than a hierarchical one: connection
+    /// timeouts are seldom longer than one revolution (128 seconds with
+    /// the default buckets and server resolution), so few timers are
+    /// visited more than once and there are no timers to cascade between
+    /// levels.
+    /// The wheel is not thread safe, the server guards it with a mutex.
+    /// @see slot_map
+    /// @see server
+    //////////////////////////////////////////////////////////////////////////
+    class timer_wheel
+    {
+    public:
+
+      /// The default number of buckets in the wheel.
+      static const size_t DEFAULT_NUMBER_OF_BUCKETS = 512;
+
+    private:
+
+      /// The index used for the end of a list.
+      static const std::uint32_t NONE = 0xFFFFFFFF;
+
+      /// A timer, at the index of its slot_handle.
+      struct timer
+      {
+        slot_handle handle;   ///< The handle of the timer.
+        std::uint64_t expiry; ///< The tick at which the timer expires.
+        std::uint32_t prev;   ///< The previous timer in the bucket.
+        std::uint32_t next;   ///< The next timer in the bucket.
+        bool armed;           ///< Whether the timer is in a bucket.
+      };
+
+      std::vector<timer> timers_;          ///< The timers.
+      std::vector<std::uint32_t> buckets_; ///< The first timer in each bucket.
+      std::vector<slot_handle> expired_;   ///< The timers expired by tick.
+      std::uint64_t current_tick_;         ///< The current tick.
+      size_t size_;                        ///< The number of armed timers.
+
+      /// The bucket for a tick.
+      /// @param tick the tick.
+      /// @return the index of the bucket.
+      size_t bucket(std::uint64_t tick) const NOEXCEPT
+      { return static_cast<size_t>(tick % buckets_.size()); }
+
+      /// Add a timer to the front of the list of its bucket.
+      /// @param index the index of the timer.
+      void link(std::uint32_t index) NOEXCEPT
+      {
+        timer& t(timers_[index]);
+        std::uint32_t& head(buckets_[bucket(t.expiry)]);
+        t.prev = NONE;
+        t.next = head;
+        if (head != NONE)
+          timers_[head].prev = index;
+        head = index;
+        t.armed = true;
+        ++size_;
+      }
+
+      /// Remove a timer from the list of its bucket.
+      /// @param index the index of the timer.
+      void unlink(std::uint32_t index) NOEXCEPT
+      {
+        timer& t(timers_[index]);
+        if (t.prev != NONE)
+          timers_[t.prev].next = t.next;
+        else
+          buckets_[bucket(t.expiry)] = t.next;
+        if (t.next != NONE)
+          timers_[t.next].prev = t.prev;
+        t.prev = NONE;
+        t.next = NONE;
+        t.armed = false;
+        --size_;
+      }
+
+    public:
+
+      /// Constructor.
+      /// @param number_of_buckets the number of buckets in the wheel,
+      /// default DEFAULT_NUMBER_OF_BUCKETS.
+      explicit timer_wheel
+          (size_t number_of_buckets = DEFAULT_NUMBER_OF_BUCKETS) :
+        timers_(),
+        buckets_(number_of_buckets ? number_of_buckets : 1,
+                 static_cast<std::uint32_t>(NONE)),
+        expired_(),
+        current_tick_(0),
+        size_(0)
+      {}
+
+      /// @fn arm
+      /// Arm the timer for a handle, replacing any timer already armed for
+      /// the slot.
+      /// @param handle the handle of the timer.
+      /// @param ticks the number of ticks until the timer expires, min 1.
+      void arm(slot_handle const& handle, std::uint64_t ticks)
+      {
+        if (handle.index >= timers_.size())
+        {
+          timer new_timer = { slot_handle(), 0, NONE, NONE, false };
+          timers_.resize(handle.index + 1, new_timer);
+        }
+        else if (timers_[handle.index].armed)
+          unlink(handle.index);
+
+        timer& t(timers_[handle.index]);
+        t.handle = handle;
+        t.expiry = current_tick_ + (ticks ? ticks : 1);
+        link(handle.index);
+      }
+
+      /// @fn cancel
+      /// Cancel the timer for a handle.
+      /// @param handle the handle of the timer.
+      /// @return true if the timer was armed, false otherwise.
+      bool cancel(slot_handle const& handle) NOEXCEPT
+      {
+        if (!is_armed(handle))
+          return false;
+
+        unlink(handle.index);
+        return true;
+      }
+
+      /// Whether the timer for a handle is armed.
+      /// @param handle the handle of the timer.
+      /// @return true if the timer is armed, false otherwise.
+      bool is_armed(slot_handle const& handle) const NOEXCEPT
+      {
+        return (handle.index < timers_.size()) &&
+                timers_[handle.index].armed &&
+               (timers_[handle.index].handle == handle);
+      }
+
+      /// @fn tick
+      /// Advance the wheel by one tick and call a function for each timer
+      /// that has expired.
+      /// The expired timers are removed before the function is called, so
+      /// the function may arm or cancel timers.
+      /// @param function the function to call with the handle of each
+      /// expired timer.
+      template <typename Function>
+      void tick(Function function)
+      {
+        ++current_tick_;
+        std::uint32_t index(buckets_[bucket(current_tick_)]);
+        while (index != NONE)
+        {
+          std::uint32_t next(timers_[index].next);
+          if (timers_[index].expiry <= current_tick_)
+          {
+            expired_.push_back(timers_[index].handle);
+            unlink(index);
+          }
+          index = next;
+        }
+
+        for (auto const& handle : expired_)
+          function(handle);
+        expired_.clear();
+      }
+
+      /// @fn clear
+      /// Cancel all of the timers.
+      void clear() NOEXCEPT
+      {
+        for (auto& t : timers_)
+        {
+          t.prev = NONE;
+          t.next = NONE;
+          t.armed = false;
+        }
+        for (auto& head : buckets_)
+          head = NONE;
+        size_ = 0;
+      }
+
+      /// The number of armed timers.
+      size_t size() const NOEXCEPT
+      { return size_; }
+
+      /// Whether no timers are armed.
+      bool empty() const NOEXCEPT
+      { return size_ == 0; }
+
+      /// The number of ticks since the wheel was created.
+      std::uint64_t current_tick() const NOEXCEPT
+      { return current_tick_; }
+    };
+  }
+}
+
+#endif
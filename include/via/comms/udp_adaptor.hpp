@@ -16,6 +16,7 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "socket_adaptor.hpp"
 #include "via/no_except.hpp"
+#include <memory>
 
 namespace via
 {
@@ -33,6 +34,15 @@ namespace via
     //////////////////////////////////////////////////////////////////////////
     class udp_adaptor
     {
+    public:
+
+      /// The type of a socket's context: a void pointer, since unencrypted
+      /// sockets don't have a context.
+      /// @see ssl::ssl_tcp_adaptor::context_pointer
+      typedef std::shared_ptr<void> context_pointer;
+
+    private:
+
       boost::asio::io_service& io_service_;        ///< The asio io_service.
       boost::asio::ip::udp::socket socket_;        ///< The asio UDP socket.
       boost::asio::ip::udp::endpoint rx_endpoint_; ///< The receive endpoint.
@@ -94,7 +104,9 @@ namespace via
 
       /// The udp_adaptor constructor.
       /// @param io_service the asio io_service associted with this connection
-      explicit udp_adaptor(boost::asio::io_service& io_service)
+      // @param context unused, udp sockets don't have a context.
+      explicit udp_adaptor(boost::asio::io_service& io_service,
+                           context_pointer /*context*/ = context_pointer())
         : io_service_(io_service)
         , socket_(io_service_)
         , rx_endpoint_(boost::asio::ip::address_v4::any(), 0)
@@ -111,6 +123,14 @@ namespace via
       /// The default size of the receive buffer.
       static const size_t DEFAULT_RX_BUFFER_SIZE = 2048;
 
+      /// Whether the adaptor supports wait_readable and read_available.
+      /// False: datagrams are read directly into a receive buffer.
+      static const bool WAIT_READABLE = false;
+
+      /// Whether the adaptor supports wait_writable and send_file.
+      /// False: files are read into buffers and sent as datagrams.
+      static const bool SEND_FILE = false;
+
       /// Enable multicast reception on the given port_number and address.
       /// @param port_number the UDP port
       /// @param multicast_address the multicast address to receive from.
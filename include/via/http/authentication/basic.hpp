@@ -15,6 +15,7 @@
 /// @brief Contains the basic authentication class.
 //////////////////////////////////////////////////////////////////////////////
 #include "authentication.hpp"
+#include <unordered_map>
 
 namespace via
 {
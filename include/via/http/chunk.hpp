@@ -220,6 +220,8 @@ namespace via
     {
       Container data_;           ///< the data contained in the chunk
       message_headers trailers_; ///< the HTTP field headers for the last chunk
+      size_t data_received_;     ///< the size of the data parsed by parse_data
+      bool cr_received_;         ///< true if the CR after the data was parsed
       bool valid_;               ///< true if the chunk is valid
 
     public:
@@ -249,6 +251,8 @@ namespace via
         data_(),
         trailers_(strict_crlf, max_whitespace, max_line_length,
                   max_header_number, max_header_length),
+        data_received_(0),
+        cr_received_(false),
         valid_(false)
       {}
 
@@ -259,6 +263,8 @@ namespace via
         chunk_header::clear();
         data_.clear();
         trailers_.clear();
+        data_received_ = 0;
+        cr_received_ = false;
         valid_ =  false;
       }
 
@@ -269,6 +275,8 @@ namespace via
         chunk_header::swap(other);
         data_.swap(other.data_);
         trailers_.swap(other.trailers_);
+        std::swap(data_received_, other.data_received_);
+        std::swap(cr_received_, other.cr_received_);
         std::swap(valid_, other.valid_);
       }
 
@@ -336,6 +344,76 @@ namespace via
         return valid_;
       }
 
+      /// Parse an HTTP chunk without copying its data into data().
+      /// The chunk data in the buffer is returned as a range instead, so the
+      /// data of a large chunk may be returned in several parts.
+      /// @retval iter reference to an iterator to the start of the data.
+      /// If the chunk is valid it will refer to:
+      ///   - the start of the next data chunk,
+      ///   - the start of the next http message, or
+      ///   - the end of the data buffer.
+      /// @param end the end of the data buffer.
+      /// @retval data_begin the start of the chunk data in the buffer.
+      /// @retval data_end the end of the chunk data in the buffer, equal to
+      /// data_begin if the buffer doesn't contain any chunk data.
+      /// @return true if the chunk is complete, false otherwise: the chunk
+      /// is invalid if iter is not at the end of the data buffer.
+      template<typename ForwardIterator>
+      bool parse_data(ForwardIterator& iter, ForwardIterator end,
+                      ForwardIterator& data_begin, ForwardIterator& data_end)
+      {
+        data_begin = iter;
+        data_end = iter;
+        if (!chunk_header::valid() && !chunk_header::parse(iter, end))
+          return false;
+
+        // Only the last chunk has a trailer.
+        if (chunk_header::is_last())
+        {
+          data_begin = iter;
+          data_end = iter;
+          if (!trailers_.parse(iter, end))
+            return false;
+        }
+        else
+        {
+          // the part of the data in the received buffer
+          size_t const rx_size(static_cast<size_t>(std::distance(iter, end)));
+          size_t const size(std::min(rx_size, chunk_header::size() -
+                                              data_received_));
+          data_begin = iter;
+          std::advance(iter, size);
+          data_end = iter;
+          data_received_ += size;
+          if (iter == end)
+            return false;
+
+          // Chunk should end in CRLF, which may be split across buffers
+          if (!cr_received_)
+          {
+            if ('\r' == *iter)
+            {
+              cr_received_ = true;
+              if (++iter == end)
+                return false;
+            }
+            else
+            { // enforce if strict
+              if (strict_crlf())
+                return false;
+            }
+          }
+
+          // But it must end with an LF
+          if ('\n' != *iter)
+            return false;
+          ++iter;
+        }
+
+        valid_ = true;
+        return valid_;
+      }
+
       /// Accessor for the chunk message trailers.
       /// @return a constant reference to the trailer message_headers
       const message_headers& trailers() const NOEXCEPT
@@ -0,0 +1,303 @@
+#ifndef COMPRESSION_HPP_VIA_HTTPLIB_
+#define COMPRESSION_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file compression.hpp
+/// @brief Classes and functions to compress HTTP response bodies.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/content_coding.hpp"
+#include "via/http/request.hpp"
+#include "via/http/response.hpp"
+#include "via/comms/file_handle.hpp"
+#include "via/comms/shared_buffer.hpp"
+#include "via/no_except.hpp"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class compression_cache
+    /// A cache of the compressed representations of static response
+    /// bodies, so that bodies that are sent repeatedly are only compressed
+    /// once. The bodies are identified without reading them:
+    ///   - a file segment by the file's device, inode, size and modification
+    ///     time and the position of the segment in the file,
+    ///   - a shared_buffer by the address of its data; the entry shares the
+    ///     (immutable) buffer, so the address can't be reused for different
+    ///     data while it's cached.
+    ///
+    /// Bodies sent in a Container are not cached, they are typically created
+    /// for a single response.
+    /// The least recently used entries are removed when the total size of
+    /// the entries exceeds the maximum.
+    /// The class is thread safe, so that it may be shared by connections
+    /// running in a thread pool.
+    //////////////////////////////////////////////////////////////////////////
+    class compression_cache
+    {
+    public:
+
+      /// The default maximum size of the cache, in bytes.
+      static const size_t DEFAULT_MAX_SIZE = 16 * 1024 * 1024;
+
+    private:
+
+      /// The key of a cache entry: the identity and coding of the body.
+      struct key_type
+      {
+        bool is_file;           ///< Whether the body is a file segment.
+        std::uint64_t device;   ///< The device of the file.
+        std::uint64_t inode;    ///< The inode of the file or the buffer address.
+        std::uint64_t size;     ///< The size of the file or the buffer.
+        std::int64_t modified;  ///< The modification time of the file.
+        std::uint64_t offset;   ///< The position of the segment in the file.
+        std::uint64_t length;   ///< The length of the segment.
+        content_coding::id coding; ///< The content coding.
+
+        bool operator<(key_type const& other) const NOEXCEPT;
+      };
+
+      /// A cached compressed body.
+      struct entry
+      {
+        comms::shared_buffer body;       ///< The shared body, if any.
+        comms::shared_buffer compressed; ///< The compressed body.
+        std::list<key_type>::iterator lru; ///< Position in lru_.
+
+        /// The size of the entry in bytes.
+        size_t size() const NOEXCEPT
+        { return body.size() + compressed.size(); }
+      };
+
+      /// The compressed bodies.
+      std::map<key_type, entry> entries_;
+      /// The keys of the entries, most recently used first.
+      std::list<key_type> lru_;
+      size_t max_size_; ///< The maximum size of the cache.
+      size_t size_;     ///< The size of the cache.
+      /// Mutex to protect the entries.
+      mutable std::mutex mutex_;
+
+      compression_cache(compression_cache const&) = delete;
+      compression_cache& operator=(compression_cache const&) = delete;
+
+      /// Remove a cache entry.
+      /// @param iter the entry's position in entries_.
+      void erase(std::map<key_type, entry>::iterator iter);
+
+      /// Remove the least recently used entries until the cache is no
+      /// larger than max_size_.
+      void trim();
+
+      /// Find a compressed body in the cache.
+      /// @param key the key of the body.
+      /// @return the compressed body, empty if it's not in the cache.
+      comms::shared_buffer find(key_type const& key);
+
+      /// Add a compressed body to the cache, if it's not larger than the
+      /// cache.
+      /// @param key the key of the body.
+      /// @param cached the entry.
+      void insert(key_type const& key, entry cached);
+
+    public:
+
+      /// Constructor.
+      /// @param max_size the maximum size of the cache in bytes,
+      /// default DEFAULT_MAX_SIZE.
+      explicit compression_cache(size_t max_size = DEFAULT_MAX_SIZE) :
+        entries_(),
+        lru_(),
+        max_size_(max_size),
+        size_(0),
+        mutex_()
+      {}
+
+      /// Compress a segment of a file, from the cache if possible.
+      /// A segment that's not in the cache is read, compressed and added to
+      /// it, unless it's larger than the cache.
+      /// @param coding the content coding.
+      /// @param level the compression level.
+      /// @param file the file segment.
+      /// @return the compressed segment, empty if the file can't be read.
+      comms::shared_buffer compress(content_coding::id coding, int level,
+                                    comms::file_segment const& file);
+
+      /// Compress a shared body, from the cache if possible.
+      /// A body that's not in the cache is compressed and added to it,
+      /// unless it's larger than the cache.
+      /// @param coding the content coding.
+      /// @param level the compression level.
+      /// @param body the body.
+      /// @return the compressed body.
+      comms::shared_buffer compress(content_coding::id coding, int level,
+                                    comms::shared_buffer const& body);
+
+      /// Set the maximum size of the cache.
+      /// Zero disables the cache.
+      /// @param max_size the maximum size of the cache in bytes.
+      void set_max_size(size_t max_size);
+
+      /// Remove all of the entries.
+      void clear();
+
+      /// The number of entries in the cache.
+      size_t size() const;
+
+      /// The total size of the shared bodies and compressed bodies in the
+      /// cache.
+      size_t bytes() const;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class response_compression
+    /// The response compression settings of an http_server.
+    /// It negotiates the content coding of the responses to a request from
+    /// its Accept-Encoding header and compresses the response bodies that
+    /// are worth compressing: i.e. successful responses with a compressible
+    /// Content-Type, no Content-Encoding and a body of at least min_size
+    /// bytes.
+    /// Files and shared_buffers are static bodies, they are compressed
+    /// through a compression_cache. Other bodies are compressed for each
+    /// response and chunked response bodies are compressed chunk by chunk
+    /// with an encoder.
+    /// @see http_server::enable_compression
+    //////////////////////////////////////////////////////////////////////////
+    class response_compression
+    {
+    public:
+
+      /// The default minimum size of a body to compress.
+      static const size_t DEFAULT_MIN_SIZE = 256;
+
+      /// The default maximum size of a body to cache.
+      static const size_t DEFAULT_MAX_CACHED_SIZE = 1024 * 1024;
+
+    private:
+
+      /// The content codings to negotiate, in order of preference.
+      std::vector<content_coding::id> codings_;
+      int level_;               ///< The compression level.
+      size_t min_size_;         ///< The minimum size of a body to compress.
+      size_t max_cached_size_;  ///< The maximum size of a body to cache.
+      /// The compressible Content-Type prefixes, e.g. "text/".
+      std::vector<std::string> content_types_;
+      compression_cache cache_; ///< The compressed bodies.
+
+      response_compression(response_compression const&) = delete;
+      response_compression& operator=(response_compression const&) = delete;
+
+    public:
+
+      /// Constructor.
+      /// The codings are brotli (if supported), gzip and deflate and the
+      /// compressible types are text, JSON, JavaScript, XML and SVG.
+      response_compression();
+
+      /// Set the content codings to negotiate.
+      /// @throw invalid_argument if a coding is not supported.
+      /// @param codings the content codings in order of preference, empty
+      /// disables compression.
+      void set_codings(std::vector<content_coding::id> const& codings);
+
+      /// Set the compression level.
+      /// @param level the compression level, default encoder::DEFAULT_LEVEL.
+      void set_level(int level) NOEXCEPT
+      { level_ = level; }
+
+      /// Set the minimum size of a body to compress, smaller bodies are not
+      /// worth compressing.
+      /// @param min_size the minimum size, default DEFAULT_MIN_SIZE.
+      void set_min_size(size_t min_size) NOEXCEPT
+      { min_size_ = min_size; }
+
+      /// Set the maximum size of a static body to cache, larger shared
+      /// bodies are compressed for each response and larger files are not
+      /// compressed.
+      /// @param max_size the maximum size, default DEFAULT_MAX_CACHED_SIZE.
+      void set_max_cached_size(size_t max_size) NOEXCEPT
+      { max_cached_size_ = max_size; }
+
+      /// Add a compressible Content-Type.
+      /// @param content_type the content type or a prefix of it, e.g.
+      /// "text/" for all text types.
+      void add_content_type(std::string const& content_type)
+      { content_types_.push_back(content_type); }
+
+      /// Accessor for the compressed body cache.
+      compression_cache& cache() NOEXCEPT
+      { return cache_; }
+
+      /// Accessor for the compression level.
+      int level() const NOEXCEPT
+      { return level_; }
+
+      /// Accessor for the maximum size of a body to cache.
+      size_t max_cached_size() const NOEXCEPT
+      { return max_cached_size_; }
+
+      /// Negotiate the content coding of the response to a request.
+      /// HEAD requests are not compressed, since the Content-Length of the
+      /// compressed body is not known without compressing it.
+      /// @param request the request.
+      /// @param is_head whether it's a HEAD request.
+      /// @return the content coding for the response, IDENTITY for none.
+      content_coding::id negotiate(rx_request const& request,
+                                   bool is_head) const;
+
+      /// Whether a response is worth compressing.
+      /// @param response the response.
+      /// @param size the size of its body, ignored for a chunked response.
+      /// @return true if the response body should be compressed.
+      bool is_compressible(tx_response const& response, size_t size) const;
+
+      /// Add the Content-Encoding and Vary headers of a compressed response.
+      /// @param coding the content coding of the response body.
+      /// @retval response the response.
+      static void add_headers(content_coding::id coding, tx_response& response);
+
+      /// Compress a response body.
+      /// @param coding the content coding.
+      /// @param data pointer to the body.
+      /// @param size the size of the body.
+      /// @return the compressed body.
+      comms::shared_buffer compress(content_coding::id coding,
+                                    char const* data, size_t size) const;
+
+      /// Compress a shared response body, from the cache if it's no larger
+      /// than max_cached_size.
+      /// @param coding the content coding.
+      /// @param body the body.
+      /// @return the compressed body.
+      comms::shared_buffer compress(content_coding::id coding,
+                                    comms::shared_buffer const& body);
+
+      /// Compress a response body from a file, from the cache.
+      /// @pre the segment is no larger than max_cached_size.
+      /// @param coding the content coding.
+      /// @param file the file segment.
+      /// @return the compressed body, empty if the file can't be read.
+      comms::shared_buffer compress(content_coding::id coding,
+                                    comms::file_segment const& file);
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef CONTENT_CODING_HPP_VIA_HTTPLIB_
+#define CONTENT_CODING_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file content_coding.hpp
+/// @brief Classes and functions to encode and decode HTTP message bodies.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    namespace content_coding
+    {
+      /// Ids for the content codings of a message body, see RFC7231.
+      /// DEFLATE and GZIP are only supported if the library was built with
+      /// HTTP_ZLIB defined and BROTLI if it was built with HTTP_BROTLI
+      /// defined, see is_supported.
+      enum id
+      {
+        IDENTITY,
+        DEFLATE,
+        GZIP,
+        BROTLI
+      };
+
+      /// The name of a content coding, as used in the Accept-Encoding and
+      /// Content-Encoding headers.
+      /// @param coding the content coding id.
+      /// @return the content coding name, e.g. "gzip".
+      const std::string& name(id coding) NOEXCEPT;
+
+      /// Find the content coding of a Content-Encoding header value.
+      /// The name is case insensitive and "x-gzip" is GZIP.
+      /// @param content_encoding the Content-Encoding header value.
+      /// @retval coding the content coding id.
+      /// @return true if the value is a single known content coding,
+      /// false otherwise.
+      bool find(std::string const& content_encoding, id& coding);
+
+      /// Whether the library can encode a content coding.
+      /// @param coding the content coding id.
+      /// @return true if it's supported, false otherwise.
+      bool is_supported(id coding) NOEXCEPT;
+
+      /// Negotiate the content coding of a response from the Accept-Encoding
+      /// header of the request, see RFC7231 section 5.3.4.
+      /// The coding with the highest quality value is selected, equal
+      /// quality values are selected in the order of the codings.
+      /// @param accept_encoding the Accept-Encoding header value.
+      /// @param codings the content codings that may be selected, in order
+      /// of preference.
+      /// @return the selected content coding, IDENTITY if none are acceptable.
+      id negotiate(std::string const& accept_encoding,
+                   std::vector<id> const& codings);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class encoder
+    /// Compresses data in a content coding: gzip, deflate (zlib format) or
+    /// brotli, as a stream, e.g. the chunks of a chunked response.
+    /// Each call to encode flushes the compressed data, so the output of
+    /// every call can be sent (and decompressed) without waiting for the
+    /// next one.
+    //////////////////////////////////////////////////////////////////////////
+    class encoder
+    {
+      struct stream;                   ///< The compression library's state.
+      std::unique_ptr<stream> stream_; ///< The compression stream.
+      bool finished_;                  ///< The stream has been finished.
+
+      encoder(encoder const&) = delete;
+      encoder& operator=(encoder const&) = delete;
+
+    public:
+
+      /// The default compression level: zlib's default level and a brotli
+      /// quality that's fast enough for dynamic content.
+      static const int DEFAULT_LEVEL = 6;
+
+      /// Constructor.
+      /// @throw invalid_argument if the coding is IDENTITY or it is not
+      /// supported.
+      /// @param coding the content coding.
+      /// @param level the compression level: 1 to 9 for gzip and deflate,
+      /// 0 to 11 for brotli, default DEFAULT_LEVEL.
+      explicit encoder(content_coding::id coding,
+                       int level = DEFAULT_LEVEL);
+
+      /// Destructor.
+      ~encoder();
+
+      /// Compress data, appending the compressed data to the output.
+      /// @param data pointer to the data.
+      /// @param size the size of the data.
+      /// @retval output the compressed data is appended to output.
+      /// @param finish whether this is the end of the data, it finishes
+      /// the stream so that any further data is ignored.
+      void encode(char const* data, size_t size, std::string& output,
+                  bool finish = false);
+
+      /// Whether the stream has been finished.
+      bool finished() const NOEXCEPT
+      { return finished_; }
+
+      /// Compress all of the data in one call.
+      /// @param coding the content coding.
+      /// @param level the compression level.
+      /// @param data pointer to the data.
+      /// @param size the size of the data.
+      /// @return the compressed data.
+      static std::string compress(content_coding::id coding, int level,
+                                  char const* data, size_t size)
+      {
+        std::string output;
+        encoder(coding, level).encode(data, size, output, true);
+        return output;
+      }
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class decoder
+    /// Decompresses data in the gzip or deflate (zlib format) content
+    /// codings as a stream, e.g. a request body as it's received.
+    /// The size of the decompressed data is limited, so that a small
+    /// compressed body can't expand to exhaust the memory.
+    //////////////////////////////////////////////////////////////////////////
+    class decoder
+    {
+    public:
+
+      /// The size of the buffer for each decompression step.
+      static const size_t BUFFER_SIZE = 4096;
+
+    private:
+
+      struct stream;                   ///< The compression library's state.
+      std::unique_ptr<stream> stream_; ///< The decompression stream.
+      size_t max_size_;                ///< The maximum decompressed size.
+      size_t size_;                    ///< The decompressed size.
+      bool finished_;                  ///< The end of the stream was decoded.
+      bool failed_;                    ///< The data is invalid or too large.
+
+      decoder(decoder const&) = delete;
+      decoder& operator=(decoder const&) = delete;
+
+      /// Decompress data until the buffer is full, the data is consumed,
+      /// the stream ends or the data is invalid.
+      /// @param data pointer to the data, it's advanced past the data that
+      /// has been consumed.
+      /// @param size the size of the data, it's reduced by the size of the
+      /// data that has been consumed.
+      /// @param buffer the buffer for the decompressed data.
+      /// @param buffer_size the size of the buffer.
+      /// @return the size of the decompressed data in the buffer.
+      size_t decode_some(char const*& data, size_t& size,
+                         char* buffer, size_t buffer_size);
+
+    public:
+
+      /// Constructor.
+      /// @throw invalid_argument if the coding is not GZIP or DEFLATE.
+      /// @param coding the content coding.
+      /// @param max_size the maximum size of the decompressed data.
+      decoder(content_coding::id coding, size_t max_size);
+
+      /// Destructor.
+      ~decoder();
+
+      /// Decompress data, appending the decompressed data to the output.
+      /// @param data pointer to the data.
+      /// @param size the size of the data.
+      /// @retval output the decompressed data is appended to output.
+      /// @return true if the data was decompressed, false if it's invalid
+      /// (including data after the end of the stream) or the decompressed
+      /// data would be larger than max_size, see too_large.
+      template <typename Container>
+      bool decode(char const* data, size_t size, Container& output)
+      {
+        char buffer[BUFFER_SIZE];
+        size_t length(BUFFER_SIZE);
+        while (length == BUFFER_SIZE)
+        {
+          length = decode_some(data, size, buffer, BUFFER_SIZE);
+          output.insert(output.end(), buffer, buffer + length);
+        }
+        return !failed_;
+      }
+
+      /// Whether the end of the stream has been decoded.
+      bool finished() const NOEXCEPT
+      { return finished_; }
+
+      /// Whether the decompressed data exceeded max_size.
+      bool too_large() const NOEXCEPT
+      { return failed_ && (size_ > max_size_); }
+
+      /// The size of the decompressed data.
+      size_t size() const NOEXCEPT
+      { return size_; }
+    };
+  }
+}
+
+#endif
@@ -16,6 +16,8 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/no_except.hpp"
 #include <string>
+#include <cstddef>
+#include <ctime>
 
 namespace via
 {
@@ -83,6 +85,10 @@ namespace via
         EXTENSION_HEADER
       };
 
+      /// The number of standard header field ids, i.e. excluding
+      /// EXTENSION_HEADER.
+      const size_t NUMBER_OF_IDS(static_cast<size_t>(id::EXTENSION_HEADER));
+
       /// Lookup the RFC2616 standard name for the given header field.
       /// @param id the header field id.
       /// @return the field name from RFC2616.
@@ -93,6 +99,12 @@ namespace via
       /// @return the field name from RFC2616 converted to lowercase.
       const std::string& lowercase_name(id field_id) NOEXCEPT;
 
+      /// Lookup the id of a header field from its lowercase name.
+      /// @param name the field name in lowercase.
+      /// @return the header field id, EXTENSION_HEADER if it's not a
+      /// standard header field.
+      id find_id(std::string const& name) NOEXCEPT;
+
       /// Format the field name and value into an http header line.
       /// @param name header field name.
       /// @param value header field value.
@@ -104,6 +116,33 @@ namespace via
       /// @param value header field value.
       std::string to_header(id field_id, std::string const& value);
 
+      /// The length of an HTTP date in RFC1123 format,
+      /// e.g. "Thu, 01 Oct 2015 12:00:00 GMT".
+      const size_t DATE_LENGTH(29);
+
+      /// Format a time as an HTTP date in RFC1123 format.
+      /// Note: it doesn't depend upon the locale and it's thread safe.
+      /// @param time the time to format.
+      /// @retval buffer the date, it must have room for DATE_LENGTH chars.
+      void format_date(std::time_t time, char* buffer) NOEXCEPT;
+
+      /// Parse an HTTP date in RFC1123 format, e.g. from an
+      /// If-Modified-Since header.
+      /// Note: the obsolete RFC850 and asctime formats are not accepted.
+      /// @param date the date string.
+      /// @return the time, or -1 if the date is not valid.
+      std::time_t parse_date(std::string const& date) NOEXCEPT;
+
+      /// Copy the current HTTP date.
+      /// The date is formatted at most once a second and shared between
+      /// threads without locking.
+      /// @retval buffer the date, it must have room for DATE_LENGTH chars.
+      void current_date(char* buffer) NOEXCEPT;
+
+      /// Append an http header line for the current date and time.
+      /// @retval header_string the string to append the Date header to.
+      void append_date_header(std::string& header_string);
+
       /// Create an http header line for the current date and time.
       std::string date_header();
 
@@ -16,7 +16,12 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "header_field.hpp"
 #include "character.hpp"
-#include <unordered_map>
+#include "scanner.hpp"
+#include <boost/utility/string_ref.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 namespace via
 {
@@ -30,9 +35,41 @@ namespace via
       RX_EXPECT_CONTINUE, ///< the client expects a 100 Continue response
       RX_INCOMPLETE,      ///< the message requires more data
       RX_VALID,           ///< a valid request or response
-      RX_CHUNK            ///< a valid chunk received
+      RX_CHUNK,           ///< a valid chunk received
+      RX_BODY             ///< part of a streamed request body received
     };
 
+    /// A non-owning reference to a string of characters.
+    typedef boost::string_ref string_view;
+
+    /// Functions to evaluate the values of the header fields that determine
+    /// how to receive a message, shared by message_headers and
+    /// rx_request_view.
+    namespace field_value
+    {
+      /// The length in a Content-Length field value.
+      /// @param value the field value.
+      /// @return the length, zero if empty, -1 if invalid.
+      std::ptrdiff_t content_length(string_view value) NOEXCEPT;
+
+      /// Whether a Transfer-Encoding field value is chunked.
+      /// Note: it's chunked if the value is not empty and "identity" is NOT
+      /// found.
+      /// @param value the field value.
+      /// @return true if it's chunked, false otherwise.
+      bool is_chunked(string_view value) NOEXCEPT;
+
+      /// Whether a Connection field value contains "close".
+      /// @param value the field value.
+      /// @return true if the connection should be closed, false otherwise.
+      bool is_close(string_view value) NOEXCEPT;
+
+      /// Whether an Expect field value contains "100-continue".
+      /// @param value the field value.
+      /// @return true if the client expects a 100 Continue response.
+      bool is_continue(string_view value) NOEXCEPT;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     /// @class field_line
     /// An HTTP header field.
@@ -128,6 +165,36 @@ namespace via
       {
         while ((iter != end) && (HEADER_VALID != state_))
         {
+          // Scan the bulk of the name or value up to a delimiter or the
+          // line length limit
+          bool const is_name(HEADER_NAME == state_);
+          if (is_name || (HEADER_VALUE == state_))
+          {
+            scanner const& functions(scanner::instance());
+            size_t length(scan(is_name ? functions.find_not_name
+                                       : functions.find_eol, iter, end,
+                               (length_ < max_line_length_) ?
+                                 max_line_length_ - length_ : 0));
+            if (length > 0)
+            {
+              ForwardIterator next(iter);
+              std::advance(next, length);
+              if (is_name)
+              {
+                for (; iter != next; ++iter)
+                  name_.push_back(static_cast<char>
+                      (std::tolower(static_cast<unsigned char>(*iter))));
+              }
+              else
+              {
+                value_.append(iter, next);
+                iter = next;
+              }
+              length_ += length;
+              continue;
+            }
+          }
+
           char c(static_cast<char>(*iter++));
           if (!parse_char(c))
             return false;
@@ -157,6 +224,11 @@ namespace via
       /// Calculate the length of the header.
       size_t length() const NOEXCEPT
       { return name_.size() + value_.size(); }
+
+      /// Whether part of a field line has been parsed, e.g. if the line was
+      /// split between received packets.
+      bool is_partial() const NOEXCEPT
+      { return (HEADER_NAME != state_) || !name_.empty(); }
     }; // class field_line
 
     //////////////////////////////////////////////////////////////////////////
@@ -164,23 +236,61 @@ namespace via
     /// The collection of HTTP headers received with a request, response or a
     /// chunk (trailers).
     /// Note: the parse function converts the received field names into lower
-    /// case before storing them in a unordered_map for efficient access.
+    /// case before storing them in a vector in the order that they were
+    /// received. The standard header fields are also indexed by their
+    /// header_field::id, so that they can be found without searching and
+    /// the values of the fields that determine how to receive a message
+    /// (content length, chunked, connection close and expect continue) are
+    /// only evaluated once per message.
     /// @see rx_request
     /// @see rx_response
     /// @see rx_chunk
     //////////////////////////////////////////////////////////////////////////
     class message_headers
     {
+    public:
+
+      /// A header field: its lowercase name and value.
+      typedef std::pair<std::string, std::string> field_type;
+
+      /// The header fields, in the order that they were received.
+      typedef std::vector<field_type> field_collection;
+
+    private:
+
+      /// The index of a standard header field that hasn't been received.
+      static const unsigned short NOT_FOUND = 0xFFFF;
+
       /// Parser parameters
       unsigned short max_header_number_; ///< the max no of header fields
       size_t         max_header_length_; ///< the max cumulative length
 
       /// The HTTP message header fields.
-      std::unordered_map<std::string, std::string> fields_;
+      field_collection fields_;
+      /// The indices of the standard header fields in fields_.
+      unsigned short indices_[header_field::NUMBER_OF_IDS];
       field_line field_; ///< the current field being parsed
       bool       valid_; ///< true if the headers are valid
       size_t     length_; ///< the length of the message headers
 
+      /// Cached values of the message header fields
+      std::ptrdiff_t content_length_;  ///< the Content-Length value
+      bool           is_chunked_;      ///< Transfer-Encoding isn't identity
+      bool           close_connection_; ///< Connection: close
+      bool           expect_continue_; ///< Expect: 100-continue
+
+      /// Clear the indices of the standard header fields.
+      void clear_indices() NOEXCEPT
+      {
+        std::fill(indices_, indices_ + header_field::NUMBER_OF_IDS,
+                  static_cast<unsigned short>(NOT_FOUND));
+      }
+
+      /// Update the cached value for a header field.
+      /// @param field_id the id of the header field.
+      /// @param value the value of the header field.
+      void update_cache(header_field::id field_id, const std::string& value);
+
     public:
 
       /// Constructor.
@@ -205,17 +315,26 @@ namespace via
         fields_(),
         field_(strict_crlf, max_whitespace, max_line_length),
         valid_(false),
-        length_(0)
-      {}
+        length_(0),
+        content_length_(0),
+        is_chunked_(false),
+        close_connection_(false),
+        expect_continue_(false)
+      { clear_indices(); }
 
       /// Clear the message_headers.
       /// Sets all member variables to their initial state.
       void clear() NOEXCEPT
       {
         fields_.clear();
+        clear_indices();
         field_.clear();
         valid_ = false;
         length_ = 0;
+        content_length_ = 0;
+        is_chunked_ = false;
+        close_connection_ = false;
+        expect_continue_ = false;
       }
 
       /// Swap member variables with another message_headers.
@@ -223,9 +342,15 @@ namespace via
       void swap(message_headers& other) NOEXCEPT
       {
         fields_.swap(other.fields_);
+        std::swap_ranges(indices_, indices_ + header_field::NUMBER_OF_IDS,
+                         other.indices_);
         field_.swap(other.field_);
         std::swap(valid_, other.valid_);
         std::swap(length_, other.length_);
+        std::swap(content_length_, other.content_length_);
+        std::swap(is_chunked_, other.is_chunked_);
+        std::swap(close_connection_, other.close_connection_);
+        std::swap(expect_continue_, other.expect_continue_);
       }
 
       /// Parse message_headers from a received request or response.
@@ -236,7 +361,8 @@ namespace via
       template<typename ForwardIterator>
       bool parse(ForwardIterator& iter, ForwardIterator end)
       {
-        while (iter != end && !is_end_of_line(*iter))
+        // Note: a partial field line may continue with its CR or LF
+        while (iter != end && (field_.is_partial() || !is_end_of_line(*iter)))
         {
          // field_line field;
           if (!field_.parse(iter, end))
@@ -282,38 +408,42 @@ namespace via
       /// Find the value for a given header id.
       /// @param field_id the id of the header.
       /// @return the value, blank if not found
-      const std::string& find(header_field::id field_id) const
-      { return find(header_field::lowercase_name(field_id)); }
+      const std::string& find(header_field::id field_id) const NOEXCEPT;
 
       /// If there is a Content-Length field return its size.
       /// @return the value of the Content-Length field or
       /// -1 if it was invalid.
       /// May also return zero if it was not found.
-      std::ptrdiff_t content_length() const NOEXCEPT;
+      std::ptrdiff_t content_length() const NOEXCEPT
+      { return content_length_; }
 
       /// Whether Chunked Transfer Coding is applied to the message.
       /// @return true if there is a transfer-encoding header and it does
       /// NOT contain the keyword "identity". See RFC2616 section 4.4 para 2.
-      bool is_chunked() const;
+      bool is_chunked() const NOEXCEPT
+      { return is_chunked_; }
 
       /// Whether the connection should be closed after the response.
       /// @return true if there is a Connection: close header, false otherwise
-      bool close_connection() const;
+      bool close_connection() const NOEXCEPT
+      { return close_connection_; }
 
       /// Whether the client expects a "100-continue" response.
       /// @return true if there is an Expect: 100-continue header, false
       /// otherwise
-      bool expect_continue() const;
+      bool expect_continue() const NOEXCEPT
+      { return expect_continue_; }
 
       /// Accessor for the valid flag.
       /// @return the valid flag.
       bool valid() const NOEXCEPT
       { return valid_; }
 
-      // @return headers as a map
-      const std::unordered_map<std::string, std::string>& fields() const
+      /// Accessor for the header fields.
+      /// @return the header fields in the order that they were received.
+      const field_collection& fields() const NOEXCEPT
       { return fields_; }
-      
+
       /// Output the message_headers as a string.
       /// Note: it is NOT terminated with an extra CRLF tso that it parses
       /// the are_headers_split function.
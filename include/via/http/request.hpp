@@ -18,7 +18,13 @@
 #include "response_status.hpp"
 #include "headers.hpp"
 #include "chunk.hpp"
+#include "scanner.hpp"
+#include "content_coding.hpp"
+#include "via/metrics.hpp"
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <utility>
 
 namespace via
 {
@@ -63,6 +69,7 @@ namespace via
 
       // Request information
       std::string method_;   ///< the request method
+      request_method::id method_id_; ///< the request method id
       std::string uri_;      ///< the request uri
       char major_version_;   ///< the HTTP major version character
       char minor_version_;   ///< the HTTP minor version character
@@ -103,6 +110,7 @@ namespace via
         max_uri_length_(max_uri_length),
 
         method_(),
+        method_id_(request_method::id::EXTENSION_METHOD),
         uri_(),
         major_version_(0),
         minor_version_(0),
@@ -118,6 +126,7 @@ namespace via
       void clear() NOEXCEPT
       {
         method_.clear();
+        method_id_ = request_method::id::EXTENSION_METHOD;
         uri_.clear();
         major_version_ = 0;
         minor_version_ = 0;
@@ -133,6 +142,7 @@ namespace via
       void swap(request_line& other) NOEXCEPT
       {
         method_.swap(other.method_);
+        std::swap(method_id_, other.method_id_);
         uri_.swap(other.uri_);
         std::swap(major_version_, other.major_version_);
         std::swap(minor_version_, other.minor_version_);
@@ -161,6 +171,21 @@ namespace via
       {
         while ((iter != end) && (REQ_VALID != state_))
         {
+          // Scan the bulk of the uri up to a delimiter or the length limit
+          if (REQ_URI == state_)
+          {
+            size_t length(scan(scanner::instance().find_ws_or_eol, iter, end,
+                               max_uri_length_ - uri_.size()));
+            if (length > 0)
+            {
+              ForwardIterator next(iter);
+              std::advance(next, length);
+              uri_.append(iter, next);
+              iter = next;
+              continue;
+            }
+          }
+
           char c(*iter++);
           if ((fail_ = !parse_char(c))) // Note: deliberate assignment
             return false;
@@ -171,11 +196,17 @@ namespace via
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
-      /// Accessor for the HTTP minor version number.
-      /// @return the minor version number.
+      /// Accessor for the request method.
+      /// @return the request method string.
       const std::string& method() const NOEXCEPT
       { return method_; }
 
+      /// Accessor for the request method id.
+      /// @return the request method id, EXTENSION_METHOD if it's not a
+      /// standard method.
+      request_method::id method_id() const NOEXCEPT
+      { return method_id_; }
+
       /// Accessor for the request uri.
       /// @return the request uri string.
       const std::string& uri() const NOEXCEPT
@@ -234,6 +265,7 @@ namespace via
         max_uri_length_(1024),
 
         method_(request_method::name(method_id)),
+        method_id_(method_id),
         uri_(uri),
         major_version_(major_version),
         minor_version_(minor_version),
@@ -259,6 +291,7 @@ namespace via
         max_uri_length_(1024),
 
         method_(method),
+        method_id_(request_method::find_id(method)),
         uri_(uri),
         major_version_(major_version),
         minor_version_(minor_version),
@@ -272,7 +305,18 @@ namespace via
       /// Set the request method.
       /// @param method the HTTP request method.
       void set_method(const std::string& method)
-      { method_ = method; }
+      {
+        method_ = method;
+        method_id_ = request_method::find_id(method);
+      }
+
+      /// Set the request method to one of the standard methods.
+      /// @param method_id the HTTP request method id.
+      void set_method(request_method::id method_id)
+      {
+        method_ = request_method::name(method_id);
+        method_id_ = method_id;
+      }
 
       /// Set the request uri.
       /// @param uri the HTTP request uri.
@@ -431,12 +475,12 @@ namespace via
       /// Whether the request is "HEAD"
       /// @return true if the request is "HEAD"
       bool is_head() const NOEXCEPT
-      { return request_method::name(request_method::id::HEAD) == method(); }
+      { return request_method::id::HEAD == method_id(); }
 
       /// Whether the request is "TRACE"
       /// @return true if the request is "TRACE"
       bool is_trace() const NOEXCEPT
-      { return request_method::name(request_method::id::TRACE) == method(); }
+      { return request_method::id::TRACE == method_id(); }
     }; // class rx_request
 
     //////////////////////////////////////////////////////////////////////////
@@ -534,6 +578,18 @@ namespace via
     //////////////////////////////////////////////////////////////////////////
     /// @class request_receiver
     /// A template class to receive HTTP requests and any associated data.
+    ///
+    /// By default the request body (or the data of its chunks) is
+    /// accumulated into body() up to max_body_size. If the body is streamed,
+    /// the request is valid when its header has been received and receive
+    /// returns RX_BODY for each part of the body instead: body_data returns
+    /// the part of the body in the received data, whether the body has a
+    /// Content-Length or is chunked. The chunk data is not copied.
+    ///
+    /// If decompression is enabled, an accumulated body with a gzip or
+    /// deflate Content-Encoding is decompressed into body() as it's
+    /// received, up to max_decompressed_size. Streamed bodies and chunks
+    /// that are not concatenated are not decompressed.
     /// @param Container the type of container in which the request is held.
     //////////////////////////////////////////////////////////////////////////
     template <typename Container>
@@ -541,20 +597,183 @@ namespace via
     {
       /// Parser parameters
       size_t max_body_size_;       ///< the maximum size of a request body.
+      /// the maximum size of a decompressed request body, zero if request
+      /// bodies are not decompressed.
+      size_t max_decompressed_size_;
 
       /// Behaviour
       bool   translate_head_;      ///< pass a HEAD request as a GET request.
       bool   concatenate_chunks_;  ///< concatenate chunk data into the body
+      bool   stream_body_;         ///< deliver the body as it's received
 
       /// Request information
       rx_request request_;         ///< the received request
       rx_chunk<Container> chunk_;  ///< the received chunk
       Container  body_;    ///< the request body or data for the last chunk
+      std::unique_ptr<decoder> decoder_; ///< decompresses the request body
       /// the appropriate response to the request:
       /// either an error code or 100 Continue.
       response_status::code response_code_;
       bool       continue_sent_;   ///< a 100 Continue response has been sent
       bool       is_head_;         ///< whether it's a HEAD request
+      size_t     body_received_;   ///< the size of the body received
+      bool       body_pending_;    ///< more of a streamed body is expected
+      /// the offset of the streamed body data from the start of the data
+      /// passed to the last call of receive.
+      size_t     body_offset_;
+      size_t     body_size_;       ///< the size of the streamed body data
+      /// the time spent parsing the request so far, in nanoseconds.
+      unsigned long long parse_time_;
+
+      /// The ids of the request metrics in the metrics_registry.
+      struct metric_ids
+      {
+        size_t parsed;     ///< The number of valid requests.
+        size_t parse_time; ///< The time to receive a valid request.
+        /// The number of invalid requests, by the response codes that
+        /// receive_data sets for invalid requests.
+        std::map<response_status::code, size_t> invalid;
+
+        metric_ids() :
+          parsed    (metrics_registry::instance().
+                       counter("via_http_requests_parsed_total")),
+          parse_time(metrics_registry::instance().
+                       histogram("via_http_request_parse_duration_ns")),
+          invalid   ()
+        {
+          static const response_status::code codes[] =
+          {
+            response_status::code::BAD_REQUEST,
+            response_status::code::METHOD_NOT_ALLOWED,
+            response_status::code::LENGTH_REQUIRED,
+            response_status::code::PAYLOAD_TOO_LARGE,
+            response_status::code::REQUEST_URI_TOO_LONG,
+            response_status::code::UNSUPPORTED_MEDIA_TYPE,
+            response_status::code::NOT_IMPLEMENTED
+          };
+          for (auto code : codes)
+            invalid.insert(std::make_pair(code, invalid_counter(code)));
+        }
+
+        /// Register the invalid requests counter of a response code.
+        static size_t invalid_counter(response_status::code code)
+        {
+          return metrics_registry::instance().counter
+              ("via_http_requests_invalid_total{code=\""
+               + std::to_string(static_cast<int>(code)) + "\"}");
+        }
+      };
+
+      /// The ids of the request metrics, registered on first use.
+      static metric_ids const& metrics()
+      {
+        static const metric_ids ids;
+        return ids;
+      }
+
+      /// Record the result of receiving a request in the metrics_registry.
+      /// Valid requests are counted with the time spent parsing them and
+      /// invalid requests are counted by their response code.
+      /// @param rx the result of receive_data.
+      void count_request(Rx rx)
+      {
+        if (!metrics_registry::ENABLED)
+          return;
+
+        metrics_registry& registry(metrics_registry::instance());
+        if (rx == RX_VALID)
+        {
+          registry.add(metrics().parsed);
+          registry.observe(metrics().parse_time, parse_time_);
+          parse_time_ = 0;
+        }
+        else if (rx == RX_INVALID)
+        {
+          auto const iter(metrics().invalid.find(response_code_));
+          registry.add((iter != metrics().invalid.end())
+                         ? iter->second
+                         : metric_ids::invalid_counter(response_code_));
+          parse_time_ = 0;
+        }
+      }
+
+      /// Create a decoder for the request body if decompression is enabled
+      /// and the request has a Content-Encoding.
+      /// @return false if the Content-Encoding can't be decompressed,
+      /// true otherwise.
+      bool create_decoder()
+      {
+        decoder_.reset();
+        if (max_decompressed_size_ == 0)
+          return true;
+
+        std::string const& content_encoding
+            (request_.headers().find(header_field::id::CONTENT_ENCODING));
+        if (content_encoding.empty())
+          return true;
+
+        content_coding::id coding(content_coding::IDENTITY);
+        if (!content_coding::find(content_encoding, coding) ||
+            (coding == content_coding::BROTLI) ||
+            !content_coding::is_supported(coding))
+        {
+          response_code_ = response_status::code::UNSUPPORTED_MEDIA_TYPE;
+          clear();
+          return false;
+        }
+
+        if (coding != content_coding::IDENTITY)
+          decoder_.reset(new decoder(coding, max_decompressed_size_));
+        return true;
+      }
+
+      /// Add received data to the request body, decompressing it if required.
+      /// @param begin an iterator to the beginning of the data.
+      /// @param end an iterator to the end of the data.
+      /// @return false if the data could not be decompressed, true otherwise.
+      template<typename ForwardIterator>
+      bool add_body(ForwardIterator begin, ForwardIterator end)
+      {
+        if (!decoder_)
+        {
+          body_.insert(body_.end(), begin, end);
+          return true;
+        }
+
+        if ((begin == end) ||
+            decoder_->decode(&*begin,
+                             static_cast<size_t>(std::distance(begin, end)),
+                             body_))
+          return true;
+
+        response_code_ = decoder_->too_large()
+                           ? response_status::code::PAYLOAD_TOO_LARGE
+                           : response_status::code::BAD_REQUEST;
+        clear();
+        return false;
+      }
+
+      /// Whether a decompressed request body is complete.
+      /// @return false if the compressed data ended before the end of its
+      /// stream, true otherwise.
+      bool body_complete()
+      {
+        if (!decoder_ || decoder_->finished())
+          return true;
+
+        response_code_ = response_status::code::BAD_REQUEST;
+        clear();
+        return false;
+      }
+
+      /// The request is valid: translate a HEAD request if required.
+      void request_valid()
+      {
+        is_head_ = request_.is_head();
+        // If enabled, translate a HEAD request to a GET request
+        if (is_head_ && translate_head_)
+          request_.set_method(request_method::id::GET);
+      }
 
     public:
 
@@ -613,16 +832,24 @@ namespace via
                                 size_t         max_body_size,
                                 size_t         max_chunk_size) :
         max_body_size_(max_body_size),
+        max_decompressed_size_(0),
         translate_head_(true),
         concatenate_chunks_(true),
+        stream_body_(false),
         request_(strict_crlf, max_whitespace, max_method_length, max_uri_length,
                  max_line_length, max_header_number, max_header_length),
         chunk_(strict_crlf, max_whitespace, max_line_length, max_chunk_size,
                max_header_number, max_header_length),
         body_(),
+        decoder_(),
         response_code_(response_status::code::NO_CONTENT),
         continue_sent_(false),
-        is_head_(false)
+        is_head_(false),
+        body_received_(0),
+        body_pending_(false),
+        body_offset_(0),
+        body_size_(0),
+        parse_time_(0)
       {}
 
       /// Enable whether HEAD requests are translated into GET
@@ -636,6 +863,23 @@ namespace via
       void set_concatenate_chunks(bool enable) NOEXCEPT
       { concatenate_chunks_ = enable; }
 
+      /// Enable whether request bodies are streamed.
+      /// @post the body and chunks are not accumulated, receive returns
+      /// RX_BODY for each part of the body instead and max_body_size is not
+      /// applied.
+      /// @param enable enable the function.
+      void set_stream_body(bool enable) NOEXCEPT
+      { stream_body_ = enable; }
+
+      /// Set the maximum size of a decompressed request body, enabling the
+      /// decompression of gzip and deflate request bodies.
+      /// A body that can't be decompressed is invalid: 415 Unsupported
+      /// Media Type for an unsupported Content-Encoding, 413 Payload Too
+      /// Large if it exceeds max_size and 400 Bad Request if it's corrupt.
+      /// @param max_size the maximum size, zero disables decompression.
+      void set_max_decompressed_size(size_t max_size) NOEXCEPT
+      { max_decompressed_size_ = max_size; }
+
       /// set the continue_sent_ flag
       void set_continue_sent() NOEXCEPT
       { continue_sent_ = true; }
@@ -647,9 +891,37 @@ namespace via
         request_.clear();
         chunk_.clear();
         body_.clear();
+        decoder_.reset();
         // response_code_ is required for response so NOT cleared.
         continue_sent_ = false;
         is_head_ = false;
+        body_received_ = 0;
+        body_pending_ = false;
+        body_offset_ = 0;
+        body_size_ = 0;
+        parse_time_ = 0;
+      }
+
+      /// Whether more of a streamed request body is expected.
+      /// @return true if a valid request's body is being streamed and it's
+      /// not complete, false otherwise.
+      bool body_pending() const NOEXCEPT
+      { return body_pending_; }
+
+      /// The part of a streamed request body in the received data.
+      /// @pre receive returned RX_BODY.
+      /// @param begin the iterator passed to receive, i.e. to the beginning
+      /// of the received data.
+      /// @return the range of the body data in the received data, it may
+      /// be empty, e.g. for the last chunk.
+      template<typename ForwardIterator>
+      std::pair<ForwardIterator, ForwardIterator>
+        body_data(ForwardIterator begin) const
+      {
+        std::advance(begin, body_offset_);
+        ForwardIterator end(begin);
+        std::advance(end, body_size_);
+        return std::make_pair(begin, end);
       }
 
       /// Accessor for the is_head flag.
@@ -666,6 +938,13 @@ namespace via
       rx_chunk<Container> const& chunk() const NOEXCEPT
       { return chunk_; }
 
+      /// Whether the request body has been decompressed.
+      /// Note: the request's Content-Encoding and Content-Length headers
+      /// describe the received (compressed) body.
+      /// @return true if body() is the decompressed body, false otherwise.
+      bool body_decompressed() const NOEXCEPT
+      { return static_cast<bool>(decoder_); }
+
       /// Accessor for the request body / last chunk data.
       /// @return a constant reference to the data.
       Container const& body() const NOEXCEPT
@@ -685,11 +964,29 @@ namespace via
       }
 
       /// Receive data for an HTTP request, body or data chunk.
+      /// The time spent receiving each request and the reasons that
+      /// requests are invalid are recorded in the metrics_registry.
       /// @param iter an iterator to the beginning of the received data.
       /// @param end an iterator to the end of the received data.
       template<typename ForwardIterator>
       Rx receive(ForwardIterator& iter, ForwardIterator end)
       {
+        metrics_timer const timer;
+        Rx const rx(receive_data(iter, end));
+        parse_time_ += timer.nanoseconds();
+        count_request(rx);
+        return rx;
+      }
+
+      /// Receive data for an HTTP request, body or data chunk, without
+      /// recording it in the metrics_registry.
+      /// @param iter an iterator to the beginning of the received data.
+      /// @param end an iterator to the end of the received data.
+      template<typename ForwardIterator>
+      Rx receive_data(ForwardIterator& iter, ForwardIterator end)
+      {
+        ForwardIterator const start(iter);
+
         // building a request
         bool request_parsed(!request_.valid());
         if (request_parsed)
@@ -760,16 +1057,21 @@ namespace via
             // if theres a valid non-zero content length header
             if (content_length > 0)
             {
-              // test the size
-              if (content_length > static_cast<std::ptrdiff_t>(max_body_size_))
+              // test the size, a streamed body is not limited
+              if (!stream_body_ &&
+                  (content_length > static_cast<std::ptrdiff_t>(max_body_size_)))
               {
                 response_code_ = response_status::code::PAYLOAD_TOO_LARGE;
                 clear();
                 return RX_INVALID;
               }
-            } // if there's a body without a  content length header
+            } // if there's a POST or PUT body without a content length header
+            // Note: other requests without a content length don't have a
+            // body, so the data is the next (pipelined) request
             else if ((rx_size > 0) && request_.headers().
-                                find(header_field::id::CONTENT_LENGTH).empty())
+                                find(header_field::id::CONTENT_LENGTH).empty() &&
+                     ((request_method::id::POST == request_.method_id()) ||
+                      (request_method::id::PUT  == request_.method_id())))
             {
               response_code_ = response_status::code::LENGTH_REQUIRED;
               clear();
@@ -777,31 +1079,50 @@ namespace via
             }
           }
 
-          // received buffer contains more than the required data
-          std::ptrdiff_t required(content_length -
-                                  static_cast<std::ptrdiff_t>(body_.size()));
-          if (rx_size > required)
-          {
-              ForwardIterator next(iter + required);
-              body_.insert(body_.end(), iter, next);
-              iter = next;
-          }
-          else // received buffer <= required data
+          // decompress an accumulated body if required
+          if (request_parsed && (content_length > 0) && !stream_body_ &&
+              !create_decoder())
+            return RX_INVALID;
+
+          // deliver the request header, then stream the body
+          if (stream_body_)
           {
-            if (end > iter)
+            if (request_parsed)
             {
-              body_.insert(body_.end(), iter, end);
-              iter = end;
+              request_valid();
+              body_pending_ = (content_length > 0);
+              return RX_VALID;
             }
+
+            // the part of the body in the received buffer
+            std::ptrdiff_t required(content_length -
+                                    static_cast<std::ptrdiff_t>(body_received_));
+            std::ptrdiff_t size(std::min(rx_size, required));
+            body_offset_ = static_cast<size_t>(std::distance(start, iter));
+            body_size_ = static_cast<size_t>(size);
+            std::advance(iter, size);
+            body_received_ += static_cast<size_t>(size);
+            body_pending_ = (size < required);
+            return RX_BODY;
           }
 
+          // the part of the body in the received buffer, the received
+          // buffer may contain more than the required data
+          std::ptrdiff_t required(content_length -
+                                  static_cast<std::ptrdiff_t>(body_received_));
+          ForwardIterator next((rx_size > required) ? iter + required : end);
+          body_received_ += static_cast<size_t>(std::distance(iter, next));
+          if (!add_body(iter, next))
+            return RX_INVALID;
+          iter = next;
+
           // determine whether the body is complete
-          if (body_.size() == static_cast<size_t>(request_.content_length()))
+          if (body_received_ == static_cast<size_t>(content_length))
           {
-            is_head_ = request_.is_head();
-            // If enabled, translate a HEAD request to a GET request
-            if (is_head_ && translate_head_)
-              request_.set_method(request_method::name(request_method::id::GET));
+            if (!body_complete())
+              return RX_INVALID;
+
+            request_valid();
             return RX_VALID;
           }
         }
@@ -815,6 +1136,10 @@ namespace via
           // If parsed the request header, respond if necessary
           if (request_parsed)
           {
+            // decompress concatenated chunks if required
+            if (concatenate_chunks_ && !stream_body_ && !create_decoder())
+              return RX_INVALID;
+
             if (request_.expect_continue() && !continue_sent_)
             {
               response_code_ = response_status::code::CONTINUE;
@@ -822,11 +1147,57 @@ namespace via
             }
             else
             {
-              if (!concatenate_chunks_)
+              if (!concatenate_chunks_ && !stream_body_)
                 return RX_VALID;
             }
           }
 
+          // Deliver the header of a streamed request before its chunks,
+          // (after any 100 Continue response)
+          if (stream_body_ && !body_pending_ &&
+              (!request_.expect_continue() || continue_sent_))
+          {
+            request_valid();
+            body_pending_ = true;
+            return RX_VALID;
+          }
+
+          // stream the chunk data from the received buffer
+          if (stream_body_)
+          {
+            while (iter != end)
+            {
+              if (chunk_.valid())
+                chunk_.clear();
+
+              ForwardIterator data_begin(iter);
+              ForwardIterator data_end(iter);
+              bool const complete(chunk_.parse_data(iter, end,
+                                                    data_begin, data_end));
+              // if a parsing error (not run out of data)
+              if (!complete && (iter != end))
+              {
+                response_code_ = response_status::code::BAD_REQUEST;
+                clear();
+                return RX_INVALID;
+              }
+
+              // deliver any data and the end of the body
+              bool const is_last(complete && chunk_.is_last());
+              if (is_last || (data_begin != data_end))
+              {
+                body_offset_ = static_cast<size_t>
+                                 (std::distance(start, data_begin));
+                body_size_ = static_cast<size_t>
+                                 (std::distance(data_begin, data_end));
+                body_pending_ = !is_last;
+                return RX_BODY;
+              }
+            }
+
+            return RX_INCOMPLETE;
+          }
+
           // parse the chunk
           if (!chunk_.parse(iter, end))
           {
@@ -845,20 +1216,23 @@ namespace via
             if (concatenate_chunks_)
             {
               if (chunk_.is_last())
-                return RX_VALID;
+                return body_complete() ? RX_VALID : RX_INVALID;
               else
               {
                 // Determine whether the total size of the concatenated chunks
                 // is within the maximum body size.
-                if ((body_.size() + chunk_.data().size()) > max_body_size_)
+                if ((body_received_ + chunk_.data().size()) > max_body_size_)
                 {
                   response_code_ = response_status::code::PAYLOAD_TOO_LARGE;
                   clear();
                   return RX_INVALID;
                 }
                 else // concatenate the chunk into the message body
-                  body_.insert(body_.end(),
-                               chunk_.data().begin(), chunk_.data().end());
+                {
+                  body_received_ += chunk_.data().size();
+                  if (!add_body(chunk_.data().begin(), chunk_.data().end()))
+                    return RX_INVALID;
+                }
               }
             }
             else
@@ -73,6 +73,22 @@ namespace via
                                          Container const& request_body,
                                          Container& response_body) const = 0;
 
+      /// The asynchronous handle_request function.
+      /// The default implementation calls the handle_request function above
+      /// and then sends its response.
+      /// @param request the HTTP request.
+      /// @param request_body the body of the HTTP request.
+      /// @param send_response the function to call to send the response.
+      virtual void handle_request(rx_request const& request,
+                                  Container const& request_body,
+                                  SendResponseHandler send_response) const
+      {
+        Container response_body;
+        tx_response response(handle_request(request, request_body,
+                                            response_body));
+        send_response(std::move(response), std::move(response_body));
+      }
+
       /// Set the handler to send an HTTP response.
       void set_send_response_handler(SendResponseHandler handler)
       { send_response_handler_ = handler; }
@@ -15,6 +15,7 @@
 /// @brief Enumerations and functions to handle standard HTTP request methods.
 //////////////////////////////////////////////////////////////////////////////
 #include "character.hpp"
+#include <cstddef>
 #include <string>
 
 #ifdef DELETE
@@ -39,12 +40,22 @@ namespace via
         PUT,
         DELETE,
         TRACE,
-        CONNECT
+        CONNECT,
+        EXTENSION_METHOD
       };
 
+      /// The number of standard method ids, i.e. excluding EXTENSION_METHOD.
+      const size_t NUMBER_OF_IDS(static_cast<size_t>(id::EXTENSION_METHOD));
+
       /// The standard method name associated with ids above.
-      /// @return the standard method name.
+      /// @return the standard method name, empty for EXTENSION_METHOD.
       const std::string& name(id method_id) NOEXCEPT;
+
+      /// Lookup the id of a request method from its name.
+      /// @param method_name the method name (an uppercase string).
+      /// @return the method id, EXTENSION_METHOD if it's not a standard
+      /// method.
+      id find_id(std::string const& method_name) NOEXCEPT;
     }
   }
 }
@@ -16,16 +16,19 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/request_handler.hpp"
 #include "via/http/request_uri.hpp"
+#include "via/http/response_cache.hpp"
+#include "via/http/route_tree.hpp"
 #include "via/http/authentication/authentication.hpp"
+#include "via/metrics.hpp"
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <stdexcept>
 
 namespace via
 {
   namespace http
   {
-    /// A map of strings to hold route parameters for the request handlers.
-    typedef std::map<std::string, std::string> Parameters;
-
     /// Get the route parameters from the uri_path given the route_path.
     /// @param uri_path the path received in the request_uri.
     /// @param route_path the path in the Route.
@@ -35,7 +38,11 @@ namespace via
 
     /// @class request_router
     /// The class contains the route paths to search in HTTP requests.
-    /// Note: the routes are searched in the order that they are added.
+    /// The route paths are compiled into a route_tree when they are added,
+    /// so a request is routed in a single pass over its uri path.
+    /// Note: static path segments are matched before ':' parameters.
+    /// The responses to GET requests on a route may be cached in a
+    /// response_cache, see cache_route.
     template <typename Container>
     class request_router : public request_handler<Container>
     {
@@ -46,13 +53,45 @@ namespace via
                                          Container const& data,
                                          Container& response_body)> Handler;
 
+      /// An HTTP request handler function that receives the route parameters
+      /// as string_views into the request uri, i.e. without copying them.
+      typedef std::function<tx_response (rx_request const& request,
+                                         route_parameters const& parameters,
+                                         Container const& data,
+                                         Container& response_body)> ViewHandler;
+
+      /// The function to call to send an asynchronous response.
+      typedef typename request_handler<Container>::SendResponseHandler
+                                                      SendResponseHandler;
+
+      /// An asynchronous HTTP request handler function.
+      /// It sends the response by calling send_response, which may be called
+      /// after the handler has returned and from another thread, e.g. after
+      /// a database query. Note: the request and data are only valid within
+      /// the handler, so it must copy anything that it needs later.
+      typedef std::function<void (rx_request const& request,
+                                  Parameters const& parameters,
+                                  Container const& data,
+                                  SendResponseHandler send_response)>
+                                                      AsyncHandler;
+
       /// A request handler with an (optional) authentication object pointer.
+      /// One of the handler, view_handler or async_handler is set.
       struct AuthenticatedHandler
       {
         Handler handler;
         authentication::authentication const* auth_ptr;
+        ViewHandler view_handler;
+        AsyncHandler async_handler;
+
+        /// Whether a handler has been set.
+        bool is_set() const
+        { return handler || view_handler || async_handler; }
       };
 
+      /// The type of the response_cache.
+      typedef http::response_cache<Container> response_cache_type;
+
       /// A map of handlers
       typedef std::map<std::string, AuthenticatedHandler> MethodHandlers;
 
@@ -67,15 +106,29 @@ namespace via
         std::string    path;
         /// The search path upto the first ':' parameter, if any.
         std::string    search_path;
-        /// The map of HTTP methods to request handlers.
-        MethodHandlers method_handlers;
+        /// The handlers for the standard methods, indexed by request_method::id.
+        AuthenticatedHandler method_handlers[request_method::NUMBER_OF_IDS];
+        /// The map of extension HTTP methods to request handlers.
+        MethodHandlers extension_handlers;
+        /// The methods allowed for the path, for an ALLOW header.
+        std::string    allowed;
+        /// The id of the route's latency histogram in the metrics_registry.
+        size_t         latency_metric;
+        /// The time to live of the route's cached responses in seconds,
+        /// zero if they are not cached.
+        long           cache_ttl;
 
         /// Constructor
-        Route(std::string const& path_str,
-              MethodHandlers_value_type method_handler)
+        explicit Route(std::string const& path_str)
           : path(path_str)
           , search_path(path_str)
-          , method_handlers{method_handler}
+          , method_handlers()
+          , extension_handlers()
+          , allowed()
+          , latency_metric(metrics_registry::instance().histogram
+              ("via_http_route_duration_us{route=\""
+               + metrics_registry::label_value(path_str) + "\"}"))
+          , cache_ttl(0)
         {
           // Find the first ':' in the path
           auto param_start(search_path.find(':'));
@@ -83,23 +136,58 @@ namespace via
             search_path.erase(param_start); // delete it and everything after it
         }
 
+        /// Add a handler for a method, unless the method already has one.
+        /// @param method the method name (an uppercase string).
+        /// @param handler the request handler.
+        void add_handler(std::string const& method,
+                         AuthenticatedHandler const& handler)
+        {
+          request_method::id const method_id(request_method::find_id(method));
+          if (method_id == request_method::id::EXTENSION_METHOD)
+            extension_handlers.insert(MethodHandlers_value_type(method, handler));
+          else if (!method_handlers[method_id].is_set())
+            method_handlers[method_id] = handler;
+
+          // Update the string of allowed methods
+          allowed.clear();
+          for (size_t i(0); i < request_method::NUMBER_OF_IDS; ++i)
+          {
+            if (method_handlers[i].is_set())
+            {
+              if (!allowed.empty())
+                allowed += ", ";
+              allowed += request_method::name(static_cast<request_method::id>(i));
+            }
+          }
+          for (auto const& elem : extension_handlers)
+          {
+            if (!allowed.empty())
+              allowed += ", ";
+            allowed += elem.first;
+          }
+        }
+
+        /// Find the handler for a request method.
+        /// @param request the HTTP request.
+        /// @return a pointer to the handler, nullptr if none.
+        AuthenticatedHandler const* find_handler(rx_request const& request) const
+        {
+          request_method::id const method_id(request.method_id());
+          if (method_id != request_method::id::EXTENSION_METHOD)
+            return method_handlers[method_id].is_set()
+                ? &method_handlers[method_id] : nullptr;
+
+          auto iter(extension_handlers.find(request.method()));
+          return (iter != extension_handlers.cend()) ? &iter->second : nullptr;
+        }
+
         /// Whether the Route has parameters i.e. a ':'
         bool has_parameters() const
         { return path.size() != search_path.size(); }
 
         /// The string of methods allowed for a given url
-        std::string allowed_methods() const
-        {
-          std::string text;
-          auto iter(method_handlers.cbegin());
-          if (iter != method_handlers.cend())
-            text = iter->first;
-
-          for (++iter; iter != method_handlers.cend(); ++iter)
-            text += ", " + iter->first;
-
-          return text;
-        }
+        std::string const& allowed_methods() const
+        { return allowed; }
 
         /// Whether a given route matches a path
         friend bool operator==(Route const& lhs, std::string const& path)
@@ -117,31 +205,101 @@ namespace via
       /// The routes to search for an HTTP request.
       Routes routes_;
 
-      /// Searches for the request in the routes collection.
-      /// @param uri_path the http request uri path
-      /// @retval parameters the route paramters (if any)
-      /// @return a constant iterator to the route in routes_, cend if not found.
-      Routes_const_iterator find_route(std::string const& uri_path,
-                                       Parameters& parameters) const
+      /// The route paths compiled into a radix tree of indices into routes_.
+      route_tree route_tree_;
+
+      /// The cached responses, null if no routes are cached.
+      std::shared_ptr<response_cache_type> cache_;
+
+      /// Add a method and it's handler to the given path.
+      /// @param method the method name (an uppercase string).
+      /// @param path the uri path.
+      /// @param handler the request handler to be called.
+      /// @return true if the path is new, false otherwise.
+      bool add_handler(std::string const& method, std::string const& path,
+                       AuthenticatedHandler const& handler)
       {
-        Routes_const_iterator iter(routes_.cbegin());
-        for (; iter != routes_.cend (); ++iter)
+        size_t const index(route_tree_.insert(path, routes_.size()));
+        bool is_new_path(index == routes_.size());
+        if (is_new_path)
+          routes_.push_back(Route(path));
+        routes_[index].add_handler(method, handler);
+
+        return is_new_path;
+      }
+
+      /// Find the handler for a request and authenticate the request.
+      /// @param request the HTTP request.
+      /// @retval parameters the route parameters.
+      /// @retval response the response if there isn't a handler for the
+      /// request or it failed authentication.
+      /// @retval latency_metric the id of the route's latency histogram.
+      /// @retval cache_ttl the time to live of the route's cached responses.
+      /// @return a pointer to the handler, nullptr if none.
+      AuthenticatedHandler const* find_handler(rx_request const& request,
+                                               route_parameters& parameters,
+                                               tx_response& response,
+                                               size_t& latency_metric,
+                                               long& cache_ttl) const
+      {
+        // The uri path is the uri up to any query or fragment
+        string_view uri_path(request.uri());
+        uri_path = uri_path.substr(0, request.uri().find_first_of("?#"));
+
+        // Search for the path and any route parameters associated with it
+        size_t const index(route_tree_.find(uri_path, parameters));
+        if (index == route_tree::NOT_FOUND)
+        {
+          response = tx_response(response_status::code::NOT_FOUND);
+          return nullptr;
+        }
+
+        Route const& route(routes_[index]);
+        latency_metric = route.latency_metric;
+        cache_ttl = route.cache_ttl;
+
+        // Search for the method
+        AuthenticatedHandler const* method_handler(route.find_handler(request));
+        if (!method_handler)
+        {
+          // send a METHOD_NOT_ALLOWED response with an ALLOW header
+          response = tx_response(response_status::code::METHOD_NOT_ALLOWED);
+          response.add_header(header_field::id::ALLOW, route.allowed_methods());
+          return nullptr;
+        }
+
+        // If this method has authentication
+        if (method_handler->auth_ptr)
         {
-          bool found_path(uri_path.find(iter->search_path) != std::string::npos);
-          if (found_path)
+          // authenticate the request
+          std::string challenge(method_handler->auth_ptr->authenticate(request));
+          if (!challenge.empty())
           {
-            if (iter->has_parameters())
-            {
-              parameters = get_route_parameters(uri_path, iter->path);
-              if (!parameters.empty())
-                break;
-            }
-            else if (uri_path.size() == iter->search_path.size())
-              break;
+            // authentication failed, send an UNAUTHORISED response
+            response = tx_response(response_status::code::UNAUTHORISED);
+            response.add_header(header_field::id::WWW_AUTHENTICATE, challenge);
+            return nullptr;
           }
         }
 
-        return iter;
+        return method_handler;
+      }
+
+      /// Store a response in the response_cache, then convert it into a
+      /// 304 Not Modified response if its ETag matches the request.
+      /// @param cache the response_cache.
+      /// @param request the HTTP request.
+      /// @param ttl the time to live of the route's cached responses.
+      /// @retval response the response.
+      /// @retval response_body the response body.
+      static void cache_response(response_cache_type& cache,
+                                 rx_request const& request, long ttl,
+                                 tx_response& response,
+                                 Container& response_body)
+      {
+        cache.store(request, response, response_body, ttl);
+        if (response_cache_type::not_modified(request, response))
+          response_body = Container();
       }
 
     public:
@@ -151,6 +309,8 @@ namespace via
       explicit request_router()
         : request_handler<Container>()
         , routes_()
+        , route_tree_()
+        , cache_()
       {}
 
       /// Destructor
@@ -163,23 +323,44 @@ namespace via
       /// @param path the uri path. Note: it may contain ':' characters to
       /// capture paramters from the uri path like Node.js.
       /// @param handler the request handler to be called.
+      /// @throw invalid_argument if the path has too many parameters or only
+      /// differs from an existing path by its parameter names.
       /// @return true if the path is new, false otherwise.
       bool add_method(std::string const& method, std::string const& path,
                       Handler handler,
                       authentication::authentication const* auth_ptr = nullptr)
-      {
-        // Serach for the path in the existing routes
-        auto iter(std::find(routes_.begin(), routes_.end(), path));
-        bool is_new_path(iter == routes_.end());
-        if (is_new_path)
-          routes_.push_back(Route(path,
-                    MethodHandlers_value_type(method, { handler, auth_ptr })));
-        else
-          iter->method_handlers.insert
-              (MethodHandlers_value_type(method, { handler, auth_ptr }));
+      { return add_handler(method, path,
+                           { handler, auth_ptr, ViewHandler(), AsyncHandler() }); }
 
-        return is_new_path;
-      }
+      /// Add a method and it's view handler to the given path.
+      /// Creates the path if it's not already got any handlers.
+      /// @param method the method name (an uppercase string).
+      /// @param path the uri path. Note: it may contain ':' characters to
+      /// capture paramters from the uri path like Node.js.
+      /// @param handler the request view handler to be called.
+      /// @throw invalid_argument if the path has too many parameters or only
+      /// differs from an existing path by its parameter names.
+      /// @return true if the path is new, false otherwise.
+      bool add_method(std::string const& method, std::string const& path,
+                      ViewHandler handler,
+                      authentication::authentication const* auth_ptr = nullptr)
+      { return add_handler(method, path,
+                           { Handler(), auth_ptr, handler, AsyncHandler() }); }
+
+      /// Add a method and it's asynchronous handler to the given path.
+      /// Creates the path if it's not already got any handlers.
+      /// @param method the method name (an uppercase string).
+      /// @param path the uri path. Note: it may contain ':' characters to
+      /// capture paramters from the uri path like Node.js.
+      /// @param handler the asynchronous request handler to be called.
+      /// @throw invalid_argument if the path has too many parameters or only
+      /// differs from an existing path by its parameter names.
+      /// @return true if the path is new, false otherwise.
+      bool add_method(std::string const& method, std::string const& path,
+                      AsyncHandler handler,
+                      authentication::authentication const* auth_ptr = nullptr)
+      { return add_handler(method, path,
+                           { Handler(), auth_ptr, ViewHandler(), handler }); }
 
       /// Add a method and it's handler to the given path.
       /// Creates the path if it's not already got any handlers.
@@ -193,6 +374,30 @@ namespace via
                       authentication::authentication const* auth_ptr = nullptr)
       { return add_method(request_method::name(method_id), path, handler, auth_ptr); }
 
+      /// Add a method and it's view handler to the given path.
+      /// Creates the path if it's not already got any handlers.
+      /// @param method_id the method id, e.g. request_method::id::GET.
+      /// @param path the uri path. Note: it may contain ':' characters to
+      /// capture paramters from the uri path like Node.js.
+      /// @param handler the request view handler to be called.
+      /// @return true if the path is new, false otherwise.
+      bool add_method(request_method::id method_id, std::string const& path,
+                      ViewHandler handler,
+                      authentication::authentication const* auth_ptr = nullptr)
+      { return add_method(request_method::name(method_id), path, handler, auth_ptr); }
+
+      /// Add a method and it's asynchronous handler to the given path.
+      /// Creates the path if it's not already got any handlers.
+      /// @param method_id the method id, e.g. request_method::id::GET.
+      /// @param path the uri path. Note: it may contain ':' characters to
+      /// capture paramters from the uri path like Node.js.
+      /// @param handler the asynchronous request handler to be called.
+      /// @return true if the path is new, false otherwise.
+      bool add_method(request_method::id method_id, std::string const& path,
+                      AsyncHandler handler,
+                      authentication::authentication const* auth_ptr = nullptr)
+      { return add_method(request_method::name(method_id), path, handler, auth_ptr); }
+
       /// The function handle HTTP requests.
       /// It validates the request and routes it to the
       /// @param request the HTTP request.
@@ -200,50 +405,195 @@ namespace via
       /// @retval response_body the body for the HTTP response.
       /// @return the response header from the handler or NOT_FOUND if it could
       /// not find a handler for the request.
+      /// @throw std::logic_error if the handler is an AsyncHandler that
+      /// doesn't send its response before it returns: use the
+      /// handle_request function with a send_response function instead.
       virtual tx_response handle_request(rx_request const& request,
                                          Container const& request_body,
                                          Container& response_body) const
       {
-        request_uri uri(request.uri());
-
-        // Search for the path and any route parameters associated with it
-        Parameters parameters;
-        auto route_itr(find_route(uri.path(), parameters));
-        if (route_itr == routes_.cend())
-          return tx_response(response_status::code::NOT_FOUND);
+        route_parameters parameters;
+        tx_response response(response_status::code::NOT_FOUND);
+        size_t latency_metric(metrics_registry::NONE);
+        long cache_ttl(0);
+        AuthenticatedHandler const* method_handler
+            (find_handler(request, parameters, response, latency_metric,
+                          cache_ttl));
+        if (!method_handler)
+          return response;
 
-        // Search for the method
-        auto methods_iter(route_itr->method_handlers.find(request.method()));
-        if (methods_iter == route_itr->method_handlers.cend())
-        {
-          // send a METHOD_NOT_ALLOWED response with an ALLOW header
-          tx_response response(response_status::code::METHOD_NOT_ALLOWED);
-          response.add_header(header_field::id::ALLOW, route_itr->allowed_methods());
+        // respond from the response cache, if possible
+        if ((cache_ttl > 0) &&
+            cache_->respond(request, response, response_body))
           return response;
-        }
+
+        // call the registered handler
+        metrics_timer const timer;
+        if (method_handler->view_handler)
+          response = method_handler->view_handler(request, parameters,
+                                                  request_body, response_body);
+        else if (method_handler->handler)
+          response = method_handler->handler(request, parameters.to_map(),
+                                             request_body, response_body);
         else
         {
-          // If this method has authentication
-          if (methods_iter->second.auth_ptr)
+          // An asynchronous handler may send its response after returning
+          typedef std::pair<std::unique_ptr<tx_response>, Container> Result;
+          std::shared_ptr<Result> result(std::make_shared<Result>());
+          std::weak_ptr<Result> weak_result(result);
+          method_handler->async_handler(request, parameters.to_map(),
+                                        request_body,
+              [weak_result](tx_response async_response, Container async_body)
           {
-            // authenticate the request
-            std::string challenge
-                (methods_iter->second.auth_ptr->authenticate(request));
-            if (!challenge.empty())
+            std::shared_ptr<Result> result_pointer(weak_result.lock());
+            if (result_pointer)
             {
-              // authentication failed, send an UNAUTHORISED response
-              tx_response response(response_status::code::UNAUTHORISED);
-              response.add_header(header_field::id::WWW_AUTHENTICATE, challenge);
-              return response;
+              result_pointer->first.reset
+                  (new tx_response(std::move(async_response)));
+              result_pointer->second = std::move(async_body);
             }
+          });
+          if (!result->first)
+            throw std::logic_error("request_router: the AsyncHandler for "
+                                   + request.uri() + " didn't respond before"
+                                   " it returned");
+          response_body.swap(result->second);
+          response = *result->first;
+        }
+
+        metrics_registry::instance().observe(latency_metric,
+                                             timer.microseconds());
+        if (cache_ttl > 0)
+          cache_response(*cache_, request, cache_ttl, response, response_body);
+        return response;
+      }
+
+      /// The function to handle HTTP requests asynchronously.
+      /// It validates the request and routes it to the handler: a
+      /// synchronous handler's response is sent before it returns, an
+      /// AsyncHandler sends its response when it calls send_response.
+      /// @param request the HTTP request.
+      /// @param request_body the body of the HTTP request.
+      /// @param send_response the function to call to send the response,
+      /// with NOT_FOUND if it could not find a handler for the request.
+      virtual void handle_request(rx_request const& request,
+                                  Container const& request_body,
+                                  SendResponseHandler send_response) const
+      {
+        route_parameters parameters;
+        tx_response response(response_status::code::NOT_FOUND);
+        size_t latency_metric(metrics_registry::NONE);
+        long cache_ttl(0);
+        AuthenticatedHandler const* method_handler
+            (find_handler(request, parameters, response, latency_metric,
+                          cache_ttl));
+
+        // respond from the response cache, if possible
+        Container response_body;
+        if (method_handler && (cache_ttl > 0) &&
+            cache_->respond(request, response, response_body))
+        {
+          send_response(std::move(response), std::move(response_body));
+          return;
+        }
+
+        metrics_timer const timer;
+        if (method_handler && method_handler->async_handler)
+        {
+          // The request is only valid within the handler, so the response
+          // cache needs a copy of it
+          std::shared_ptr<response_cache_type> cache;
+          std::shared_ptr<rx_request const> cache_request;
+          if (cache_ttl > 0)
+          {
+            cache = cache_;
+            cache_request = std::make_shared<rx_request>(request);
           }
 
-          // call the registered handler
-          return methods_iter->second.handler(request, parameters,
-                                              request_body, response_body);
+          // The latency of an asynchronous handler includes the time until
+          // it sends its response
+          method_handler->async_handler(request, parameters.to_map(),
+                                        request_body,
+            [latency_metric, timer, send_response, cache, cache_request,
+             cache_ttl](tx_response async_response, Container async_body)
+          {
+            metrics_registry::instance().observe(latency_metric,
+                                                 timer.microseconds());
+            if (cache)
+              cache_response(*cache, *cache_request, cache_ttl,
+                             async_response, async_body);
+            send_response(std::move(async_response), std::move(async_body));
+          });
+          return;
+        }
+
+        if (method_handler)
+        {
+          if (method_handler->view_handler)
+            response = method_handler->view_handler(request, parameters,
+                                                    request_body, response_body);
+          else
+            response = method_handler->handler(request, parameters.to_map(),
+                                               request_body, response_body);
+          metrics_registry::instance().observe(latency_metric,
+                                               timer.microseconds());
+          if (cache_ttl > 0)
+            cache_response(*cache_, request, cache_ttl, response,
+                           response_body);
         }
+        send_response(std::move(response), std::move(response_body));
+      }
+
+      /// Add a GET route that responds with the metrics in the
+      /// metrics_registry, in the Prometheus text exposition format.
+      /// @param path the uri path, default "/metrics".
+      /// @param auth_ptr an optional authentication for the route.
+      /// @return true if the path is new, false otherwise.
+      bool add_metrics_route(std::string const& path = "/metrics",
+                      authentication::authentication const* auth_ptr = nullptr)
+      {
+        return add_method(request_method::id::GET, path,
+          Handler([](rx_request const&, Parameters const&, Container const&,
+                     Container& response_body)
+        {
+          std::string const text(metrics_registry::instance().text());
+          response_body = Container(text.begin(), text.end());
+          tx_response response(response_status::code::OK);
+          response.add_header(header_field::id::CONTENT_TYPE,
+                              "text/plain; version=0.0.4");
+          return response;
+        }), auth_ptr);
+      }
+
+      /// Cache the responses to GET requests on a route in the response_cache,
+      /// which is created when the first route is cached.
+      /// The cached responses are sent without calling the route's handler,
+      /// but after authenticating the request.
+      /// A successful response to a POST, PUT, DELETE or other unsafe
+      /// request on the route removes the cached responses for its uri.
+      /// @throw invalid_argument if the path is not the path of a route.
+      /// @param path the route path, as given to add_method.
+      /// @param ttl the time to live of the cached responses in seconds,
+      /// unless a response's Cache-Control max-age is shorter; zero stops
+      /// caching the responses.
+      void cache_route(std::string const& path, long ttl)
+      {
+        auto iter(std::find(routes_.begin(), routes_.end(), path));
+        if (iter == routes_.end())
+          throw std::invalid_argument("request_router::cache_route: "
+                                      "unknown route: " + path);
+
+        if (!cache_)
+          cache_ = std::make_shared<response_cache_type>();
+        iter->cache_ttl = std::max(ttl, 0L);
       }
 
+      /// Accessor for the response_cache.
+      /// @return a pointer to the response_cache, null if no routes are
+      /// cached.
+      std::shared_ptr<response_cache_type> const& cache() const NOEXCEPT
+      { return cache_; }
+
       /// Accessor for the stored routes
       Routes const& routes() const
       { return routes_; }
@@ -0,0 +1,256 @@
+#ifndef REQUEST_VIEW_HPP_VIA_HTTPLIB_
+#define REQUEST_VIEW_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file request_view.hpp
+/// @brief A class to parse HTTP request headers without copying them.
+//////////////////////////////////////////////////////////////////////////////
+#include "request_method.hpp"
+#include "header_field.hpp"
+#include "headers.hpp"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class rx_request_view
+    /// A class to parse an HTTP request line and headers in view mode:
+    /// the method, uri, field names and values are string_views into the
+    /// received data, so a request that arrives in a single read is parsed
+    /// without copying it or allocating memory (once the fields vector has
+    /// grown to the number of fields received).
+    ///
+    /// If a request header spans reads, it's copied into an internal buffer
+    /// until it's complete and the views refer to that buffer instead.
+    /// Folded (obsolete multi-line) field values are also copied.
+    ///
+    /// The views are only valid while the received data is retained,
+    /// e.g. during the RECEIVED event for a connection's receive buffer,
+    /// and until the rx_request_view is cleared.
+    /// The parser applies the same limits as an rx_request, however
+    /// duplicate fields are not combined: find returns the first one.
+    ///
+    /// Note: http_server doesn't use it, since its handlers are given an
+    /// rx_request that outlives the receive buffer. It's for applications
+    /// that parse the RECEIVED data of a comms::server directly, e.g. a
+    /// proxy.
+    /// @see rx_request
+    //////////////////////////////////////////////////////////////////////////
+    class rx_request_view
+    {
+    public:
+
+      /// A header field.
+      struct field
+      {
+        string_view name;  ///< The field name, as received.
+        string_view value; ///< The field value.
+      };
+
+      /// The initial capacity of the fields vector.
+      static const size_t DEFAULT_FIELDS_CAPACITY = 32;
+
+    private:
+
+      // Parser parameters
+      bool           strict_crlf_;       ///< enforce strict parsing of CRLF
+      unsigned char  max_whitespace_;    ///< the max no of consectutive whitespace characters.
+      unsigned char  max_method_length_; ///< the maximum length of a request method
+      size_t         max_uri_length_;    ///< the maximum length of a uri.
+      unsigned short max_line_length_;   ///< the max length of a field line
+      unsigned short max_header_number_; ///< the max no of header fields
+      size_t         max_header_length_; ///< the max cumulative length
+
+      // Request information
+      string_view method_;         ///< the request method
+      string_view uri_;            ///< the request uri
+      char major_version_;         ///< the HTTP major version character
+      char minor_version_;         ///< the HTTP minor version character
+      std::vector<field> fields_;  ///< the header fields
+      std::deque<std::string> folded_values_; ///< copies of folded values
+
+      // Parser state
+      std::string partial_;        ///< a request header that spans reads
+      bool valid_;                 ///< true if the request is valid
+      bool copied_;                ///< true if the views refer to partial_
+
+      /// The maximum size of a request line and headers.
+      size_t max_request_size() const NOEXCEPT;
+
+      /// Parse a complete request line and headers.
+      /// @param begin the start of the request.
+      /// @param end the end of the blank line after the headers.
+      /// @return true if valid, false otherwise.
+      bool parse_header(const char* begin, const char* end);
+
+      /// Parse the request line.
+      /// @retval iter the start of the line, the start of the next line
+      /// if valid.
+      /// @param end the end of the request header.
+      /// @return true if valid, false otherwise.
+      bool parse_request_line(const char*& iter, const char* end);
+
+      /// Parse a header field line.
+      /// @retval iter the start of the line, the start of the next line
+      /// if valid.
+      /// @param end the end of the request header.
+      /// @retval length the cumulative length of the fields.
+      /// @return true if valid, false otherwise.
+      bool parse_field_line(const char*& iter, const char* end,
+                            size_t& length);
+
+      /// Parse the end of a line: CRLF or (if not strict) LF.
+      /// @retval iter the end of the line, the start of the next line
+      /// if valid.
+      /// @param end the end of the request header.
+      /// @return true if valid, false otherwise.
+      bool parse_eol(const char*& iter, const char* end) const NOEXCEPT;
+
+    public:
+
+      /// Constructor.
+      /// Sets the parser parameters, the parameters are the same as for an
+      /// rx_request.
+      /// @param strict_crlf enforce strict parsing of CRLF.
+      /// @param max_whitespace the maximum number of consectutive whitespace
+      /// characters allowed in a request: min 1, max 254.
+      /// @param max_method_length the maximum length of an HTTP request method:
+      /// min 1, max 254.
+      /// @param max_uri_length the maximum length of an HTTP request uri:
+      /// min 1, max 4 billion.
+      /// @param max_line_length the maximum length of an HTTP header field line:
+      /// min 1, max 65534.
+      /// @param max_header_number the maximum number of HTTP header field lines:
+      /// max 65534.
+      /// @param max_header_length the maximum cumulative length the HTTP header
+      /// fields: max 4 billion.
+      explicit rx_request_view(bool           strict_crlf,
+                               unsigned char  max_whitespace,
+                               unsigned char  max_method_length,
+                               size_t         max_uri_length,
+                               unsigned short max_line_length,
+                               unsigned short max_header_number,
+                               size_t         max_header_length) :
+        strict_crlf_(strict_crlf),
+        max_whitespace_(max_whitespace),
+        max_method_length_(max_method_length),
+        max_uri_length_(max_uri_length),
+        max_line_length_(max_line_length),
+        max_header_number_(max_header_number),
+        max_header_length_(max_header_length),
+        method_(),
+        uri_(),
+        major_version_(0),
+        minor_version_(0),
+        fields_(),
+        folded_values_(),
+        partial_(),
+        valid_(false),
+        copied_(false)
+      { fields_.reserve(DEFAULT_FIELDS_CAPACITY); }
+
+      /// Clear the rx_request_view, keeping the capacity of its buffers.
+      void clear() NOEXCEPT
+      {
+        method_ = string_view();
+        uri_ = string_view();
+        major_version_ = 0;
+        minor_version_ = 0;
+        fields_.clear();
+        folded_values_.clear();
+        partial_.clear();
+        valid_ = false;
+        copied_ = false;
+      }
+
+      /// Parse an HTTP request line and headers.
+      /// @retval iter reference to a pointer to the start of the data.
+      /// If the request is valid it will refer to the start of the body,
+      /// the next request or the end of the data. If it's incomplete it
+      /// will be end.
+      /// @param end the end of the data.
+      /// @return RX_VALID if the request is complete and valid,
+      /// RX_INCOMPLETE if it requires more data, RX_INVALID otherwise.
+      Rx parse(const char*& iter, const char* end);
+
+      /// Accessor for the request method.
+      string_view method() const NOEXCEPT
+      { return method_; }
+
+      /// Accessor for the request uri.
+      string_view uri() const NOEXCEPT
+      { return uri_; }
+
+      /// Accessor for the HTTP major version number.
+      char major_version() const NOEXCEPT
+      { return major_version_; }
+
+      /// Accessor for the HTTP minor version number.
+      char minor_version() const NOEXCEPT
+      { return minor_version_; }
+
+      /// Whether the HTTP version is 1.0 or earlier.
+      bool is_http_1_0_or_earlier() const NOEXCEPT
+      {
+        return (major_version_ <= '0') ||
+              ((major_version_ == '1') && (minor_version_ == '0'));
+      }
+
+      /// Accessor for the header fields, in the order received.
+      std::vector<field> const& fields() const NOEXCEPT
+      { return fields_; }
+
+      /// Find the value of a header field.
+      /// @param name the field name, compared case insensitively.
+      /// @return the value of the first field with the name, empty if
+      /// not found.
+      string_view find(string_view name) const NOEXCEPT;
+
+      /// Find the value of a standard header field.
+      /// @param field_id the id of the field.
+      /// @return the value of the first field with the name, empty if
+      /// not found.
+      string_view find(header_field::id field_id) const NOEXCEPT
+      { return find(string_view(header_field::lowercase_name(field_id))); }
+
+      /// The size in the content_length header (if there is one)
+      /// @return the content_length header value, -1 if invalid.
+      std::ptrdiff_t content_length() const NOEXCEPT;
+
+      /// Whether chunked transfer encoding is enabled.
+      bool is_chunked() const NOEXCEPT;
+
+      /// Whether the connection should be kept alive.
+      bool keep_alive() const NOEXCEPT;
+
+      /// Whether the client expects a "100-continue" response.
+      bool expect_continue() const NOEXCEPT;
+
+      /// Whether an HTTP 1.1 request is missing a Host: header.
+      bool missing_host_header() const NOEXCEPT;
+
+      /// Accessor for the valid flag.
+      bool valid() const NOEXCEPT
+      { return valid_; }
+
+      /// Whether the request header was copied because it spanned reads.
+      bool copied() const NOEXCEPT
+      { return copied_; }
+    };
+  }
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include "response_status.hpp"
 #include "headers.hpp"
 #include "chunk.hpp"
+#include "scanner.hpp"
 #include <algorithm>
 #include <climits>
 
@@ -166,6 +167,22 @@ namespace via
       {
         while ((iter != end) && (RESP_VALID != state_))
         {
+          // Scan the bulk of the reason phrase, after any leading whitespace,
+          // up to the end of the line or the length limit
+          if ((RESP_REASON == state_) && !reason_phrase_.empty())
+          {
+            size_t length(scan(scanner::instance().find_eol, iter, end,
+                               max_reason_length_ - reason_phrase_.size()));
+            if (length > 0)
+            {
+              ForwardIterator next(iter);
+              std::advance(next, length);
+              reason_phrase_.append(iter, next);
+              iter = next;
+              continue;
+            }
+          }
+
           char c(*iter++);
           if ((fail_ = !parse_char(c))) // Note: deliberate assignment
             return false;
@@ -488,7 +505,7 @@ namespace via
 
       /// Add a Date header to the response.
       void add_date_header()
-      { header_string_ += header_field::date_header(); }
+      { header_field::append_date_header(header_string_); }
 
       /// Add a Server header to the response.
       void add_server_header()
@@ -503,6 +520,20 @@ namespace via
       bool is_valid() const NOEXCEPT
       { return !are_headers_split(header_string_); }
 
+      /// Accessor for the header string.
+      /// @return the headers that have been added to the response.
+      std::string const& header_string() const NOEXCEPT
+      { return header_string_; }
+
+      /// Whether the response has a Transfer-Encoding header, i.e. whether
+      /// the body of the response is sent in chunks.
+      /// @return true if the response has a Transfer-Encoding header.
+      bool is_chunked() const
+      {
+        return std::string::npos != header_string_.find
+            (header_field::standard_name(header_field::id::TRANSFER_ENCODING));
+      }
+
       /// The http message header string.
       /// @param content_length the size of the message body for the
       /// content_length header.
@@ -527,6 +558,71 @@ namespace via
       }
     }; // class tx_response
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @class response_template
+    /// An immutable, preformatted HTTP response status line and headers,
+    /// e.g. for the responses of frequently requested resources.
+    /// It's created from a tx_response containing the fixed headers, e.g.
+    /// Server and Content-Type, so that only the per-response headers:
+    /// Date, Content-Length and any others, need to be formatted when the
+    /// response is sent.
+    /// @see http_connection::send(response_template const&, Container)
+    //////////////////////////////////////////////////////////////////////////
+    class response_template
+    {
+      std::string header_1_0_;  ///< the HTTP/1.0 status line and headers
+      std::string header_1_1_;  ///< the HTTP/1.1 status line and headers
+      bool add_date_;           ///< add a Date header to each response
+      bool add_content_length_; ///< add a Content-Length header to each response
+      bool is_chunked_;         ///< the response has a Transfer-Encoding
+
+    public:
+
+      /// Constructor.
+      /// @throw invalid_argument if the response contains split headers.
+      /// @param response the response status and the fixed headers.
+      /// @param add_date whether to add a Date header to each response,
+      /// default true.
+      explicit response_template(tx_response const& response,
+                                 bool add_date = true);
+
+      /// The preformatted status line and headers for a request.
+      /// @param major_version the HTTP major version of the request.
+      /// @param minor_version the HTTP minor version of the request.
+      /// @return the HTTP/1.0 header for an HTTP/1.0 (or earlier) request,
+      /// the HTTP/1.1 header otherwise.
+      std::string const& header(char major_version = '1',
+                                char minor_version = '1') const NOEXCEPT
+      {
+        bool const is_http_1_0_or_earlier((major_version <= '0') ||
+              ((major_version == '1') && (minor_version == '0')));
+        return is_http_1_0_or_earlier ? header_1_0_ : header_1_1_;
+      }
+
+      /// Whether the response has a Transfer-Encoding header.
+      /// @return true if the body of the response is sent in chunks.
+      bool is_chunked() const NOEXCEPT
+      { return is_chunked_; }
+
+      /// The per-response headers that follow the preformatted header,
+      /// including the blank line at the end of the headers.
+      /// @param content_length the size of the message body.
+      /// @param header_string any other header lines for the response,
+      /// default none.
+      /// @return the per-response headers.
+      std::string dynamic_header(size_t content_length,
+                                 std::string const& header_string = "") const;
+
+      /// The complete http message header.
+      /// @param content_length the size of the message body.
+      /// @param header_string any other header lines for the response,
+      /// default none.
+      /// @return the preformatted and per-response headers.
+      std::string message(size_t content_length = 0,
+                          std::string const& header_string = "") const
+      { return header_1_1_ + dynamic_header(content_length, header_string); }
+    }; // class response_template
+
     //////////////////////////////////////////////////////////////////////////
     /// @class response_receiver
     /// A template class to receive HTTP responses and any associated data.
@@ -536,6 +632,7 @@ namespace via
     {
       /// Parser parameters
       size_t max_body_size_;      ///< the maximum size of a response body.
+      bool   is_head_;            ///< the response is to a HEAD request.
 
       /// Response information
       rx_response response_;      ///< the received response
@@ -601,6 +698,7 @@ namespace via
           size_t         max_body_size     = DEFAULT_MAX_BODY_SIZE,
           size_t         max_chunk_size    = DEFAULT_MAX_CHUNK_SIZE) :
         max_body_size_(max_body_size),
+        is_head_(false),
         response_(strict_crlf, max_whitespace, max_status_no, max_reason_length,
                   max_line_length, max_header_number, max_header_length),
         chunk_(strict_crlf, max_whitespace, max_line_length, max_chunk_size,
@@ -617,6 +715,13 @@ namespace via
         body_.clear();
       }
 
+      /// Set whether the response is to a HEAD request, i.e. whether the
+      /// response doesn't have a body.
+      /// Note: it's not changed by clear.
+      /// @param is_head whether the response is to a HEAD request.
+      void set_is_head(bool is_head) NOEXCEPT
+      { is_head_ = is_head; }
+
       /// Accessor for the HTTP response header.
       /// @return a constant reference to an rx_response.
       rx_response const& response() const NOEXCEPT
@@ -656,6 +761,13 @@ namespace via
           }
         }
 
+        // A response to a HEAD request or an informational, No Content or
+        // Not Modified response doesn't have a body, so any following data
+        // is the next response
+        if (response_parsed &&
+            (is_head_ || !response_status::content_permitted(response_.status())))
+          return RX_VALID;
+
         // build a response body or receive a chunk
         if (!response_.is_chunked())
         {
@@ -0,0 +1,556 @@
+#ifndef RESPONSE_CACHE_HPP_VIA_HTTPLIB_
+#define RESPONSE_CACHE_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file response_cache.hpp
+/// @brief Classes and functions to cache HTTP responses.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request.hpp"
+#include "via/http/response.hpp"
+#include "via/metrics.hpp"
+#include "via/no_except.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    namespace cache_control
+    {
+      /// The Cache-Control directives that are used by the response_cache,
+      /// see RFC7234 section 5.2.
+      struct directives
+      {
+        bool no_store;   ///< no-store: the message must not be stored.
+        bool no_cache;   ///< no-cache: a stored response must be revalidated.
+        bool is_private; ///< private: the response is for a single user.
+        bool is_public;  ///< public: the response may be stored.
+        /// The s-maxage or max-age of the message in seconds, -1 if neither.
+        long max_age;
+      };
+
+      /// Parse the value of a Cache-Control header.
+      /// @param value the Cache-Control header value.
+      /// @return the directives.
+      directives parse(std::string const& value);
+
+      /// Find the value of a header field of a tx_response.
+      /// The field name is compared case insensitively.
+      /// @param response the response.
+      /// @param name the header field name, e.g. "Set-Cookie".
+      /// @return the value of the first matching header field, empty if not
+      /// found.
+      std::string find_header(tx_response const& response,
+                              std::string const& name);
+
+      /// Find the value of a standard header field of a tx_response.
+      /// @param response the response.
+      /// @param field_id the header field id.
+      /// @return the value of the first matching header field, empty if not
+      /// found.
+      inline std::string find_header(tx_response const& response,
+                                     header_field::id field_id)
+      { return find_header(response, header_field::standard_name(field_id)); }
+
+      /// Whether an entity tag matches an If-None-Match header, using the
+      /// weak comparison function, see RFC7232 section 3.2.
+      /// @param if_none_match the If-None-Match header value.
+      /// @param etag the entity tag, e.g. "\"v1\"".
+      /// @return true if the entity tag matches, false otherwise.
+      bool etag_matches(std::string const& if_none_match,
+                        std::string const& etag);
+
+      /// The header field names of a Vary header.
+      /// @param vary the Vary header value.
+      /// @return the lowercase field names, "*" if the response varies on
+      /// more than the request header fields.
+      std::vector<std::string> vary_fields(std::string const& vary);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class response_cache
+    /// An in-process cache of the responses to GET requests, keyed by the
+    /// request method and uri and the request header fields named by the
+    /// Vary header of the response.
+    ///
+    /// A response is stored if it's a 200 OK response that isn't chunked,
+    /// has no Set-Cookie header and whose Cache-Control header permits a
+    /// shared cache to store it. It's fresh for the time to live of its
+    /// route, or its max-age (or s-maxage) if that's shorter.
+    /// A fresh response is sent without calling the handler, as a
+    /// 304 Not Modified response if its ETag matches the request's
+    /// If-None-Match header.
+    ///
+    /// The cache is split into shards by a hash of the key, each guarded by
+    /// its own mutex, so it may be shared by connections running in a
+    /// thread pool. The mutex is only held to find or replace the variants
+    /// of a response: the cached responses are immutable and shared, so
+    /// they are copied into the response after the mutex is released.
+    /// When a shard is full, its stale responses are removed, followed by
+    /// the responses that would become stale first.
+    /// @see request_router::cache_route
+    /// @param Container the type of container in which the body is held.
+    //////////////////////////////////////////////////////////////////////////
+    template <typename Container>
+    class response_cache
+    {
+    public:
+
+      /// The number of shards.
+      static const size_t NUMBER_OF_SHARDS = 16;
+
+      /// The default maximum size of the cache, in bytes.
+      static const size_t DEFAULT_MAX_SIZE = 16 * 1024 * 1024;
+
+      /// The clock used to time cached responses.
+      typedef std::chrono::steady_clock clock_type;
+
+    private:
+
+      /// A cached response.
+      struct entry
+      {
+        std::vector<std::string> vary_fields; ///< The Vary header field names.
+        std::vector<std::string> vary_values; ///< The request's field values.
+        tx_response response;           ///< The response.
+        Container   body;               ///< The response body.
+        std::string etag;               ///< The response ETag, if any.
+        clock_type::time_point stored;  ///< When the response was stored.
+        clock_type::time_point expires; ///< When the response becomes stale.
+
+        entry(tx_response const& response_header,
+              Container const& response_body) :
+          vary_fields(),
+          vary_values(),
+          response(response_header),
+          body(response_body),
+          etag(),
+          stored(),
+          expires()
+        {}
+
+        /// Whether the entry is the variant of the response for a request.
+        bool matches(rx_request const& request) const
+        {
+          for (size_t i(0); i < vary_fields.size(); ++i)
+            if (request.headers().find(vary_fields[i]) != vary_values[i])
+              return false;
+          return true;
+        }
+
+        /// The size of the entry in bytes.
+        size_t size() const NOEXCEPT
+        { return response.header_string().size() + body.size(); }
+      };
+
+      /// The variants of the responses to a request method and uri.
+      typedef std::vector<std::shared_ptr<entry const> > variants;
+
+      /// The responses in a shard, keyed by request method and uri.
+      typedef std::unordered_map<std::string, variants> table;
+
+      /// A shard of the cache.
+      struct shard
+      {
+        table entries;            ///< The responses, see mutex.
+        mutable std::mutex mutex; ///< Guards the entries and size.
+        size_t size;              ///< The size of the responses, see mutex.
+
+        shard() :
+          entries(),
+          mutex(),
+          size(0)
+        {}
+      };
+
+      shard shards_[NUMBER_OF_SHARDS]; ///< The shards.
+      std::atomic<size_t> max_size_;   ///< The maximum size of the cache.
+
+      response_cache(response_cache const&) = delete;
+      response_cache& operator=(response_cache const&) = delete;
+
+      /// The ids of the response cache metrics in the metrics_registry.
+      struct metric_ids
+      {
+        size_t hits;   ///< The number of responses sent from the cache.
+        size_t misses; ///< The number of cacheable requests not in the cache.
+
+        metric_ids() :
+          hits  (metrics_registry::instance().
+                   counter("via_http_response_cache_hits_total")),
+          misses(metrics_registry::instance().
+                   counter("via_http_response_cache_misses_total"))
+        {}
+      };
+
+      /// The ids of the response cache metrics, registered on first use.
+      static metric_ids const& metrics()
+      {
+        static const metric_ids ids;
+        return ids;
+      }
+
+      /// The key of the responses to a request.
+      /// @param method the request method.
+      /// @param uri the request uri.
+      static std::string key(std::string const& method, std::string const& uri)
+      { return method + ' ' + uri; }
+
+      /// The shard for a key.
+      shard& find_shard(std::string const& key) NOEXCEPT
+      { return shards_[std::hash<std::string>()(key) % NUMBER_OF_SHARDS]; }
+
+      /// The shard for a key.
+      shard const& find_shard(std::string const& key) const NOEXCEPT
+      { return shards_[std::hash<std::string>()(key) % NUMBER_OF_SHARDS]; }
+
+      /// Remove stale entries from a table, then the entries that would
+      /// become stale first until the table is no larger than max_size.
+      /// @param entries the table.
+      /// @retval size the size of the table.
+      /// @param max_size the maximum size of the table.
+      /// @param now the current time.
+      static void trim(table& entries, size_t& size, size_t max_size,
+                       clock_type::time_point now)
+      {
+        bool trimming(true);
+        while (trimming)
+        {
+          // Find the entry that becomes stale first
+          typename table::iterator oldest(entries.end());
+          size_t oldest_index(0);
+          for (auto iter(entries.begin()); iter != entries.end(); )
+          {
+            variants& responses(iter->second);
+            for (size_t i(0); i < responses.size(); )
+            {
+              if (responses[i]->expires <= now)
+              {
+                size -= responses[i]->size();
+                responses.erase(responses.begin() + i);
+              }
+              else
+              {
+                if ((oldest == entries.end()) ||
+                    (responses[i]->expires <
+                       oldest->second[oldest_index]->expires))
+                {
+                  oldest = iter;
+                  oldest_index = i;
+                }
+                ++i;
+              }
+            }
+
+            if (responses.empty())
+              iter = entries.erase(iter);
+            else
+              ++iter;
+          }
+
+          trimming = (size > max_size) && (oldest != entries.end());
+          if (trimming)
+          {
+            size -= oldest->second[oldest_index]->size();
+            oldest->second.erase(oldest->second.begin() + oldest_index);
+            if (oldest->second.empty())
+              entries.erase(oldest);
+          }
+        }
+      }
+
+    public:
+
+      /// Constructor.
+      /// @param max_size the maximum size of the cache in bytes,
+      /// default DEFAULT_MAX_SIZE.
+      explicit response_cache(size_t max_size = DEFAULT_MAX_SIZE) :
+        shards_(),
+        max_size_(max_size)
+      {}
+
+      /// Convert a response into a 304 Not Modified response if its ETag
+      /// matches the request's If-None-Match header.
+      /// @param request the request.
+      /// @retval response the response.
+      /// @return true if the response has been converted, false otherwise.
+      static bool not_modified(rx_request const& request,
+                               tx_response& response)
+      {
+        std::string const& if_none_match
+            (request.headers().find(header_field::id::IF_NONE_MATCH));
+        if (if_none_match.empty() || (response.status() !=
+                  static_cast<int>(response_status::code::OK)))
+          return false;
+
+        std::string const etag
+          (cache_control::find_header(response, header_field::id::ETAG));
+        if (etag.empty() || !cache_control::etag_matches(if_none_match, etag))
+          return false;
+
+        // A 304 response has the header fields that would have been sent
+        // with a 200 response that affect caching, see RFC7232 section 4.1
+        tx_response modified(response_status::code::NOT_MODIFIED);
+        modified.add_header(header_field::id::ETAG, etag);
+        for (header_field::id const field_id :
+               { header_field::id::CACHE_CONTROL, header_field::id::EXPIRES,
+                 header_field::id::VARY })
+        {
+          std::string const value(cache_control::find_header(response,
+                                                             field_id));
+          if (!value.empty())
+            modified.add_header(field_id, value);
+        }
+        response = modified;
+        return true;
+      }
+
+      /// Respond to a request from the cache, if possible.
+      /// The response is sent from the cache if a fresh response has been
+      /// stored for the request and the request's Cache-Control (or Pragma)
+      /// header does not require a new response.
+      /// @param request the request.
+      /// @retval response the cached response with an Age header, or a
+      /// 304 Not Modified response.
+      /// @retval response_body the cached response body, empty for a
+      /// 304 Not Modified response.
+      /// @return true if the response is from the cache, false otherwise.
+      bool respond(rx_request const& request, tx_response& response,
+                   Container& response_body) const
+      {
+        if (request.method_id() != request_method::id::GET)
+          return false;
+
+        // The request may require a new response
+        std::string const& request_cache_control
+            (request.headers().find(header_field::id::CACHE_CONTROL));
+        cache_control::directives const directives
+            (cache_control::parse(request_cache_control));
+        if (directives.no_cache || directives.no_store ||
+            (request_cache_control.empty() &&
+             (request.headers().find(header_field::id::PRAGMA).find
+                ("no-cache") != std::string::npos)))
+          return false;
+
+        // Find a fresh variant of the response
+        std::string const request_key(key(request.method(), request.uri()));
+        shard const& cache_shard(find_shard(request_key));
+        clock_type::time_point const now(clock_type::now());
+        std::shared_ptr<entry const> cached;
+        long age(0);
+        {
+          std::lock_guard<std::mutex> lock(cache_shard.mutex);
+          typename table::const_iterator iter
+              (cache_shard.entries.find(request_key));
+          if (iter != cache_shard.entries.end())
+          {
+            for (auto const& variant : iter->second)
+            {
+              age = static_cast<long>
+                (std::chrono::duration_cast<std::chrono::seconds>
+                   (now - variant->stored).count());
+              if ((variant->expires > now) && variant->matches(request) &&
+                  ((directives.max_age < 0) || (age <= directives.max_age)))
+              {
+                cached = variant;
+                break;
+              }
+            }
+          }
+        }
+
+        if (!cached)
+        {
+          metrics_registry::instance().add(metrics().misses);
+          return false;
+        }
+
+        metrics_registry::instance().add(metrics().hits);
+        response = cached->response;
+        if (not_modified(request, response))
+          response_body = Container();
+        else
+        {
+          response.add_header(header_field::id::AGE, std::to_string(age));
+          response_body = cached->body;
+        }
+        return true;
+      }
+
+      /// Store the response to a request, if it may be cached.
+      /// A successful response to a request with an unsafe method, e.g.
+      /// POST, PUT or DELETE, removes the responses to GET requests for the
+      /// same uri, see RFC7234 section 4.4.
+      /// @param request the request.
+      /// @param response the response.
+      /// @param response_body the response body.
+      /// @param ttl the maximum time to live of the response in seconds.
+      void store(rx_request const& request, tx_response const& response,
+                 Container const& response_body, long ttl)
+      {
+        request_method::id const method_id(request.method_id());
+        if (method_id != request_method::id::GET)
+        {
+          if ((method_id != request_method::id::HEAD) &&
+              (method_id != request_method::id::OPTIONS) &&
+              (method_id != request_method::id::TRACE) &&
+              (response.status() >= 200) && (response.status() < 400))
+            erase(request_method::name(request_method::id::GET),
+                  request.uri());
+          return;
+        }
+
+        if ((ttl <= 0) || (response.status() !=
+                             static_cast<int>(response_status::code::OK)) ||
+            response.is_chunked() ||
+            !cache_control::find_header(response, "Set-Cookie").empty() ||
+            cache_control::parse(request.headers().find
+                                   (header_field::id::CACHE_CONTROL)).no_store)
+          return;
+
+        // A shared cache can only store a response to an authorized request
+        // if the response is public
+        cache_control::directives const directives(cache_control::parse
+          (cache_control::find_header(response,
+                                      header_field::id::CACHE_CONTROL)));
+        if (directives.no_store || directives.no_cache ||
+            directives.is_private || (directives.max_age == 0) ||
+            (!request.headers().find(header_field::id::AUTHORIZATION).empty() &&
+             !directives.is_public))
+          return;
+        if ((directives.max_age > 0) && (directives.max_age < ttl))
+          ttl = directives.max_age;
+
+        std::vector<std::string> vary_fields(cache_control::vary_fields
+              (cache_control::find_header(response, header_field::id::VARY)));
+        if (!vary_fields.empty() && (vary_fields.front() == "*"))
+          return;
+
+        std::shared_ptr<entry> cached(std::make_shared<entry>(response,
+                                                              response_body));
+        size_t const max_shard_size(max_size_ / NUMBER_OF_SHARDS);
+        if (cached->size() > max_shard_size)
+          return;
+
+        for (auto const& field : vary_fields)
+          cached->vary_values.push_back(request.headers().find(field));
+        cached->vary_fields.swap(vary_fields);
+        cached->etag = cache_control::find_header(response,
+                                                  header_field::id::ETAG);
+        cached->stored  = clock_type::now();
+        cached->expires = cached->stored + std::chrono::seconds(ttl);
+
+        // Replace any entry for the same variant, only trimming the shard
+        // when it's full
+        std::string const request_key(key(request.method(), request.uri()));
+        shard& cache_shard(find_shard(request_key));
+        std::lock_guard<std::mutex> lock(cache_shard.mutex);
+        variants& responses(cache_shard.entries[request_key]);
+        for (size_t i(0); i < responses.size(); )
+        {
+          if ((responses[i]->vary_fields == cached->vary_fields) &&
+              (responses[i]->vary_values == cached->vary_values))
+          {
+            cache_shard.size -= responses[i]->size();
+            responses.erase(responses.begin() + i);
+          }
+          else
+            ++i;
+        }
+        responses.push_back(cached);
+        cache_shard.size += cached->size();
+
+        if (cache_shard.size > max_shard_size)
+          trim(cache_shard.entries, cache_shard.size, max_shard_size,
+               cached->stored);
+      }
+
+      /// Remove the responses to a request method and uri.
+      /// @param method the request method, e.g. "GET".
+      /// @param uri the request uri.
+      void erase(std::string const& method, std::string const& uri)
+      {
+        std::string const request_key(key(method, uri));
+        shard& cache_shard(find_shard(request_key));
+        std::lock_guard<std::mutex> lock(cache_shard.mutex);
+        typename table::iterator iter(cache_shard.entries.find(request_key));
+        if (iter == cache_shard.entries.end())
+          return;
+
+        for (auto const& cached : iter->second)
+          cache_shard.size -= cached->size();
+        cache_shard.entries.erase(iter);
+      }
+
+      /// Set the maximum size of the cache.
+      /// Zero disables the cache.
+      /// @param max_size the maximum size of the cache in bytes.
+      void set_max_size(size_t max_size)
+      {
+        max_size_ = max_size;
+        clock_type::time_point const now(clock_type::now());
+        for (auto& cache_shard : shards_)
+        {
+          std::lock_guard<std::mutex> lock(cache_shard.mutex);
+          trim(cache_shard.entries, cache_shard.size,
+               max_size / NUMBER_OF_SHARDS, now);
+        }
+      }
+
+      /// Remove all of the responses.
+      void clear()
+      {
+        for (auto& cache_shard : shards_)
+        {
+          std::lock_guard<std::mutex> lock(cache_shard.mutex);
+          cache_shard.entries.clear();
+          cache_shard.size = 0;
+        }
+      }
+
+      /// The number of responses in the cache, including stale responses
+      /// that have not been removed yet.
+      size_t size() const
+      {
+        size_t count(0);
+        for (auto const& cache_shard : shards_)
+        {
+          std::lock_guard<std::mutex> lock(cache_shard.mutex);
+          for (auto const& elem : cache_shard.entries)
+            count += elem.second.size();
+        }
+        return count;
+      }
+
+      /// The total size of the responses in the cache, in bytes.
+      size_t bytes() const
+      {
+        size_t total(0);
+        for (auto const& cache_shard : shards_)
+        {
+          std::lock_guard<std::mutex> lock(cache_shard.mutex);
+          total += cache_shard.size;
+        }
+        return total;
+      }
+    };
+  }
+}
+
+#endif
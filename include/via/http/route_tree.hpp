@@ -0,0 +1,223 @@
+#ifndef ROUTE_TREE_HPP_VIA_HTTPLIB_
+#define ROUTE_TREE_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file route_tree.hpp
+/// @brief A radix tree of uri route paths.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request_view.hpp"
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    /// A map of strings to hold route parameters for the request handlers.
+    typedef std::map<std::string, std::string> Parameters;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class route_parameters
+    /// The parameters of a matched route as name:value string_views.
+    /// The names refer to the route_tree and the values refer to the uri
+    /// path that was matched, so the parameters are only valid while both
+    /// are retained.
+    /// The parameters are stored in a fixed size array, so that matching a
+    /// route doesn't allocate memory.
+    //////////////////////////////////////////////////////////////////////////
+    class route_parameters
+    {
+    public:
+
+      /// A parameter name:value pair.
+      typedef std::pair<string_view, string_view> value_type;
+
+      /// A const_iterator to the parameters.
+      typedef const value_type* const_iterator;
+
+      /// The maximum number of parameters in a route.
+      static const size_t MAX_PARAMETERS = 16;
+
+    private:
+
+      value_type parameters_[MAX_PARAMETERS]; ///< the parameters
+      size_t     size_;                       ///< the number of parameters
+
+    public:
+
+      /// Constructor.
+      route_parameters() :
+        parameters_(),
+        size_(0)
+      {}
+
+      /// Remove all of the parameters.
+      void clear() NOEXCEPT
+      { size_ = 0; }
+
+      /// Add a parameter.
+      /// @pre size() < MAX_PARAMETERS
+      /// @param parameter the parameter name:value pair.
+      void push_back(value_type const& parameter) NOEXCEPT
+      { parameters_[size_++] = parameter; }
+
+      /// Remove the last parameter.
+      /// @pre !empty()
+      void pop_back() NOEXCEPT
+      { --size_; }
+
+      /// The number of parameters.
+      size_t size() const NOEXCEPT
+      { return size_; }
+
+      /// Whether there are no parameters.
+      bool empty() const NOEXCEPT
+      { return size_ == 0; }
+
+      /// Accessor for a parameter.
+      /// @pre index < size()
+      value_type& operator[](size_t index) NOEXCEPT
+      { return parameters_[index]; }
+
+      /// Accessor for a parameter.
+      /// @pre index < size()
+      value_type const& operator[](size_t index) const NOEXCEPT
+      { return parameters_[index]; }
+
+      /// An iterator to the first parameter.
+      const_iterator begin() const NOEXCEPT
+      { return parameters_; }
+
+      /// An iterator to one past the last parameter.
+      const_iterator end() const NOEXCEPT
+      { return parameters_ + size_; }
+
+      /// Find a parameter by name.
+      /// @param name the parameter name.
+      /// @return an iterator to the parameter, end() if not found.
+      const_iterator find(string_view name) const NOEXCEPT
+      {
+        const_iterator iter(begin());
+        for (; iter != end(); ++iter)
+          if (iter->first == name)
+            break;
+        return iter;
+      }
+
+      /// Copy the parameters into a Parameters map.
+      /// @return the map of parameter name:value strings.
+      Parameters to_map() const
+      {
+        Parameters parameters;
+        for (const_iterator iter(begin()); iter != end(); ++iter)
+          parameters.insert(Parameters::value_type(iter->first.to_string(),
+                                                   iter->second.to_string()));
+        return parameters;
+      }
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @class route_tree
+    /// A compressed radix tree of uri route paths.
+    /// The routes are compiled when they are inserted: the static parts of
+    /// the paths are stored in nodes whose labels are the longest common
+    /// prefixes of the paths and each ':' parameter segment is stored as a
+    /// parameter node that matches a single, non-empty uri path segment.
+    ///
+    /// A uri path is matched in a single pass, preferring static nodes over
+    /// parameter nodes, e.g. "/customer/new" matches "/customer/new" before
+    /// "/customer/:id" irrespective of the order that they were inserted.
+    //////////////////////////////////////////////////////////////////////////
+    class route_tree
+    {
+    public:
+
+      /// The value returned by find when a path doesn't match a route.
+      static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    private:
+
+      /// A node in the route_tree.
+      struct node
+      {
+        std::string         label;       ///< the static characters to match
+        std::string         first_chars; ///< the first char of each child label
+        std::vector<size_t> children;    ///< the static child nodes
+        size_t              parameter;   ///< the parameter child node, 0 if none
+        size_t              route;       ///< the route, NOT_FOUND if none
+        std::string         path;        ///< the route path
+        std::vector<std::string> names;  ///< the route parameter names
+
+        /// Constructor.
+        node() :
+          label(),
+          first_chars(),
+          children(),
+          parameter(0),
+          route(NOT_FOUND),
+          path(),
+          names()
+        {}
+      };
+
+      /// The nodes, the root node is at index zero.
+      std::vector<node> nodes_;
+
+      /// Insert the static part of a route path below a node.
+      /// @param parent the index of the node.
+      /// @param begin the start of the static characters.
+      /// @param length the number of static characters.
+      /// @return the index of the node that matches the static characters.
+      size_t insert_static(size_t parent, const char* begin, size_t length);
+
+      /// Match the rest of a uri path from a node.
+      /// @param index the index of the node.
+      /// @param iter the start of the rest of the uri path.
+      /// @param end the end of the uri path.
+      /// @retval parameters the values of the parameters matched so far.
+      /// @return the index of the node that matches the path, NOT_FOUND if
+      /// the path doesn't match a route.
+      size_t match(size_t index, const char* iter, const char* end,
+                   route_parameters& parameters) const NOEXCEPT;
+
+    public:
+
+      /// Constructor, creates the root node.
+      route_tree() :
+        nodes_(1)
+      {}
+
+      /// Insert a route path.
+      /// @throw invalid_argument if the path has more than MAX_PARAMETERS or
+      /// if it only differs from an existing route by its parameter names.
+      /// @param path the route path, it may contain ':' parameters.
+      /// @param route the index of the route to insert.
+      /// @return the index of the route for the path: route if the path is
+      /// new, otherwise the index of the existing route.
+      size_t insert(std::string const& path, size_t route);
+
+      /// Find the route that matches a uri path.
+      /// @param path the uri path.
+      /// @retval parameters the route parameters.
+      /// @return the index of the route, NOT_FOUND if none.
+      size_t find(string_view path, route_parameters& parameters) const NOEXCEPT;
+
+      /// Remove all of the routes.
+      void clear()
+      { nodes_.assign(1, node()); }
+    };
+  }
+}
+
+#endif
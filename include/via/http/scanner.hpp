@@ -0,0 +1,157 @@
+#ifndef SCANNER_HPP_VIA_HTTPLIB_
+#define SCANNER_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file scanner.hpp
+/// @brief Functions to find the delimiters of HTTP header fields in bulk.
+/// The parsers use them to skip over the bulk of a uri, field name, field
+/// value or reason phrase and only parse the delimiters character by
+/// character.
+/// The functions are vectorised with SSE4.2 or AVX2 instructions, selected
+/// at run time on x86 processors. Define VIA_HTTPLIB_NO_SIMD to only use
+/// the scalar functions.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace via
+{
+  namespace http
+  {
+    /// @enum simd_level the instruction sets used by a scanner.
+    enum class simd_level
+    {
+      SCALAR, ///< no vector instructions.
+      SSE4_2, ///< SSE4.2 instructions, 16 bytes at a time.
+      AVX2    ///< AVX2 instructions, 32 bytes at a time.
+    };
+
+    /// The highest simd_level supported by the processor and the library.
+    /// @return the simd_level.
+    simd_level supported_simd_level() NOEXCEPT;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @struct scanner
+    /// A set of functions to find the first delimiter in a buffer.
+    /// Each function returns a pointer to the first delimiter in
+    /// [begin, end) or end if there isn't one.
+    //////////////////////////////////////////////////////////////////////////
+    struct scanner
+    {
+      /// A function to find a delimiter.
+      typedef const char* (*scan_function)(const char* begin, const char* end);
+
+      /// Find the first SP, HT, CR or LF, i.e. the end of a request uri.
+      scan_function find_ws_or_eol;
+
+      /// Find the first CR or LF, i.e. the end of a field value or reason.
+      scan_function find_eol;
+
+      /// Find the first character that's not a letter or '-', i.e. the
+      /// end of a field name.
+      scan_function find_not_name;
+
+      /// The scanner for the supported_simd_level.
+      /// @return a reference to the scanner.
+      static scanner const& instance() NOEXCEPT;
+
+      /// The scanner for a given simd_level.
+      /// @pre level <= supported_simd_level().
+      /// @param level the simd_level.
+      /// @return a reference to the scanner.
+      static scanner const& instance(simd_level level) NOEXCEPT;
+    };
+
+    /// @struct is_contiguous_iterator
+    /// Whether an iterator refers to a contiguous array of chars, so that
+    /// it can be scanned in bulk.
+    template <typename ForwardIterator>
+    struct is_contiguous_iterator : std::false_type {};
+
+    /// A char pointer is contiguous.
+    template <>
+    struct is_contiguous_iterator<char*> : std::true_type {};
+
+    /// A const char pointer is contiguous.
+    template <>
+    struct is_contiguous_iterator<const char*> : std::true_type {};
+
+    /// A std::string iterator is contiguous.
+    template <>
+    struct is_contiguous_iterator<std::string::iterator> : std::true_type {};
+
+    /// A std::string const_iterator is contiguous.
+    template <>
+    struct is_contiguous_iterator<std::string::const_iterator>
+      : std::true_type {};
+
+    /// A std::vector<char> iterator is contiguous.
+    template <>
+    struct is_contiguous_iterator<std::vector<char>::iterator>
+      : std::true_type {};
+
+    /// A std::vector<char> const_iterator is contiguous.
+    template <>
+    struct is_contiguous_iterator<std::vector<char>::const_iterator>
+      : std::true_type {};
+
+    /// Scan contiguous data for a delimiter.
+    /// @pre iter != end.
+    /// @param function the scan function.
+    /// @param iter an iterator to the start of the data.
+    /// @param end the end of the data.
+    /// @param max_length the maximum number of characters to scan.
+    /// @return the number of characters before the delimiter, max_length or
+    /// the end of the data.
+    template <typename ForwardIterator>
+    size_t scan(scanner::scan_function function,
+                ForwardIterator iter, ForwardIterator end, size_t max_length,
+                std::true_type) NOEXCEPT
+    {
+      const char* begin(&*iter);
+      size_t length(std::min(static_cast<size_t>(std::distance(iter, end)),
+                             max_length));
+      return function(begin, begin + length) - begin;
+    }
+
+    /// Data that isn't contiguous can't be scanned.
+    /// @return zero.
+    template <typename ForwardIterator>
+    size_t scan(scanner::scan_function, // function,
+                ForwardIterator, ForwardIterator, size_t, // iter, end, max
+                std::false_type) NOEXCEPT
+    { return 0; }
+
+    /// Scan data for a delimiter, if it's contiguous.
+    /// @pre iter != end.
+    /// @param function the scan function.
+    /// @param iter an iterator to the start of the data.
+    /// @param end the end of the data.
+    /// @param max_length the maximum number of characters to scan.
+    /// @return the number of characters before the delimiter, max_length or
+    /// the end of the data. Zero if the data isn't contiguous.
+    template <typename ForwardIterator>
+    size_t scan(scanner::scan_function function,
+                ForwardIterator iter, ForwardIterator end,
+                size_t max_length) NOEXCEPT
+    {
+      return scan(function, iter, end, max_length,
+                  is_contiguous_iterator<ForwardIterator>());
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef STATIC_FILES_HPP_VIA_HTTPLIB_
+#define STATIC_FILES_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file static_files.hpp
+/// @brief Contains the static_files class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request.hpp"
+#include "via/http/response.hpp"
+#include "via/comms/file_handle.hpp"
+#include <map>
+#include <string>
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    /// @class static_files
+    /// Responds to GET and HEAD requests with the files in a directory.
+    /// It supports conditional requests with If-Modified-Since and partial
+    /// requests with a single byte Range (and If-Range), and it keeps the
+    /// served files open in a comms::file_cache.
+    /// The response body is a comms::file_segment, so that http_connection
+    /// can send it directly from the file, e.g. with sendfile(2).
+    /// @see http_server::add_static_files
+    //////////////////////////////////////////////////////////////////////////
+    class static_files
+    {
+    public:
+
+      /// A response and the segment of the file to send as its body.
+      struct file_response
+      {
+        tx_response response;     ///< The response.
+        comms::file_segment body; ///< The body, empty if none.
+      };
+
+    private:
+
+      std::string directory_;  ///< The directory containing the files.
+      std::string index_file_; ///< The file to serve for a directory path.
+      /// The content types, keyed by lowercase file extension.
+      std::map<std::string, std::string> content_types_;
+      comms::file_cache cache_; ///< The open files.
+
+      static_files(static_files const&) = delete;
+      static_files& operator=(static_files const&) = delete;
+
+    public:
+
+      /// Constructor.
+      /// @param directory the directory containing the files.
+      /// @param max_open_files the maximum number of open files to cache,
+      /// default comms::file_cache::DEFAULT_MAX_FILES.
+      explicit static_files(std::string const& directory,
+                            size_t max_open_files =
+                              comms::file_cache::DEFAULT_MAX_FILES);
+
+      /// Set the file to serve for a path that ends in a '/'.
+      /// @param index_file the name of the file, default "index.html".
+      void set_index_file(std::string const& index_file)
+      { index_file_ = index_file; }
+
+      /// Set the Content-Type for the files with an extension.
+      /// Files with an unknown extension are application/octet-stream.
+      /// @param extension the file extension, without the '.'.
+      /// @param content_type the content type.
+      void set_content_type(std::string const& extension,
+                            std::string const& content_type);
+
+      /// The Content-Type of a file.
+      /// @param path the path of the file.
+      /// @return the content type for the file's extension.
+      std::string const& content_type(std::string const& path) const;
+
+      /// Accessor for the cache of open files.
+      comms::file_cache& cache() NOEXCEPT
+      { return cache_; }
+
+      /// Respond to a request for a file.
+      /// @param request the HTTP request.
+      /// @param path the (percent encoded) path of the file relative to the
+      /// directory, e.g. the request uri path after the mount prefix.
+      /// @return the response and the file segment to send as its body.
+      file_response respond(rx_request const& request,
+                            std::string const& path);
+    };
+  }
+}
+
+#endif
@@ -90,8 +90,6 @@ namespace via
     std::string port_name_;                         ///< the port name / number
     unsigned long period_;                          ///< the reconnection period
 
-    std::string tx_header_; /// A buffer for the HTTP request header.
-    Container   tx_body_;   /// A buffer for the HTTP request body.
     Container   rx_buffer_;  /// A buffer for the last packet read.
 
     ResponseHandler   http_response_handler_; ///< the response callback function
@@ -129,11 +127,17 @@ namespace via
         pointer->connect();
     }
 
-    /// Send buffers on the connection.
-    /// @param buffers the data to write.
-    bool send(comms::ConstBuffers buffers)
+    /// Send data on the connection.
+    /// The data is sent in a single write after the current handler returns.
+    /// @param header the HTTP header or chunk header to write, may be empty.
+    /// @param body the body data to write, may be empty.
+    /// @param buffers the unbuffered data to write after the body, may be
+    /// empty.
+    bool send(std::string header, Container body, comms::ConstBuffers buffers)
     {
       rx_.clear();
+      connection_->send_data(comms::to_container<Container>(std::move(header)));
+      connection_->send_data(std::move(body));
       return connection_->send_data(std::move(buffers));
     }
 
@@ -267,16 +271,17 @@ namespace via
     /// @param chunk_handler the handler for received HTTP chunks.
     /// @param rx_buffer_size the size of the receive_buffer, default
     /// SocketAdaptor::DEFAULT_RX_BUFFER_SIZE
+    /// @param context the connection's context, e.g. an SSL context.
     explicit http_client(boost::asio::io_service& io_service,
                          ResponseHandler response_handler,
                          ChunkHandler    chunk_handler,
-                         size_t          rx_buffer_size) :
-      connection_(connection_type::create(io_service, rx_buffer_size)),
+                         size_t          rx_buffer_size,
+                         typename connection_type::context_pointer context) :
+      connection_(connection_type::create(io_service, rx_buffer_size,
+                                          context)),
       timer_(io_service),
       rx_(),
       host_name_(),
-      tx_header_(),
-      tx_body_(),
       rx_buffer_(),
       http_response_handler_(response_handler),
       http_chunk_handler_(chunk_handler),
@@ -302,13 +307,17 @@ namespace via
     /// @param chunk_handler the handler for received HTTP chunks.
     /// @param rx_buffer_size the size of the receive_buffer, default
     /// SocketAdaptor::DEFAULT_RX_BUFFER_SIZE
+    /// @param context the connection's context, e.g. an SSL context,
+    /// default null: the SocketAdaptor's default context.
     static shared_pointer create(boost::asio::io_service& io_service,
                                  ResponseHandler response_handler,
                                  ChunkHandler    chunk_handler,
-               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE)
+               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE,
+               typename connection_type::context_pointer context =
+                 typename connection_type::context_pointer())
     {
       shared_pointer client_ptr(new http_client(io_service, response_handler,
-                                            chunk_handler, rx_buffer_size));
+                                   chunk_handler, rx_buffer_size, context));
       weak_pointer ptr(client_ptr);
       client_ptr->connection_->set_error_callback([]
         (const boost::system::error_code &error,
@@ -412,8 +421,7 @@ namespace via
         return false;
 
       request.add_header(http::header_field::id::HOST, http_host_name());
-      tx_header_ = request.message();
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_header_)));
+      return send(request.message(), Container(), comms::ConstBuffers());
     }
 
     /// Send an HTTP request with a body.
@@ -425,12 +433,8 @@ namespace via
         return false;
 
       request.add_header(http::header_field::id::HOST, http_host_name());
-      tx_header_ = request.message(body.size());
-      comms::ConstBuffers buffers(1, boost::asio::buffer(tx_header_));
-
-      tx_body_.swap(body);
-      buffers.push_back(boost::asio::buffer(tx_body_));
-      return send(std::move(buffers));
+      std::string header(request.message(body.size()));
+      return send(std::move(header), std::move(body), comms::ConstBuffers());
     }
 
     /// Send an HTTP request with a body.
@@ -444,10 +448,8 @@ namespace via
         return false;
 
       request.add_header(http::header_field::id::HOST, http_host_name());
-      tx_header_ = request.message(boost::asio::buffer_size(buffers));
-
-      buffers.push_front(boost::asio::buffer(tx_header_));
-      return send(std::move(buffers));
+      std::string header(request.message(boost::asio::buffer_size(buffers)));
+      return send(std::move(header), Container(), std::move(buffers));
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -462,8 +464,7 @@ namespace via
       if (!is_connected())
         return false;
 
-      tx_body_.swap(body);
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_body_)));
+      return send(std::string(), std::move(body), comms::ConstBuffers());
     }
 
     /// Send an HTTP request body.
@@ -477,7 +478,7 @@ namespace via
       if (!is_connected())
         return false;
 
-      return send(std::move(buffers));
+      return send(std::string(), Container(), std::move(buffers));
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -493,13 +494,9 @@ namespace via
 
       size_t size(chunk.size());
       http::chunk_header chunk_header(size, extension);
-      tx_header_ = chunk_header.to_string();
-      tx_body_.swap(chunk);
 
-      comms::ConstBuffers buffers(1, boost::asio::buffer(tx_header_));
-      buffers.push_back(boost::asio::buffer(tx_body_));
-      buffers.push_back(boost::asio::buffer(http::CRLF));
-      return send(std::move(buffers));
+      return send(chunk_header.to_string(), std::move(chunk),
+                  comms::ConstBuffers(1, boost::asio::buffer(http::CRLF)));
     }
 
     /// Send an HTTP body chunk.
@@ -516,10 +513,9 @@ namespace via
       size_t size(boost::asio::buffer_size(buffers));
 
       http::chunk_header chunk_header(size, extension);
-      tx_header_ = chunk_header.to_string();
-      buffers.push_front(boost::asio::buffer(tx_header_));
       buffers.push_back(boost::asio::buffer(http::CRLF));
-      return send(std::move(buffers));
+
+      return send(chunk_header.to_string(), Container(), std::move(buffers));
     }
 
     /// Send the last HTTP chunk for a request.
@@ -532,9 +528,8 @@ namespace via
         return false;
 
       http::last_chunk last_chunk(extension, trailer_string);
-      tx_header_ = last_chunk.to_string();
 
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_header_)));
+      return send(last_chunk.to_string(), Container(), comms::ConstBuffers());
     }
 
     ////////////////////////////////////////////////////////////////////////
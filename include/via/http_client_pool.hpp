@@ -0,0 +1,720 @@
+#ifndef HTTP_CLIENT_POOL_HPP_VIA_HTTPLIB_
+#define HTTP_CLIENT_POOL_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file http_client_pool.hpp
+/// @brief Contains the http_client_pool template class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request.hpp"
+#include "via/http/response.hpp"
+#include "via/comms/connection.hpp"
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+namespace via
+{
+  ////////////////////////////////////////////////////////////////////////////
+  /// @class http_client_pool
+  /// A pool of keep-alive connections to an HTTP server.
+  /// Requests are queued and sent on the first idle connection. Connections
+  /// are created when there are queued requests and no idle connections,
+  /// up to max_connections, and are re-established when the server drops
+  /// them.
+  /// Idempotent requests (GET, HEAD, PUT, DELETE, OPTIONS and TRACE) may be
+  /// pipelined on a busy connection, up to max_pipeline requests per
+  /// connection, they're resent once if the connection is dropped before
+  /// their responses are received.
+  /// The response_handler of each request is called with its response,
+  /// or with an error if the request couldn't be sent or was dropped.
+  /// Note: the pool is not thread safe, it must be called by the thread(s)
+  /// running the io_service.
+  /// @see http_client
+  /// @param SocketAdaptor the type of socket to use:
+  /// tcp_adaptor or ssl::ssl_tcp_adaptor
+  /// @param Container the container to use for the tx buffer:
+  /// std::vector<char> or std::string, default std::vector<char>.
+  /// @param use_strand if true use an asio::strand to wrap the handlers,
+  /// default false.
+  ////////////////////////////////////////////////////////////////////////////
+  template <typename SocketAdaptor, typename Container = std::vector<char>,
+            bool use_strand = false>
+  class http_client_pool : public std::enable_shared_from_this
+                     <http_client_pool<SocketAdaptor, Container, use_strand> >
+  {
+  public:
+    /// The underlying connection, TCP or SSL.
+    typedef comms::connection<SocketAdaptor, Container, use_strand>
+                                                              connection_type;
+
+    /// A weak pointer to this type.
+    typedef typename std::weak_ptr<http_client_pool<SocketAdaptor, Container,
+                                                   use_strand> > weak_pointer;
+
+    /// A shared pointer to this type.
+    typedef typename std::shared_ptr<http_client_pool<SocketAdaptor, Container,
+                                                   use_strand> > shared_pointer;
+
+    /// The enable_shared_from_this type of this class.
+    typedef typename std::enable_shared_from_this
+                <http_client_pool<SocketAdaptor, Container, use_strand> > enable;
+
+    /// A shared pointer to the connections' context, e.g. an SSL context.
+    typedef typename connection_type::context_pointer context_pointer;
+
+    /// The template requires a typename to access the iterator.
+    typedef typename Container::const_iterator Container_const_iterator;
+
+    /// The ResponseHandler type.
+    /// The error is set if the request failed, in which case the response
+    /// is empty.
+    typedef std::function <void (boost::system::error_code const&,
+                                 http::rx_response const&, Container const&)>
+      ResponseHandler;
+
+    /// The default maximum number of connections to the server.
+    static const size_t DEFAULT_MAX_CONNECTIONS = 4;
+
+    /// The default maximum number of requests in flight on a connection,
+    /// i.e. requests are not pipelined.
+    static const size_t DEFAULT_MAX_PIPELINE = 1;
+
+    /// The number of times that an idempotent request is resent after its
+    /// connection was dropped.
+    static const size_t MAX_RETRIES = 1;
+
+    /// The default time to wait for a released connection to shut down,
+    /// in milliseconds.
+    static const long DEFAULT_SHUTDOWN_TIMEOUT = 1000;
+
+  private:
+
+    /// A queued request.
+    struct request_data
+    {
+      std::string     header;        ///< the request header
+      Container       body;          ///< the request body
+      ResponseHandler handler;       ///< the response handler
+      bool            is_idempotent; ///< the request may be resent
+      bool            is_head;       ///< the response doesn't have a body
+      size_t          retries;       ///< the number of times it's been resent
+    };
+
+    /// A connection in the pool.
+    struct pooled_connection
+    {
+      std::shared_ptr<connection_type>   connection; ///< the comms connection
+      http::response_receiver<Container> rx;         ///< the response receiver
+      Container                rx_buffer; ///< a buffer for the last packet read
+      Container                body;      ///< the chunked response body
+      std::deque<request_data> in_flight; ///< the requests awaiting responses
+      bool                     connecting; ///< a connection is in progress
+
+      /// Constructor.
+      pooled_connection() :
+        connection(),
+        rx(),
+        rx_buffer(),
+        body(),
+        in_flight(),
+        connecting(false)
+      {}
+
+      /// Whether the connection is connected.
+      bool connected() const NOEXCEPT
+      { return connection && connection->connected(); }
+    };
+
+    ////////////////////////////////////////////////////////////////////////
+    // Variables
+
+    boost::asio::io_service& io_service_;     ///< the asio io_service
+    std::string host_name_;                   ///< the name of the host
+    std::string port_name_;                   ///< the port name / number
+    size_t      rx_buffer_size_;              ///< the connection rx buffer size
+    context_pointer context_;                 ///< the connection context
+    size_t      max_pipeline_;                ///< the requests per connection
+    long        shutdown_timeout_;            ///< the shutdown timeout in ms
+    std::vector<pooled_connection> connections_; ///< the pool of connections
+    std::deque<request_data>       queue_;       ///< the requests to send
+    http::response_receiver<Container> no_response_; ///< for failed requests
+
+    ////////////////////////////////////////////////////////////////////////
+    // Functions
+
+    /// @fn weak_from_this
+    /// Get a weak_pointer to this instance.
+    /// @return a weak_pointer to this http_client_pool.
+    weak_pointer weak_from_this()
+    { return weak_pointer(enable::shared_from_this()); }
+
+    /// Whether a request method is idempotent, see RFC7231 section 4.2.2.
+    /// @param method_id the request method id.
+    /// @return true if the request may be resent, false otherwise.
+    static bool is_idempotent(http::request_method::id method_id) NOEXCEPT
+    {
+      switch (method_id)
+      {
+      case http::request_method::id::OPTIONS:
+      case http::request_method::id::GET:
+      case http::request_method::id::HEAD:
+      case http::request_method::id::PUT:
+      case http::request_method::id::DELETE:
+      case http::request_method::id::TRACE:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    /// Queue a request and send it if a connection is available.
+    /// @param request the request.
+    /// @param body the request body.
+    /// @param handler the response handler.
+    void queue_request(http::tx_request request, Container body,
+                       ResponseHandler handler)
+    {
+      request.add_header(http::header_field::id::HOST, http_host_name());
+      request_data data =
+        { request.message(body.size()), std::move(body), handler,
+          is_idempotent(request.method_id()),
+          request.method_id() == http::request_method::id::HEAD, 0 };
+      queue_.push_back(std::move(data));
+      dispatch_requests();
+    }
+
+    /// Send the queued requests on the available connections and start
+    /// new connections for the requests that are still queued.
+    void dispatch_requests()
+    {
+      while (!queue_.empty())
+      {
+        pooled_connection* selected(0);
+        size_t connecting(0);
+        for (auto& pooled : connections_)
+        {
+          if (pooled.connecting)
+            ++connecting;
+          else if (pooled.connected())
+          {
+            if (pooled.in_flight.empty())
+            {
+              selected = &pooled;
+              break;
+            }
+
+            // only pipeline behind idempotent requests
+            if (queue_.front().is_idempotent &&
+                (pooled.in_flight.size() < max_pipeline_) &&
+                pooled.in_flight.back().is_idempotent &&
+                (!selected ||
+                 (pooled.in_flight.size() < selected->in_flight.size())))
+              selected = &pooled;
+          }
+        }
+
+        if (selected)
+        {
+          send_request(*selected);
+          continue;
+        }
+
+        // start another connection if there are more queued requests than
+        // connections in progress
+        if (connecting < queue_.size())
+        {
+          for (size_t i(0); i < connections_.size(); ++i)
+          {
+            if (!connections_[i].connecting && !connections_[i].connection)
+            {
+              connect(i);
+              break;
+            }
+          }
+        }
+        break;
+      }
+    }
+
+    /// Send the request at the front of the queue on a connection.
+    /// @param pooled the connection.
+    void send_request(pooled_connection& pooled)
+    {
+      request_data data(std::move(queue_.front()));
+      queue_.pop_front();
+
+      if (pooled.in_flight.empty())
+        pooled.rx.set_is_head(data.is_head);
+
+      pooled.connection->send_data
+          (comms::to_container<Container>(std::string(data.header)));
+      pooled.connection->send_data(Container(data.body));
+      pooled.in_flight.push_back(std::move(data));
+    }
+
+    /// Start a connection to the host.
+    /// @param index the index of the connection in the pool.
+    void connect(size_t index)
+    {
+      pooled_connection& pooled(connections_[index]);
+      pooled.connection = connection_type::create(io_service_, rx_buffer_size_,
+                                                  context_);
+      pooled.connection->set_no_delay(true);
+
+      weak_pointer ptr(weak_from_this());
+      pooled.connection->set_error_callback([ptr, index]
+        (const boost::system::error_code &error,
+         typename connection_type::weak_pointer weak_ptr)
+           { error_callback(ptr, index, error, weak_ptr); });
+      pooled.connection->set_event_callback([ptr, index]
+        (int event, typename connection_type::weak_pointer weak_ptr)
+           { event_callback(ptr, index, event, weak_ptr); });
+
+      pooled.connecting = true;
+      if (!pooled.connection->connect(host_name_.c_str(), port_name_.c_str()))
+        drop_connection(pooled, boost::asio::error::host_not_found);
+    }
+
+    /// Callback function for a comms::connection event.
+    /// @param ptr a weak pointer to this http_client_pool.
+    /// @param index the index of the connection in the pool.
+    /// @param event the type of event.
+    /// @param weak_ptr a weak ponter to the underlying comms connection.
+    static void event_callback(weak_pointer ptr, size_t index, int event,
+                               typename connection_type::weak_pointer weak_ptr)
+    {
+      shared_pointer pointer(ptr.lock());
+      if (pointer)
+        pointer->event_handler(index, event, weak_ptr);
+    }
+
+    /// Callback function for a comms::connection error.
+    /// @param ptr a weak pointer to this http_client_pool.
+    /// @param index the index of the connection in the pool.
+    /// @param error the boost error_code.
+    /// @param weak_ptr a weak ponter to the underlying comms connection.
+    static void error_callback(weak_pointer ptr, size_t index,
+                               const boost::system::error_code &error,
+                               typename connection_type::weak_pointer weak_ptr)
+    {
+      shared_pointer pointer(ptr.lock());
+      if (pointer)
+      {
+        pooled_connection& pooled(pointer->connections_[index]);
+        if (pooled.connection && (pooled.connection == weak_ptr.lock()))
+          pointer->drop_connection(pooled, error);
+      }
+    }
+
+    /// Receive an event from the underlying comms connection.
+    /// @param index the index of the connection in the pool.
+    /// @param event the type of event.
+    /// @param weak_ptr a weak ponter to the underlying comms connection.
+    void event_handler(size_t index, int event,
+                       typename connection_type::weak_pointer weak_ptr)
+    {
+      // Ignore events from a connection that has been replaced
+      pooled_connection& pooled(connections_[index]);
+      if (!pooled.connection || (pooled.connection != weak_ptr.lock()))
+        return;
+
+      switch(event)
+      {
+      case via::comms::CONNECTED:
+        pooled.connecting = false;
+        pooled.rx_buffer.clear();
+        pooled.rx.clear();
+        pooled.body.clear();
+        dispatch_requests();
+        break;
+      case via::comms::RECEIVED:
+        receive_handler(pooled);
+        break;
+      case via::comms::DISCONNECTED:
+        drop_connection(pooled, pooled.connected() ?
+                                  boost::asio::error::connection_reset :
+                                  boost::asio::error::connection_refused);
+        break;
+      default:
+        break;
+      }
+    }
+
+    /// Receive responses on a connection.
+    /// @param pooled the connection.
+    void receive_handler(pooled_connection& pooled)
+    {
+      pooled.connection->read_rx_buffer(pooled.rx_buffer);
+      Container_const_iterator iter(pooled.rx_buffer.begin());
+      Container_const_iterator end(pooled.rx_buffer.end());
+
+      while (iter != end)
+      {
+        // A response without a request
+        if (pooled.in_flight.empty())
+        {
+          drop_connection(pooled, boost::asio::error::connection_reset);
+          return;
+        }
+
+        http::Rx rx_state(pooled.rx.receive(iter, end));
+        switch (rx_state)
+        {
+        case http::RX_VALID:
+          // Ignore informational responses, e.g. 100 Continue
+          if (pooled.rx.response().status() < 200)
+            pooled.rx.clear();
+          else if (pooled.in_flight.front().is_head ||
+                   !pooled.rx.response().is_chunked())
+          {
+            if (!complete_request(pooled, pooled.rx.body()))
+              return;
+          }
+          break;
+
+        case http::RX_CHUNK:
+          pooled.body.insert(pooled.body.end(),
+                             pooled.rx.chunk().data().begin(),
+                             pooled.rx.chunk().data().end());
+          if (pooled.rx.chunk().is_last())
+          {
+            Container body;
+            body.swap(pooled.body);
+            if (!complete_request(pooled, body))
+              return;
+          }
+          break;
+
+        case http::RX_INVALID:
+          drop_connection(pooled, boost::asio::error::invalid_argument);
+          return;
+
+        default:
+          return;
+        }
+      }
+    }
+
+    /// Call the handler of the request at the front of a connection.
+    /// @param pooled the connection.
+    /// @param body the response body.
+    /// @return true if the connection is still connected, false otherwise.
+    bool complete_request(pooled_connection& pooled, Container const& body)
+    {
+      request_data data(std::move(pooled.in_flight.front()));
+      pooled.in_flight.pop_front();
+      if (!pooled.in_flight.empty())
+        pooled.rx.set_is_head(pooled.in_flight.front().is_head);
+
+      // Drop the connection before calling the handler if the server closes
+      // it, so that new requests aren't sent on it.
+      if (!pooled.rx.response().keep_alive())
+      {
+        http::rx_response const response(pooled.rx.response());
+        Container const response_body(body);
+        pooled.rx.clear();
+        drop_connection(pooled, boost::asio::error::connection_reset);
+        if (data.handler)
+          data.handler(boost::system::error_code(), response, response_body);
+        return false;
+      }
+
+      if (data.handler)
+        data.handler(boost::system::error_code(), pooled.rx.response(), body);
+      pooled.rx.clear();
+
+      if (!pooled.connection)
+        return false;
+
+      dispatch_requests();
+      return true;
+    }
+
+    /// Shut down a connection and release it.
+    /// The shutdown handler holds the connection and closes its socket, so
+    /// the connection is kept until the shutdown has completed, since an SSL
+    /// stream's operations refer to the stream. The shutdown cancels the
+    /// connection's other operations.
+    /// An SSL shutdown waits for the server's close_notify, so the socket is
+    /// closed if the shutdown hasn't completed within shutdown_timeout_,
+    /// which completes the shutdown.
+    /// @param connection the connection, it's reset.
+    void release_connection(std::shared_ptr<connection_type>& connection)
+    {
+      if (connection)
+      {
+        std::shared_ptr<connection_type> closed_connection;
+        closed_connection.swap(connection);
+        closed_connection->set_connected(false);
+
+        std::shared_ptr<boost::asio::deadline_timer> timer
+            (std::make_shared<boost::asio::deadline_timer>(io_service_));
+        timer->expires_from_now
+            (boost::posix_time::milliseconds(shutdown_timeout_));
+        timer->async_wait([closed_connection]
+          (boost::system::error_code const& error)
+        {
+          if (boost::asio::error::operation_aborted != error)
+            closed_connection->close();
+        });
+
+        closed_connection->SocketAdaptor::shutdown([closed_connection, timer]
+          (boost::system::error_code const&, size_t)
+        {
+          boost::system::error_code ignoredEc;
+          timer->cancel(ignoredEc);
+          closed_connection->close();
+        });
+      }
+    }
+
+    /// Close a connection, resend its idempotent requests and fail the
+    /// others.
+    /// @param pooled the connection.
+    /// @param error the reason the connection was dropped.
+    void drop_connection(pooled_connection& pooled,
+                         boost::system::error_code const& error)
+    {
+      bool const was_connected(pooled.connected());
+
+      // A response body that's delimited by the connection closing
+      if (!pooled.in_flight.empty() && pooled.rx.response().valid() &&
+          !pooled.rx.response().is_chunked() &&
+          pooled.rx.response().headers().find
+                    (http::header_field::id::CONTENT_LENGTH).empty())
+      {
+        Container body(pooled.rx.body());
+        request_data data(std::move(pooled.in_flight.front()));
+        pooled.in_flight.pop_front();
+        if (data.handler)
+          data.handler(boost::system::error_code(), pooled.rx.response(), body);
+      }
+
+      release_connection(pooled.connection);
+      pooled.connecting = false;
+      pooled.rx_buffer.clear();
+      pooled.rx.clear();
+      pooled.body.clear();
+
+      // Resend the idempotent requests in order, fail the others
+      std::deque<request_data> in_flight;
+      in_flight.swap(pooled.in_flight);
+      std::deque<request_data> failed;
+      while (!in_flight.empty())
+      {
+        request_data& data(in_flight.back());
+        if (data.is_idempotent && (data.retries < MAX_RETRIES))
+        {
+          ++data.retries;
+          queue_.push_front(std::move(data));
+        }
+        else
+          failed.push_front(std::move(data));
+        in_flight.pop_back();
+      }
+
+      // If the host can't be connected to, fail the queued requests
+      if (!was_connected && (connected() == 0) && (connecting() == 0))
+      {
+        while (!queue_.empty())
+        {
+          failed.push_back(std::move(queue_.front()));
+          queue_.pop_front();
+        }
+      }
+
+      for (auto& data : failed)
+        if (data.handler)
+          data.handler(error, no_response_.response(), no_response_.body());
+
+      // Reconnect for the requests that are queued, unless the connection
+      // failed, in which case they wait for the other connections
+      if (was_connected)
+        dispatch_requests();
+    }
+
+    /// Constructor.
+    /// @param io_service the asio io_service to use.
+    /// @param host_name the host to connect to.
+    /// @param port_name the port to connect to.
+    /// @param max_connections the maximum number of connections.
+    /// @param rx_buffer_size the size of the receive_buffer.
+    /// @param context the connections' context, e.g. an SSL context.
+    explicit http_client_pool(boost::asio::io_service& io_service,
+                              std::string const& host_name,
+                              std::string const& port_name,
+                              size_t max_connections,
+                              size_t rx_buffer_size,
+                              context_pointer context) :
+      io_service_(io_service),
+      host_name_(host_name),
+      port_name_(port_name),
+      rx_buffer_size_(rx_buffer_size),
+      context_(context),
+      max_pipeline_(DEFAULT_MAX_PIPELINE),
+      shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
+      connections_(max_connections),
+      queue_(),
+      no_response_()
+    {}
+
+    ////////////////////////////////////////////////////////////////////////
+
+  public:
+
+    /// @fn create
+    /// The factory function to create pools.
+    /// @throw invalid_argument if max_connections is zero.
+    /// @param io_service the boost asio io_service used by the underlying
+    /// connections.
+    /// @param host_name the host to connect to.
+    /// @param port_name the port to connect to, default "http".
+    /// @param max_connections the maximum number of connections,
+    /// default DEFAULT_MAX_CONNECTIONS.
+    /// @param rx_buffer_size the size of the receive_buffer, default
+    /// SocketAdaptor::DEFAULT_RX_BUFFER_SIZE
+    /// @param context the connections' context, e.g. an SSL context,
+    /// default null: the SocketAdaptor's default context.
+    static shared_pointer create(boost::asio::io_service& io_service,
+                                 std::string const& host_name,
+                                 std::string const& port_name = "http",
+                         size_t max_connections = DEFAULT_MAX_CONNECTIONS,
+               size_t rx_buffer_size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE,
+               context_pointer context = context_pointer())
+    {
+      if (max_connections == 0)
+        throw std::invalid_argument("http_client_pool: no connections");
+
+      return shared_pointer(new http_client_pool(io_service, host_name,
+                       port_name, max_connections, rx_buffer_size, context));
+    }
+
+    /// Destructor
+    /// Close the connections.
+    virtual ~http_client_pool()
+    {
+      for (auto& pooled : connections_)
+        if (pooled.connection)
+          pooled.connection->close();
+    }
+
+    /// Set the maximum number of idempotent requests that may be in flight
+    /// on a connection, i.e. pipelined.
+    /// @throw invalid_argument if max_pipeline is zero.
+    /// @param max_pipeline the maximum number of requests per connection.
+    void set_max_pipeline(size_t max_pipeline)
+    {
+      if (max_pipeline == 0)
+        throw std::invalid_argument("http_client_pool: max_pipeline is zero");
+      max_pipeline_ = max_pipeline;
+    }
+
+    /// Set the maximum time to wait for a released connection to shut
+    /// down before its socket is closed, e.g. for an SSL server's
+    /// close_notify.
+    /// @param milliseconds the shutdown timeout in milliseconds.
+    void set_shutdown_timeout(long milliseconds) NOEXCEPT
+    { shutdown_timeout_ = milliseconds; }
+
+    /// Get the host name to send in the http "Host:" header.
+    /// @return http host name.
+    std::string http_host_name() const
+    {
+      if ((port_name_ == "http") || (port_name_ == "https"))
+        return host_name_;
+      else
+        return host_name_ + ":" + port_name_;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // send (request) functions
+
+    /// Send an HTTP request without a body.
+    /// @param request the request to send.
+    /// @param handler the handler for the response.
+    void send(http::tx_request request, ResponseHandler handler)
+    { queue_request(std::move(request), Container(), handler); }
+
+    /// Send an HTTP request with a body.
+    /// @param request the request to send.
+    /// @param body the body to send
+    /// @param handler the handler for the response.
+    void send(http::tx_request request, Container body,
+              ResponseHandler handler)
+    { queue_request(std::move(request), std::move(body), handler); }
+
+    ////////////////////////////////////////////////////////////////////////
+    // other functions
+
+    /// Close the connections and fail the requests that haven't been
+    /// responded to with operation_aborted.
+    void close()
+    {
+      std::deque<request_data> failed;
+      failed.swap(queue_);
+      for (auto& pooled : connections_)
+      {
+        while (!pooled.in_flight.empty())
+        {
+          failed.push_back(std::move(pooled.in_flight.front()));
+          pooled.in_flight.pop_front();
+        }
+
+        release_connection(pooled.connection);
+        pooled.connecting = false;
+        pooled.rx.clear();
+        pooled.body.clear();
+      }
+
+      for (auto& data : failed)
+        if (data.handler)
+          data.handler(boost::asio::error::operation_aborted,
+                       no_response_.response(), no_response_.body());
+    }
+
+    /// The number of requests waiting for a connection.
+    size_t queued() const NOEXCEPT
+    { return queue_.size(); }
+
+    /// The number of requests that have been sent and are waiting for
+    /// their responses.
+    size_t in_flight() const NOEXCEPT
+    {
+      size_t requests(0);
+      for (auto const& pooled : connections_)
+        requests += pooled.in_flight.size();
+      return requests;
+    }
+
+    /// The number of connected connections.
+    size_t connected() const NOEXCEPT
+    {
+      size_t connections(0);
+      for (auto const& pooled : connections_)
+        if (!pooled.connecting && pooled.connected())
+          ++connections;
+      return connections;
+    }
+
+    /// The number of connections in progress.
+    size_t connecting() const NOEXCEPT
+    {
+      size_t connections(0);
+      for (auto const& pooled : connections_)
+        if (pooled.connecting)
+          ++connections;
+      return connections;
+    }
+  };
+}
+
+#endif
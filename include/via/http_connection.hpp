@@ -17,9 +17,13 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/request.hpp"
 #include "via/http/response.hpp"
+#include "via/http/compression.hpp"
 #include "via/comms/connection.hpp"
+#include "via/comms/shared_buffer.hpp"
+#include <cctype>
 #include <deque>
 #include <iostream>
+#include <utility>
 
 namespace via
 {
@@ -40,29 +44,87 @@ namespace via
   /// std::array<char, size>
   /// @param use_strand if true use an asio::strand to wrap the handlers,
   /// default false.
+  /// @param RxBufferPool the pool to borrow receive buffers from,
+  /// default comms::rx_buffer_pool<Container>.
   ////////////////////////////////////////////////////////////////////////////
-  template <typename SocketAdaptor, typename Container, bool use_strand>
+  template <typename SocketAdaptor, typename Container, bool use_strand,
+            typename RxBufferPool = comms::rx_buffer_pool<Container> >
   class http_connection : public std::enable_shared_from_this
-                      <http_connection<SocketAdaptor, Container, use_strand> >
+        <http_connection<SocketAdaptor, Container, use_strand, RxBufferPool> >
   {
   public:
     /// The underlying connection, TCP or SSL.
-    typedef comms::connection<SocketAdaptor, Container, use_strand>
-                                                              connection_type;
+    typedef comms::connection<SocketAdaptor, Container, use_strand,
+                              RxBufferPool> connection_type;
 
     /// A weak pointer to this type.
     typedef typename std::weak_ptr<http_connection<SocketAdaptor, Container,
-                                     use_strand> > weak_pointer;
+                                     use_strand, RxBufferPool> > weak_pointer;
 
     /// A strong pointer to this type.
     typedef typename std::shared_ptr<http_connection<SocketAdaptor, Container,
-                                       use_strand> > shared_pointer;
+                                     use_strand, RxBufferPool> > shared_pointer;
 
     /// The template requires a typename to access the iterator.
     typedef typename Container::const_iterator Container_const_iterator;
 
+    /// The identifier of a response in the connection's response queue.
+    /// Zero is not a valid identifier.
+    typedef size_t response_id;
+
   private:
 
+    /// Response data waiting for the responses to earlier requests.
+    struct tx_data
+    {
+      boost::asio::const_buffer preformatted; ///< an unbuffered header
+      std::string header;                     ///< the header or chunk header
+      Container body;                         ///< the body or chunk data
+      comms::shared_buffer shared;            ///< shared body data
+      comms::ConstBuffers buffers;            ///< unbuffered body data
+      comms::file_segment file;               ///< body data from a file
+    };
+
+    /// The response to a request, in the order that the requests were
+    /// received.
+    struct response_slot
+    {
+      response_id id;             ///< the identifier of the response
+      char major_version;         ///< the HTTP major version of the request
+      char minor_version;         ///< the HTTP minor version of the request
+      bool is_head;               ///< whether the request was a HEAD request
+      bool keep_alive;            ///< whether to keep the connection alive
+      bool complete;              ///< whether the response has been sent
+      /// the content coding negotiated for the response
+      http::content_coding::id coding;
+      /// compresses the chunks of a chunked response, if any
+      std::unique_ptr<http::encoder> encoder;
+      std::deque<tx_data> pending; ///< data waiting for earlier responses
+
+      /// Constructor.
+      /// @param response the identifier of the response.
+      /// @param rx the request receiver containing the request.
+      response_slot(response_id response,
+                    http::request_receiver<Container> const& rx) :
+        id(response),
+        major_version(rx.request().major_version()),
+        minor_version(rx.request().minor_version()),
+        is_head(rx.is_head()),
+        keep_alive(rx.request().keep_alive()),
+        complete(false),
+        coding(http::content_coding::IDENTITY),
+        encoder(),
+        pending()
+      {
+        // An invalid request may not have a version, so respond with HTTP/1.1
+        if (!std::isdigit(major_version) || !std::isdigit(minor_version))
+        {
+          major_version = '1';
+          minor_version = '1';
+        }
+      }
+    };
+
     ////////////////////////////////////////////////////////////////////////
     // Variables
 
@@ -75,59 +137,255 @@ namespace via
     /// The request receiver for this connection.
     http::request_receiver<Container> rx_;
 
-    /// A buffer for the HTTP header of the response message.
-    std::string tx_header_;
+    /// The position in the receive buffer to resume receiving from.
+    size_t rx_offset_;
+
+    /// The responses in request order, from the oldest unsent response.
+    std::deque<response_slot> tx_slots_;
+
+    /// The identifier of the next response slot.
+    response_id next_response_id_;
 
-    /// A buffer for the body of the response message.
-    Container tx_body_;
+    /// The response to the request being received, zero if none.
+    response_id rx_response_;
 
-    /// A buffer for the last packet read on the connection.
-    Container rx_buffer_;
+    /// The response that the send functions write to.
+    response_id tx_response_;
+
+    /// The response compression settings, null if disabled.
+    std::shared_ptr<http::response_compression> compression_;
 
     ////////////////////////////////////////////////////////////////////////
     // Functions
 
-    /// Send buffers on the connection.
-    /// @param buffers the data to write.
-    bool send(comms::ConstBuffers buffers)
+    /// Queue data on the connection's transmit queue.
+    /// The data is sent in a single write after the current handler returns.
+    /// The preformatted header is written first, then the header, body,
+    /// shared data, buffers and file, any of which may be empty.
+    /// @param tcp_pointer a shared pointer to the connection.
+    /// @param data the data to write.
+    static void send_data(std::shared_ptr<connection_type> const& tcp_pointer,
+                          tx_data data)
+    {
+      tcp_pointer->send_data(data.preformatted);
+      tcp_pointer->send_data
+        (comms::to_container<Container>(std::move(data.header)));
+      tcp_pointer->send_data(std::move(data.body));
+      if (!data.shared.empty())
+        tcp_pointer->send_data(std::move(data.shared));
+      if (!data.buffers.empty())
+        tcp_pointer->send_data(std::move(data.buffers));
+      if (data.file.file)
+        tcp_pointer->send_data(std::move(data.file));
+    }
+
+    /// Find a response slot.
+    /// @param id the identifier of the response.
+    /// @return a pointer to the response slot, nullptr if the response has
+    /// been sent.
+    response_slot* find_slot(response_id id) NOEXCEPT
+    {
+      if (tx_slots_.empty() || (id < tx_slots_.front().id))
+        return nullptr;
+
+      size_t const index(id - tx_slots_.front().id);
+      return (index < tx_slots_.size()) ? &tx_slots_[index] : nullptr;
+    }
+
+    /// Write the data of the responses at the front of the queue, up to the
+    /// first response that has not been completely sent.
+    /// Disconnects after a response that doesn't keep the connection alive.
+    /// @param tcp_pointer a shared pointer to the connection.
+    /// @return true if the connection is kept alive, false otherwise.
+    bool flush(std::shared_ptr<connection_type> const& tcp_pointer)
+    {
+      while (!tx_slots_.empty())
+      {
+        response_slot& front(tx_slots_.front());
+        for (typename std::deque<tx_data>::iterator iter(front.pending.begin());
+             iter != front.pending.end(); ++iter)
+          send_data(tcp_pointer, std::move(*iter));
+        front.pending.clear();
+
+        if (!front.complete)
+          break;
+
+        if (!front.keep_alive)
+        {
+          tx_slots_.clear();
+          tcp_pointer->disconnect();
+          return false;
+        }
+
+        tx_slots_.pop_front();
+      }
+
+      return true;
+    }
+
+    /// Write data to a response slot.
+    /// The data is sent if the slot is at the front of the queue, otherwise
+    /// it's held in the slot until the responses to earlier requests have
+    /// been sent.
+    /// @param tcp_pointer a shared pointer to the connection.
+    /// @param slot the response slot.
+    /// @param data the data to write.
+    /// @param complete whether the data completes the response.
+    /// @return true if the connection is kept alive, false otherwise.
+    bool write_slot(std::shared_ptr<connection_type> const& tcp_pointer,
+                    response_slot& slot, tx_data data, bool complete)
+    {
+      slot.complete = complete;
+      bool const keep_alive(slot.keep_alive);
+      if (complete && (slot.id == tx_response_))
+        tx_response_ = rx_response_;
+
+      if (&slot == &tx_slots_.front())
+      {
+        send_data(tcp_pointer, std::move(data));
+        if (complete)
+          return flush(tcp_pointer);
+      }
+      else
+        slot.pending.push_back(std::move(data));
+
+      return keep_alive;
+    }
+
+    /// Send chunk data on the connection.
+    /// @param data the chunk header or last chunk and the chunk data to
+    /// write.
+    /// @param is_last whether this is the last chunk of the response.
+    bool send_chunk_data(tx_data data, bool is_last)
     {
       std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
       if (tcp_pointer)
       {
-        tcp_pointer->send_data(std::move(buffers));
+        response_slot* slot(find_slot(tx_response_));
+        if (slot && !slot->complete)
+          return write_slot(tcp_pointer, *slot, std::move(data), is_last);
+
+        // Chunks without a response slot can only follow all the responses
+        if (!tx_slots_.empty())
+          return false;
+
+        send_data(tcp_pointer, std::move(data));
         return true;
       }
       else
         return false;
     }
 
-    /// Send buffers on the connection.
-    /// @param buffers the data to write.
+    /// Send data on the connection.
+    /// @param header the chunk header or last chunk to write.
+    /// @param body the chunk data to write, may be empty.
+    /// @param buffers the unbuffered data to write after the body, may be
+    /// empty.
+    /// @param is_last whether this is the last chunk of the response.
+    bool send(std::string header, Container body, comms::ConstBuffers buffers,
+              bool is_last = false)
+    {
+      tx_data data = { boost::asio::const_buffer(), std::move(header),
+                       std::move(body), comms::shared_buffer(),
+                       std::move(buffers), comms::file_segment() };
+      return send_chunk_data(std::move(data), is_last);
+    }
+
+    /// Send a response on the connection.
+    /// @param header the HTTP response header to write.
+    /// @param body the body data to write, may be empty.
+    /// @param buffers the unbuffered data to write after the body, may be
+    /// empty.
     /// @param is_continue whether this is a 100 Continue response
-    bool send(comms::ConstBuffers buffers, bool is_continue)
+    /// @param is_chunked whether the response body is sent in chunks.
+    /// @param preformatted an unbuffered preformatted header to write before
+    /// the header, may be empty.
+    bool send(std::string header, Container body, comms::ConstBuffers buffers,
+              bool is_continue, bool is_chunked,
+          boost::asio::const_buffer preformatted = boost::asio::const_buffer())
     {
-      bool keep_alive(rx_.request().keep_alive());
-      if (is_continue)
-        rx_.set_continue_sent();
-      else
-        rx_.clear();
+      tx_data data = { preformatted, std::move(header), std::move(body),
+                       comms::shared_buffer(), std::move(buffers),
+                       comms::file_segment() };
+      return send_response_data(std::move(data), is_continue, is_chunked);
+    }
 
-      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
-      if (tcp_pointer)
-      {
-        tcp_pointer->send_data(std::move(buffers));
+    /// Send response data on the connection.
+    /// @param data the HTTP response header and body to write.
+    /// @param is_continue whether this is a 100 Continue response
+    /// @param is_chunked whether the response body is sent in chunks.
+    bool send_response_data(tx_data data, bool is_continue, bool is_chunked)
+    {
+      response_slot* slot(find_slot(tx_response_));
+      if (!slot || slot->complete)
+        return false;
 
-        if (keep_alive)
-          return true;
+      // An early response to the request being received ends the request
+      if (slot->id == rx_response_)
+      {
+        if (is_continue)
+          rx_.set_continue_sent();
         else
-          tcp_pointer->shutdown();
+          clear_request();
       }
+
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        return write_slot(tcp_pointer, *slot, std::move(data),
+                          !is_continue && !is_chunked);
       else
         std::cerr << "http_connection::send connection weak pointer expired"
                   << std::endl;
       return false;
     }
 
+    /// Select the content coding of a response body.
+    /// If the response is compressible it adds a Vary header and, if the
+    /// body is to be compressed, a Content-Encoding header.
+    /// @param slot the response slot.
+    /// @param response the response.
+    /// @param size the size of the response body.
+    /// @return the content coding of the body, IDENTITY if it's not
+    /// compressed.
+    http::content_coding::id select_coding(response_slot const& slot,
+                                           http::tx_response& response,
+                                           size_t size) const
+    {
+      if (!compression_ || !compression_->is_compressible(response, size))
+        return http::content_coding::IDENTITY;
+
+      http::response_compression::add_headers(slot.coding, response);
+      return slot.coding;
+    }
+
+    /// Call a send function with a response selected, then select the
+    /// previously selected response again.
+    /// @param id the identifier of the response.
+    /// @param function the send function.
+    /// @return the result of the function, false if the response has
+    /// already been sent.
+    template <typename Function>
+    bool send_to(response_id id, Function function)
+    {
+      response_id const current(tx_response_);
+      if (!select_response(id))
+        return false;
+
+      bool const result(function());
+      if (current != id)
+        tx_response_ = current;
+      return result;
+    }
+
+    /// The encoder of the response that the send functions write to.
+    /// @return a pointer to the encoder, nullptr if the chunks of the
+    /// response are not compressed.
+    http::encoder* chunk_encoder() NOEXCEPT
+    {
+      response_slot* slot(find_slot(tx_response_));
+      return (slot && !slot->complete) ? slot->encoder.get() : nullptr;
+    }
+
     ////////////////////////////////////////////////////////////////////////
 
   public:
@@ -168,9 +426,12 @@ namespace via
       rx_(strict_crlf, max_whitespace, max_method_length, max_uri_length,
           max_line_length, max_header_number, max_header_length,
           max_body_size, max_chunk_size),
-      tx_header_(),
-      tx_body_(),
-      rx_buffer_()
+      rx_offset_(0),
+      tx_slots_(),
+      next_response_id_(1),
+      rx_response_(0),
+      tx_response_(0),
+      compression_()
     {}
 
     /// The destructor calls close to ensure that all of the socket's
@@ -197,32 +458,222 @@ namespace via
     void set_concatenate_chunks(bool enable) NOEXCEPT
     { rx_.set_concatenate_chunks(enable); }
 
+    /// Enable whether the http server streams request bodies.
+    /// If a BodyHandler is registered with the http_server then request
+    /// bodies are delivered as they are received instead of being
+    /// accumulated into the request message body.
+    /// @post body streaming enabled/disabled.
+    /// @param enable enable the function.
+    void set_stream_body(bool enable) NOEXCEPT
+    { rx_.set_stream_body(enable); }
+
+    /// Set the maximum size of a decompressed request body.
+    /// If it's not zero, request bodies with a gzip or deflate
+    /// Content-Encoding are decompressed as they are received.
+    /// @post request body decompression enabled/disabled.
+    /// @param max_size the maximum size, zero disables decompression.
+    void set_max_decompressed_size(size_t max_size) NOEXCEPT
+    { rx_.set_max_decompressed_size(max_size); }
+
+    /// Set the response compression settings.
+    /// @param compression the response compression settings, null disables
+    /// response compression.
+    void set_compression
+      (std::shared_ptr<http::response_compression> compression) NOEXCEPT
+    { compression_ = std::move(compression); }
+
     ////////////////////////////////////////////////////////////////////////
     // Accessors
 
-    /// Read the last packet into the receive buffer.
-    /// @post the receive buffer is invalid to read again.
+    /// Read the last packet from the underlying connection's receive buffer.
+    /// The buffer is borrowed from the connection's receive buffer pool and
+    /// returned to it after the receive event has been handled.
+    /// @pre Only valid within the receive event callback function.
     /// @return the receive buffer.
-    Container const& read_rx_buffer()
-    {
-      connection_.lock()->read_rx_buffer(rx_buffer_);
-      return rx_buffer_;
-    }
+    Container const& read_rx_buffer() const
+    { return rx_buffer(); }
 
     /// Accessor for the receive buffer.
+    /// @pre Only valid within the receive event callback function.
     /// @return the receive buffer.
-    Container const& rx_buffer() const NOEXCEPT
-    { return rx_buffer_; }
+    Container const& rx_buffer() const
+    {
+      static const Container EMPTY_BUFFER;
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      return tcp_pointer ? tcp_pointer->rx_buffer() : EMPTY_BUFFER;
+    }
 
     /// Accessor for the remote address of the connection.
     /// @return the remote address of the connection.
     std::string remote_address() const NOEXCEPT
     { return remote_address_; }
 
+    /// Accessor for the handle of the connection in the comms server.
+    /// @return the handle of the connection, invalid if disconnected.
+    comms::slot_handle handle() const NOEXCEPT
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      return tcp_pointer ? tcp_pointer->handle() : comms::slot_handle();
+    }
+
     /// The request receiver for this connection.
     http::request_receiver<Container>& rx() NOEXCEPT
     { return rx_; }
 
+    /// Accessor for the position in the receive buffer to resume receiving
+    /// from after reception has been paused.
+    size_t rx_offset() const NOEXCEPT
+    { return rx_offset_; }
+
+    /// Set the position in the receive buffer to resume receiving from.
+    /// @param offset the position in the receive buffer.
+    void set_rx_offset(size_t offset) NOEXCEPT
+    { rx_offset_ = offset; }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Flow control functions
+
+    /// Stop receiving data on the connection, e.g. while the application
+    /// processes part of a streamed request body asynchronously.
+    /// If it's called by a BodyHandler, the data passed to the handler
+    /// remains valid until reception is resumed.
+    void pause_reception()
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        tcp_pointer->pause_reception();
+    }
+
+    /// Resume receiving data on the connection after pause_reception.
+    /// Any received data that follows the data passed to the BodyHandler is
+    /// then processed before more data is read.
+    void resume_reception()
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        tcp_pointer->resume_reception();
+    }
+
+    /// Dispatch a handler to the connection's io_service, e.g. to send a
+    /// response from another thread.
+    /// @see comms::connection::dispatch
+    /// @param handler the handler to call.
+    /// @return true if dispatched, false if the connection has closed.
+    template <typename Handler>
+    bool dispatch(Handler handler)
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        tcp_pointer->dispatch(std::move(handler));
+      return static_cast<bool>(tcp_pointer);
+    }
+
+    /// Whether reception has been paused.
+    /// @return true if paused, false otherwise.
+    bool reception_paused() const
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      return tcp_pointer && tcp_pointer->reception_paused();
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Response queue functions
+
+    /// Open a response slot for the request being received, unless one is
+    /// already open, and select it for the send functions.
+    /// The responses are sent in the order that the requests were received,
+    /// so the responses to pipelined requests may be sent out of order.
+    /// Called by http_server before it calls a request handler.
+    /// @return the identifier of the response.
+    response_id open_response()
+    {
+      if (!rx_response_)
+      {
+        rx_response_ = next_response_id_++;
+        tx_slots_.push_back(response_slot(rx_response_, rx_));
+        if (compression_)
+          tx_slots_.back().coding =
+              compression_->negotiate(rx_.request(), rx_.is_head());
+      }
+      tx_response_ = rx_response_;
+      return rx_response_;
+    }
+
+    /// Clear the request receiver, ready to receive the next request.
+    void clear_request()
+    {
+      rx_.clear();
+      rx_response_ = 0;
+    }
+
+    /// Accessor for the response that the send functions write to.
+    /// Within a request handler it's the response to the request, so a
+    /// handler that responds later, e.g. from another thread, should store
+    /// it and send the response with the send functions that take a
+    /// response_id.
+    /// @return the identifier of the response.
+    response_id current_response() const NOEXCEPT
+    { return tx_response_; }
+
+    /// Select the response that the send functions write to.
+    /// After the response has been sent, e.g. a response with a body or
+    /// the last chunk of a chunked response, the send functions write to
+    /// the response of the request being received again.
+    /// @param id the identifier of the response.
+    /// @return true if the response has not been sent, false otherwise.
+    bool select_response(response_id id) NOEXCEPT
+    {
+      response_slot const* slot(find_slot(id));
+      if (!slot || slot->complete)
+        return false;
+
+      tx_response_ = id;
+      return true;
+    }
+
+    /// Send (part of) a response to an earlier request, e.g. a response
+    /// to a pipelined request that's sent after the handler has returned.
+    /// It calls the send function with the same arguments for the response,
+    /// without changing the response that the other send functions write to.
+    /// @pre it must be called in the connection's io_service, i.e. from
+    /// another thread it must be called by a handler passed to dispatch.
+    /// @param id the identifier of the response, see current_response.
+    /// @param args the arguments of the send function.
+    /// @return true if sent, false if the response had already been sent or
+    /// the send function failed.
+    template <typename... Args>
+    bool send(response_id id, Args&&... args)
+    { return send_to(id, [&]{ return send(std::forward<Args>(args)...); }); }
+
+    /// Send a chunk of a response to an earlier request.
+    /// @see send(response_id, Args&&...)
+    /// @param id the identifier of the response, see current_response.
+    /// @param args the arguments of the send_chunk function.
+    /// @return true if sent, false otherwise.
+    template <typename... Args>
+    bool send_chunk(response_id id, Args&&... args)
+    {
+      return send_to(id, [&]
+        { return send_chunk(std::forward<Args>(args)...); });
+    }
+
+    /// Send the last chunk of a response to an earlier request.
+    /// @see send(response_id, Args&&...)
+    /// @param id the identifier of the response, see current_response.
+    /// @param args the arguments of the last_chunk function.
+    /// @return true if sent, false otherwise.
+    template <typename... Args>
+    bool last_chunk(response_id id, Args&&... args)
+    {
+      return send_to(id, [&]
+        { return last_chunk(std::forward<Args>(args)...); });
+    }
+
+    /// The number of responses that have not been sent, i.e. the number of
+    /// pipelined requests waiting for a response.
+    size_t pending_responses() const NOEXCEPT
+    { return tx_slots_.size(); }
+
     /// Accessor for the HTTP request header.
     /// @return a constant reference to an rx_request.
     http::rx_request const& request() const NOEXCEPT
@@ -245,13 +696,16 @@ namespace via
     /// @return true if sent, false otherwise.
     bool send_response()
     {
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot)
+        return false;
+
       http::tx_response response(rx_.response_code());
-      response.set_major_version(rx_.request().major_version());
-      response.set_minor_version(rx_.request().minor_version());
-      tx_header_ = response.message();
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
 
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_header_)),
-                  response.is_continue());
+      return send(response.message(), Container(), comms::ConstBuffers(),
+                  response.is_continue(), false);
     }
 
     /// Send an HTTP response without a body.
@@ -260,15 +714,25 @@ namespace via
     /// @return true if sent, false otherwise.
     bool send(http::tx_response response)
     {
-      if (!response.is_valid())
+      response_slot* slot(find_slot(tx_response_));
+      if (!slot || !response.is_valid())
         return false;
 
-      response.set_major_version(rx_.request().major_version());
-      response.set_minor_version(rx_.request().minor_version());
-      tx_header_ = response.message();
+      // Compress the chunks of a chunked response
+      if (response.is_chunked() && !slot->complete)
+      {
+        http::content_coding::id const coding
+            (select_coding(*slot, response, 0));
+        if (coding != http::content_coding::IDENTITY)
+          slot->encoder.reset
+              (new http::encoder(coding, compression_->level()));
+      }
+
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
 
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_header_)),
-                  response.is_continue());
+      return send(response.message(), Container(), comms::ConstBuffers(),
+                  response.is_continue(), response.is_chunked());
     }
 
     /// Send an HTTP response with a body.
@@ -278,22 +742,26 @@ namespace via
     /// @return true if sent, false otherwise.
     bool send(http::tx_response response, Container body)
     {
-      if (!response.is_valid())
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot || !response.is_valid())
         return false;
 
-      response.set_major_version(rx_.request().major_version());
-      response.set_minor_version(rx_.request().minor_version());
-      tx_header_ = response.message(body.size());
-      comms::ConstBuffers buffers(1, boost::asio::buffer(tx_header_));
+      http::content_coding::id const coding
+          (select_coding(*slot, response, body.size()));
+      if (coding != http::content_coding::IDENTITY)
+        return send(std::move(response),
+                    compression_->compress(coding, body.data(), body.size()));
+
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
+      std::string header(response.message(body.size()));
 
       // Don't send a body in response to a HEAD request
-      if (!rx_.is_head())
-      {
-        tx_body_.swap(body);
-        buffers.push_back(boost::asio::buffer(tx_body_));
-      }
+      if (slot->is_head)
+        body.clear();
 
-      return send(std::move(buffers), response.is_continue());
+      return send(std::move(header), std::move(body), comms::ConstBuffers(),
+                  response.is_continue(), response.is_chunked());
     }
 
     /// Send an HTTP response with a body.
@@ -304,22 +772,144 @@ namespace via
     /// @param buffers a deque of asio::buffers containing the body to send.
     bool send(http::tx_response response, comms::ConstBuffers buffers)
     {
-      if (!response.is_valid())
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot || !response.is_valid())
         return false;
 
       // Calculate the overall size of the data in the buffers
       size_t size(boost::asio::buffer_size(buffers));
 
+      http::content_coding::id const coding
+          (select_coding(*slot, response, size));
+      if (coding != http::content_coding::IDENTITY)
+      {
+        std::string body(size, '\0');
+        boost::asio::buffer_copy(boost::asio::buffer(&body[0], size), buffers);
+        return send(std::move(response),
+                    compression_->compress(coding, body.data(), size));
+      }
+
       // Don't send a body in response to a HEAD request
-      if (rx_.is_head())
+      if (slot->is_head)
         buffers.clear();
 
-      response.set_major_version(rx_.request().major_version());
-      response.set_minor_version(rx_.request().minor_version());
-      tx_header_ = response.message(size);
-      buffers.push_front(boost::asio::buffer(tx_header_));
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
 
-      return send(std::move(buffers), response.is_continue());
+      return send(response.message(size), Container(), std::move(buffers),
+                  response.is_continue(), response.is_chunked());
+    }
+
+    /// Send an HTTP response with a body from a file.
+    /// The header is written normally, then the body is sent directly from
+    /// the file to the socket, e.g. with sendfile(2), where the
+    /// SocketAdaptor supports it.
+    /// @pre the response must not contain any split headers.
+    /// @param response the response to send.
+    /// @param file the segment of the file to send as the body, may be empty.
+    /// @return true if sent, false otherwise.
+    bool send(http::tx_response response, comms::file_segment file)
+    {
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot || !response.is_valid())
+        return false;
+
+      size_t const size(file.file ? static_cast<size_t>(file.length) : 0);
+
+      // Compress a file that's small enough to cache, so that it's only
+      // compressed once
+      if (compression_ && compression_->is_compressible(response, size))
+      {
+        comms::shared_buffer compressed;
+        if ((slot->coding != http::content_coding::IDENTITY) &&
+            (size <= compression_->max_cached_size()))
+          compressed = compression_->compress(slot->coding, file);
+
+        http::content_coding::id const coding(compressed.size() > 0
+            ? slot->coding : http::content_coding::IDENTITY);
+        http::response_compression::add_headers(coding, response);
+        if (coding != http::content_coding::IDENTITY)
+          return send(std::move(response), std::move(compressed));
+      }
+
+      // Don't send a body in response to a HEAD request
+      if (slot->is_head)
+        file = comms::file_segment();
+
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
+
+      tx_data data = { boost::asio::const_buffer(), response.message(size),
+                       Container(), comms::shared_buffer(),
+                       comms::ConstBuffers(), std::move(file) };
+      return send_response_data(std::move(data), response.is_continue(),
+                                response.is_chunked());
+    }
+
+    /// Send an HTTP response with a shared body.
+    /// The body is not copied: the connection shares the ownership of its
+    /// data until it has been sent, so many connections can send the same
+    /// data, e.g. a memory mapped file, concurrently.
+    /// @pre the response must not contain any split headers.
+    /// @param response the response to send.
+    /// @param body the body to send.
+    /// @return true if sent, false otherwise.
+    bool send(http::tx_response response, comms::shared_buffer body)
+    {
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot || !response.is_valid())
+        return false;
+
+      http::content_coding::id const coding
+          (select_coding(*slot, response, body.size()));
+      if (coding != http::content_coding::IDENTITY)
+        body = compression_->compress(coding, body);
+
+      size_t const size(body.size());
+
+      // Don't send a body in response to a HEAD request
+      if (slot->is_head)
+        body = comms::shared_buffer();
+
+      response.set_major_version(slot->major_version);
+      response.set_minor_version(slot->minor_version);
+
+      tx_data data = { boost::asio::const_buffer(), response.message(size),
+                       Container(), std::move(body), comms::ConstBuffers(),
+                       comms::file_segment() };
+      return send_response_data(std::move(data), response.is_continue(),
+                                response.is_chunked());
+    }
+
+    /// Send an HTTP response from a response_template with a body.
+    /// Only the per-response headers are formatted, the preformatted
+    /// status line and headers are sent from the response_template.
+    /// @pre The response_template is NOT buffered.
+    /// Its lifetime MUST exceed that of the write, e.g. it's static or it's
+    /// kept for the lifetime of the server.
+    /// @param response the response_template to send.
+    /// @param body the body to send
+    /// @param header_string any other header lines for the response,
+    /// default none.
+    /// @return true if sent, false otherwise.
+    bool send(http::response_template const& response, Container body,
+              std::string const& header_string = "")
+    {
+      response_slot const* slot(find_slot(tx_response_));
+      if (!slot)
+        return false;
+
+      std::string const& preformatted
+        (response.header(slot->major_version, slot->minor_version));
+      std::string header(response.dynamic_header(body.size(), header_string));
+
+      // Don't send a body in response to a HEAD request
+      if (slot->is_head)
+        body.clear();
+
+      return send(std::move(header), std::move(body), comms::ConstBuffers(),
+                  false, response.is_chunked(),
+                  boost::asio::buffer(preformatted));
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -330,15 +920,19 @@ namespace via
     /// @param extension the (optional) chunk extension.
     bool send_chunk(Container chunk, std::string extension = "")
     {
+      http::encoder* encoder(chunk_encoder());
+      if (encoder)
+      {
+        std::string compressed;
+        encoder->encode(chunk.data(), chunk.size(), compressed);
+        chunk = comms::to_container<Container>(std::move(compressed));
+      }
+
       size_t size(chunk.size());
       http::chunk_header chunk_header(size, extension);
-      tx_header_ = chunk_header.to_string();
-      tx_body_.swap(chunk);
 
-      comms::ConstBuffers buffers(1, boost::asio::buffer(tx_header_));
-      buffers.push_back(boost::asio::buffer(tx_body_));
-      buffers.push_back(boost::asio::buffer(http::CRLF));
-      return send(std::move(buffers));
+      return send(chunk_header.to_string(), std::move(chunk),
+                  comms::ConstBuffers(1, boost::asio::buffer(http::CRLF)));
     }
 
     /// Send an HTTP body chunk.
@@ -351,11 +945,39 @@ namespace via
       // Calculate the overall size of the data in the buffers
       size_t size(boost::asio::buffer_size(buffers));
 
+      // Compressed chunk data is buffered
+      if (chunk_encoder())
+      {
+        std::string data(size, '\0');
+        boost::asio::buffer_copy(boost::asio::buffer(&data[0], size), buffers);
+        return send_chunk(comms::to_container<Container>(std::move(data)),
+                          std::move(extension));
+      }
+
       http::chunk_header chunk_header(size, extension);
-      tx_header_ = chunk_header.to_string();
-      buffers.push_front(boost::asio::buffer(tx_header_));
       buffers.push_back(boost::asio::buffer(http::CRLF));
-      return send(std::move(buffers));
+
+      return send(chunk_header.to_string(), Container(), std::move(buffers));
+    }
+
+    /// Send an HTTP body chunk with shared data.
+    /// The data is not copied, see send(response, shared_buffer).
+    /// @param chunk the body chunk to send
+    /// @param extension the (optional) chunk extension.
+    bool send_chunk(comms::shared_buffer chunk, std::string extension = "")
+    {
+      // Compressed chunk data is buffered
+      if (chunk_encoder())
+        return send_chunk(Container(chunk.data(), chunk.data() + chunk.size()),
+                          std::move(extension));
+
+      http::chunk_header chunk_header(chunk.size(), extension);
+
+      tx_data data = { boost::asio::const_buffer(), chunk_header.to_string(),
+                       Container(), std::move(chunk),
+                       comms::ConstBuffers(1, boost::asio::buffer(http::CRLF)),
+                       comms::file_segment() };
+      return send_chunk_data(std::move(data), false);
     }
 
     /// Send the last HTTP chunk for a response.
@@ -364,10 +986,25 @@ namespace via
     bool last_chunk(std::string extension = "",
                     std::string trailer_string = "")
     {
+      // Send the end of a compressed stream in a final chunk
+      http::encoder* encoder(chunk_encoder());
+      if (encoder)
+      {
+        std::string compressed;
+        encoder->encode(nullptr, 0, compressed, true);
+        if (!compressed.empty())
+        {
+          http::chunk_header chunk_header(compressed.size(), "");
+          send(chunk_header.to_string(),
+               comms::to_container<Container>(std::move(compressed)),
+               comms::ConstBuffers(1, boost::asio::buffer(http::CRLF)));
+        }
+      }
+
       http::last_chunk last_chunk(extension, trailer_string);
-      tx_header_ = last_chunk.to_string();
 
-      return send(comms::ConstBuffers(1, boost::asio::buffer(tx_header_)));
+      return send(last_chunk.to_string(), Container(), comms::ConstBuffers(),
+                  true);
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -375,11 +1012,19 @@ namespace via
 
     /// Disconnect the underlying connection.
     void disconnect()
-    { connection_.lock()->disconnect(); }
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        tcp_pointer->disconnect();
+    }
 
     /// Close the underlying connection.
     void close()
-    { connection_.lock()->close(); }
+    {
+      std::shared_ptr<connection_type> tcp_pointer(connection_.lock());
+      if (tcp_pointer)
+        tcp_pointer->close();
+    }
 
     /// Accessor function for the comms connection.
     /// @return a weak pointer to the connection
@@ -50,10 +50,11 @@
 #include "http_connection.hpp"
 #include "via/comms/server.hpp"
 #include "via/http/request_router.hpp"
+#include "via/http/static_files.hpp"
+#include "via/http/compression.hpp"
 #ifdef HTTP_SSL
 #include <boost/asio/ssl/context.hpp>
 #endif
-#include <map>
 #include <stdexcept>
 #include <iostream>
 
@@ -73,34 +74,29 @@ namespace via
   /// @param use_strand for multi-threaded
   /// if true use an asio::strand to wrap the handlers,
   /// default false.
+  /// @param RxBufferPool the pool that the connections borrow receive
+  /// buffers from, default comms::rx_buffer_pool<Container>.
   ////////////////////////////////////////////////////////////////////////////
   template <typename SocketAdaptor, typename Container = std::vector<char>,
-            bool use_strand = false>
+            bool use_strand = false,
+            typename RxBufferPool = comms::rx_buffer_pool<Container> >
   class http_server
   {
   public:
 
     /// The comms server for the underlying connections, TCP or SSL.
-    typedef comms::server<SocketAdaptor, Container, use_strand> server_type;
+    typedef comms::server<SocketAdaptor, Container, use_strand, RxBufferPool>
+      server_type;
 
     /// The http_connections managed by this server.
-    typedef http_connection<SocketAdaptor, Container, use_strand>
+    typedef http_connection<SocketAdaptor, Container, use_strand, RxBufferPool>
       http_connection_type;
 
     /// The underlying comms connection, TCP or SSL.
     typedef typename http_connection_type::connection_type connection_type;
 
-    /// A collection of http_connections keyed by the connection pointer.
-    typedef std::map<void*, std::shared_ptr<http_connection_type> >
-      connection_collection;
-
-    /// The template requires a typename to access the iterator.
-    typedef typename connection_collection::iterator
-      connection_collection_iterator;
-
-    /// The template requires a typename to collection value_type.
-    typedef typename connection_collection::value_type
-      connection_collection_value_type;
+    /// A shared pointer to the connections' context, i.e. an SSL context.
+    typedef typename server_type::context_pointer context_pointer;
 
     /// The template requires a typename to access the iterator.
     typedef typename Container::const_iterator Container_const_iterator;
@@ -121,6 +117,16 @@ namespace via
                                  chunk_type const&, Container const&)>
       ChunkHandler;
 
+    /// The BodyHandler type.
+    /// The data is part of a streamed request body: either directly from
+    /// the connection's receive buffer or the data of a chunk. The last
+    /// parameter is true for the last part of the body.
+    typedef std::function <void (std::weak_ptr<http_connection_type>,
+                                 http::rx_request const&,
+                                 Container_const_iterator,
+                                 Container_const_iterator, bool)>
+      BodyHandler;
+
     /// The ConnectionHandler type.
     typedef std::function <void (std::weak_ptr<http_connection_type>)>
       ConnectionHandler;
@@ -131,15 +137,32 @@ namespace via
     /// The built-in request_router Handler type.
     typedef typename request_router_type::Handler request_router_handler_type;
 
+    /// The identifier of a response on an http_connection.
+    typedef typename http_connection_type::response_id response_id;
+
+    /// The default idle timeout of a connection in milliseconds.
+    static const unsigned long DEFAULT_IDLE_TIMEOUT   = 60000;
+
+    /// The default timeout to receive a request header in milliseconds.
+    static const unsigned long DEFAULT_HEADER_TIMEOUT = 20000;
+
+    /// The default timeout between the data of a request body in
+    /// milliseconds.
+    static const unsigned long DEFAULT_BODY_TIMEOUT   = 20000;
+
   private:
 
     ////////////////////////////////////////////////////////////////////////
     // Variables
 
     std::shared_ptr<server_type> server_;    ///< the communications server
-    connection_collection http_connections_; ///< the communications channels
     request_router_type   request_router_;   ///< the built-in request_router
-    bool                  shutting_down_;    ///< the server is shutting down
+    /// the static_files mounted in front of the request_router_, with
+    /// their uri path prefixes
+    std::vector<std::pair<std::string, std::shared_ptr<http::static_files> > >
+                          static_files_;
+    /// the response compression settings, null if disabled
+    std::shared_ptr<http::response_compression> compression_;
 
     // Request parser parameters
     bool           strict_crlf_;       ///< enforce strict parsing of CRLF
@@ -151,6 +174,7 @@ namespace via
     size_t         max_header_length_; ///< the max cumulative length
     size_t         max_body_size_;     ///< the maximum size of a request body
     size_t         max_chunk_size_;    ///< the maximum size of a request chunk
+    size_t         max_decompressed_size_; ///< the max size of a decompressed body
 
     // HTTP server options
     bool require_host_header_; ///< whether the http server requires a host header
@@ -161,6 +185,7 @@ namespace via
     // callback function pointers
     RequestHandler    http_request_handler_; ///< the request callback function
     ChunkHandler      http_chunk_handler_;   ///< the http chunk callback function
+    BodyHandler       http_body_handler_;    ///< the request body callback function
     RequestHandler    http_continue_handler_;///< the continue callback function
     RequestHandler    http_invalid_handler_; ///< the invalid callback function
     ConnectionHandler connected_handler_;    ///< the connected callback function
@@ -174,14 +199,13 @@ namespace via
     /// @param connection a weak ponter to the underlying comms connection.
     void connected_handler(std::weak_ptr<connection_type> connection)
     {
-      // Use the raw pointer of the connection as the map key.
-      void* pointer(connection.lock().get());
+      std::shared_ptr<connection_type> pointer(connection.lock());
       if (!pointer)
         return;
 
-      // search for the connection in the collection
-      connection_collection_iterator iter(http_connections_.find(pointer));
-      if (iter == http_connections_.end())
+      // search for the http_connection in the comms server
+      std::shared_ptr<void> data(server_->connection_data(pointer->handle()));
+      if (!data)
       {
         // Create and configure a new http_connection_type.
         std::shared_ptr<http_connection_type> http_connection
@@ -198,20 +222,96 @@ namespace via
 
         http_connection->set_translate_head(translate_head_);
         http_connection->set_concatenate_chunks(!http_chunk_handler_);
+        http_connection->set_stream_body(static_cast<bool>(http_body_handler_));
+        http_connection->set_max_decompressed_size(max_decompressed_size_);
+        http_connection->set_compression(compression_);
 
-        http_connections_.insert
-            (connection_collection_value_type(pointer, http_connection));
+        // store the http_connection with the comms connection
+        server_->set_connection_data(pointer->handle(), http_connection);
         // signal that the socket is connected
         if (connected_handler_)
           connected_handler_(http_connection);
       }
       else
         std::cerr << "http_server, error: duplicate connection for "
-                  << iter->second->remote_address() << std::endl;
+                  << static_cast<http_connection_type*>(data.get())->remote_address()
+                  << std::endl;
+    }
+
+    /// Find the http_connection of an underlying comms connection.
+    /// @param connection a weak ponter to the underlying comms connection.
+    /// @return a shared pointer to the http_connection, nullptr if not found.
+    std::shared_ptr<http_connection_type>
+      find_http_connection(std::weak_ptr<connection_type> connection) const
+    {
+      std::shared_ptr<connection_type> pointer(connection.lock());
+      if (pointer)
+        return std::static_pointer_cast<http_connection_type>
+                  (server_->connection_data(pointer->handle()));
+      return std::shared_ptr<http_connection_type>();
+    }
+
+    /// Send a response from the request_router_.
+    /// Called in the connection's io_service, see route_request.
+    /// @param weak_ptr a weak pointer to the http_connection.
+    /// @param id the identifier of the response.
+    /// @param response the response to send.
+    /// @param response_body the body of the response.
+    static void send_routed_response(std::weak_ptr<http_connection_type> weak_ptr,
+                                     response_id id,
+                                     http::tx_response& response,
+                                     Container& response_body)
+    {
+      std::shared_ptr<http_connection_type> connection(weak_ptr.lock());
+      if (connection && connection->select_response(id))
+      {
+        response.add_date_header();
+        response.add_server_header();
+        connection->send(std::move(response), std::move(response_body));
+      }
+    }
+
+    /// Respond to the request from the static_files mounted on the
+    /// longest prefix of its uri path, if any.
+    /// @param connection the http_connection.
+    /// @param request the received request.
+    /// @return true if the request was for a static file, false otherwise.
+    bool serve_static_file
+      (std::shared_ptr<http_connection_type> const& connection,
+       http::rx_request const& request)
+    {
+      // The uri path is the uri up to any query or fragment
+      std::string const& uri(request.uri());
+      size_t const path_length(uri.find_first_of("?#"));
+      std::string const path(uri.substr(0, path_length));
+
+      auto mount(static_files_.cend());
+      for (auto iter(static_files_.cbegin()); iter != static_files_.cend();
+           ++iter)
+      {
+        std::string const& prefix(iter->first);
+        if ((path.compare(0, prefix.size(), prefix) == 0) &&
+            ((path.size() == prefix.size()) || (prefix.back() == '/') ||
+             (path[prefix.size()] == '/')) &&
+            ((mount == static_files_.cend()) ||
+             (prefix.size() > mount->first.size())))
+          mount = iter;
+      }
+      if (mount == static_files_.cend())
+        return false;
+
+      http::static_files::file_response file
+        (mount->second->respond(request, path.substr(mount->first.size())));
+      file.response.add_date_header();
+      file.response.add_server_header();
+      connection->send(std::move(file.response), std::move(file.body));
+      return true;
     }
 
     /// Route the request using the request_router_.
-    /// @param weak_ptr a weak pointer to the comms connection.
+    /// The response is sent in the connection's io_service, so an
+    /// asynchronous handler may send its response from another thread.
+    /// @param weak_ptr a weak pointer to the http_connection.
     /// @param request the received request.
     /// @param body the received request body.
     void route_request(std::weak_ptr<http_connection_type> weak_ptr,
@@ -219,37 +319,48 @@ namespace via
                        Container const& body)
     {
       std::shared_ptr<http_connection_type> connection(weak_ptr.lock());
-      if (connection)
+      if (connection && !serve_static_file(connection, request))
       {
-        Container response_body;
-        http::tx_response response
-            (request_router_.handle_request(request, body, response_body));
-        response.add_date_header();
-        response.add_server_header();
-        connection->send(std::move(response), std::move(response_body));
+        response_id const id(connection->current_response());
+        request_router_.handle_request(request, body,
+          [weak_ptr, id](http::tx_response response, Container response_body)
+        {
+          std::shared_ptr<http_connection_type> pointer(weak_ptr.lock());
+          if (pointer)
+            pointer->dispatch(std::bind(&http_server::send_routed_response,
+                                        weak_ptr, id, std::move(response),
+                                        std::move(response_body)));
+        });
       }
     }
 
     /// Receive data packets on an underlying communications connection.
-    /// @param iter a valid iterator into the connection collection.
-    void receive_handler(connection_collection_iterator conn)
+    /// @param http_connection a shared pointer to the http_connection.
+    void receive_handler
+      (std::shared_ptr<http_connection_type> const& http_connection)
     {
-      // Get the connection
-      std::shared_ptr<http_connection_type> http_connection(conn->second);
-
-      // Get the receive buffer
+      // Get the receive buffer, resuming from where reception was paused
       Container const& rx_buffer(http_connection->read_rx_buffer());
       Container_const_iterator iter(rx_buffer.begin());
       Container_const_iterator end(rx_buffer.end());
+      std::advance(iter, std::min(http_connection->rx_offset(),
+                                  rx_buffer.size()));
+      http_connection->set_rx_offset(0);
 
       // Get the receive parser for this connection
       http::Rx rx_state(http::RX_VALID);
+      bool paused(false);
 
       // Loop around the received buffer while there's valid data to read
-      while ((iter != end) && (rx_state != http::RX_INVALID))
+      while ((iter != end) && (rx_state != http::RX_INVALID) && !paused)
       {
+        Container_const_iterator begin(iter);
         rx_state = http_connection->rx().receive(iter, end);
 
+        // Queue a response to the request, in the order received
+        if (rx_state != http::RX_INCOMPLETE)
+          http_connection->open_response();
+
         switch (rx_state)
         {
         case http::RX_VALID:
@@ -259,8 +370,9 @@ namespace via
             http_request_handler_(http_connection,
                                   http_connection->request(),
                                   http_connection->body());
-            if (!http_connection->request().is_chunked())
-              http_connection->rx().clear();
+            if (!http_connection->request().is_chunked() &&
+                !http_connection->rx().body_pending())
+              http_connection->clear_request();
             break;
           }
           else if (trace_enabled_) // the server reflects the message back.
@@ -271,7 +383,7 @@ namespace via
             ok_response.add_content_http_header();
             http_connection->send(ok_response,
                                   http_connection->rx().trace_body());
-            http_connection->rx().clear();
+            http_connection->clear_request();
             break;
           }
           // intentional fall through
@@ -287,7 +399,7 @@ namespace via
             if (auto_disconnect_)
               http_connection->disconnect();
           }
-          http_connection->rx().clear();
+          http_connection->clear_request();
           break;
 
         case http::RX_EXPECT_CONTINUE:
@@ -305,29 +417,57 @@ namespace via
                                 http_connection->chunk(),
                                 http_connection->chunk().data());
           if (http_connection->chunk().is_last())
-            http_connection->rx().clear();
+            http_connection->clear_request();
           break;
 
+        case http::RX_BODY:
+        {
+          bool const is_last(!http_connection->rx().body_pending());
+          std::pair<Container_const_iterator, Container_const_iterator>
+            const data(http_connection->rx().body_data(begin));
+          http_body_handler_(http_connection, http_connection->request(),
+                             data.first, data.second, is_last);
+          if (is_last)
+            http_connection->clear_request();
+          break;
+        }
+
         default:
           break;
         } // end switch
+
+        // Stop if the application can't consume any more data
+        paused = http_connection->reception_paused();
       } // end while
+
+      // Don't time a paused connection, resume from this data later
+      if (paused)
+      {
+        http_connection->set_rx_offset(std::distance(rx_buffer.begin(), iter));
+        server_->cancel_timer(http_connection->handle());
+        return;
+      }
+
+      // Time the next stage of the request: the rest of the header,
+      // the body or the next request on a persistent connection.
+      comms::timeout_type timeout(comms::IDLE_TIMEOUT);
+      if (http_connection->request().valid())
+        timeout = comms::BODY_TIMEOUT;
+      else if (rx_state == http::RX_INCOMPLETE)
+        timeout = comms::HEADER_TIMEOUT;
+      server_->start_timer(http_connection->handle(), timeout);
     }
 
     /// Handle a disconnected signal from an underlying comms connection.
-    /// Noitfy the handler and erase the connection from the collection.
-    /// @param iter a valid iterator into the connection collection.
-    void disconnected_handler(connection_collection_iterator iter)
+    /// Noitfy the handler, the comms server deletes the http_connection
+    /// with the comms connection.
+    /// @param http_connection a shared pointer to the http_connection.
+    void disconnected_handler
+      (std::shared_ptr<http_connection_type> const& http_connection)
     {
       // Noitfy the disconnected handler if one exists
       if (disconnected_handler_)
-        disconnected_handler_(iter->second);
-
-      http_connections_.erase(iter);
-
-      // If the http_server is being shutdown and this was the last connection
-      if (shutting_down_ && http_connections_.empty())
-        server_->close();
+        disconnected_handler_(http_connection);
     }
 
     /// Receive an event from the underlying comms connection.
@@ -339,14 +479,10 @@ namespace via
         connected_handler(connection);
       else
       {
-        // Get the raw pointer of the connection
-        void* pointer(connection.lock().get());
-        if (!pointer)
-          return;
-
-        // search for the connection in the collection
-        connection_collection_iterator iter(http_connections_.find(pointer));
-        if (iter == http_connections_.end())
+        // search for the http_connection of the connection
+        std::shared_ptr<http_connection_type> http_connection
+            (find_http_connection(connection));
+        if (!http_connection)
         {
           std::cerr << "http_server, event_handler error: connection not found "
                     << std::endl;
@@ -356,15 +492,15 @@ namespace via
         switch(event)
         {
         case via::comms::RECEIVED:
-          receive_handler(iter);
+          receive_handler(http_connection);
           break;
         case via::comms::SENT:
           // Noitfy the sent handler if one exists
           if (message_sent_handler_)
-            message_sent_handler_(iter->second);
+            message_sent_handler_(http_connection);
           break;
         case via::comms::DISCONNECTED:
-          disconnected_handler(iter);
+          disconnected_handler(http_connection);
           break;
         default:
           ;
@@ -397,9 +533,9 @@ namespace via
     /// @param auth_ptr a shared pointer to an authentication.
     explicit http_server(boost::asio::io_service& io_service) :
       server_(new server_type(io_service)),
-      http_connections_(),
       request_router_(),
-      shutting_down_(false),
+      static_files_(),
+      compression_(),
 
       // Set request parser parameters to default values
       strict_crlf_        (false),
@@ -411,6 +547,7 @@ namespace via
       max_header_length_  (http_request::DEFAULT_MAX_HEADER_LENGTH),
       max_body_size_      (http_request::DEFAULT_MAX_BODY_SIZE),
       max_chunk_size_     (http_request::DEFAULT_MAX_CHUNK_SIZE),
+      max_decompressed_size_(0),
 
       require_host_header_(true),
       translate_head_     (true),
@@ -419,6 +556,7 @@ namespace via
 
       http_request_handler_ (),
       http_chunk_handler_   (),
+      http_body_handler_    (),
       http_continue_handler_(),
       http_invalid_handler_ (),
       connected_handler_    (),
@@ -435,6 +573,14 @@ namespace via
       // Set no delay, i.e. disable the Nagle algorithm
       // An http_server will want to send messages immediately
       server_->set_no_delay(true);
+
+      // Time out idle and slow connections
+      server_->set_connection_timeout(comms::IDLE_TIMEOUT,
+                                      DEFAULT_IDLE_TIMEOUT);
+      server_->set_connection_timeout(comms::HEADER_TIMEOUT,
+                                      DEFAULT_HEADER_TIMEOUT);
+      server_->set_connection_timeout(comms::BODY_TIMEOUT,
+                                      DEFAULT_BODY_TIMEOUT);
     }
 
     /// Destructor, close the connections.
@@ -468,6 +614,53 @@ namespace via
     request_router_type& request_router()
     { return request_router_; }
 
+    /// Serve the files in a directory on a uri path prefix, in front of the
+    /// request_router_.
+    /// GET and HEAD requests for paths under the prefix are answered from
+    /// the directory, with the file bodies sent directly from the files,
+    /// e.g. with sendfile(2); other methods get 405 Method Not Allowed.
+    /// @pre the built-in request_router must be used, i.e.
+    /// request_received_event must not have been called.
+    /// @throw invalid_argument if the uri_prefix doesn't start with a '/'.
+    /// @param uri_prefix the uri path prefix, e.g. "/static".
+    /// @param directory the directory containing the files.
+    /// @return the static_files, e.g. to configure content types.
+    http::static_files& add_static_files(std::string const& uri_prefix,
+                                         std::string const& directory)
+    {
+      if (uri_prefix.empty() || (uri_prefix[0] != '/'))
+        throw std::invalid_argument("http_server::add_static_files: "
+                                    "the uri_prefix must start with a '/'");
+
+      std::shared_ptr<http::static_files> files
+        (std::make_shared<http::static_files>(directory));
+      static_files_.push_back(std::make_pair(uri_prefix, files));
+      return *files;
+    }
+
+    /// Enable the compression of response bodies for all future
+    /// connections.
+    /// The content coding of the responses to a request is negotiated from
+    /// its Accept-Encoding header. The bodies of compressible responses
+    /// sent with http_connection::send are compressed through a cache of
+    /// compressed bodies, so a body that's sent repeatedly, e.g. a static
+    /// file, is only compressed once; chunked response bodies are
+    /// compressed chunk by chunk.
+    /// Note: responses sent from a response_template are not compressed.
+    /// @return the response_compression, e.g. to configure the content
+    /// types and compression level.
+    http::response_compression& enable_compression()
+    {
+      if (!compression_)
+        compression_ = std::make_shared<http::response_compression>();
+      return *compression_;
+    }
+
+    /// Disable the compression of response bodies for all future
+    /// connections.
+    void disable_compression() NOEXCEPT
+    { compression_.reset(); }
+
     ////////////////////////////////////////////////////////////////////////
     // Event Handlers
 
@@ -487,6 +680,22 @@ namespace via
     void chunk_received_event(ChunkHandler handler) NOEXCEPT
     { http_chunk_handler_ = handler; }
 
+    /// Connect the request body received callback function.
+    ///
+    /// If the application registers a handler for this event, then request
+    /// bodies are streamed instead of being accumulated up to max_body_size:
+    /// the request received handler is called with an empty body when the
+    /// request header has been received, then this handler is called with
+    /// each part of the body as it's received.
+    /// The data is only valid within the handler, unless the handler calls
+    /// http_connection::pause_reception, in which case it remains valid until
+    /// http_connection::resume_reception is called. No more data is received
+    /// on the connection while it's paused.
+    /// @post disables automatic concatenating of chunks and max_body_size.
+    /// @param handler the handler for received request body data.
+    void body_received_event(BodyHandler handler) NOEXCEPT
+    { http_body_handler_ = handler; }
+
     /// Connect the expect continue received callback function.
     ///
     /// If the application registers a handler for this event, then the
@@ -580,6 +789,16 @@ namespace via
         http_request::DEFAULT_MAX_CHUNK_SIZE) NOEXCEPT
     { max_chunk_size_ = max_size; }
 
+    /// Set the maximum size of a decompressed HTTP request body to allow.
+    /// If it's not zero, request bodies with a gzip or deflate
+    /// Content-Encoding are decompressed as they are received, so that
+    /// clients may send compressed uploads. The compressed body is still
+    /// limited by max_body_size. Request bodies received by a BodyHandler
+    /// or ChunkHandler are not decompressed.
+    /// @param max_size default zero: request bodies are not decompressed.
+    void set_max_decompressed_size(size_t max_size = 0) NOEXCEPT
+    { max_decompressed_size_ = max_size; }
+
     ////////////////////////////////////////////////////////////////////////
     // HTTP server options set functions
 
@@ -614,12 +833,33 @@ namespace via
     void set_rx_buffer_size(size_t size = SocketAdaptor::DEFAULT_RX_BUFFER_SIZE) NOEXCEPT
     { server_->set_rx_buffer_size(size); }
 
+    /// Set the receive buffer pool for all future connections.
+    /// E.g. to share a pool between an http and an https server.
+    /// @param rx_buffer_pool the receive buffer pool, must not be null.
+    void set_rx_buffer_pool
+      (typename server_type::rx_buffer_pool_pointer rx_buffer_pool) NOEXCEPT
+    { server_->set_rx_buffer_pool(rx_buffer_pool); }
+
+    /// Accessor for the receive buffer pool.
+    /// @return a shared pointer to the receive buffer pool.
+    typename server_type::rx_buffer_pool_pointer rx_buffer_pool() const NOEXCEPT
+    { return server_->rx_buffer_pool(); }
+
+    /// Set SO_REUSEPORT on the server's listening sockets.
+    /// @see comms::multi_reactor_server
+    /// @pre must be called before accept_connections.
+    /// @param enable enable/disable SO_REUSEPORT.
+    void set_reuse_port(bool enable) NOEXCEPT
+    { server_->set_reuse_port(enable); }
+
     /// Set the tcp keep alive status for all future connections.
     /// @param enable if true enables the tcp socket keep alive status.
     void set_keep_alive(bool enable) NOEXCEPT
     { server_->set_keep_alive(enable); }
 
     /// Set the send and receive timeout values for all future connections.
+    /// Note: these are socket options that don't apply to asynchronous
+    /// reads and writes, @see set_idle_timeout.
     /// @pre sockets may remain open forever
     /// @post sockets will close if no activity has occured after the
     /// timeout period.
@@ -627,6 +867,35 @@ namespace via
     void set_timeout(int timeout) NOEXCEPT
     { server_->set_timeout(timeout); }
 
+    /// Set the time that a connection may wait for a request, e.g.
+    /// between the requests of a persistent connection.
+    /// @param timeout the timeout in milliseconds, zero is disabled,
+    /// default DEFAULT_IDLE_TIMEOUT.
+    void set_idle_timeout(unsigned long timeout = DEFAULT_IDLE_TIMEOUT) NOEXCEPT
+    { server_->set_connection_timeout(comms::IDLE_TIMEOUT, timeout); }
+
+    /// Set the time allowed to receive a request header, from its first
+    /// data to the end of the header.
+    /// @param timeout the timeout in milliseconds, zero is disabled,
+    /// default DEFAULT_HEADER_TIMEOUT.
+    void set_header_timeout(unsigned long timeout = DEFAULT_HEADER_TIMEOUT)
+      NOEXCEPT
+    { server_->set_connection_timeout(comms::HEADER_TIMEOUT, timeout); }
+
+    /// Set the time that a connection may wait for the next data of a
+    /// request body.
+    /// @param timeout the timeout in milliseconds, zero is disabled,
+    /// default DEFAULT_BODY_TIMEOUT.
+    void set_body_timeout(unsigned long timeout = DEFAULT_BODY_TIMEOUT) NOEXCEPT
+    { server_->set_connection_timeout(comms::BODY_TIMEOUT, timeout); }
+
+    /// Set the period of the timer that times the connections.
+    /// @param milliseconds the period in milliseconds,
+    /// default server_type::DEFAULT_TIMER_RESOLUTION.
+    void set_timer_resolution(unsigned long milliseconds =
+        server_type::DEFAULT_TIMER_RESOLUTION) NOEXCEPT
+    { server_->set_timer_resolution(milliseconds); }
+
     ////////////////////////////////////////////////////////////////////////
     // HTTPS set functions
 
@@ -636,50 +905,94 @@ namespace via
     void set_password(std::string const& password) NOEXCEPT
     { server_->set_password(password); }
 
-    /// Set the files required for an SSL server.
+    /// Set the SSL context of this server's connections, e.g. containing
+    /// this server's certificate, instead of the process-wide context.
     /// @pre http_server derived from via::comms::ssl::ssl_tcp_adaptor.
+    /// @see via::comms::ssl::ssl_tcp_adaptor::create_context
+    /// @param context the SSL context, null for the process-wide context.
+    void set_ssl_context(context_pointer context) NOEXCEPT
+    { server_->set_context(context); }
+
+    /// Add an SSL context for a server name, selected by the Server Name
+    /// Indication (SNI) of the client connections. E.g. so that one server
+    /// can present the certificates of many host names.
+    /// Connections that don't request a server name with a context use this
+    /// server's SSL context.
+    /// @pre http_server derived from via::comms::ssl::ssl_tcp_adaptor.
+    /// @pre the server must not be accepting connections.
+    /// @throw invalid_argument if context is null.
+    /// @param server_name the server name, e.g. "www.example.com" or a
+    /// wildcard for its subdomains, e.g. "*.example.com".
+    /// @param context the SSL context for the server name.
+    void add_ssl_context(std::string const& server_name,
+                         context_pointer context)
+    {
+#ifdef HTTP_SSL
+      context_pointer server_context(server_->context());
+      connection_type::add_server_name_context
+          (server_context ? *server_context : connection_type::ssl_context(),
+           server_name, context);
+#endif // HTTP_SSL
+    }
+
+#ifdef HTTP_SSL
+    /// Set the files required for an SSL context.
+    /// @param context the SSL context.
     /// @param certificate_file the server SSL certificate file.
     /// @param key_file the private key file
     /// @param dh_file the dh file.
     static boost::system::error_code set_ssl_files
-                       (const std::string& certificate_file,
+                       (boost::asio::ssl::context& context,
+                        const std::string& certificate_file,
                         const std::string& key_file,
                         std::string        dh_file = "")
     {
       boost::system::error_code error;
-#ifdef HTTP_SSL
-      server_type::connection_type::ssl_context().
-          use_certificate_file(certificate_file,
-                               boost::asio::ssl::context::pem, error);
+      context.use_certificate_file(certificate_file,
+                                   boost::asio::ssl::context::pem, error);
       if (error)
         return error;
 
-      server_type::connection_type::ssl_context().
-          use_private_key_file(key_file, boost::asio::ssl::context::pem,
-                               error);
+      context.use_private_key_file(key_file, boost::asio::ssl::context::pem,
+                                   error);
       if (error)
         return error;
 
       if (dh_file.empty())
-        server_type::connection_type::ssl_context().
-           set_options(boost::asio::ssl::context::default_workarounds |
-                       boost::asio::ssl::context::no_sslv2);
+        context.set_options(boost::asio::ssl::context::default_workarounds |
+                            boost::asio::ssl::context::no_sslv2);
       else
       {
-        server_type::connection_type::ssl_context().use_tmp_dh_file(dh_file,
-                                                                   error);
+        context.use_tmp_dh_file(dh_file, error);
         if (error)
           return error;
 
-        server_type::connection_type::ssl_context().
-           set_options(boost::asio::ssl::context::default_workarounds |
-                       boost::asio::ssl::context::no_sslv2 |
-                       boost::asio::ssl::context::single_dh_use,
-                       error);
+        context.set_options(boost::asio::ssl::context::default_workarounds |
+                            boost::asio::ssl::context::no_sslv2 |
+                            boost::asio::ssl::context::single_dh_use,
+                            error);
       }
-#endif // HTTP_SSL
       return error;
     }
+#endif // HTTP_SSL
+
+    /// Set the files required for the process-wide SSL context.
+    /// @pre http_server derived from via::comms::ssl::ssl_tcp_adaptor.
+    /// @param certificate_file the server SSL certificate file.
+    /// @param key_file the private key file
+    /// @param dh_file the dh file.
+    static boost::system::error_code set_ssl_files
+                       (const std::string& certificate_file,
+                        const std::string& key_file,
+                        std::string        dh_file = "")
+    {
+#ifdef HTTP_SSL
+      return set_ssl_files(server_type::connection_type::ssl_context(),
+                           certificate_file, key_file, dh_file);
+#else
+      return boost::system::error_code();
+#endif // HTTP_SSL
+    }
 
     ////////////////////////////////////////////////////////////////////////
     // other functions
@@ -687,23 +1000,11 @@ namespace via
     /// Disconnect all of the outstanding http server connections to prepare
     /// for closing the server.
     void shutdown()
-    {
-      if (!http_connections_.empty())
-      {
-        shutting_down_ = true;
-        for (auto& elem : http_connections_)
-          elem.second->disconnect();
-      }
-      else
-        close();
-    }
+    { server_->shutdown(); }
 
     /// Close the http server and all of the connections associated with it.
     void close()
-    {
-      http_connections_.clear();
-      server_->close();
-    }
+    { server_->close(); }
 
     /// Accessor function for the comms server.
     /// @return a shared pointer to the server
@@ -0,0 +1,487 @@
+#ifndef METRICS_HPP_VIA_HTTPLIB_
+#define METRICS_HPP_VIA_HTTPLIB_
+
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file metrics.hpp
+/// @brief The metrics_registry and metrics_timer classes.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/no_except.hpp"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace via
+{
+  ////////////////////////////////////////////////////////////////////////////
+  /// @class metrics_registry
+  /// A registry of named counters and histograms.
+  ///
+  /// Each thread that updates a metric writes to its own set of metric
+  /// cells, so updates don't contend between the threads of a thread pool;
+  /// the cells of all the threads are merged when a metric is read.
+  /// A counter may also be used as a gauge, by adding negative values.
+  /// A histogram counts values in buckets with power of two upper bounds:
+  /// 1, 2, 4 ... 2^(HISTOGRAM_BUCKETS - 1) and +Inf.
+  ///
+  /// Metric names may contain labels in the Prometheus format, e.g.
+  /// via_http_requests_invalid_total{code="400"}, see text().
+  /// The library records its metrics in the process-wide instance().
+  ///
+  /// If VIA_NO_METRICS is defined, metrics may still be registered and
+  /// read but updates are ignored and metrics_timer doesn't read the clock.
+  /// It must be defined (or not) consistently in every translation unit.
+  ////////////////////////////////////////////////////////////////////////////
+  class metrics_registry
+  {
+  public:
+
+    /// Whether metrics are updated, false if VIA_NO_METRICS is defined.
+#ifdef VIA_NO_METRICS
+    static const bool ENABLED = false;
+#else
+    static const bool ENABLED = true;
+#endif
+
+    /// The id of a metric that couldn't be registered: updates are ignored.
+    static const size_t NONE = static_cast<size_t>(-1);
+
+    /// The number of metrics in a block of metric cells.
+    static const size_t BLOCK_SIZE = 64;
+
+    /// The maximum number of counters and of histograms.
+    static const size_t MAX_METRICS = BLOCK_SIZE * 64;
+
+    /// The number of finite histogram buckets.
+    static const size_t HISTOGRAM_BUCKETS = 32;
+
+    /// The merged values of a histogram.
+    struct histogram_values
+    {
+      /// The number of values in each bucket, the last bucket is +Inf.
+      /// Note: the counts are NOT cumulative.
+      std::vector<unsigned long long> buckets;
+      unsigned long long count; ///< The number of values.
+      unsigned long long sum;   ///< The sum of the values.
+    };
+
+  private:
+
+    /// The cells of a histogram.
+    struct histogram_cell
+    {
+      std::atomic<unsigned long long> buckets[HISTOGRAM_BUCKETS + 1];
+      std::atomic<unsigned long long> sum;
+    };
+
+    /// The metric cells of a thread, in blocks that are allocated by the
+    /// thread when it first updates a metric in the block.
+    template <typename T>
+    class cell_blocks
+    {
+      std::atomic<T*> blocks_[MAX_METRICS / BLOCK_SIZE];
+
+      cell_blocks(cell_blocks const&) = delete;
+      cell_blocks& operator=(cell_blocks const&) = delete;
+
+    public:
+
+      cell_blocks()
+      {
+        for (auto& block : blocks_)
+          block.store(nullptr, std::memory_order_relaxed);
+      }
+
+      ~cell_blocks()
+      {
+        for (auto& block : blocks_)
+          delete [] block.load(std::memory_order_relaxed);
+      }
+
+      /// The cell of a metric, for its thread to update.
+      T& at(size_t id)
+      {
+        std::atomic<T*>& block(blocks_[id / BLOCK_SIZE]);
+        T* cells(block.load(std::memory_order_acquire));
+        if (!cells)
+        {
+          cells = new T[BLOCK_SIZE]();
+          block.store(cells, std::memory_order_release);
+        }
+        return cells[id % BLOCK_SIZE];
+      }
+
+      /// The cell of a metric, for another thread to read.
+      /// @return a pointer to the cell, nullptr if it's not been updated.
+      T const* find(size_t id) const NOEXCEPT
+      {
+        T const* cells(blocks_[id / BLOCK_SIZE].load(std::memory_order_acquire));
+        return cells ? &cells[id % BLOCK_SIZE] : nullptr;
+      }
+    };
+
+    /// The metric cells of a thread.
+    struct shard
+    {
+      std::thread::id thread;                        ///< The thread.
+      cell_blocks<std::atomic<long long> > counters;   ///< Its counters.
+      cell_blocks<histogram_cell>          histograms; ///< Its histograms.
+
+      explicit shard(std::thread::id id) :
+        thread(id),
+        counters(),
+        histograms()
+      {}
+    };
+
+    /// Update a cell that only the current thread writes.
+    template <typename T, typename V>
+    static void increment(std::atomic<T>& cell, V value) NOEXCEPT
+    {
+      cell.store(cell.load(std::memory_order_relaxed) + static_cast<T>(value),
+                 std::memory_order_relaxed);
+    }
+
+    /// A unique serial number for each registry, to identify its shards.
+    static unsigned long next_serial() NOEXCEPT
+    {
+      static std::atomic<unsigned long> serial(0);
+      return ++serial;
+    }
+
+    unsigned long const serial_;          ///< This registry's serial number.
+    std::map<std::string, size_t> counter_ids_;   ///< The counter names.
+    std::map<std::string, size_t> histogram_ids_; ///< The histogram names.
+    std::vector<bool> gauges_;            ///< Whether each counter's a gauge.
+    std::vector<std::unique_ptr<shard> > shards_; ///< The threads' shards.
+    mutable std::mutex mutex_;            ///< Mutex to protect the above.
+
+    /// Get the shard of the current thread, creating it if necessary.
+    shard& local_shard()
+    {
+      // A cache of the last registry used by this thread.
+      static thread_local unsigned long cached_serial(0);
+      static thread_local shard* cached_shard(nullptr);
+      if (cached_serial != serial_)
+      {
+        std::thread::id const id(std::this_thread::get_id());
+        std::lock_guard<std::mutex> lock(mutex_);
+        cached_shard = nullptr;
+        for (auto const& elem : shards_)
+        {
+          if (elem->thread == id)
+            cached_shard = elem.get();
+        }
+
+        if (!cached_shard)
+        {
+          shards_.push_back(std::unique_ptr<shard>(new shard(id)));
+          cached_shard = shards_.back().get();
+        }
+        cached_serial = serial_;
+      }
+      return *cached_shard;
+    }
+
+    /// Register a metric name.
+    /// @return the id of the metric, NONE if there are MAX_METRICS.
+    size_t register_name(std::map<std::string, size_t>& ids,
+                         std::string const& name)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto iter(ids.find(name));
+      if (iter != ids.end())
+        return iter->second;
+
+      if (ids.size() >= MAX_METRICS)
+        return NONE;
+
+      size_t const id(ids.size());
+      ids.insert(std::make_pair(name, id));
+      return id;
+    }
+
+    /// Split a metric name into its base name and its labels, if any.
+    static void split_name(std::string const& name,
+                           std::string& base, std::string& labels)
+    {
+      size_t const brace(name.find('{'));
+      base = name.substr(0, brace);
+      labels.clear();
+      if ((brace != std::string::npos) && (name.size() > brace + 2))
+        labels = name.substr(brace + 1, name.size() - brace - 2);
+    }
+
+    metrics_registry(metrics_registry const&) = delete;
+    metrics_registry& operator=(metrics_registry const&) = delete;
+
+  public:
+
+    /// Constructor.
+    metrics_registry() :
+      serial_(next_serial()),
+      counter_ids_(),
+      histogram_ids_(),
+      gauges_(),
+      shards_(),
+      mutex_()
+    {}
+
+    /// The process-wide metrics registry.
+    static metrics_registry& instance()
+    {
+      static metrics_registry registry_;
+      return registry_;
+    }
+
+    /// Escape a Prometheus label value.
+    /// @param value the label value.
+    /// @return the value with backslash, double-quote and line feed
+    /// characters escaped.
+    static std::string label_value(std::string const& value)
+    {
+      std::string escaped;
+      escaped.reserve(value.size());
+      for (char c : value)
+      {
+        switch (c)
+        {
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        default:
+          escaped += c;
+        }
+      }
+      return escaped;
+    }
+
+    /// Register a counter, or find a registered counter.
+    /// @param name the name of the counter.
+    /// @return the id of the counter, NONE if there are too many counters.
+    size_t counter(std::string const& name)
+    { return register_name(counter_ids_, name); }
+
+    /// Register a gauge, or find a registered gauge.
+    /// A gauge is a counter that's reported as a gauge by text(), e.g.
+    /// the number of active connections.
+    /// @param name the name of the gauge.
+    /// @return the id of the gauge, NONE if there are too many counters.
+    size_t gauge(std::string const& name)
+    {
+      size_t const id(register_name(counter_ids_, name));
+      if (id != NONE)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (gauges_.size() <= id)
+          gauges_.resize(id + 1, false);
+        gauges_[id] = true;
+      }
+      return id;
+    }
+
+    /// Register a histogram, or find a registered histogram.
+    /// @param name the name of the histogram.
+    /// @return the id of the histogram, NONE if there are too many histograms.
+    size_t histogram(std::string const& name)
+    { return register_name(histogram_ids_, name); }
+
+    /// Add a value to a counter.
+    /// @param id the id of the counter.
+    /// @param value the value to add, default 1.
+    void add(size_t id, long long value = 1)
+    {
+      if (ENABLED && (id < MAX_METRICS))
+        increment(local_shard().counters.at(id), value);
+    }
+
+    /// Add a value to a histogram.
+    /// @param id the id of the histogram.
+    /// @param value the value.
+    void observe(size_t id, unsigned long long value)
+    {
+      if (!ENABLED || (id >= MAX_METRICS))
+        return;
+
+      size_t bucket(0);
+      while ((bucket < HISTOGRAM_BUCKETS) && ((1ULL << bucket) < value))
+        ++bucket;
+
+      histogram_cell& cell(local_shard().histograms.at(id));
+      increment(cell.buckets[bucket], 1);
+      increment(cell.sum, value);
+    }
+
+    /// The value of a counter, merged from all of the threads.
+    /// @param id the id of the counter.
+    /// @return the value of the counter.
+    long long counter_value(size_t id) const
+    {
+      long long value(0);
+      if (id < MAX_METRICS)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto const& elem : shards_)
+        {
+          std::atomic<long long> const* cell(elem->counters.find(id));
+          if (cell)
+            value += cell->load(std::memory_order_relaxed);
+        }
+      }
+      return value;
+    }
+
+    /// The values of a histogram, merged from all of the threads.
+    /// @param id the id of the histogram.
+    /// @return the values of the histogram.
+    histogram_values histogram_value(size_t id) const
+    {
+      histogram_values values =
+        { std::vector<unsigned long long>(HISTOGRAM_BUCKETS + 1, 0), 0, 0 };
+      if (id < MAX_METRICS)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto const& elem : shards_)
+        {
+          histogram_cell const* cell(elem->histograms.find(id));
+          if (cell)
+          {
+            for (size_t i(0); i <= HISTOGRAM_BUCKETS; ++i)
+            {
+              unsigned long long const number
+                (cell->buckets[i].load(std::memory_order_relaxed));
+              values.buckets[i] += number;
+              values.count      += number;
+            }
+            values.sum += cell->sum.load(std::memory_order_relaxed);
+          }
+        }
+      }
+      return values;
+    }
+
+    /// The metrics in the Prometheus text exposition format.
+    /// Histograms without any values are omitted.
+    /// @return the metrics text.
+    std::string text() const
+    {
+      std::map<std::string, size_t> counter_ids;
+      std::map<std::string, size_t> histogram_ids;
+      std::vector<bool> gauges;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counter_ids   = counter_ids_;
+        histogram_ids = histogram_ids_;
+        gauges        = gauges_;
+      }
+
+      std::ostringstream os;
+      std::string base;
+      std::string labels;
+      std::string previous;
+      for (auto const& elem : counter_ids)
+      {
+        split_name(elem.first, base, labels);
+        if (base != previous)
+          os << "# TYPE " << base
+             << (((elem.second < gauges.size()) && gauges[elem.second])
+                  ? " gauge\n" : " counter\n");
+        previous = base;
+        os << elem.first << ' ' << counter_value(elem.second) << '\n';
+      }
+
+      previous.clear();
+      for (auto const& elem : histogram_ids)
+      {
+        histogram_values const values(histogram_value(elem.second));
+        if (values.count == 0)
+          continue;
+
+        split_name(elem.first, base, labels);
+        if (base != previous)
+          os << "# TYPE " << base << " histogram\n";
+        previous = base;
+
+        std::string const prefix(labels.empty() ? "{" : "{" + labels + ",");
+        unsigned long long cumulative(0);
+        for (size_t i(0); i < HISTOGRAM_BUCKETS; ++i)
+        {
+          cumulative += values.buckets[i];
+          os << base << "_bucket" << prefix << "le=\"" << (1ULL << i)
+             << "\"} " << cumulative << '\n';
+        }
+        os << base << "_bucket" << prefix << "le=\"+Inf\"} "
+           << values.count << '\n';
+
+        std::string const suffix(labels.empty() ? "" : "{" + labels + "}");
+        os << base << "_sum"   << suffix << ' ' << values.sum   << '\n';
+        os << base << "_count" << suffix << ' ' << values.count << '\n';
+      }
+
+      return os.str();
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////
+  /// @class metrics_timer
+  /// A timer to measure durations for a metrics_registry histogram.
+  /// If VIA_NO_METRICS is defined, it doesn't read the clock and all
+  /// durations are zero.
+  ////////////////////////////////////////////////////////////////////////////
+  class metrics_timer
+  {
+    std::chrono::steady_clock::time_point start_; ///< The start time.
+
+    /// The current time, if metrics are enabled.
+    static std::chrono::steady_clock::time_point now()
+    {
+      return metrics_registry::ENABLED ? std::chrono::steady_clock::now()
+                                       : std::chrono::steady_clock::time_point();
+    }
+
+  public:
+
+    /// Constructor, starts the timer.
+    metrics_timer() :
+      start_(now())
+    {}
+
+    /// Restart the timer.
+    void restart()
+    { start_ = now(); }
+
+    /// The time since the timer was started, in nanoseconds.
+    unsigned long long nanoseconds() const
+    {
+      return static_cast<unsigned long long>
+          (std::chrono::duration_cast<std::chrono::nanoseconds>
+             (now() - start_).count());
+    }
+
+    /// The time since the timer was started, in microseconds.
+    unsigned long long microseconds() const
+    { return nanoseconds() / 1000; }
+  };
+}
+
+#endif
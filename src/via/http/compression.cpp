@@ -0,0 +1,371 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file compression.cpp
+/// @brief Classes and functions to compress HTTP response bodies.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/compression.hpp"
+#include "via/metrics.hpp"
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+  /// The ids of the compression metrics in the metrics_registry.
+  struct metric_ids
+  {
+    size_t hits;   ///< The number of compression_cache hits.
+    size_t misses; ///< The number of compression_cache misses.
+
+    metric_ids() :
+      hits  (via::metrics_registry::instance().
+               counter("via_http_compression_cache_hits_total")),
+      misses(via::metrics_registry::instance().
+               counter("via_http_compression_cache_misses_total"))
+    {}
+  };
+
+  /// The ids of the compression metrics, registered on first use.
+  metric_ids const& metrics()
+  {
+    static const metric_ids ids;
+    return ids;
+  }
+
+  /// Remove the leading and trailing whitespace from a string.
+  /// @param value the string.
+  /// @return the string without leading or trailing whitespace.
+  std::string trim(std::string const& value)
+  {
+    size_t const first(value.find_first_not_of(" \t"));
+    if (first == std::string::npos)
+      return std::string();
+    size_t const last(value.find_last_not_of(" \t"));
+    return value.substr(first, last - first + 1);
+  }
+
+  /// Find the value of a header field in a header string.
+  /// @param header_string the header string, e.g. of a tx_response.
+  /// @param field_id the header field id.
+  /// @return the value of the header field, empty if not found.
+  std::string find_header(std::string const& header_string,
+                          via::http::header_field::id field_id)
+  {
+    std::string const name
+      (via::http::header_field::standard_name(field_id) + ":");
+    size_t start(header_string.find(name));
+    if (start == std::string::npos)
+      return std::string();
+
+    start += name.size();
+    size_t const end(header_string.find('\r', start));
+    return trim(header_string.substr(start, end - start));
+  }
+}
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    bool compression_cache::key_type::operator<(key_type const& other) const
+      NOEXCEPT
+    {
+      return std::tie(is_file, device, inode, size, modified, offset, length,
+                      coding) <
+             std::tie(other.is_file, other.device, other.inode, other.size,
+                      other.modified, other.offset, other.length,
+                      other.coding);
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void compression_cache::erase(std::map<key_type, entry>::iterator iter)
+    {
+      size_ -= iter->second.size();
+      lru_.erase(iter->second.lru);
+      entries_.erase(iter);
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void compression_cache::trim()
+    {
+      while ((size_ > max_size_) && !lru_.empty())
+        erase(entries_.find(lru_.back()));
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer compression_cache::find(key_type const& key)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<key_type, entry>::iterator iter(entries_.find(key));
+        if (iter != entries_.end())
+        {
+          lru_.splice(lru_.begin(), lru_, iter->second.lru);
+          metrics_registry::instance().add(metrics().hits);
+          return iter->second.compressed;
+        }
+      }
+      metrics_registry::instance().add(metrics().misses);
+      return comms::shared_buffer();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void compression_cache::insert(key_type const& key, entry cached)
+    {
+      size_t const size(cached.size());
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size > max_size_)
+        return;
+
+      std::map<key_type, entry>::iterator iter(entries_.find(key));
+      if (iter != entries_.end())
+        erase(iter);
+
+      lru_.push_front(key);
+      cached.lru = lru_.begin();
+      size_ += size;
+      entries_.insert(std::make_pair(key, std::move(cached)));
+      trim();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer compression_cache::compress
+      (content_coding::id coding, int level, comms::file_segment const& file)
+    {
+      if (!file.file)
+        return comms::shared_buffer();
+
+      key_type const key = { true, file.file->device(), file.file->inode(),
+                             file.file->size(),
+                             static_cast<std::int64_t>
+                               (file.file->last_modified()),
+                             file.offset, file.length, coding };
+      comms::shared_buffer compressed(find(key));
+      if (compressed.size() > 0)
+        return compressed;
+
+      // Read and compress the segment without holding the lock
+      size_t const size(static_cast<size_t>(file.length));
+      std::string body(size, '\0');
+      boost::system::error_code error;
+      for (size_t read(0); read < size; )
+      {
+        size_t const bytes(file.file->read(&body[read], size - read,
+                                           file.offset + read, error));
+        if (error || (bytes == 0))
+          return comms::shared_buffer();
+        read += bytes;
+      }
+
+      compressed = comms::shared_buffer::share
+                     (encoder::compress(coding, level, body.data(), size));
+      entry cached = { comms::shared_buffer(), compressed,
+                       std::list<key_type>::iterator() };
+      insert(key, std::move(cached));
+      return compressed;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer compression_cache::compress
+      (content_coding::id coding, int level, comms::shared_buffer const& body)
+    {
+      key_type const key = { false, 0,
+                             reinterpret_cast<std::uintptr_t>(body.data()),
+                             body.size(), 0, 0, 0, coding };
+      comms::shared_buffer compressed(find(key));
+      if (compressed.size() > 0)
+        return compressed;
+
+      // Compress the body without holding the lock
+      compressed = comms::shared_buffer::share
+          (encoder::compress(coding, level, body.data(), body.size()));
+      entry cached = { body, compressed, std::list<key_type>::iterator() };
+      insert(key, std::move(cached));
+      return compressed;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void compression_cache::set_max_size(size_t max_size)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      max_size_ = max_size;
+      trim();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void compression_cache::clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      entries_.clear();
+      lru_.clear();
+      size_ = 0;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t compression_cache::size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return entries_.size();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t compression_cache::bytes() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return size_;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    response_compression::response_compression() :
+      codings_(),
+      level_(encoder::DEFAULT_LEVEL),
+      min_size_(DEFAULT_MIN_SIZE),
+      max_cached_size_(DEFAULT_MAX_CACHED_SIZE),
+      content_types_(),
+      cache_()
+    {
+      for (content_coding::id const coding :
+             { content_coding::BROTLI, content_coding::GZIP,
+               content_coding::DEFLATE })
+        if (content_coding::is_supported(coding))
+          codings_.push_back(coding);
+
+      add_content_type("text/");
+      add_content_type("application/json");
+      add_content_type("application/javascript");
+      add_content_type("application/xml");
+      add_content_type("image/svg+xml");
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void response_compression::set_codings
+                              (std::vector<content_coding::id> const& codings)
+    {
+      for (auto coding : codings)
+        if ((coding == content_coding::IDENTITY) ||
+            !content_coding::is_supported(coding))
+          throw std::invalid_argument("response_compression::set_codings: "
+                  "unsupported coding: " + content_coding::name(coding));
+      codings_ = codings;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    content_coding::id response_compression::negotiate
+                                (rx_request const& request, bool is_head) const
+    {
+      if (is_head || codings_.empty())
+        return content_coding::IDENTITY;
+
+      std::string const& accept_encoding
+          (request.headers().find(header_field::id::ACCEPT_ENCODING));
+      return accept_encoding.empty() ? content_coding::IDENTITY
+                 : content_coding::negotiate(accept_encoding, codings_);
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool response_compression::is_compressible(tx_response const& response,
+                                               size_t size) const
+    {
+      // Only compress the bodies of successful responses, not ranges
+      int const status(response.status());
+      if ((status < 200) || (status >= 300) ||
+          (status == static_cast<int>(response_status::code::NO_CONTENT)) ||
+          (status == static_cast<int>(response_status::code::PARTIAL_CONTENT)))
+        return false;
+
+      // Don't compress small bodies or bodies that the application encoded,
+      // or may not be transformed
+      std::string const& headers(response.header_string());
+      if (!response.is_chunked() && (size < min_size_))
+        return false;
+      if ((headers.find(header_field::standard_name
+                          (header_field::id::CONTENT_ENCODING))
+             != std::string::npos) ||
+          (headers.find(header_field::standard_name
+                          (header_field::id::CONTENT_LENGTH))
+             != std::string::npos) ||
+          (find_header(headers, header_field::id::CACHE_CONTROL).find
+                          ("no-transform") != std::string::npos))
+        return false;
+
+      std::string const content_type
+          (find_header(headers, header_field::id::CONTENT_TYPE));
+      for (auto const& type : content_types_)
+        if (content_type.compare(0, type.size(), type) == 0)
+          return true;
+      return false;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void response_compression::add_headers(content_coding::id coding,
+                                           tx_response& response)
+    {
+      if (coding != content_coding::IDENTITY)
+      {
+        // The compressed body is a different representation, so a strong
+        // entity tag must be weakened
+        std::string const etag(header_field::standard_name
+                                 (header_field::id::ETAG) + ": \"");
+        std::string headers(response.header_string());
+        size_t const position(headers.find(etag));
+        if (position != std::string::npos)
+        {
+          headers.insert(position + etag.size() - 1, "W/");
+          response.set_header_string(headers);
+        }
+
+        response.add_header(header_field::id::CONTENT_ENCODING,
+                            content_coding::name(coding));
+      }
+      response.add_header(header_field::id::VARY, "Accept-Encoding");
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer response_compression::compress
+              (content_coding::id coding, char const* data, size_t size) const
+    {
+      return comms::shared_buffer::share
+                          (encoder::compress(coding, level_, data, size));
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer response_compression::compress
+              (content_coding::id coding, comms::shared_buffer const& body)
+    {
+      if (body.size() <= max_cached_size_)
+        return cache_.compress(coding, level_, body);
+      else
+        return compress(coding, body.data(), body.size());
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    comms::shared_buffer response_compression::compress
+              (content_coding::id coding, comms::file_segment const& file)
+    { return cache_.compress(coding, level_, file); }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
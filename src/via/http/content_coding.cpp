@@ -0,0 +1,426 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file content_coding.cpp
+/// @brief Classes and functions to encode and decode HTTP message bodies.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/content_coding.hpp"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#ifdef HTTP_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HTTP_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace
+{
+  /// The size of the output buffer for each compression step.
+  const size_t OUTPUT_BUFFER_SIZE(16384);
+
+  /// Remove the leading and trailing whitespace from a string.
+  /// @param value the string.
+  /// @return the string without leading or trailing whitespace.
+  std::string trim(std::string const& value)
+  {
+    size_t const first(value.find_first_not_of(" \t"));
+    if (first == std::string::npos)
+      return std::string();
+    size_t const last(value.find_last_not_of(" \t"));
+    return value.substr(first, last - first + 1);
+  }
+
+  /// Convert a string to lower case.
+  /// @param value the string.
+  /// @return the string in lower case.
+  std::string to_lower(std::string value)
+  {
+    for (auto& c : value)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return value;
+  }
+}
+
+namespace via
+{
+  namespace http
+  {
+    namespace content_coding
+    {
+      //////////////////////////////////////////////////////////////////////
+      const std::string& name(id coding) NOEXCEPT
+      {
+        static const std::string IDENTITY_NAME("identity");
+        static const std::string DEFLATE_NAME ("deflate");
+        static const std::string GZIP_NAME    ("gzip");
+        static const std::string BROTLI_NAME  ("br");
+
+        switch (coding)
+        {
+        case DEFLATE:
+          return DEFLATE_NAME;
+        case GZIP:
+          return GZIP_NAME;
+        case BROTLI:
+          return BROTLI_NAME;
+        default:
+          return IDENTITY_NAME;
+        }
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      bool find(std::string const& content_encoding, id& coding)
+      {
+        std::string const value(to_lower(trim(content_encoding)));
+        for (id const known : { IDENTITY, DEFLATE, GZIP, BROTLI })
+          if (value == name(known))
+          {
+            coding = known;
+            return true;
+          }
+
+        if (value == "x-gzip")
+        {
+          coding = GZIP;
+          return true;
+        }
+        return false;
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      bool is_supported(id coding) NOEXCEPT
+      {
+#ifdef HTTP_ZLIB
+        bool const zlib(true);
+#else
+        bool const zlib(false);
+#endif
+#ifdef HTTP_BROTLI
+        bool const brotli(true);
+#else
+        bool const brotli(false);
+#endif
+        switch (coding)
+        {
+        case DEFLATE:
+        case GZIP:
+          return zlib;
+        case BROTLI:
+          return brotli;
+        default:
+          return true;
+        }
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      id negotiate(std::string const& accept_encoding,
+                   std::vector<id> const& codings)
+      {
+        // The quality value of each coding, negative if it's not listed
+        std::vector<double> qualities(codings.size(), -1.0);
+        double any_quality(-1.0);
+
+        size_t next(0);
+        while (next < accept_encoding.size())
+        {
+          size_t end(accept_encoding.find(',', next));
+          if (end == std::string::npos)
+            end = accept_encoding.size();
+          std::string const element(accept_encoding.substr(next, end - next));
+          next = end + 1;
+
+          // The coding name and an optional quality value, e.g. "gzip;q=0.5"
+          size_t const semicolon(element.find(';'));
+          std::string const coding
+              (to_lower(trim(element.substr(0, semicolon))));
+
+          double quality(1.0);
+          if (semicolon != std::string::npos)
+          {
+            std::string const parameter(trim(element.substr(semicolon + 1)));
+            if ((parameter.size() > 2) &&
+                (std::tolower(static_cast<unsigned char>(parameter[0])) == 'q')
+                && (parameter[1] == '='))
+              quality = std::atof(parameter.c_str() + 2);
+          }
+
+          if (coding == "*")
+            any_quality = quality;
+          else
+          {
+            for (size_t i(0); i < codings.size(); ++i)
+              if ((coding == name(codings[i])) ||
+                  ((codings[i] == GZIP) && (coding == "x-gzip")))
+                qualities[i] = quality;
+          }
+        }
+
+        id result(IDENTITY);
+        double best(0.0);
+        for (size_t i(0); i < codings.size(); ++i)
+        {
+          double const quality((qualities[i] < 0.0) ? any_quality
+                                                    : qualities[i]);
+          if (quality > best)
+          {
+            best   = quality;
+            result = codings[i];
+          }
+        }
+        return result;
+      }
+      //////////////////////////////////////////////////////////////////////
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    struct encoder::stream
+    {
+      content_coding::id coding; ///< The content coding.
+#ifdef HTTP_ZLIB
+      z_stream zlib;             ///< The gzip or deflate stream.
+#endif
+#ifdef HTTP_BROTLI
+      BrotliEncoderState* brotli; ///< The brotli stream.
+#endif
+    };
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    encoder::encoder(content_coding::id coding, int level) :
+      stream_(new stream()),
+      finished_(false)
+    {
+      if ((coding == content_coding::IDENTITY) ||
+          !content_coding::is_supported(coding))
+        throw std::invalid_argument("http::encoder: unsupported coding: "
+                                    + content_coding::name(coding));
+
+      stream_->coding = coding;
+#ifdef HTTP_BROTLI
+      stream_->brotli = nullptr;
+      if (coding == content_coding::BROTLI)
+      {
+        stream_->brotli = BrotliEncoderCreateInstance(nullptr, nullptr,
+                                                      nullptr);
+        if (!stream_->brotli)
+          throw std::bad_alloc();
+        BrotliEncoderSetParameter(stream_->brotli, BROTLI_PARAM_QUALITY,
+          static_cast<uint32_t>(std::min(std::max(level, 0), 11)));
+        return;
+      }
+#endif
+
+#ifdef HTTP_ZLIB
+      // A gzip stream has a gzip wrapper, a deflate stream a zlib wrapper
+      int const window_bits((coding == content_coding::GZIP) ? 15 + 16 : 15);
+      if (deflateInit2(&stream_->zlib, std::min(std::max(level, 1), 9),
+                       Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::bad_alloc();
+#else
+      (void)level;
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    encoder::~encoder()
+    {
+#ifdef HTTP_BROTLI
+      if (stream_->coding == content_coding::BROTLI)
+      {
+        BrotliEncoderDestroyInstance(stream_->brotli);
+        return;
+      }
+#endif
+#ifdef HTTP_ZLIB
+      deflateEnd(&stream_->zlib);
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void encoder::encode(char const* data, size_t size, std::string& output,
+                         bool finish)
+    {
+      // Nothing to flush, or the stream has already been finished
+      if (finished_ || ((size == 0) && !finish))
+        return;
+      finished_ = finish;
+
+#ifdef HTTP_BROTLI
+      if (stream_->coding == content_coding::BROTLI)
+      {
+        size_t available_in(size);
+        uint8_t const* next_in(reinterpret_cast<uint8_t const*>(data));
+        BrotliEncoderOperation const operation
+            (finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH);
+        do
+        {
+          size_t available_out(0);
+          if (!BrotliEncoderCompressStream(stream_->brotli, operation,
+                                           &available_in, &next_in,
+                                           &available_out, nullptr, nullptr))
+            break;
+
+          size_t output_size(0);
+          uint8_t const* compressed
+              (BrotliEncoderTakeOutput(stream_->brotli, &output_size));
+          output.append(reinterpret_cast<char const*>(compressed),
+                        output_size);
+        } while ((available_in > 0) ||
+                 BrotliEncoderHasMoreOutput(stream_->brotli) ||
+                 (finish && !BrotliEncoderIsFinished(stream_->brotli)));
+        return;
+      }
+#endif
+
+#ifdef HTTP_ZLIB
+      // zlib takes the input in pieces of up to UINT_MAX bytes
+      z_stream& zlib(stream_->zlib);
+      do
+      {
+        size_t const piece(std::min(size, static_cast<size_t>(UINT_MAX)));
+        zlib.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zlib.avail_in = static_cast<uInt>(piece);
+        data += piece;
+        size -= piece;
+
+        int const flush((size > 0) ? Z_NO_FLUSH
+                                   : (finish ? Z_FINISH : Z_SYNC_FLUSH));
+        int result(Z_OK);
+        do
+        {
+          size_t const offset(output.size());
+          output.resize(offset + OUTPUT_BUFFER_SIZE);
+          zlib.next_out  = reinterpret_cast<Bytef*>(&output[offset]);
+          zlib.avail_out = static_cast<uInt>(OUTPUT_BUFFER_SIZE);
+          result = deflate(&zlib, flush);
+          output.resize(offset + OUTPUT_BUFFER_SIZE - zlib.avail_out);
+        } while ((result == Z_OK) &&
+                 ((zlib.avail_out == 0) || (flush == Z_FINISH)));
+      } while (size > 0);
+#else
+      (void)data;
+      (void)output;
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    struct decoder::stream
+    {
+#ifdef HTTP_ZLIB
+      z_stream zlib; ///< The gzip or deflate stream.
+#endif
+    };
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    decoder::decoder(content_coding::id coding, size_t max_size) :
+      stream_(new stream()),
+      max_size_(max_size),
+      size_(0),
+      finished_(false),
+      failed_(false)
+    {
+      if (((coding != content_coding::GZIP) &&
+           (coding != content_coding::DEFLATE)) ||
+          !content_coding::is_supported(coding))
+        throw std::invalid_argument("http::decoder: unsupported coding: "
+                                    + content_coding::name(coding));
+
+#ifdef HTTP_ZLIB
+      // A gzip stream has a gzip wrapper, a deflate stream a zlib wrapper
+      int const window_bits((coding == content_coding::GZIP) ? 15 + 16 : 15);
+      if (inflateInit2(&stream_->zlib, window_bits) != Z_OK)
+        throw std::bad_alloc();
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    decoder::~decoder()
+    {
+#ifdef HTTP_ZLIB
+      inflateEnd(&stream_->zlib);
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t decoder::decode_some(char const*& data, size_t& size,
+                                char* buffer, size_t buffer_size)
+    {
+      if (failed_)
+        return 0;
+
+      // Data after the end of the stream is invalid
+      if (finished_)
+      {
+        failed_ = (size > 0);
+        return 0;
+      }
+
+#ifdef HTTP_ZLIB
+      z_stream& zlib(stream_->zlib);
+      zlib.next_out  = reinterpret_cast<Bytef*>(buffer);
+      zlib.avail_out = static_cast<uInt>(buffer_size);
+      while (zlib.avail_out > 0)
+      {
+        // zlib takes the input in pieces of up to UINT_MAX bytes
+        size_t const piece(std::min(size, static_cast<size_t>(UINT_MAX)));
+        zlib.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zlib.avail_in = static_cast<uInt>(piece);
+        int const result(inflate(&zlib, Z_NO_FLUSH));
+        size_t const consumed(piece - zlib.avail_in);
+        data += consumed;
+        size -= consumed;
+
+        if (result == Z_STREAM_END)
+        {
+          finished_ = true;
+          failed_ = (size > 0);
+          break;
+        }
+
+        // Z_BUF_ERROR: no progress is possible until there's more data
+        if (result != Z_OK)
+        {
+          failed_ = (result != Z_BUF_ERROR);
+          break;
+        }
+      }
+
+      size_t const length(buffer_size - zlib.avail_out);
+#else
+      // A decoder can't be constructed without zlib
+      (void)data;
+      (void)buffer;
+      (void)buffer_size;
+      size_t const length(0);
+      failed_ = true;
+#endif
+      size_ += length;
+      if (size_ > max_size_)
+      {
+        failed_ = true;
+        return 0;
+      }
+      return failed_ ? 0 : length;
+    }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
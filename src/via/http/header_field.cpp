@@ -8,7 +8,11 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/header_field.hpp"
 #include "via/http/character.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <unordered_map>
 
 #ifdef _MSC_VER // MSVC doesn't like gmtime...
 #pragma warning( disable : 4996 )
@@ -147,6 +151,38 @@ namespace
 
   /// The value to use for chunked tranfer encoding.
   const std::string CHUNKED  ("Chunked");
+
+  /// The day names for an HTTP date, starting from Sunday.
+  const char DAY_NAMES[][4] =
+    { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+  /// The month names for an HTTP date.
+  const char MONTH_NAMES[][4] =
+    { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+  /// The number of 64 bit words required to store an HTTP date.
+  const size_t DATE_WORDS(4);
+
+  /// The current HTTP date, formatted at most once a second.
+  /// It's published with a sequence lock: the sequence is odd whilst the
+  /// date is being updated, so readers never wait and writers never block.
+  struct date_cache
+  {
+    std::atomic<unsigned>      sequence;          ///< the update sequence
+    std::atomic<std::time_t>   time;              ///< the time of the date
+    std::atomic<std::uint64_t> words[DATE_WORDS]; ///< the formatted date
+  };
+
+  /// The date cache, zero initialised as it has static storage duration.
+  date_cache DATE_CACHE;
+
+  /// Write a number as two decimal digits.
+  inline void put_2_digits(char* buffer, int number) NOEXCEPT
+  {
+    buffer[0] = static_cast<char>('0' + number / 10);
+    buffer[1] = static_cast<char>('0' + number % 10);
+  }
 }
 
 namespace via
@@ -287,6 +323,29 @@ namespace via
       }
       ////////////////////////////////////////////////////////////////////////
 
+      ////////////////////////////////////////////////////////////////////////
+      id find_id(std::string const& name) NOEXCEPT
+      {
+        typedef std::unordered_map<std::string, id> id_map;
+        struct lowercase_ids : public id_map
+        {
+          lowercase_ids()
+          {
+            for (size_t i(0); i < NUMBER_OF_IDS; ++i)
+            {
+              id const field_id(static_cast<id>(i));
+              insert(value_type(lowercase_name(field_id), field_id));
+            }
+          }
+        };
+        static const lowercase_ids LOWERCASE_IDS;
+
+        id_map::const_iterator iter(LOWERCASE_IDS.find(name));
+        return (iter != LOWERCASE_IDS.end()) ? iter->second
+                                             : id::EXTENSION_HEADER;
+      }
+      ////////////////////////////////////////////////////////////////////////
+
       ////////////////////////////////////////////////////////////////////////
       std::string to_header(std::string const& name,
                             std::string const& value)
@@ -298,18 +357,168 @@ namespace via
       { return to_header(standard_name(field_id), value); }
       ////////////////////////////////////////////////////////////////////////
 
+      ////////////////////////////////////////////////////////////////////////
+      void format_date(std::time_t time, char* buffer) NOEXCEPT
+      {
+        // Split the time into days and seconds since the epoch
+        std::int64_t const SECONDS_PER_DAY(86400);
+        std::int64_t days(static_cast<std::int64_t>(time) / SECONDS_PER_DAY);
+        std::int64_t seconds(static_cast<std::int64_t>(time) % SECONDS_PER_DAY);
+        if (seconds < 0)
+        {
+          seconds += SECONDS_PER_DAY;
+          --days;
+        }
+
+        // 1st January 1970 was a Thursday
+        int const weekday(static_cast<int>(((days % 7) + 11) % 7));
+
+        // Convert the days to a civil date, see:
+        // http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+        std::int64_t const z(days + 719468);
+        std::int64_t const era((z >= 0 ? z : z - 146096) / 146097);
+        std::int64_t const doe(z - era * 146097);
+        std::int64_t const yoe((doe - doe / 1460 + doe / 36524 - doe / 146096)
+                                 / 365);
+        std::int64_t const doy(doe - (365 * yoe + yoe / 4 - yoe / 100));
+        std::int64_t const mp((5 * doy + 2) / 153);
+        int const day(static_cast<int>(doy - (153 * mp + 2) / 5 + 1));
+        int const month(static_cast<int>(mp < 10 ? mp + 3 : mp - 9));
+        int const year(static_cast<int>(yoe + era * 400 + (month <= 2)));
+
+        // "Www, DD Mmm YYYY HH:MM:SS GMT"
+        std::memcpy(buffer, DAY_NAMES[weekday], 3);
+        buffer[3] = ',';
+        buffer[4] = ' ';
+        put_2_digits(buffer + 5, day);
+        buffer[7] = ' ';
+        std::memcpy(buffer + 8, MONTH_NAMES[month - 1], 3);
+        buffer[11] = ' ';
+        put_2_digits(buffer + 12, (year / 100) % 100);
+        put_2_digits(buffer + 14, year % 100);
+        buffer[16] = ' ';
+        put_2_digits(buffer + 17, static_cast<int>(seconds / 3600));
+        buffer[19] = ':';
+        put_2_digits(buffer + 20, static_cast<int>((seconds / 60) % 60));
+        buffer[22] = ':';
+        put_2_digits(buffer + 23, static_cast<int>(seconds % 60));
+        std::memcpy(buffer + 25, " GMT", 4);
+      }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      std::time_t parse_date(std::string const& date) NOEXCEPT
+      {
+        // "Www, DD Mmm YYYY HH:MM:SS GMT"
+        if ((date.size() != DATE_LENGTH) || (date[3] != ',') ||
+            (date[4] != ' ') || (date[7] != ' ') || (date[11] != ' ') ||
+            (date[16] != ' ') || (date[19] != ':') || (date[22] != ':') ||
+            (date.compare(25, 4, " GMT") != 0))
+          return -1;
+
+        // Read the digits at the given positions, -1 if any aren't digits
+        auto const read_number([&date](size_t start, size_t length) -> int
+        {
+          int number(0);
+          for (size_t i(start); i < start + length; ++i)
+          {
+            if ((date[i] < '0') || (date[i] > '9'))
+              return -1;
+            number = 10 * number + (date[i] - '0');
+          }
+          return number;
+        });
+
+        int month(0);
+        while ((month < 12) && date.compare(8, 3, MONTH_NAMES[month]))
+          ++month;
+        ++month;
+
+        int const day(read_number(5, 2));
+        int const year(read_number(12, 4));
+        int const hours(read_number(17, 2));
+        int const minutes(read_number(20, 2));
+        int const seconds(read_number(23, 2));
+        if ((month > 12) || (day < 1) || (day > 31) || (year < 0) ||
+            (hours < 0) || (hours > 23) || (minutes < 0) || (minutes > 59) ||
+            (seconds < 0) || (seconds > 60))
+          return -1;
+
+        // Convert the civil date to days since the epoch, see:
+        // http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+        std::int64_t const y(year - (month <= 2));
+        std::int64_t const era((y >= 0 ? y : y - 399) / 400);
+        std::int64_t const yoe(y - era * 400);
+        std::int64_t const doy((153 * (month > 2 ? month - 3 : month + 9) + 2)
+                                 / 5 + day - 1);
+        std::int64_t const doe(yoe * 365 + yoe / 4 - yoe / 100 + doy);
+        std::int64_t const days(era * 146097 + doe - 719468);
+
+        return static_cast<std::time_t>
+            (((days * 24 + hours) * 60 + minutes) * 60 + seconds);
+      }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      void current_date(char* buffer) NOEXCEPT
+      {
+        std::time_t const now(std::time(nullptr));
+
+        // Read the cached date, if it's for the current second
+        unsigned sequence(DATE_CACHE.sequence.load(std::memory_order_acquire));
+        if (!(sequence & 1u) &&
+            (DATE_CACHE.time.load(std::memory_order_relaxed) == now))
+        {
+          std::uint64_t words[DATE_WORDS];
+          for (size_t i(0); i < DATE_WORDS; ++i)
+            words[i] = DATE_CACHE.words[i].load(std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_acquire);
+
+          if (DATE_CACHE.sequence.load(std::memory_order_relaxed) == sequence)
+          {
+            std::memcpy(buffer, words, DATE_LENGTH);
+            return;
+          }
+        }
+
+        // Otherwise format the date
+        std::uint64_t words[DATE_WORDS] = { 0, 0, 0, 0 };
+        format_date(now, reinterpret_cast<char*>(words));
+        std::memcpy(buffer, words, DATE_LENGTH);
+
+        // and publish it, unless another thread is already doing so
+        if (!(sequence & 1u) &&
+            DATE_CACHE.sequence.compare_exchange_strong
+              (sequence, sequence + 1, std::memory_order_relaxed))
+        {
+          std::atomic_thread_fence(std::memory_order_release);
+          for (size_t i(0); i < DATE_WORDS; ++i)
+            DATE_CACHE.words[i].store(words[i], std::memory_order_relaxed);
+          DATE_CACHE.time.store(now, std::memory_order_relaxed);
+          DATE_CACHE.sequence.store(sequence + 2, std::memory_order_release);
+        }
+      }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      void append_date_header(std::string& header_string)
+      {
+        char date[DATE_LENGTH];
+        current_date(date);
+
+        header_string += standard_name(id::DATE);
+        header_string += SEPARATOR;
+        header_string.append(date, DATE_LENGTH);
+        header_string += CRLF;
+      }
+      ////////////////////////////////////////////////////////////////////////
+
       ////////////////////////////////////////////////////////////////////////
       std::string date_header()
       {
-        /// The value to use to format an HTTP date into RFC1123 format.
-        static const char DATE_FORMAT[] = {"%a, %d %b %Y %H:%M:%S GMT"};
-        static char dateBuffer[30] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-        time_t uTime;
-        time(&uTime);
-        strftime(dateBuffer, 30, DATE_FORMAT, std::gmtime(&uTime));
-        return to_header(header_field::id::DATE, dateBuffer);
+        std::string header;
+        append_date_header(header);
+        return header;
       }
       ////////////////////////////////////////////////////////////////////////
 
@@ -9,21 +9,86 @@
 #include "via/http/headers.hpp"
 #include <cstdlib>
 #include <algorithm>
+#include <limits>
 
 namespace
 {
   const std::string EMPTY_STRING("");
 
   const std::string COOKIE("cookie");
-  const std::string IDENTITY("identity");
-  const std::string CLOSE("close");
-  const std::string CONTINUE("100-continue");
+  const via::http::string_view IDENTITY("identity");
+  const via::http::string_view CLOSE("close");
+  const via::http::string_view CONTINUE("100-continue");
+
+  /// Convert an ASCII character to lower case.
+  inline char to_lower(char c) NOEXCEPT
+  { return (('A' <= c) && (c <= 'Z')) ? static_cast<char>(c | 0x20) : c; }
+
+  /// Whether a string contains a lower case string, ignoring the case of
+  /// ASCII letters in the string.
+  bool contains_nocase(via::http::string_view str,
+                       via::http::string_view lower) NOEXCEPT
+  {
+    if (str.size() < lower.size())
+      return false;
+
+    size_t const last(str.size() - lower.size());
+    for (size_t i(0); i <= last; ++i)
+    {
+      size_t j(0);
+      while ((j < lower.size()) && (to_lower(str[i + j]) == lower[j]))
+        ++j;
+      if (j == lower.size())
+        return true;
+    }
+
+    return false;
+  }
 }
 
 namespace via
 {
   namespace http
   {
+    namespace field_value
+    {
+      ////////////////////////////////////////////////////////////////////////
+      std::ptrdiff_t content_length(string_view value) NOEXCEPT
+      {
+        std::ptrdiff_t const max_length
+          (std::numeric_limits<std::ptrdiff_t>::max());
+        std::ptrdiff_t length(0);
+        for (size_t i(0); i < value.size(); ++i)
+        {
+          if (!std::isdigit(static_cast<unsigned char>(value[i])))
+            return -1;
+
+          std::ptrdiff_t const digit(value[i] - '0');
+          if (length > (max_length - digit) / 10)
+            return -1;
+          length = length * 10 + digit;
+        }
+
+        return length;
+      }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      bool is_chunked(string_view value) NOEXCEPT
+      { return !value.empty() && !contains_nocase(value, IDENTITY); }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      bool is_close(string_view value) NOEXCEPT
+      { return contains_nocase(value, CLOSE); }
+      ////////////////////////////////////////////////////////////////////////
+
+      ////////////////////////////////////////////////////////////////////////
+      bool is_continue(string_view value) NOEXCEPT
+      { return contains_nocase(value, CONTINUE); }
+      ////////////////////////////////////////////////////////////////////////
+    }
+
     //////////////////////////////////////////////////////////////////////////
     bool field_line::parse_char(char c)
     {
@@ -90,90 +155,102 @@ namespace via
     //////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////
-    void message_headers::add(const std::string& name, const std::string& value)
+    void message_headers::update_cache(header_field::id field_id,
+                                       const std::string& value)
     {
-      std::unordered_map<std::string, std::string>::iterator iter
-        (fields_.find(name));
-      // if the field name was found previously
-      if (iter != fields_.end())
+      switch (field_id)
       {
-        if (name.find(COOKIE) != std::string::npos)
-          iter->second += SC + value;
-        else
-          iter->second += COMMA + value;
+      case header_field::id::CONTENT_LENGTH:
+        content_length_ = field_value::content_length(value);
+        break;
+
+      case header_field::id::TRANSFER_ENCODING:
+        is_chunked_ = field_value::is_chunked(value);
+        break;
+
+      case header_field::id::CONNECTION:
+        close_connection_ = field_value::is_close(value);
+        break;
+
+      case header_field::id::EXPECT:
+        expect_continue_ = field_value::is_continue(value);
+        break;
+
+      default:
+        break;
       }
-      else
-        fields_.insert(std::unordered_map<std::string, std::string>::value_type
-                             (name, value));
     }
     //////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////
-    const std::string& message_headers::find(const std::string& name) const
+    void message_headers::add(const std::string& name, const std::string& value)
     {
-      std::unordered_map<std::string, std::string>::const_iterator iter
-        (fields_.find(name));
+      header_field::id const field_id(header_field::find_id(name));
+      bool const is_standard(field_id != header_field::id::EXTENSION_HEADER);
 
-      if (iter != fields_.end())
-        return iter->second;
+      // Find whether the field name was found previously
+      field_collection::iterator iter(fields_.end());
+      if (is_standard)
+      {
+        unsigned short const index(indices_[static_cast<size_t>(field_id)]);
+        if (index != NOT_FOUND)
+          iter = fields_.begin() + index;
+      }
       else
-        return EMPTY_STRING;
-    }
-    //////////////////////////////////////////////////////////////////////////
+      {
+        for (iter = fields_.begin(); iter != fields_.end(); ++iter)
+          if (iter->first == name)
+            break;
+      }
 
-    //////////////////////////////////////////////////////////////////////////
-    std::ptrdiff_t message_headers::content_length() const NOEXCEPT
-    {
-      // Find whether there is a content length field.
-      const std::string& content_length(find(header_field::id::CONTENT_LENGTH));
-      if (content_length.empty())
-        return 0;
+      if (iter != fields_.end())
+      {
+        if (name.find(COOKIE) != std::string::npos)
+          iter->second += SC + value;
+        else
+          iter->second += COMMA + value;
+      }
+      else
+      {
+        if (is_standard)
+          indices_[static_cast<size_t>(field_id)] =
+            static_cast<unsigned short>(fields_.size());
+        fields_.push_back(field_type(name, value));
+        iter = fields_.end() - 1;
+      }
 
-      // Get the length from the content length field.
-      return from_dec_string(content_length);
+      if (is_standard)
+        update_cache(field_id, iter->second);
     }
     //////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////
-    bool message_headers::is_chunked() const
+    const std::string& message_headers::find(const std::string& name) const
     {
-      // Find whether there is a transfer encoding header.
-      std::string xfer_encoding(find(header_field::id::TRANSFER_ENCODING));
-      if (xfer_encoding.empty())
-        return false;
-
-      std::transform(xfer_encoding.begin(), xfer_encoding.end(),
-                     xfer_encoding.begin(), ::tolower);
-      // Note: is transfer encoding if "identity" is NOT found.
-      return (xfer_encoding.find(IDENTITY) == std::string::npos);
-    }
-    //////////////////////////////////////////////////////////////////////////
+      header_field::id const field_id(header_field::find_id(name));
+      if (field_id != header_field::id::EXTENSION_HEADER)
+        return find(field_id);
 
-    //////////////////////////////////////////////////////////////////////////
-    bool message_headers::close_connection() const
-    {
-      // Find whether there is a connection header.
-      std::string connection(find(header_field::id::CONNECTION));
-      if (connection.empty())
-        return false;
+      for (field_collection::const_iterator iter(fields_.begin());
+           iter != fields_.end(); ++iter)
+      {
+        if (iter->first == name)
+          return iter->second;
+      }
 
-      std::transform(connection.begin(), connection.end(),
-                     connection.begin(), ::tolower);
-      return (connection.find(CLOSE) != std::string::npos);
+      return EMPTY_STRING;
     }
     //////////////////////////////////////////////////////////////////////////
 
     //////////////////////////////////////////////////////////////////////////
-    bool message_headers::expect_continue() const
+    const std::string& message_headers::find(header_field::id field_id) const
+      NOEXCEPT
     {
-      // Find whether there is a expect header.
-      std::string expect(find(header_field::id::EXPECT));
-      if (expect.empty())
-        return false;
+      if (field_id == header_field::id::EXTENSION_HEADER)
+        return EMPTY_STRING;
 
-      std::transform(expect.begin(), expect.end(),
-                     expect.begin(), ::tolower);
-      return (expect.find(CONTINUE) != std::string::npos);
+      unsigned short const index(indices_[static_cast<size_t>(field_id)]);
+      return (index != NOT_FOUND) ? fields_[index].second : EMPTY_STRING;
     }
     //////////////////////////////////////////////////////////////////////////
 
@@ -181,8 +258,8 @@ namespace via
     std::string message_headers::to_string() const
     {
       std::string output;
-      for (std::unordered_map<std::string, std::string>::const_iterator
-           iter(fields_.begin()); iter != fields_.end(); ++iter)
+      for (field_collection::const_iterator iter(fields_.begin());
+           iter != fields_.end(); ++iter)
         output += header_field::to_header(iter->first, iter->second);
 
       return output;
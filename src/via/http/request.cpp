@@ -34,6 +34,7 @@ namespace via
         // If this char is whitespace and method has been read
         else if (is_space_or_tab(c) && !method_.empty())
         {
+          method_id_ = request_method::find_id(method_);
           ws_count_ = 1;
           state_ = REQ_URI;
         }
@@ -52,6 +52,19 @@ namespace via
       }
       //////////////////////////////////////////////////////////////////////////
 
+      //////////////////////////////////////////////////////////////////////////
+      id find_id(std::string const& method_name) NOEXCEPT
+      {
+        for (size_t i(0); i < NUMBER_OF_IDS; ++i)
+        {
+          id const method_id(static_cast<id>(i));
+          if (name(method_id) == method_name)
+            return method_id;
+        }
+
+        return id::EXTENSION_METHOD;
+      }
+      //////////////////////////////////////////////////////////////////////////
     }
   }
 }
@@ -0,0 +1,348 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request_view.hpp"
+#include "via/http/character.hpp"
+#include "via/http/scanner.hpp"
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+  using via::http::string_view;
+
+  /// Convert an ASCII character to lower case.
+  inline char to_lower(char c) NOEXCEPT
+  { return (('A' <= c) && (c <= 'Z')) ? static_cast<char>(c | 0x20) : c; }
+
+  /// Compare two strings ignoring the case of ASCII letters.
+  bool equals_nocase(string_view lhs, string_view rhs) NOEXCEPT
+  {
+    if (lhs.size() != rhs.size())
+      return false;
+
+    for (size_t i(0); i < lhs.size(); ++i)
+      if (to_lower(lhs[i]) != to_lower(rhs[i]))
+        return false;
+
+    return true;
+  }
+
+  /// Skip a run of spaces and tabs.
+  /// @return the number of characters skipped.
+  size_t skip_whitespace(const char*& iter, const char* end) NOEXCEPT
+  {
+    const char* begin(iter);
+    while ((iter != end) && via::http::is_space_or_tab(*iter))
+      ++iter;
+    return iter - begin;
+  }
+
+  /// Find the blank line at the end of a request header.
+  /// @param begin the start of the data.
+  /// @param end the end of the data.
+  /// @return the end of the blank line, or null if it wasn't found.
+  const char* find_header_end(const char* begin, const char* end) NOEXCEPT
+  {
+    const char* iter(begin);
+    while (iter != end)
+    {
+      const char* lf(static_cast<const char*>
+                       (std::memchr(iter, '\n', end - iter)));
+      if (!lf || (++lf == end))
+        break;
+
+      if ('\n' == *lf)
+        return lf + 1;
+
+      if ('\r' == *lf)
+      {
+        if (lf + 1 == end)
+          break;
+        if ('\n' == lf[1])
+          return lf + 2;
+      }
+      iter = lf;
+    }
+
+    return 0;
+  }
+}
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    size_t rx_request_view::max_request_size() const NOEXCEPT
+    {
+      // method, whitespace, uri, whitespace, "HTTP/x.y" and CRLF
+      size_t const line_size(max_method_length_ + 2 * max_whitespace_
+                             + max_uri_length_ + 10);
+      // the field lines and the blank line
+      size_t const header_size((max_header_number_ + 1) *
+                               static_cast<size_t>(max_line_length_) + 2);
+      return line_size + header_size;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    Rx rx_request_view::parse(const char*& iter, const char* end)
+    {
+      size_t const max_size(max_request_size());
+
+      // If the header hasn't spanned reads, parse it from the received data
+      if (partial_.empty())
+      {
+        size_t const length(std::min(static_cast<size_t>(end - iter),
+                                     max_size));
+        const char* header_end(find_header_end(iter, iter + length));
+        if (header_end)
+        {
+          const char* begin(iter);
+          iter = header_end;
+          return parse_header(begin, header_end) ? RX_VALID : RX_INVALID;
+        }
+
+        if (length == max_size)
+          return RX_INVALID;
+
+        partial_.assign(iter, end);
+        iter = end;
+        return RX_INCOMPLETE;
+      }
+
+      // Otherwise append the received data to the partial header
+      size_t const old_size(partial_.size());
+      size_t const length(std::min(static_cast<size_t>(end - iter),
+                                   max_size - old_size));
+      partial_.append(iter, length);
+
+      // the blank line may start in the previous data
+      size_t const start((old_size > 3) ? old_size - 3 : 0);
+      const char* data(partial_.data());
+      const char* header_end(find_header_end(data + start,
+                                             data + partial_.size()));
+      if (header_end)
+      {
+        size_t const header_size(header_end - data);
+        iter += header_size - old_size;
+        partial_.resize(header_size);
+        copied_ = true;
+        data = partial_.data();
+        return parse_header(data, data + header_size) ? RX_VALID : RX_INVALID;
+      }
+
+      if (partial_.size() == max_size)
+        return RX_INVALID;
+
+      iter = end;
+      return RX_INCOMPLETE;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::parse_header(const char* begin, const char* end)
+    {
+      const char* iter(begin);
+      if (!parse_request_line(iter, end))
+        return false;
+
+      size_t length(0);
+      while (iter != end && !is_end_of_line(*iter))
+      {
+        if (!parse_field_line(iter, end, length))
+          return false;
+      }
+
+      // the blank line at the end of the header
+      valid_ = parse_eol(iter, end);
+      return valid_;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::parse_request_line(const char*& iter,
+                                             const char* end)
+    {
+      // Valid HTTP methods must be uppercase chars
+      const char* method_begin(iter);
+      while ((iter != end) &&
+             std::isupper(static_cast<unsigned char>(*iter)))
+        ++iter;
+      size_t const method_length(iter - method_begin);
+      if ((method_length == 0) || (method_length > max_method_length_))
+        return false;
+      method_ = string_view(method_begin, method_length);
+
+      size_t ws_count(skip_whitespace(iter, end));
+      if ((ws_count == 0) || (ws_count > max_whitespace_))
+        return false;
+
+      const char* uri_begin(iter);
+      iter = scanner::instance().find_ws_or_eol(iter, end);
+      size_t const uri_length(iter - uri_begin);
+      if ((uri_length == 0) || (uri_length > max_uri_length_))
+        return false;
+      uri_ = string_view(uri_begin, uri_length);
+
+      ws_count = skip_whitespace(iter, end);
+      if ((ws_count == 0) || (ws_count > max_whitespace_))
+        return false;
+
+      // "HTTP/x.y"
+      if ((end - iter < 8) || std::strncmp(iter, "HTTP/", 5) ||
+          !std::isdigit(static_cast<unsigned char>(iter[5])) ||
+          ('.' != iter[6]) ||
+          !std::isdigit(static_cast<unsigned char>(iter[7])))
+        return false;
+      major_version_ = iter[5];
+      minor_version_ = iter[7];
+      iter += 8;
+
+      return parse_eol(iter, end);
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::parse_field_line(const char*& iter, const char* end,
+                                           size_t& length)
+    {
+      const char* line_begin(iter);
+      string_view name;
+
+      // A continuation line is appended to the previous field value
+      bool const is_continuation(is_space_or_tab(*iter));
+      if (is_continuation)
+      {
+        if (fields_.empty())
+          return false;
+      }
+      else
+      {
+        const char* name_begin(iter);
+        iter = scanner::instance().find_not_name(iter, end);
+        if ((iter == name_begin) || (iter == end) || (':' != *iter))
+          return false;
+        name = string_view(name_begin, iter - name_begin);
+        ++iter;
+      }
+
+      // Ignore leading whitespace, but only upto to a limit!
+      if (skip_whitespace(iter, end) > max_whitespace_)
+        return false;
+
+      const char* value_begin(iter);
+      iter = scanner::instance().find_eol(iter, end);
+      string_view value(value_begin, iter - value_begin);
+
+      if (!parse_eol(iter, end) ||
+          (static_cast<size_t>(iter - line_begin) > max_line_length_))
+        return false;
+
+      if (is_continuation)
+      {
+        field& previous(fields_.back());
+        std::string folded(previous.value.data(), previous.value.size());
+        folded += ' ';
+        folded.append(value.data(), value.size());
+        folded_values_.push_back(folded);
+        previous.value = folded_values_.back();
+        length += value.size() + 1;
+      }
+      else
+      {
+        if (fields_.size() >= max_header_number_)
+          return false;
+        field const new_field = { name, value };
+        fields_.push_back(new_field);
+        length += name.size() + value.size();
+      }
+
+      return length <= max_header_length_;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::parse_eol(const char*& iter, const char* end)
+      const NOEXCEPT
+    {
+      if (iter == end)
+        return false;
+
+      // The line should end with a \r\n...
+      if ('\r' == *iter)
+      {
+        if ((++iter == end) || ('\n' != *iter))
+          return false;
+      }
+      // but (if not being strict) permit just \n
+      else if (strict_crlf_ || ('\n' != *iter))
+        return false;
+
+      ++iter;
+      return true;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    string_view rx_request_view::find(string_view name) const NOEXCEPT
+    {
+      for (std::vector<field>::const_iterator iter(fields_.begin());
+           iter != fields_.end(); ++iter)
+      {
+        if (equals_nocase(iter->name, name))
+          return iter->value;
+      }
+
+      return string_view();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    std::ptrdiff_t rx_request_view::content_length() const NOEXCEPT
+    {
+      return field_value::content_length
+          (find(header_field::id::CONTENT_LENGTH));
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::is_chunked() const NOEXCEPT
+    {
+      return field_value::is_chunked
+          (find(header_field::id::TRANSFER_ENCODING));
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::keep_alive() const NOEXCEPT
+    {
+      return !is_http_1_0_or_earlier() &&
+             !field_value::is_close(find(header_field::id::CONNECTION));
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::missing_host_header() const NOEXCEPT
+    {
+      return major_version_ == '1' &&
+             minor_version_ == '1' &&
+             find(header_field::id::HOST).empty();
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    bool rx_request_view::expect_continue() const NOEXCEPT
+    {
+      return !is_http_1_0_or_earlier() &&
+             field_value::is_continue(find(header_field::id::EXPECT));
+    }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
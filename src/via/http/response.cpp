@@ -8,6 +8,7 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/response.hpp"
 #include "via/http/character.hpp"
+#include <stdexcept>
 
 namespace via
 {
@@ -206,5 +207,50 @@ namespace via
       return output;
     }
     //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    response_template::response_template(tx_response const& response,
+                                         bool add_date) :
+      header_1_0_(),
+      header_1_1_(),
+      add_date_(add_date),
+      add_content_length_(false),
+      is_chunked_(response.is_chunked())
+    {
+      if (!response.is_valid())
+        throw std::invalid_argument("response_template: split headers");
+
+      tx_response versioned(response);
+      versioned.set_major_version('1');
+      versioned.set_minor_version('0');
+      header_1_0_ = versioned.to_string() + response.header_string();
+      versioned.set_minor_version('1');
+      header_1_1_ = versioned.to_string() + response.header_string();
+
+      // A Content-Length header is required unless one has been given, a
+      // tranfer encoding is being applied or content is not permitted
+      std::string const& header_string(response.header_string());
+      bool no_content_length(std::string::npos == header_string.find
+            (header_field::standard_name(header_field::id::CONTENT_LENGTH)));
+      add_content_length_ = no_content_length && !is_chunked_ &&
+                            response_status::content_permitted(response.status());
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    std::string response_template::dynamic_header(size_t content_length,
+                                         std::string const& header_string) const
+    {
+      std::string output;
+      output.reserve(64 + header_string.size());
+      if (add_date_)
+        header_field::append_date_header(output);
+      output += header_string;
+      if (add_content_length_)
+        output += header_field::content_length(content_length);
+      output += CRLF;
+      return output;
+    }
+    //////////////////////////////////////////////////////////////////////////
   }
 }
@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file response_cache.cpp
+/// @brief Classes and functions to cache HTTP responses.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/response_cache.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace
+{
+  /// Remove the leading and trailing whitespace from a string.
+  /// @param value the string.
+  /// @return the string without leading or trailing whitespace.
+  std::string trim(std::string const& value)
+  {
+    size_t const first(value.find_first_not_of(" \t"));
+    if (first == std::string::npos)
+      return std::string();
+    size_t const last(value.find_last_not_of(" \t"));
+    return value.substr(first, last - first + 1);
+  }
+
+  /// Convert a string to lower case.
+  /// @param value the string.
+  /// @return the string in lower case.
+  std::string to_lower(std::string value)
+  {
+    for (auto& c : value)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return value;
+  }
+
+  /// Split a comma separated list, trimming each element.
+  /// @param list the list, e.g. a header field value.
+  /// @return the non empty elements of the list.
+  std::vector<std::string> split_list(std::string const& list)
+  {
+    std::vector<std::string> elements;
+    size_t next(0);
+    while (next < list.size())
+    {
+      size_t end(list.find(',', next));
+      if (end == std::string::npos)
+        end = list.size();
+      std::string const element(trim(list.substr(next, end - next)));
+      if (!element.empty())
+        elements.push_back(element);
+      next = end + 1;
+    }
+    return elements;
+  }
+
+  /// The opaque tag of an entity tag, i.e. without a weak indicator.
+  /// @param etag the entity tag, e.g. W/"v1".
+  /// @return the opaque tag, e.g. "v1".
+  std::string opaque_tag(std::string const& etag)
+  {
+    return ((etag.size() > 2) && (etag[0] == 'W') && (etag[1] == '/'))
+        ? etag.substr(2) : etag;
+  }
+}
+
+namespace via
+{
+  namespace http
+  {
+    namespace cache_control
+    {
+      //////////////////////////////////////////////////////////////////////
+      directives parse(std::string const& value)
+      {
+        directives result = { false, false, false, false, -1 };
+        long s_maxage(-1);
+        for (auto const& element : split_list(value))
+        {
+          // A directive and an optional argument, e.g. "max-age=60"
+          size_t const equals(element.find('='));
+          std::string const directive
+              (to_lower(trim(element.substr(0, equals))));
+          std::string argument((equals != std::string::npos)
+                                   ? trim(element.substr(equals + 1))
+                                   : std::string());
+          if ((argument.size() >= 2) && (argument.front() == '"') &&
+              (argument.back() == '"'))
+            argument = argument.substr(1, argument.size() - 2);
+
+          if (directive == "no-store")
+            result.no_store = true;
+          else if (directive == "no-cache")
+            result.no_cache = true;
+          else if (directive == "private")
+            result.is_private = true;
+          else if (directive == "public")
+            result.is_public = true;
+          else if ((directive == "max-age") && !argument.empty())
+            result.max_age = std::max(0L, std::atol(argument.c_str()));
+          else if ((directive == "s-maxage") && !argument.empty())
+            s_maxage = std::max(0L, std::atol(argument.c_str()));
+        }
+
+        // A shared cache uses s-maxage in preference to max-age
+        if (s_maxage >= 0)
+          result.max_age = s_maxage;
+        return result;
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      std::string find_header(tx_response const& response,
+                              std::string const& name)
+      {
+        std::string const headers(to_lower(response.header_string()));
+        std::string const field(to_lower(name) + ':');
+
+        // The field must be at the start of a header line
+        size_t start(headers.find(field));
+        while ((start != std::string::npos) &&
+               (start > 0) && (headers[start - 1] != '\n'))
+          start = headers.find(field, start + 1);
+        if (start == std::string::npos)
+          return std::string();
+
+        start += field.size();
+        size_t const end(headers.find('\r', start));
+        return trim(response.header_string().substr(start, end - start));
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      bool etag_matches(std::string const& if_none_match,
+                        std::string const& etag)
+      {
+        std::string const tag(opaque_tag(trim(etag)));
+        for (auto const& element : split_list(if_none_match))
+          if ((element == "*") || (opaque_tag(element) == tag))
+            return true;
+        return false;
+      }
+      //////////////////////////////////////////////////////////////////////
+
+      //////////////////////////////////////////////////////////////////////
+      std::vector<std::string> vary_fields(std::string const& vary)
+      {
+        std::vector<std::string> fields(split_list(to_lower(vary)));
+        for (auto const& field : fields)
+          if (field == "*")
+            return std::vector<std::string>(1, field);
+        return fields;
+      }
+      //////////////////////////////////////////////////////////////////////
+    }
+  }
+}
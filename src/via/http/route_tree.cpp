@@ -0,0 +1,190 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file route_tree.cpp
+/// @brief A radix tree of uri route paths.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/route_tree.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace via
+{
+  namespace http
+  {
+    const size_t route_parameters::MAX_PARAMETERS;
+    const size_t route_tree::NOT_FOUND;
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t route_tree::insert_static(size_t parent, const char* begin,
+                                     size_t length)
+    {
+      while (length > 0)
+      {
+        size_t const i(nodes_[parent].first_chars.find(*begin));
+        if (i == std::string::npos)
+        {
+          // A new static node for the rest of the characters
+          node child;
+          child.label.assign(begin, length);
+          nodes_.push_back(child);
+          size_t const child_index(nodes_.size() - 1);
+          nodes_[parent].first_chars += *begin;
+          nodes_[parent].children.push_back(child_index);
+          return child_index;
+        }
+
+        size_t child_index(nodes_[parent].children[i]);
+        std::string const& label(nodes_[child_index].label);
+        size_t const max_common(std::min(label.size(), length));
+        size_t common(1);
+        while ((common < max_common) && (label[common] == begin[common]))
+          ++common;
+
+        // Split the child if only part of its label matches
+        if (common < label.size())
+        {
+          node prefix;
+          prefix.label = label.substr(0, common);
+          prefix.first_chars = label[common];
+          prefix.children.push_back(child_index);
+          nodes_[child_index].label.erase(0, common);
+
+          nodes_.push_back(prefix);
+          child_index = nodes_.size() - 1;
+          nodes_[parent].children[i] = child_index;
+        }
+
+        parent = child_index;
+        begin  += common;
+        length -= common;
+      }
+
+      return parent;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t route_tree::insert(std::string const& path, size_t route)
+    {
+      std::vector<std::string> names;
+      size_t current(0);
+      size_t pos(0);
+      while (pos < path.size())
+      {
+        if (':' == path[pos])
+        {
+          // A parameter continues up to the next '/'
+          size_t const name_end(std::min(path.find('/', pos), path.size()));
+          names.push_back(path.substr(pos + 1, name_end - pos - 1));
+          if (names.size() > route_parameters::MAX_PARAMETERS)
+            throw std::invalid_argument("route_tree: too many parameters in "
+                                        + path);
+
+          if (!nodes_[current].parameter)
+          {
+            nodes_.push_back(node());
+            nodes_[current].parameter = nodes_.size() - 1;
+          }
+          current = nodes_[current].parameter;
+          pos = name_end;
+        }
+        else
+        {
+          size_t const static_end(std::min(path.find(':', pos), path.size()));
+          current = insert_static(current, path.data() + pos,
+                                  static_end - pos);
+          pos = static_end;
+        }
+      }
+
+      node& terminal(nodes_[current]);
+      if (NOT_FOUND == terminal.route)
+      {
+        terminal.route = route;
+        terminal.path  = path;
+        terminal.names.swap(names);
+      }
+      else if (terminal.path != path)
+        throw std::invalid_argument("route_tree: " + path +
+                                    " conflicts with " + terminal.path);
+
+      return terminal.route;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t route_tree::match(size_t index, const char* iter, const char* end,
+                             route_parameters& parameters) const NOEXCEPT
+    {
+      node const& current(nodes_[index]);
+      if (iter == end)
+      {
+        if (NOT_FOUND != current.route)
+          return index;
+      }
+      else
+      {
+        // Try the static child that starts with the next character
+        size_t const i(current.first_chars.find(*iter));
+        if (i != std::string::npos)
+        {
+          size_t const child_index(current.children[i]);
+          std::string const& label(nodes_[child_index].label);
+          if ((static_cast<size_t>(end - iter) >= label.size()) &&
+              !std::memcmp(iter, label.data(), label.size()))
+          {
+            size_t const result(match(child_index, iter + label.size(), end,
+                                      parameters));
+            if (NOT_FOUND != result)
+              return result;
+          }
+        }
+      }
+
+      // Otherwise try the parameter child with the rest of the segment,
+      // a parameter must not be empty
+      if (current.parameter && (iter != end) && (*iter != '/'))
+      {
+        const char* slash(static_cast<const char*>
+                            (std::memchr(iter, '/', end - iter)));
+        const char* const segment_end(slash ? slash : end);
+        parameters.push_back(route_parameters::value_type
+                     (string_view(), string_view(iter, segment_end - iter)));
+        size_t const result(match(current.parameter, segment_end, end,
+                                  parameters));
+        if (NOT_FOUND != result)
+          return result;
+        parameters.pop_back();
+      }
+
+      return NOT_FOUND;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t route_tree::find(string_view path,
+                            route_parameters& parameters) const NOEXCEPT
+    {
+      parameters.clear();
+      size_t const index(match(0, path.data(), path.data() + path.size(),
+                               parameters));
+      if (NOT_FOUND == index)
+        return NOT_FOUND;
+
+      // Name the parameter values
+      node const& terminal(nodes_[index]);
+      for (size_t i(0); i < parameters.size(); ++i)
+        parameters[i].first = terminal.names[i];
+
+      return terminal.route;
+    }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
@@ -0,0 +1,310 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/scanner.hpp"
+
+#if !defined(VIA_HTTPLIB_NO_SIMD) && \
+    (defined(__x86_64__) || defined(__i386__) || \
+     defined(_M_X64) || defined(_M_IX86))
+#define VIA_HTTPLIB_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef VIA_HTTPLIB_X86_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+#define VIA_TARGET_SSE4_2 __attribute__((target("sse4.2")))
+#define VIA_TARGET_AVX2   __attribute__((target("avx2")))
+#else
+#define VIA_TARGET_SSE4_2
+#define VIA_TARGET_AVX2
+#endif
+#endif
+
+namespace
+{
+  using via::http::scanner;
+  using via::http::simd_level;
+
+  //////////////////////////////////////////////////////////////////////////
+  // Scalar functions, also used for the tails of the vectorised functions.
+
+  /// Whether a character is a letter or '-'.
+  inline bool is_name_char(char c) NOEXCEPT
+  {
+    unsigned char lower(static_cast<unsigned char>(c | 0x20));
+    return (('a' <= lower) && (lower <= 'z')) || ('-' == c);
+  }
+
+  const char* scalar_find_ws_or_eol(const char* begin, const char* end)
+  {
+    for (; begin != end; ++begin)
+    {
+      char c(*begin);
+      if ((' ' == c) || ('\t' == c) || ('\r' == c) || ('\n' == c))
+        break;
+    }
+    return begin;
+  }
+
+  const char* scalar_find_eol(const char* begin, const char* end)
+  {
+    for (; begin != end; ++begin)
+    {
+      if (('\r' == *begin) || ('\n' == *begin))
+        break;
+    }
+    return begin;
+  }
+
+  const char* scalar_find_not_name(const char* begin, const char* end)
+  {
+    for (; begin != end; ++begin)
+    {
+      if (!is_name_char(*begin))
+        break;
+    }
+    return begin;
+  }
+
+#ifdef VIA_HTTPLIB_X86_SIMD
+  //////////////////////////////////////////////////////////////////////////
+  // x86 run time detection.
+
+  /// The index of the lowest set bit.
+  /// @pre mask != 0
+  inline unsigned lowest_bit(unsigned mask) NOEXCEPT
+  {
+#ifdef _MSC_VER
+    unsigned long index(0);
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+  }
+
+  /// Detect the highest simd_level supported by the processor.
+  simd_level detect_simd_level() NOEXCEPT
+  {
+#ifdef _MSC_VER
+    int info[4] = { 0, 0, 0, 0 };
+    __cpuid(info, 0);
+    int const max_id(info[0]);
+    __cpuid(info, 1);
+    bool const sse4_2((info[2] & (1 << 20)) != 0);
+    bool const osxsave((info[2] & (1 << 27)) != 0);
+    bool avx2(false);
+    if (osxsave && (max_id >= 7))
+    {
+      // the OS must save the AVX registers
+      bool const ymm_saved((_xgetbv(0) & 0x6) == 0x6);
+      __cpuidex(info, 7, 0);
+      avx2 = ymm_saved && ((info[1] & (1 << 5)) != 0);
+    }
+#else
+    __builtin_cpu_init();
+    bool const sse4_2(__builtin_cpu_supports("sse4.2") != 0);
+    bool const avx2(__builtin_cpu_supports("avx2") != 0);
+#endif
+    if (avx2)
+      return simd_level::AVX2;
+    if (sse4_2)
+      return simd_level::SSE4_2;
+    return simd_level::SCALAR;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // SSE4.2 functions, using the string comparison instructions.
+
+  /// The string comparison mode to find any of a set of characters.
+  const int SSE_EQUAL_ANY(_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                          _SIDD_LEAST_SIGNIFICANT);
+
+  /// The string comparison mode to find a character outside of ranges.
+  const int SSE_NOT_RANGES(_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                           _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+
+  VIA_TARGET_SSE4_2
+  const char* sse4_2_find_ws_or_eol(const char* begin, const char* end)
+  {
+    __m128i const set(_mm_setr_epi8(' ', '\t', '\r', '\n', 0, 0, 0, 0,
+                                    0, 0, 0, 0, 0, 0, 0, 0));
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i const data
+        (_mm_loadu_si128(reinterpret_cast<__m128i const*>(begin)));
+      int const index(_mm_cmpestri(set, 4, data, 16, SSE_EQUAL_ANY));
+      if (index < 16)
+        return begin + index;
+    }
+    return scalar_find_ws_or_eol(begin, end);
+  }
+
+  VIA_TARGET_SSE4_2
+  const char* sse4_2_find_eol(const char* begin, const char* end)
+  {
+    __m128i const set(_mm_setr_epi8('\r', '\n', 0, 0, 0, 0, 0, 0,
+                                    0, 0, 0, 0, 0, 0, 0, 0));
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i const data
+        (_mm_loadu_si128(reinterpret_cast<__m128i const*>(begin)));
+      int const index(_mm_cmpestri(set, 2, data, 16, SSE_EQUAL_ANY));
+      if (index < 16)
+        return begin + index;
+    }
+    return scalar_find_eol(begin, end);
+  }
+
+  VIA_TARGET_SSE4_2
+  const char* sse4_2_find_not_name(const char* begin, const char* end)
+  {
+    __m128i const ranges(_mm_setr_epi8('A', 'Z', 'a', 'z', '-', '-', 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0));
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i const data
+        (_mm_loadu_si128(reinterpret_cast<__m128i const*>(begin)));
+      int const index(_mm_cmpestri(ranges, 6, data, 16, SSE_NOT_RANGES));
+      if (index < 16)
+        return begin + index;
+    }
+    return scalar_find_not_name(begin, end);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // AVX2 functions, using byte comparisons 32 bytes at a time.
+
+  VIA_TARGET_AVX2
+  const char* avx2_find_ws_or_eol(const char* begin, const char* end)
+  {
+    __m256i const sp(_mm256_set1_epi8(' '));
+    __m256i const ht(_mm256_set1_epi8('\t'));
+    __m256i const cr(_mm256_set1_epi8('\r'));
+    __m256i const lf(_mm256_set1_epi8('\n'));
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i const data
+        (_mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin)));
+      __m256i const found
+        (_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(data, sp),
+                                         _mm256_cmpeq_epi8(data, ht)),
+                         _mm256_or_si256(_mm256_cmpeq_epi8(data, cr),
+                                         _mm256_cmpeq_epi8(data, lf))));
+      unsigned const mask(static_cast<unsigned>(_mm256_movemask_epi8(found)));
+      if (mask)
+        return begin + lowest_bit(mask);
+    }
+    return sse4_2_find_ws_or_eol(begin, end);
+  }
+
+  VIA_TARGET_AVX2
+  const char* avx2_find_eol(const char* begin, const char* end)
+  {
+    __m256i const cr(_mm256_set1_epi8('\r'));
+    __m256i const lf(_mm256_set1_epi8('\n'));
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i const data
+        (_mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin)));
+      __m256i const found(_mm256_or_si256(_mm256_cmpeq_epi8(data, cr),
+                                          _mm256_cmpeq_epi8(data, lf)));
+      unsigned const mask(static_cast<unsigned>(_mm256_movemask_epi8(found)));
+      if (mask)
+        return begin + lowest_bit(mask);
+    }
+    return sse4_2_find_eol(begin, end);
+  }
+
+  VIA_TARGET_AVX2
+  const char* avx2_find_not_name(const char* begin, const char* end)
+  {
+    __m256i const case_bit(_mm256_set1_epi8(0x20));
+    __m256i const lower_a(_mm256_set1_epi8('a'));
+    __m256i const letters(_mm256_set1_epi8('z' - 'a'));
+    __m256i const dash(_mm256_set1_epi8('-'));
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i const data
+        (_mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin)));
+      // a letter if (c | 0x20) - 'a' <= 'z' - 'a', unsigned
+      __m256i const offset
+        (_mm256_sub_epi8(_mm256_or_si256(data, case_bit), lower_a));
+      __m256i const is_letter
+        (_mm256_cmpeq_epi8(_mm256_min_epu8(offset, letters), offset));
+      __m256i const is_name
+        (_mm256_or_si256(is_letter, _mm256_cmpeq_epi8(data, dash)));
+      unsigned const mask
+        (~static_cast<unsigned>(_mm256_movemask_epi8(is_name)));
+      if (mask)
+        return begin + lowest_bit(mask);
+    }
+    return sse4_2_find_not_name(begin, end);
+  }
+#endif // VIA_HTTPLIB_X86_SIMD
+
+  /// The scalar scanner.
+  const scanner SCALAR_SCANNER =
+    { scalar_find_ws_or_eol, scalar_find_eol, scalar_find_not_name };
+
+#ifdef VIA_HTTPLIB_X86_SIMD
+  /// The SSE4.2 scanner.
+  const scanner SSE4_2_SCANNER =
+    { sse4_2_find_ws_or_eol, sse4_2_find_eol, sse4_2_find_not_name };
+
+  /// The AVX2 scanner.
+  const scanner AVX2_SCANNER =
+    { avx2_find_ws_or_eol, avx2_find_eol, avx2_find_not_name };
+#endif
+}
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    simd_level supported_simd_level() NOEXCEPT
+    {
+#ifdef VIA_HTTPLIB_X86_SIMD
+      static const simd_level level(detect_simd_level());
+      return level;
+#else
+      return simd_level::SCALAR;
+#endif
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    scanner const& scanner::instance(simd_level level) NOEXCEPT
+    {
+      switch (level)
+      {
+#ifdef VIA_HTTPLIB_X86_SIMD
+      case simd_level::AVX2:
+        return AVX2_SCANNER;
+      case simd_level::SSE4_2:
+        return SSE4_2_SCANNER;
+#endif
+      default:
+        return SCALAR_SCANNER;
+      }
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    scanner const& scanner::instance() NOEXCEPT
+    {
+      static scanner const& best(instance(supported_simd_level()));
+      return best;
+    }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
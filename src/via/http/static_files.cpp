@@ -0,0 +1,326 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Ken Barker
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+/// @file static_files.cpp
+/// @brief Contains the static_files class.
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/static_files.hpp"
+#include <cctype>
+
+namespace
+{
+  /// The value of a hexadecimal digit.
+  /// @param c the character.
+  /// @return the value of the digit, -1 if it isn't a hexadecimal digit.
+  int hex_digit(char c) NOEXCEPT
+  {
+    if ((c >= '0') && (c <= '9'))
+      return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+      return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  /// Decode a percent encoded uri path into a relative file path.
+  /// It rejects paths that could escape the directory or name a hidden
+  /// file, i.e. paths containing a segment that starts with a '.', a '\'
+  /// or a NUL character.
+  /// @param path the uri path.
+  /// @retval file_path the relative file path.
+  /// @return true if the path is valid, false otherwise.
+  bool decode_path(std::string const& path, std::string& file_path)
+  {
+    file_path.clear();
+    for (size_t i(0); i < path.size(); ++i)
+    {
+      char c(path[i]);
+      if (c == '%')
+      {
+        int const high((i + 2 < path.size()) ? hex_digit(path[i + 1]) : -1);
+        int const low ((i + 2 < path.size()) ? hex_digit(path[i + 2]) : -1);
+        if ((high < 0) || (low < 0))
+          return false;
+        c = static_cast<char>((high << 4) | low);
+        i += 2;
+      }
+
+      if ((c == '\0') || (c == '\\'))
+        return false;
+
+      bool const segment_start(file_path.empty() || (file_path.back() == '/'));
+      if (segment_start && ((c == '.') || (c == '/')))
+      {
+        // ignore empty segments, e.g. a leading '/'
+        if (c == '.')
+          return false;
+      }
+      else
+        file_path.push_back(c);
+    }
+
+    return true;
+  }
+
+  /// The result of parsing a Range header.
+  enum class range_result
+  {
+    WHOLE_FILE,      ///< not a single byte range, send the whole file
+    UNSATISFIABLE,   ///< the range is outside of the file
+    SATISFIABLE      ///< the range is valid
+  };
+
+  /// Read a decimal number.
+  /// @param value the string.
+  /// @retval next the position in the string, after the number.
+  /// @retval number the number.
+  /// @return true if a number was read, false otherwise.
+  bool read_number(std::string const& value, size_t& next,
+                   std::uint64_t& number) NOEXCEPT
+  {
+    size_t const start(next);
+    number = 0;
+    for (; (next < value.size()) &&
+           std::isdigit(static_cast<unsigned char>(value[next])); ++next)
+    {
+      // limit the number of digits so that it can't overflow
+      if (next - start >= 18)
+        return false;
+      number = 10 * number + static_cast<std::uint64_t>(value[next] - '0');
+    }
+    return next > start;
+  }
+
+  /// Parse a Range header value containing a single byte range.
+  /// @param value the Range header value.
+  /// @param size the size of the file.
+  /// @retval first the position of the first byte of the range.
+  /// @retval last the position of the last byte of the range.
+  /// @return whether the range is satisfiable, unsatisfiable or ignored.
+  range_result parse_range(std::string const& value, std::uint64_t size,
+                           std::uint64_t& first, std::uint64_t& last) NOEXCEPT
+  {
+    static const std::string BYTES("bytes=");
+    if (value.compare(0, BYTES.size(), BYTES) != 0)
+      return range_result::WHOLE_FILE;
+
+    size_t next(BYTES.size());
+    bool const is_suffix((next < value.size()) && (value[next] == '-'));
+    if (is_suffix)
+    {
+      // "bytes=-N": the last N bytes
+      std::uint64_t length(0);
+      if (!read_number(value, ++next, length) || (next != value.size()))
+        return range_result::WHOLE_FILE;
+      if ((length == 0) || (size == 0))
+        return range_result::UNSATISFIABLE;
+
+      first = (length < size) ? size - length : 0;
+      last  = size - 1;
+      return range_result::SATISFIABLE;
+    }
+
+    // "bytes=F-" or "bytes=F-L"
+    if (!read_number(value, next, first) ||
+        (next >= value.size()) || (value[next] != '-'))
+      return range_result::WHOLE_FILE;
+
+    last = size - 1;
+    if (++next < value.size())
+    {
+      std::uint64_t end(0);
+      if (!read_number(value, next, end) || (next != value.size()) ||
+          (end < first))
+        return range_result::WHOLE_FILE;
+      if (end < last)
+        last = end;
+    }
+
+    return (first < size) ? range_result::SATISFIABLE
+                          : range_result::UNSATISFIABLE;
+  }
+}
+
+namespace via
+{
+  namespace http
+  {
+    //////////////////////////////////////////////////////////////////////////
+    static_files::static_files(std::string const& directory,
+                               size_t max_open_files) :
+      directory_(directory),
+      index_file_("index.html"),
+      content_types_(),
+      cache_(max_open_files)
+    {
+      // Remove any trailing '/', the file path is appended after a '/'
+      while ((directory_.size() > 1) && (directory_.back() == '/'))
+        directory_.erase(directory_.size() - 1);
+
+      set_content_type("html",  "text/html; charset=utf-8");
+      set_content_type("htm",   "text/html; charset=utf-8");
+      set_content_type("css",   "text/css; charset=utf-8");
+      set_content_type("js",    "application/javascript");
+      set_content_type("json",  "application/json");
+      set_content_type("txt",   "text/plain; charset=utf-8");
+      set_content_type("xml",   "application/xml");
+      set_content_type("svg",   "image/svg+xml");
+      set_content_type("png",   "image/png");
+      set_content_type("jpg",   "image/jpeg");
+      set_content_type("jpeg",  "image/jpeg");
+      set_content_type("gif",   "image/gif");
+      set_content_type("ico",   "image/x-icon");
+      set_content_type("webp",  "image/webp");
+      set_content_type("pdf",   "application/pdf");
+      set_content_type("wasm",  "application/wasm");
+      set_content_type("woff",  "font/woff");
+      set_content_type("woff2", "font/woff2");
+      set_content_type("mp4",   "video/mp4");
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    void static_files::set_content_type(std::string const& extension,
+                                        std::string const& content_type)
+    {
+      std::string lowercase(extension);
+      for (auto& c : lowercase)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      content_types_[lowercase] = content_type;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    std::string const& static_files::content_type(std::string const& path) const
+    {
+      static const std::string DEFAULT_CONTENT_TYPE("application/octet-stream");
+
+      size_t const dot(path.find_last_of("./"));
+      if ((dot == std::string::npos) || (path[dot] != '.'))
+        return DEFAULT_CONTENT_TYPE;
+
+      std::string extension(path.substr(dot + 1));
+      for (auto& c : extension)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      std::map<std::string, std::string>::const_iterator iter
+          (content_types_.find(extension));
+      return (iter != content_types_.end()) ? iter->second
+                                            : DEFAULT_CONTENT_TYPE;
+    }
+    //////////////////////////////////////////////////////////////////////////
+
+    //////////////////////////////////////////////////////////////////////////
+    static_files::file_response static_files::respond
+                              (rx_request const& request, std::string const& path)
+    {
+      file_response result = { tx_response(response_status::code::OK),
+                               comms::file_segment() };
+
+      if ((request.method_id() != request_method::id::GET) &&
+          (request.method_id() != request_method::id::HEAD))
+      {
+        result.response = tx_response(response_status::code::METHOD_NOT_ALLOWED);
+        result.response.add_header(header_field::id::ALLOW, "GET, HEAD");
+        return result;
+      }
+
+      std::string file_path;
+      if (!decode_path(path, file_path))
+      {
+        result.response = tx_response(response_status::code::NOT_FOUND);
+        return result;
+      }
+      if (file_path.empty() || (file_path.back() == '/'))
+        file_path += index_file_;
+
+      boost::system::error_code error;
+      std::shared_ptr<comms::file_handle const> file
+          (cache_.open(directory_ + '/' + file_path, error));
+      if (!file)
+      {
+        if (error == boost::system::errc::permission_denied)
+          result.response = tx_response(response_status::code::FORBIDDEN);
+        else if ((error == boost::system::errc::no_such_file_or_directory) ||
+                 (error == boost::system::errc::is_a_directory) ||
+                 (error == boost::system::errc::not_a_directory))
+          result.response = tx_response(response_status::code::NOT_FOUND);
+        else
+          result.response =
+              tx_response(response_status::code::INTERNAL_SERVER_ERROR);
+        return result;
+      }
+
+      char last_modified[header_field::DATE_LENGTH];
+      header_field::format_date(file->last_modified(), last_modified);
+      std::string const last_modified_date(last_modified,
+                                           header_field::DATE_LENGTH);
+
+      // A conditional GET for a file that hasn't been modified
+      std::string const& if_modified_since
+          (request.headers().find(header_field::id::IF_MODIFIED_SINCE));
+      if (!if_modified_since.empty())
+      {
+        std::time_t const since(header_field::parse_date(if_modified_since));
+        if ((since >= 0) && (file->last_modified() <= since))
+        {
+          result.response = tx_response(response_status::code::NOT_MODIFIED);
+          result.response.add_header(header_field::id::LAST_MODIFIED,
+                                     last_modified_date);
+          return result;
+        }
+      }
+
+      result.body.file   = file;
+      result.body.offset = 0;
+      result.body.length = file->size();
+
+      // A partial GET, unless If-Range shows that the file has changed
+      std::string const& range(request.headers().find(header_field::id::RANGE));
+      std::string const& if_range
+          (request.headers().find(header_field::id::IF_RANGE));
+      if (!range.empty() &&
+          (if_range.empty() || (if_range == last_modified_date)))
+      {
+        std::uint64_t first(0);
+        std::uint64_t last(0);
+        switch (parse_range(range, file->size(), first, last))
+        {
+        case range_result::UNSATISFIABLE:
+          result.response =
+              tx_response(response_status::code::REQUEST_RANGE_NOT_SATISFIABLE);
+          result.response.add_header(header_field::id::CONTENT_RANGE,
+                            "bytes */" + std::to_string(file->size()));
+          result.body = comms::file_segment();
+          return result;
+
+        case range_result::SATISFIABLE:
+          result.response = tx_response(response_status::code::PARTIAL_CONTENT);
+          result.response.add_header(header_field::id::CONTENT_RANGE,
+                            "bytes " + std::to_string(first) + "-" +
+                            std::to_string(last) + "/" +
+                            std::to_string(file->size()));
+          result.body.offset = first;
+          result.body.length = last - first + 1;
+          break;
+
+        default:
+          break;
+        }
+      }
+
+      result.response.add_header(header_field::id::CONTENT_TYPE,
+                                 content_type(file_path));
+      result.response.add_header(header_field::id::LAST_MODIFIED,
+                                 last_modified_date);
+      result.response.add_header(header_field::id::ACCEPT_RANGES, "bytes");
+      return result;
+    }
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
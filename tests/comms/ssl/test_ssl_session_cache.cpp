@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/ssl/ssl_session_cache.hpp"
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+using namespace via::comms::ssl;
+
+namespace
+{
+  /// A client SSL connection and a session to store in the cache.
+  struct session_fixture
+  {
+    boost::asio::ssl::context context;
+    SSL* ssl;
+    SSL_SESSION* session;
+
+    session_fixture() :
+      context(boost::asio::ssl::context::tlsv12_client),
+      ssl(SSL_new(context.native_handle())),
+      session(new_session("session-1"))
+    {
+      BOOST_REQUIRE(ssl);
+      BOOST_REQUIRE(session);
+    }
+
+    ~session_fixture()
+    {
+      SSL_SESSION_free(session);
+      SSL_free(ssl);
+    }
+
+    /// Create a TLS 1.2 session with an id.
+    /// @param id the session id.
+    /// @return the session, null if it couldn't be created.
+    SSL_SESSION* new_session(std::string const& id) const
+    {
+      // TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256
+      unsigned char const cipher_id[2] = { 0xC0, 0x2F };
+      unsigned char const key[48] = { 1, 2, 3 };
+      SSL_SESSION* new_session(SSL_SESSION_new());
+      if (new_session &&
+          SSL_SESSION_set_protocol_version(new_session, TLS1_2_VERSION) &&
+          SSL_SESSION_set_cipher(new_session,
+                                 SSL_CIPHER_find(ssl, cipher_id)) &&
+          SSL_SESSION_set1_id(new_session,
+              reinterpret_cast<unsigned char const*>(id.data()),
+              static_cast<unsigned int>(id.size())) &&
+          SSL_SESSION_set1_master_key(new_session, key, sizeof(key)))
+        return new_session;
+
+      SSL_SESSION_free(new_session);
+      return 0;
+    }
+
+    /// The id of the session set on the SSL connection, if any.
+    std::string session_id() const
+    {
+      SSL_SESSION const* current(SSL_get_session(ssl));
+      if (!current)
+        return std::string();
+
+      unsigned int length(0);
+      unsigned char const* id(SSL_SESSION_get_id(current, &length));
+      return std::string(reinterpret_cast<char const*>(id), length);
+    }
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestSslSessionCache, session_fixture)
+
+BOOST_AUTO_TEST_CASE(StoreResume1)
+{
+  ssl_session_cache cache;
+  BOOST_CHECK(!cache.resume("host:443", ssl));
+  BOOST_CHECK(session_id().empty());
+
+  cache.store("host:443", session);
+  BOOST_CHECK_EQUAL(1u, cache.size());
+  BOOST_CHECK(!cache.resume("host:8443", ssl));
+  BOOST_CHECK(cache.resume("host:443", ssl));
+  BOOST_CHECK_EQUAL("session-1", session_id());
+
+  // A stored session replaces the previous session of the host
+  SSL_SESSION* second(new_session("session-2"));
+  BOOST_REQUIRE(second);
+  cache.store("host:443", second);
+  SSL_SESSION_free(second);
+  BOOST_CHECK_EQUAL(1u, cache.size());
+  BOOST_CHECK(cache.resume("host:443", ssl));
+  BOOST_CHECK_EQUAL("session-2", session_id());
+
+  cache.remove("host:443");
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  BOOST_CHECK(!cache.resume("host:443", ssl));
+}
+
+BOOST_AUTO_TEST_CASE(Eviction1)
+{
+  ssl_session_cache cache(2);
+  cache.store("a:443", session);
+  cache.store("b:443", session);
+  cache.store("c:443", session);
+  BOOST_CHECK_EQUAL(2u, cache.size());
+  BOOST_CHECK(cache.resume("c:443", ssl));
+
+  cache.set_max_sessions(1);
+  BOOST_CHECK_EQUAL(1u, cache.size());
+
+  // Zero disables the cache
+  cache.set_max_sessions(0);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  cache.store("a:443", session);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  BOOST_CHECK(!cache.resume("a:443", ssl));
+
+  cache.set_max_sessions(2);
+  cache.store("a:443", session);
+  cache.clear();
+  BOOST_CHECK_EQUAL(0u, cache.size());
+}
+
+BOOST_AUTO_TEST_CASE(Counters1)
+{
+  ssl_session_cache cache;
+  cache.count_handshake(false, true);
+  cache.count_handshake(false, false);
+  cache.count_handshake(false, false);
+  cache.count_handshake(true, true);
+  cache.count_handshake(true, true);
+  cache.count_handshake(true, false);
+  BOOST_CHECK_EQUAL(1u, cache.client_hits());
+  BOOST_CHECK_EQUAL(2u, cache.client_misses());
+  BOOST_CHECK_EQUAL(2u, cache.server_hits());
+  BOOST_CHECK_EQUAL(1u, cache.server_misses());
+
+  cache.reset_counters();
+  BOOST_CHECK_EQUAL(0u, cache.client_hits());
+  BOOST_CHECK_EQUAL(0u, cache.client_misses());
+  BOOST_CHECK_EQUAL(0u, cache.server_hits());
+  BOOST_CHECK_EQUAL(0u, cache.server_misses());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
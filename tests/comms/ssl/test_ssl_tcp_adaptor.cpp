@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/ssl/ssl_tcp_adaptor.hpp"
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <string>
+
+using namespace via::comms::ssl;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestSslTcpAdaptor)
+
+BOOST_AUTO_TEST_CASE(ContextSessionCache1)
+{
+  // A server's own context is configured separately from the default
+  ssl_tcp_adaptor::context_pointer context(ssl_tcp_adaptor::create_context());
+  SSL_CTX* ssl_ctx(context->native_handle());
+  ssl_tcp_adaptor::set_session_cache(*context, 5, 60, false);
+  BOOST_CHECK_EQUAL(5, SSL_CTX_sess_get_cache_size(ssl_ctx));
+  BOOST_CHECK_EQUAL(60, SSL_CTX_get_timeout(ssl_ctx));
+  BOOST_CHECK(SSL_CTX_get_options(ssl_ctx) & SSL_OP_NO_TICKET);
+  BOOST_CHECK(SSL_CTX_get_session_cache_mode(ssl_ctx) & SSL_SESS_CACHE_SERVER);
+  BOOST_CHECK(!(SSL_CTX_get_options(ssl_tcp_adaptor::ssl_context().native_handle())
+                & SSL_OP_NO_TICKET));
+
+  ssl_tcp_adaptor::set_session_cache(*context, 0);
+  BOOST_CHECK_EQUAL(SSL_SESS_CACHE_OFF, SSL_CTX_get_session_cache_mode(ssl_ctx));
+  BOOST_CHECK(!(SSL_CTX_get_options(ssl_ctx) & SSL_OP_NO_TICKET));
+}
+
+BOOST_AUTO_TEST_CASE(ContextTicketKeys1)
+{
+  ssl_tcp_adaptor::context_pointer context(ssl_tcp_adaptor::create_context());
+  SSL_CTX* ssl_ctx(context->native_handle());
+  long const key_length(SSL_CTX_get_tlsext_ticket_keys(ssl_ctx, 0, 0));
+  BOOST_CHECK_THROW(ssl_tcp_adaptor::set_session_ticket_keys(*context, "short"),
+                    std::invalid_argument);
+
+  std::string const keys(static_cast<size_t>(key_length), 'k');
+  ssl_tcp_adaptor::set_session_ticket_keys(*context, keys);
+  std::string read_keys(keys.size(), '\0');
+  BOOST_REQUIRE_EQUAL(1, SSL_CTX_get_tlsext_ticket_keys
+                           (ssl_ctx, &read_keys[0], key_length));
+  BOOST_CHECK(read_keys == keys);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/buffer_pool.hpp"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using namespace via::comms;
+
+typedef rx_buffer_pool<std::vector<char> > vector_pool;
+typedef rx_buffer_pool<std::string> string_pool;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestRxBufferPool)
+
+BOOST_AUTO_TEST_CASE(AcquireEmptyPool1)
+{
+  vector_pool pool;
+  vector_pool::buffer_pointer buffer(pool.acquire(8192));
+  BOOST_REQUIRE(buffer);
+  BOOST_CHECK_EQUAL(8192u, buffer->size());
+  BOOST_CHECK_EQUAL(0u, pool.size());
+}
+
+BOOST_AUTO_TEST_CASE(AcquireReleaseAcquire1)
+{
+  vector_pool pool;
+  vector_pool::buffer_pointer buffer(pool.acquire(8000));
+  BOOST_CHECK_EQUAL(8000u, buffer->size());
+  BOOST_CHECK(8192u <= buffer->capacity());
+
+  std::vector<char>* raw(buffer.get());
+  pool.release(buffer);
+  buffer.reset();
+  BOOST_CHECK_EQUAL(1u, pool.size());
+
+  // A smaller buffer in the same size class reuses the released buffer
+  vector_pool::buffer_pointer reused(pool.acquire(5000));
+  BOOST_CHECK_EQUAL(raw, reused.get());
+  BOOST_CHECK_EQUAL(5000u, reused->size());
+  BOOST_CHECK_EQUAL(0u, pool.size());
+}
+
+BOOST_AUTO_TEST_CASE(AcquireDifferentSizeClass1)
+{
+  string_pool pool;
+  string_pool::buffer_pointer buffer(pool.acquire(1000));
+  std::string* raw(buffer.get());
+  pool.release(buffer);
+  buffer.reset();
+
+  // A larger buffer is not taken from a smaller size class
+  string_pool::buffer_pointer larger(pool.acquire(4000));
+  BOOST_CHECK(raw != larger.get());
+  BOOST_CHECK_EQUAL(4000u, larger->size());
+  BOOST_CHECK_EQUAL(1u, pool.size());
+}
+
+BOOST_AUTO_TEST_CASE(ReleaseSmallBuffer1)
+{
+  vector_pool pool;
+  vector_pool::buffer_pointer buffer(new std::vector<char>(16, 0));
+  pool.release(buffer);
+  BOOST_CHECK_EQUAL(0u, pool.size());
+
+  pool.release(vector_pool::buffer_pointer());
+  BOOST_CHECK_EQUAL(0u, pool.size());
+}
+
+BOOST_AUTO_TEST_CASE(MaxPooledBuffers1)
+{
+  vector_pool pool(2);
+  vector_pool::buffer_pointer buffer1(pool.acquire(8192));
+  vector_pool::buffer_pointer buffer2(pool.acquire(8192));
+  vector_pool::buffer_pointer buffer3(pool.acquire(8192));
+  pool.release(buffer1);
+  pool.release(buffer2);
+  pool.release(buffer3);
+  BOOST_CHECK_EQUAL(2u, pool.size());
+
+  pool.clear();
+  BOOST_CHECK_EQUAL(0u, pool.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
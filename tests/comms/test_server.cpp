@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/tcp_adaptor.hpp"
+#include "via/comms/server.hpp"
+#include "via/metrics.hpp"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace via::comms;
+
+namespace
+{
+  typedef server<tcp_adaptor, std::string> server_type;
+
+  const unsigned short PORT = 18401;          ///< The server's port.
+  const unsigned long IDLE_TIMEOUT_MS = 200;  ///< The idle timeout.
+  const size_t FILE_SIZE = 2 * 1024 * 1024;   ///< The size of the file.
+  const size_t READ_SIZE = 16 * 1024;         ///< The size of each read.
+  const size_t PACKET_SIZE = 64 * 1024;       ///< The size of the 1st packet.
+
+  /// A server with a short idle timeout, running in its own thread, that
+  /// sends a file to each connection if it's given one.
+  /// Or, if gather is set, it sends a large packet to each connection and
+  /// queues packets and buffers while it's being written, before
+  /// disconnecting.
+  struct server_fixture
+  {
+    boost::asio::io_service io_service;
+    server_type tcp_server;
+    std::string path;      ///< The file.
+    std::string file_path; ///< The file to send, none if empty.
+    bool gather;           ///< Queue data while writing the first packet.
+    std::string buffer_c;  ///< Data sent in ConstBuffers.
+    std::string buffer_d;  ///< Data sent in ConstBuffers.
+    std::string buffer_f;  ///< Data sent in ConstBuffers.
+    /// Whether send_data(ConstBuffers) returned true while transmitting.
+    std::atomic<bool> buffers_queued;
+    std::thread thread;
+
+    server_fixture() :
+      io_service(),
+      tcp_server(io_service),
+      path("/tmp/via_test_server_XXXXXX"),
+      file_path(),
+      gather(false),
+      buffer_c("c2"),
+      buffer_d("d3"),
+      buffer_f("f5"),
+      buffers_queued(false),
+      thread()
+    {
+      int const fd(::mkstemp(&path[0]));
+      BOOST_REQUIRE(fd >= 0);
+      ::close(fd);
+      std::ofstream(path) << std::string(FILE_SIZE, 'x');
+
+      tcp_server.set_event_callback([this](int event,
+                                    std::weak_ptr<server_type::connection_type> weak_ptr)
+        { event_handler(event, weak_ptr); });
+      tcp_server.set_error_callback([](boost::system::error_code const&,
+                                    std::weak_ptr<server_type::connection_type>)
+        {});
+      tcp_server.set_connection_timeout(IDLE_TIMEOUT, IDLE_TIMEOUT_MS);
+      tcp_server.set_timer_resolution(10);
+      tcp_server.set_send_buffer_size(static_cast<int>(READ_SIZE));
+    }
+
+    ~server_fixture()
+    {
+      io_service.stop();
+      if (thread.joinable())
+        thread.join();
+      std::remove(path.c_str());
+    }
+
+    void event_handler(int event,
+                       std::weak_ptr<server_type::connection_type> weak_ptr)
+    {
+      std::shared_ptr<server_type::connection_type> connection(weak_ptr.lock());
+      if ((event == CONNECTED) && connection && !file_path.empty())
+      {
+        boost::system::error_code error;
+        file_segment segment = { via::comms::file_handle::open(file_path, error),
+                                 0, FILE_SIZE };
+        BOOST_REQUIRE(!error);
+        connection->send_data(std::move(segment));
+      }
+
+      if ((event == CONNECTED) && connection && gather)
+      {
+        connection->send_data(std::string(PACKET_SIZE, 'a'));
+
+        // queue the rest after the write of the first packet has started
+        io_service.post([this, connection]
+        {
+          connection->send_data(std::string("b1"));
+          ConstBuffers buffers;
+          buffers.push_back(boost::asio::buffer(buffer_c));
+          buffers.push_back(boost::asio::buffer(buffer_d));
+          buffers_queued = connection->send_data(buffers);
+          connection->send_data(std::string("e4"));
+          connection->send_data(boost::asio::buffer(buffer_f));
+          connection->disconnect();
+        });
+      }
+    }
+
+    /// The expected data received from a gather server.
+    static std::string gathered()
+    { return std::string(PACKET_SIZE, 'a') + "b1c2d3e4f5"; }
+
+    /// Connect to the gather server and read everything that it sends.
+    /// @retval writes the number of writes made by the server.
+    /// @return the data received.
+    std::string read_all(long long& writes)
+    {
+      via::metrics_registry& registry(via::metrics_registry::instance());
+      size_t const writes_id(registry.counter("via_comms_writes_total"));
+      long long const initial_writes(registry.counter_value(writes_id));
+
+      boost::asio::ip::tcp::socket socket(io_service);
+      socket.connect(boost::asio::ip::tcp::endpoint
+                       (boost::asio::ip::address_v4::loopback(), PORT));
+
+      std::string received;
+      std::string buffer(READ_SIZE, '\0');
+      boost::system::error_code error;
+      while (!error)
+        received.append(buffer, 0,
+                        socket.read_some(boost::asio::buffer(&buffer[0],
+                                                             buffer.size()),
+                                         error));
+
+      // the server disconnects after its last write has completed
+      writes = registry.counter_value(writes_id) - initial_writes;
+      return received;
+    }
+
+    void run()
+    {
+      BOOST_REQUIRE(!tcp_server.accept_connections(PORT, true));
+      thread = std::thread([this]{ io_service.run(); });
+    }
+
+    /// Connect to the server and read slowly until the connection is
+    /// closed or everything has been received.
+    /// @return the number of bytes received.
+    size_t read_slowly(size_t max_size)
+    {
+      boost::asio::ip::tcp::socket socket(io_service);
+      socket.open(boost::asio::ip::tcp::v4());
+      socket.set_option(boost::asio::socket_base::receive_buffer_size
+                          (static_cast<int>(READ_SIZE)));
+      socket.connect(boost::asio::ip::tcp::endpoint
+                       (boost::asio::ip::address_v4::loopback(), PORT));
+
+      std::string buffer(READ_SIZE, '\0');
+      size_t received(0);
+      boost::system::error_code error;
+      while (!error && (received < max_size))
+      {
+        received += socket.read_some(boost::asio::buffer(&buffer[0],
+                                                         buffer.size()), error);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      return received;
+    }
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestServer, server_fixture)
+
+// A connection that doesn't send or receive anything is timed out.
+BOOST_AUTO_TEST_CASE(IdleTimeout1)
+{
+  run();
+  auto const start(std::chrono::steady_clock::now());
+  BOOST_CHECK_EQUAL(0u, read_slowly(FILE_SIZE));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start <
+              std::chrono::seconds(5));
+}
+
+// A file transfer that takes longer than the idle timeout is not timed out
+// while it's progressing.
+BOOST_AUTO_TEST_CASE(IdleTimeout2)
+{
+  file_path = path;
+  run();
+  auto const start(std::chrono::steady_clock::now());
+  BOOST_CHECK_EQUAL(FILE_SIZE, read_slowly(FILE_SIZE));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start >
+              std::chrono::milliseconds(2 * IDLE_TIMEOUT_MS));
+}
+
+// Packets and buffers queued during a write are sent in order, in a single
+// gather write after it.
+BOOST_AUTO_TEST_CASE(GatherWrite1)
+{
+  gather = true;
+  tcp_server.set_connection_timeout(IDLE_TIMEOUT, 0);
+  run();
+  long long writes(0);
+  BOOST_CHECK(gathered() == read_all(writes));
+  BOOST_CHECK_EQUAL(2, writes);
+  BOOST_CHECK(buffers_queued);
+}
+
+// A gather write is limited to max_tx_buffers buffers.
+BOOST_AUTO_TEST_CASE(GatherWrite2)
+{
+  gather = true;
+  tcp_server.set_connection_timeout(IDLE_TIMEOUT, 0);
+  tcp_server.set_max_tx_buffers(3);
+  run();
+  long long writes(0);
+  BOOST_CHECK(gathered() == read_all(writes));
+  BOOST_CHECK_EQUAL(3, writes); // a, b1 c2 d3, e4 f5
+}
+
+// A gather write is limited to max_tx_bytes bytes, but a larger buffer is
+// written on its own.
+BOOST_AUTO_TEST_CASE(GatherWrite3)
+{
+  gather = true;
+  tcp_server.set_connection_timeout(IDLE_TIMEOUT, 0);
+  tcp_server.set_max_tx_bytes(5);
+  run();
+  long long writes(0);
+  BOOST_CHECK(gathered() == read_all(writes));
+  BOOST_CHECK_EQUAL(4, writes); // a, b1 c2, d3 e4, f5
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
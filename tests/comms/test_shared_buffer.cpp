@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/shared_buffer.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace via::comms;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestSharedBuffer)
+
+BOOST_AUTO_TEST_CASE(Empty1)
+{
+  shared_buffer buffer;
+  BOOST_CHECK(buffer.empty());
+  BOOST_CHECK_EQUAL(0u, buffer.size());
+  BOOST_CHECK(!buffer.owner());
+}
+
+BOOST_AUTO_TEST_CASE(Share1)
+{
+  std::string data("abcdefghijklmnopqrstuvwxyz");
+  shared_buffer buffer(shared_buffer::share(std::move(data)));
+  BOOST_CHECK_EQUAL(26u, buffer.size());
+  BOOST_CHECK_EQUAL("abcdefghijklmnopqrstuvwxyz",
+                    std::string(buffer.data(), buffer.size()));
+
+  // A copy shares the data
+  shared_buffer copy(buffer);
+  BOOST_CHECK_EQUAL(buffer.data(), copy.data());
+  BOOST_CHECK_EQUAL(2, buffer.owner().use_count());
+}
+
+BOOST_AUTO_TEST_CASE(Slice1)
+{
+  shared_buffer buffer(shared_buffer::share(std::vector<char>(10, 'a')));
+  shared_buffer part(buffer.slice(4, 3));
+  BOOST_CHECK_EQUAL(3u, part.size());
+  BOOST_CHECK_EQUAL(buffer.data() + 4, part.data());
+  BOOST_CHECK(part.owner() == buffer.owner());
+
+  // The slice is truncated to the size of the buffer
+  BOOST_CHECK_EQUAL(2u, buffer.slice(8, 100).size());
+  BOOST_CHECK(buffer.slice(20, 5).empty());
+}
+
+BOOST_AUTO_TEST_CASE(MapFile1)
+{
+  std::string path("/tmp/via_shared_buffer_XXXXXX");
+  int const fd(::mkstemp(&path[0]));
+  BOOST_REQUIRE(fd >= 0);
+  ::close(fd);
+  std::ofstream(path) << "abcdefghijklmnopqrstuvwxyz";
+
+  boost::system::error_code error;
+  shared_buffer buffer(shared_buffer::map_file(path, error));
+  std::remove(path.c_str());
+
+  // The data remains valid after the file has been removed
+  BOOST_CHECK(!error);
+  BOOST_REQUIRE_EQUAL(26u, buffer.size());
+  BOOST_CHECK_EQUAL("abcdefghijklmnopqrstuvwxyz",
+                    std::string(buffer.data(), buffer.size()));
+}
+
+BOOST_AUTO_TEST_CASE(MapFileInvalid1)
+{
+  boost::system::error_code error;
+  shared_buffer buffer(shared_buffer::map_file("/tmp/via_missing_file", error));
+  BOOST_CHECK(buffer.empty());
+  BOOST_CHECK(error == boost::system::errc::no_such_file_or_directory);
+
+  buffer = shared_buffer::map_file("/tmp", error);
+  BOOST_CHECK(buffer.empty());
+  BOOST_CHECK(error == boost::system::errc::is_a_directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
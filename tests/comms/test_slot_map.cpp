@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/slot_map.hpp"
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace via::comms;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestSlotMap)
+
+BOOST_AUTO_TEST_CASE(EmptySlotMap1)
+{
+  slot_map<std::string> values;
+  BOOST_CHECK(values.empty());
+  BOOST_CHECK_EQUAL(0u, values.size());
+  BOOST_CHECK(!values.find(slot_handle()));
+}
+
+BOOST_AUTO_TEST_CASE(InsertFind1)
+{
+  slot_map<std::string> values;
+  slot_handle one(values.insert("one"));
+  slot_handle two(values.insert("two"));
+  BOOST_CHECK(one != two);
+  BOOST_CHECK(one != slot_handle());
+  BOOST_CHECK_EQUAL(2u, values.size());
+
+  BOOST_REQUIRE(values.find(one));
+  BOOST_CHECK_EQUAL("one", *values.find(one));
+  BOOST_REQUIRE(values.find(two));
+  BOOST_CHECK_EQUAL("two", *values.find(two));
+}
+
+BOOST_AUTO_TEST_CASE(EraseStaleHandle1)
+{
+  slot_map<std::string> values;
+  slot_handle one(values.insert("one"));
+  BOOST_CHECK(values.erase(one));
+  BOOST_CHECK(values.empty());
+  BOOST_CHECK(!values.find(one));
+  BOOST_CHECK(!values.erase(one));
+
+  // The slot is reused with a new generation
+  slot_handle two(values.insert("two"));
+  BOOST_CHECK_EQUAL(one.index, two.index);
+  BOOST_CHECK(one != two);
+  BOOST_CHECK(!values.find(one));
+  BOOST_CHECK(!values.erase(one));
+  BOOST_REQUIRE(values.find(two));
+  BOOST_CHECK_EQUAL("two", *values.find(two));
+}
+
+BOOST_AUTO_TEST_CASE(EraseDestroysValue1)
+{
+  std::shared_ptr<int> value(std::make_shared<int>(1));
+  std::weak_ptr<int> weak_value(value);
+
+  slot_map<std::shared_ptr<int> > values;
+  slot_handle handle(values.insert(std::move(value)));
+  BOOST_CHECK(!weak_value.expired());
+  values.erase(handle);
+  BOOST_CHECK(weak_value.expired());
+}
+
+BOOST_AUTO_TEST_CASE(Clear1)
+{
+  slot_map<std::string> values;
+  slot_handle one(values.insert("one"));
+  slot_handle two(values.insert("two"));
+  values.clear();
+  BOOST_CHECK(values.empty());
+  BOOST_CHECK(!values.find(one));
+  BOOST_CHECK(!values.find(two));
+
+  // Old handles remain invalid after the slots are reused
+  values.insert("three");
+  values.insert("four");
+  BOOST_CHECK_EQUAL(2u, values.size());
+  BOOST_CHECK(!values.find(one));
+  BOOST_CHECK(!values.find(two));
+}
+
+BOOST_AUTO_TEST_CASE(ClearValues1)
+{
+  // The erased values are moved out, so the caller decides when they're
+  // destroyed
+  std::shared_ptr<int> value(std::make_shared<int>(1));
+  std::weak_ptr<int> weak_value(value);
+
+  slot_map<std::shared_ptr<int> > values;
+  slot_handle handle(values.insert(std::move(value)));
+  std::vector<std::shared_ptr<int> > erased;
+  values.clear(erased);
+  BOOST_CHECK(values.empty());
+  BOOST_CHECK(!values.find(handle));
+  BOOST_REQUIRE_EQUAL(1u, erased.size());
+  BOOST_CHECK(!weak_value.expired());
+
+  erased.clear();
+  BOOST_CHECK(weak_value.expired());
+  values.insert(std::make_shared<int>(2));
+  BOOST_CHECK(!values.find(handle));
+}
+
+BOOST_AUTO_TEST_CASE(ForEachErase1)
+{
+  slot_map<int> values;
+  slot_handle handles[4];
+  for (int i(0); i < 4; ++i)
+    handles[i] = values.insert(i);
+
+  // Erase every value from within for_each
+  int total(0);
+  values.for_each([&values, &handles, &total](int& value)
+  {
+    total += value;
+    values.erase(handles[value]);
+  });
+
+  BOOST_CHECK_EQUAL(6, total);
+  BOOST_CHECK(values.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/timer_wheel.hpp"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+using namespace via::comms;
+
+namespace
+{
+  /// Tick the wheel a number of times, collecting the expired handles.
+  std::vector<slot_handle> tick(timer_wheel& wheel, int ticks)
+  {
+    std::vector<slot_handle> expired;
+    for (int i(0); i < ticks; ++i)
+      wheel.tick([&expired](slot_handle const& handle)
+        { expired.push_back(handle); });
+    return expired;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestTimerWheel)
+
+BOOST_AUTO_TEST_CASE(EmptyTimerWheel1)
+{
+  timer_wheel wheel(8);
+  BOOST_CHECK(wheel.empty());
+  BOOST_CHECK(tick(wheel, 10).empty());
+  BOOST_CHECK_EQUAL(10u, wheel.current_tick());
+}
+
+BOOST_AUTO_TEST_CASE(ArmExpire1)
+{
+  timer_wheel wheel(8);
+  slot_handle one(0, 1);
+  slot_handle two(1, 1);
+  wheel.arm(one, 2);
+  wheel.arm(two, 3);
+  BOOST_CHECK_EQUAL(2u, wheel.size());
+  BOOST_CHECK(wheel.is_armed(one));
+
+  BOOST_CHECK(tick(wheel, 1).empty());
+  std::vector<slot_handle> expired(tick(wheel, 1));
+  BOOST_REQUIRE_EQUAL(1u, expired.size());
+  BOOST_CHECK(one == expired[0]);
+  BOOST_CHECK(!wheel.is_armed(one));
+
+  expired = tick(wheel, 1);
+  BOOST_REQUIRE_EQUAL(1u, expired.size());
+  BOOST_CHECK(two == expired[0]);
+  BOOST_CHECK(wheel.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Rearm1)
+{
+  timer_wheel wheel(8);
+  slot_handle one(0, 1);
+  wheel.arm(one, 2);
+  BOOST_CHECK(tick(wheel, 1).empty());
+
+  // re-arming replaces the timer
+  wheel.arm(one, 2);
+  BOOST_CHECK_EQUAL(1u, wheel.size());
+  BOOST_CHECK(tick(wheel, 1).empty());
+  BOOST_CHECK_EQUAL(1u, tick(wheel, 1).size());
+}
+
+BOOST_AUTO_TEST_CASE(LongerThanWheel1)
+{
+  timer_wheel wheel(8);
+  slot_handle one(0, 1);
+  wheel.arm(one, 20);
+  BOOST_CHECK(tick(wheel, 19).empty());
+  BOOST_CHECK(wheel.is_armed(one));
+  BOOST_CHECK_EQUAL(1u, tick(wheel, 1).size());
+}
+
+BOOST_AUTO_TEST_CASE(Cancel1)
+{
+  timer_wheel wheel(8);
+  slot_handle one(0, 1);
+  slot_handle two(1, 1);
+  wheel.arm(one, 2);
+  wheel.arm(two, 2);
+  BOOST_CHECK(wheel.cancel(one));
+  BOOST_CHECK(!wheel.cancel(one));
+
+  std::vector<slot_handle> expired(tick(wheel, 2));
+  BOOST_REQUIRE_EQUAL(1u, expired.size());
+  BOOST_CHECK(two == expired[0]);
+}
+
+BOOST_AUTO_TEST_CASE(CancelStaleHandle1)
+{
+  timer_wheel wheel(8);
+  slot_handle old_handle(0, 1);
+  slot_handle new_handle(0, 2);
+  wheel.arm(new_handle, 2);
+  BOOST_CHECK(!wheel.is_armed(old_handle));
+  BOOST_CHECK(!wheel.cancel(old_handle));
+  BOOST_CHECK(wheel.is_armed(new_handle));
+}
+
+BOOST_AUTO_TEST_CASE(ArmInTick1)
+{
+  timer_wheel wheel(8);
+  slot_handle one(0, 1);
+  wheel.arm(one, 1);
+
+  // re-arm the timer from the expiry function
+  int count(0);
+  for (int i(0); i < 4; ++i)
+    wheel.tick([&wheel, &count](slot_handle const& handle)
+    {
+      ++count;
+      wheel.arm(handle, 1);
+    });
+  BOOST_CHECK_EQUAL(4, count);
+  BOOST_CHECK(wheel.is_armed(one));
+}
+
+BOOST_AUTO_TEST_CASE(Clear1)
+{
+  timer_wheel wheel(8);
+  wheel.arm(slot_handle(0, 1), 1);
+  wheel.arm(slot_handle(1, 1), 1);
+  wheel.clear();
+  BOOST_CHECK(wheel.empty());
+  BOOST_CHECK(tick(wheel, 2).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
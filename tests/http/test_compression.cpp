@@ -0,0 +1,390 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/compression.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace via::http;
+
+namespace
+{
+  /// Decompress gzip or deflate data with zlib.
+  std::string inflate_data(std::string const& data, bool gzip)
+  {
+    z_stream stream = z_stream();
+    BOOST_REQUIRE_EQUAL(Z_OK, inflateInit2(&stream, gzip ? 15 + 16 : 15));
+    stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    std::string output;
+    int result(Z_OK);
+    while (result == Z_OK)
+    {
+      char buffer[1024];
+      stream.next_out  = reinterpret_cast<Bytef*>(buffer);
+      stream.avail_out = sizeof(buffer);
+      result = inflate(&stream, Z_NO_FLUSH);
+      output.append(buffer, sizeof(buffer) - stream.avail_out);
+      if ((result == Z_BUF_ERROR) && (stream.avail_in == 0))
+        break;
+    }
+    inflateEnd(&stream);
+    return output;
+  }
+
+  /// Some compressible text.
+  std::string const TEXT(std::string(100, 'a') + std::string(100, 'b') +
+                         "The quick brown fox jumps over the lazy dog.");
+
+  /// Make a response with a Content-Type.
+  tx_response make_response(std::string const& content_type)
+  {
+    tx_response response(response_status::code::OK);
+    response.add_header(header_field::id::CONTENT_TYPE, content_type);
+    return response;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestContentCoding)
+
+BOOST_AUTO_TEST_CASE(Negotiate1)
+{
+  std::vector<content_coding::id> const codings
+    { content_coding::GZIP, content_coding::DEFLATE };
+
+  BOOST_CHECK_EQUAL(content_coding::GZIP,
+                    content_coding::negotiate("gzip, deflate", codings));
+  BOOST_CHECK_EQUAL(content_coding::DEFLATE,
+                    content_coding::negotiate("deflate", codings));
+  BOOST_CHECK_EQUAL(content_coding::DEFLATE,
+                    content_coding::negotiate("gzip;q=0.5, deflate", codings));
+  BOOST_CHECK_EQUAL(content_coding::GZIP,
+                    content_coding::negotiate("*", codings));
+  BOOST_CHECK_EQUAL(content_coding::DEFLATE,
+                    content_coding::negotiate("GZIP; q=0, *", codings));
+  BOOST_CHECK_EQUAL(content_coding::GZIP,
+                    content_coding::negotiate("x-gzip", codings));
+}
+
+BOOST_AUTO_TEST_CASE(NegotiateIdentity1)
+{
+  std::vector<content_coding::id> const codings
+    { content_coding::GZIP, content_coding::DEFLATE };
+
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY,
+                    content_coding::negotiate("", codings));
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY,
+                    content_coding::negotiate("identity", codings));
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY,
+                    content_coding::negotiate("br, compress", codings));
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY,
+                    content_coding::negotiate("*;q=0", codings));
+}
+
+BOOST_AUTO_TEST_CASE(Find1)
+{
+  content_coding::id coding(content_coding::IDENTITY);
+  BOOST_CHECK(content_coding::find(" GZIP ", coding));
+  BOOST_CHECK_EQUAL(content_coding::GZIP, coding);
+  BOOST_CHECK(content_coding::find("x-gzip", coding));
+  BOOST_CHECK_EQUAL(content_coding::GZIP, coding);
+  BOOST_CHECK(content_coding::find("deflate", coding));
+  BOOST_CHECK_EQUAL(content_coding::DEFLATE, coding);
+  BOOST_CHECK(content_coding::find("identity", coding));
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY, coding);
+
+  BOOST_CHECK(!content_coding::find("compress", coding));
+  BOOST_CHECK(!content_coding::find("gzip, deflate", coding));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestEncoder)
+
+BOOST_AUTO_TEST_CASE(CompressGzip1)
+{
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                                 TEXT.data(), TEXT.size()));
+  BOOST_CHECK(compressed.size() < TEXT.size());
+  BOOST_CHECK_EQUAL(TEXT, inflate_data(compressed, true));
+}
+
+BOOST_AUTO_TEST_CASE(CompressDeflate1)
+{
+  std::string const compressed(encoder::compress(content_coding::DEFLATE, 9,
+                                                 TEXT.data(), TEXT.size()));
+  BOOST_CHECK(compressed.size() < TEXT.size());
+  BOOST_CHECK_EQUAL(TEXT, inflate_data(compressed, false));
+}
+
+BOOST_AUTO_TEST_CASE(EncodeStream1)
+{
+  encoder stream(content_coding::GZIP);
+  std::string compressed;
+
+  // Each part is flushed, so it can be decompressed on its own
+  stream.encode(TEXT.data(), TEXT.size(), compressed);
+  BOOST_CHECK_EQUAL(TEXT, inflate_data(compressed, true));
+
+  stream.encode(TEXT.data(), TEXT.size(), compressed);
+  stream.encode(nullptr, 0, compressed, true);
+  BOOST_CHECK(stream.finished());
+  BOOST_CHECK_EQUAL(TEXT + TEXT, inflate_data(compressed, true));
+
+  // Data after the end of the stream is ignored
+  std::string const finished(compressed);
+  stream.encode(TEXT.data(), TEXT.size(), compressed);
+  BOOST_CHECK_EQUAL(finished, compressed);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidCoding1)
+{
+  BOOST_CHECK_THROW(encoder stream(content_coding::IDENTITY),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestDecoder)
+
+BOOST_AUTO_TEST_CASE(DecodeGzip1)
+{
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                                 TEXT.data(), TEXT.size()));
+  decoder stream(content_coding::GZIP, TEXT.size());
+
+  // Decompress the data one byte at a time
+  std::vector<char> output;
+  for (size_t i(0); i < compressed.size(); ++i)
+    BOOST_REQUIRE(stream.decode(&compressed[i], 1, output));
+  BOOST_CHECK(stream.finished());
+  BOOST_CHECK_EQUAL(TEXT.size(), stream.size());
+  BOOST_CHECK_EQUAL(TEXT, std::string(output.begin(), output.end()));
+}
+
+BOOST_AUTO_TEST_CASE(DecodeDeflate1)
+{
+  std::string const large(std::string(100000, 'x') + TEXT);
+  std::string const compressed(encoder::compress(content_coding::DEFLATE, 6,
+                                                 large.data(), large.size()));
+  decoder stream(content_coding::DEFLATE, large.size());
+
+  std::string output;
+  BOOST_CHECK(stream.decode(compressed.data(), compressed.size(), output));
+  BOOST_CHECK(stream.finished());
+  BOOST_CHECK_EQUAL(large, output);
+}
+
+BOOST_AUTO_TEST_CASE(DecodeTooLarge1)
+{
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                                 TEXT.data(), TEXT.size()));
+  decoder stream(content_coding::GZIP, TEXT.size() - 1);
+
+  std::string output;
+  BOOST_CHECK(!stream.decode(compressed.data(), compressed.size(), output));
+  BOOST_CHECK(stream.too_large());
+  BOOST_CHECK(output.size() < TEXT.size());
+}
+
+BOOST_AUTO_TEST_CASE(DecodeInvalid1)
+{
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                                 TEXT.data(), TEXT.size()));
+
+  // A deflate decoder can't decode gzip data
+  decoder deflate_stream(content_coding::DEFLATE, 1000);
+  std::string output;
+  BOOST_CHECK(!deflate_stream.decode(compressed.data(), compressed.size(),
+                                     output));
+  BOOST_CHECK(!deflate_stream.too_large());
+
+  // Data after the end of the stream is invalid
+  std::string const extra(compressed + "abc");
+  decoder gzip_stream(content_coding::GZIP, 1000);
+  BOOST_CHECK(!gzip_stream.decode(extra.data(), extra.size(), output));
+
+  BOOST_CHECK_THROW(decoder stream(content_coding::BROTLI, 1000),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestCompressionCache)
+
+BOOST_AUTO_TEST_CASE(CacheHit1)
+{
+  compression_cache cache;
+  via::comms::shared_buffer const body(via::comms::shared_buffer::share(TEXT));
+  via::comms::shared_buffer const compressed
+    (cache.compress(content_coding::GZIP, 6, body));
+  BOOST_CHECK_EQUAL(TEXT, inflate_data(std::string(compressed.data(),
+                                                   compressed.size()), true));
+  BOOST_CHECK_EQUAL(1u, cache.size());
+
+  // The same body is not compressed again
+  BOOST_CHECK_EQUAL(compressed.data(),
+    cache.compress(content_coding::GZIP, 6, body).data());
+
+  // A different coding is a different entry
+  cache.compress(content_coding::DEFLATE, 6, body);
+  BOOST_CHECK_EQUAL(2u, cache.size());
+
+  // As is a different buffer with the same data
+  cache.compress(content_coding::GZIP, 6,
+                 via::comms::shared_buffer::share(TEXT));
+  BOOST_CHECK_EQUAL(3u, cache.size());
+}
+
+BOOST_AUTO_TEST_CASE(CacheFile1)
+{
+  std::string path("/tmp/via_test_compression_XXXXXX");
+  int const fd(::mkstemp(&path[0]));
+  BOOST_REQUIRE(fd >= 0);
+  ::close(fd);
+  std::ofstream(path) << TEXT;
+
+  boost::system::error_code error;
+  via::comms::file_segment const file =
+    { via::comms::file_handle::open(path, error), 0, TEXT.size() };
+  BOOST_REQUIRE(!error);
+
+  compression_cache cache;
+  via::comms::shared_buffer const compressed
+    (cache.compress(content_coding::GZIP, 6, file));
+  BOOST_CHECK_EQUAL(TEXT, inflate_data(std::string(compressed.data(),
+                                                   compressed.size()), true));
+
+  // The file is found by its identity, even if it's opened again
+  via::comms::file_segment const reopened =
+    { via::comms::file_handle::open(path, error), 0, TEXT.size() };
+  BOOST_CHECK_EQUAL(compressed.data(),
+    cache.compress(content_coding::GZIP, 6, reopened).data());
+  BOOST_CHECK_EQUAL(1u, cache.size());
+
+  // A different segment of the file is a different entry
+  via::comms::file_segment const segment = { file.file, 100, 100 };
+  via::comms::shared_buffer const part
+    (cache.compress(content_coding::GZIP, 6, segment));
+  BOOST_CHECK_EQUAL(TEXT.substr(100, 100),
+    inflate_data(std::string(part.data(), part.size()), true));
+  BOOST_CHECK_EQUAL(2u, cache.size());
+  std::remove(path.c_str());
+
+  // A segment that can't be read isn't compressed
+  via::comms::file_segment const invalid = { file.file, TEXT.size(), 100 };
+  BOOST_CHECK_EQUAL(0u,
+    cache.compress(content_coding::GZIP, 6, invalid).size());
+}
+
+BOOST_AUTO_TEST_CASE(CacheLimit1)
+{
+  compression_cache cache(TEXT.size() + 100);
+  cache.compress(content_coding::GZIP, 6,
+                 via::comms::shared_buffer::share(TEXT));
+  BOOST_CHECK_EQUAL(1u, cache.size());
+
+  // The least recently used body is removed when the cache is full
+  cache.compress(content_coding::GZIP, 6,
+                 via::comms::shared_buffer::share(TEXT + "!"));
+  BOOST_CHECK_EQUAL(1u, cache.size());
+  BOOST_CHECK(cache.bytes() <= TEXT.size() + 100);
+
+  cache.set_max_size(0);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  BOOST_CHECK_EQUAL(0u, cache.bytes());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestResponseCompression)
+
+BOOST_AUTO_TEST_CASE(IsCompressible1)
+{
+  response_compression compression;
+  BOOST_CHECK(compression.is_compressible(make_response("text/html"), 1000));
+  BOOST_CHECK(compression.is_compressible
+                (make_response("application/json; charset=utf-8"), 1000));
+  BOOST_CHECK(!compression.is_compressible(make_response("image/png"), 1000));
+  BOOST_CHECK(!compression.is_compressible(make_response("text/html"), 10));
+
+  tx_response partial(response_status::code::PARTIAL_CONTENT);
+  partial.add_header(header_field::id::CONTENT_TYPE, "text/html");
+  BOOST_CHECK(!compression.is_compressible(partial, 1000));
+
+  tx_response encoded(make_response("text/html"));
+  encoded.add_header(header_field::id::CONTENT_ENCODING, "gzip");
+  BOOST_CHECK(!compression.is_compressible(encoded, 1000));
+
+  tx_response no_transform(make_response("text/html"));
+  no_transform.add_header(header_field::id::CACHE_CONTROL, "no-transform");
+  BOOST_CHECK(!compression.is_compressible(no_transform, 1000));
+
+  // A chunked response is compressible whatever its size
+  tx_response chunked(make_response("text/plain"));
+  chunked.add_header(header_field::id::TRANSFER_ENCODING, "chunked");
+  BOOST_CHECK(compression.is_compressible(chunked, 0));
+}
+
+BOOST_AUTO_TEST_CASE(AddHeaders1)
+{
+  tx_response response(make_response("text/html"));
+  response.add_header(header_field::id::ETAG, "\"abc\"");
+  response_compression::add_headers(content_coding::GZIP, response);
+
+  std::string const& headers(response.header_string());
+  BOOST_CHECK(headers.find("ETag: W/\"abc\"\r\n") != std::string::npos);
+  BOOST_CHECK(headers.find("Content-Encoding: gzip\r\n") != std::string::npos);
+  BOOST_CHECK(headers.find("Vary: Accept-Encoding\r\n") != std::string::npos);
+
+  tx_response identity(make_response("text/html"));
+  response_compression::add_headers(content_coding::IDENTITY, identity);
+  BOOST_CHECK(identity.header_string().find("Content-Encoding")
+                == std::string::npos);
+  BOOST_CHECK(identity.header_string().find("Vary: Accept-Encoding\r\n")
+                != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(Negotiate1)
+{
+  response_compression compression;
+  compression.set_codings({ content_coding::GZIP });
+
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  std::string const data("GET / HTTP/1.1\r\nHost: h\r\n"
+                         "Accept-Encoding: gzip, deflate\r\n\r\n");
+  std::string::const_iterator next(data.begin());
+  BOOST_REQUIRE(request.parse(next, data.end()));
+
+  BOOST_CHECK_EQUAL(content_coding::GZIP,
+                    compression.negotiate(request, false));
+  BOOST_CHECK_EQUAL(content_coding::IDENTITY,
+                    compression.negotiate(request, true));
+
+  BOOST_CHECK_THROW(compression.set_codings({ content_coding::IDENTITY }),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
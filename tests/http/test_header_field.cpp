@@ -62,6 +62,58 @@ BOOST_AUTO_TEST_CASE(ToHeaderDate)
   BOOST_CHECK(!memcmp(end.c_str(), result.c_str() + 31, end.size()));
 }
 
+BOOST_AUTO_TEST_CASE(FormatDate1)
+{
+  char date[header_field::DATE_LENGTH + 1] = { 0 };
+
+  header_field::format_date(0, date);
+  BOOST_CHECK_EQUAL("Thu, 01 Jan 1970 00:00:00 GMT", date);
+
+  header_field::format_date(951868799, date);
+  BOOST_CHECK_EQUAL("Tue, 29 Feb 2000 23:59:59 GMT", date);
+
+  header_field::format_date(1443700800, date);
+  BOOST_CHECK_EQUAL("Thu, 01 Oct 2015 12:00:00 GMT", date);
+}
+
+BOOST_AUTO_TEST_CASE(ParseDate1)
+{
+  BOOST_CHECK_EQUAL(0, header_field::parse_date("Thu, 01 Jan 1970 00:00:00 GMT"));
+  BOOST_CHECK_EQUAL(951868799,
+                    header_field::parse_date("Tue, 29 Feb 2000 23:59:59 GMT"));
+  BOOST_CHECK_EQUAL(1443700800,
+                    header_field::parse_date("Thu, 01 Oct 2015 12:00:00 GMT"));
+}
+
+BOOST_AUTO_TEST_CASE(ParseDateInvalid1)
+{
+  BOOST_CHECK_EQUAL(-1, header_field::parse_date(""));
+  BOOST_CHECK_EQUAL(-1, header_field::parse_date("Thu, 01 Oct 2015 12:00:00 UTC"));
+  BOOST_CHECK_EQUAL(-1, header_field::parse_date("Thu, 01 Okt 2015 12:00:00 GMT"));
+  BOOST_CHECK_EQUAL(-1, header_field::parse_date("Thu, 01 Oct 2015 24:00:00 GMT"));
+  BOOST_CHECK_EQUAL(-1, header_field::parse_date("Thursday, 01-Oct-15 12:00:00 GMT"));
+}
+
+BOOST_AUTO_TEST_CASE(CurrentDate1)
+{
+  // The cached date is the same as the formatted current date
+  char cached[header_field::DATE_LENGTH + 1] = { 0 };
+  char formatted[header_field::DATE_LENGTH + 1] = { 0 };
+  for (int i(0); i < 2; ++i)
+  {
+    std::time_t const now(std::time(nullptr));
+    header_field::current_date(cached);
+    header_field::format_date(now, formatted);
+    if (std::time(nullptr) == now)
+      BOOST_CHECK_EQUAL(formatted, cached);
+  }
+
+  std::string header_string("Server: test\r\n");
+  header_field::append_date_header(header_string);
+  BOOST_CHECK_EQUAL(14u + 6u + header_field::DATE_LENGTH + 2u,
+                    header_string.size());
+}
+
 BOOST_AUTO_TEST_CASE(ServerHeader)
 {
   std::string line("Server: Via-httplib\r\n");
@@ -226,6 +226,33 @@ BOOST_AUTO_TEST_CASE(ValidMultiMsg2)
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestFieldValue)
+
+BOOST_AUTO_TEST_CASE(ContentLength1)
+{
+  BOOST_CHECK_EQUAL(0, field_value::content_length(""));
+  BOOST_CHECK_EQUAL(1234, field_value::content_length("1234"));
+  BOOST_CHECK_EQUAL(-1, field_value::content_length("12a"));
+  BOOST_CHECK_EQUAL(-1, field_value::content_length("\xB2"));
+  BOOST_CHECK_EQUAL(-1, field_value::content_length
+                          ("99999999999999999999999"));
+}
+
+BOOST_AUTO_TEST_CASE(Contains1)
+{
+  BOOST_CHECK(field_value::is_chunked("Chunked"));
+  BOOST_CHECK(!field_value::is_chunked("Identity"));
+  BOOST_CHECK(!field_value::is_chunked(""));
+  BOOST_CHECK(field_value::is_close("Keep-Alive, CLOSE"));
+  BOOST_CHECK(!field_value::is_close("keep-alive\xC3"));
+  BOOST_CHECK(field_value::is_continue("100-Continue"));
+  BOOST_CHECK(!field_value::is_continue("100"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_SUITE(TestHeadersParser)
 
@@ -429,6 +456,61 @@ BOOST_AUTO_TEST_CASE(ValidExpectContinue1)
   BOOST_CHECK(the_headers.expect_continue());
 }
 
+BOOST_AUTO_TEST_CASE(ValidStandardAndExtensionHeaders1)
+{
+  std::string HEADER_LINE("X-Custom: custom\r\n");
+  HEADER_LINE += "Transfer-Encoding: Chunked\r\n";
+  HEADER_LINE += "Connection: Keep-Alive, Close\r\n";
+  HEADER_LINE += "Content-Type: text/plain\r\n\r\n";
+  std::vector<char> header_data(HEADER_LINE.begin(), HEADER_LINE.end());
+  std::vector<char>::iterator header_next(header_data.begin());
+
+  message_headers the_headers(false, 8, 1024, 100, 8190);
+  BOOST_CHECK(the_headers.parse(header_next, header_data.end()));
+
+  // The fields are stored in the order that they were received
+  BOOST_REQUIRE_EQUAL(4u, the_headers.fields().size());
+  BOOST_CHECK_EQUAL("x-custom", the_headers.fields()[0].first);
+  BOOST_CHECK_EQUAL("content-type", the_headers.fields()[3].first);
+
+  BOOST_CHECK_EQUAL("custom", the_headers.find("x-custom"));
+  BOOST_CHECK_EQUAL("text/plain", the_headers.find("content-type"));
+  BOOST_CHECK_EQUAL("text/plain",
+                    the_headers.find(header_field::id::CONTENT_TYPE));
+  BOOST_CHECK(the_headers.find(header_field::id::HOST).empty());
+  BOOST_CHECK(the_headers.find(header_field::id::EXTENSION_HEADER).empty());
+  BOOST_CHECK(the_headers.is_chunked());
+  BOOST_CHECK(the_headers.close_connection());
+  BOOST_CHECK_EQUAL(0, the_headers.content_length());
+
+  // Clearing the headers clears the cached values
+  the_headers.clear();
+  BOOST_CHECK(the_headers.fields().empty());
+  BOOST_CHECK(the_headers.find(header_field::id::CONTENT_TYPE).empty());
+  BOOST_CHECK(!the_headers.is_chunked());
+  BOOST_CHECK(!the_headers.close_connection());
+}
+
+BOOST_AUTO_TEST_CASE(ValidIdentityTransferEncoding1)
+{
+  std::string HEADER_LINE("Transfer-Encoding: Identity\r\n");
+  HEADER_LINE += "Content-Length: 12\r\n\r\n";
+  std::vector<char> header_data(HEADER_LINE.begin(), HEADER_LINE.end());
+  std::vector<char>::iterator header_next(header_data.begin());
+
+  message_headers the_headers(false, 8, 1024, 100, 8190);
+  BOOST_CHECK(the_headers.parse(header_next, header_data.end()));
+  BOOST_CHECK(!the_headers.is_chunked());
+  BOOST_CHECK_EQUAL(12, the_headers.content_length());
+
+  message_headers other_headers(false, 8, 1024, 100, 8190);
+  other_headers.swap(the_headers);
+  BOOST_CHECK_EQUAL(12, other_headers.content_length());
+  BOOST_CHECK_EQUAL("12", other_headers.find(header_field::id::CONTENT_LENGTH));
+  BOOST_CHECK_EQUAL(0, the_headers.content_length());
+  BOOST_CHECK(the_headers.find(header_field::id::CONTENT_LENGTH).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
 
@@ -533,5 +615,20 @@ BOOST_AUTO_TEST_CASE(ValidRepeatedHeader1)
   BOOST_CHECK_EQUAL(CONTENT_STR, content);
 }
 
+BOOST_AUTO_TEST_CASE(ValidRepeatedConnectionHeader1)
+{
+  // The cached value is updated when a field is repeated
+  std::string HEADER_LINE("Connection: keep-alive\r\n");
+  HEADER_LINE += "Connection: close\r\n\r\n";
+  std::vector<char> header_data(HEADER_LINE.begin(), HEADER_LINE.end());
+  std::vector<char>::iterator header_next(header_data.begin());
+
+  message_headers the_headers(false, 8, 1024, 100, 8190);
+  BOOST_CHECK(the_headers.parse(header_next, header_data.end()));
+  BOOST_CHECK_EQUAL(1u, the_headers.fields().size());
+  BOOST_CHECK_EQUAL("keep-alive,close", the_headers.find("connection"));
+  BOOST_CHECK(the_headers.close_connection());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
@@ -14,6 +14,8 @@
 #include <vector>
 #include <iostream>
 #include <limits>
+#include <sstream>
+#include <string>
 
 using namespace via::http;
 
@@ -33,6 +35,18 @@ BOOST_AUTO_TEST_CASE(RequestMethod1)
   BOOST_CHECK_EQUAL("OPTIONS", request_method::name(request_method::id::OPTIONS));
 }
 
+BOOST_AUTO_TEST_CASE(RequestMethodId1)
+{
+  BOOST_CHECK_EQUAL(request_method::id::GET,  request_method::find_id("GET"));
+  BOOST_CHECK_EQUAL(request_method::id::HEAD, request_method::find_id("HEAD"));
+  BOOST_CHECK_EQUAL(request_method::id::CONNECT,
+                    request_method::find_id("CONNECT"));
+  BOOST_CHECK_EQUAL(request_method::id::EXTENSION_METHOD,
+                    request_method::find_id("PATCH"));
+  BOOST_CHECK_EQUAL(request_method::id::EXTENSION_METHOD,
+                    request_method::find_id("get"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
 
@@ -81,9 +95,27 @@ BOOST_AUTO_TEST_CASE(ValidGet1)
   BOOST_CHECK(the_request.parse(next, request_data.end()));
   BOOST_CHECK(request_data.end() == next);
   BOOST_CHECK_EQUAL("GET", the_request.method().c_str());
+  BOOST_CHECK_EQUAL(request_method::id::GET, the_request.method_id());
   BOOST_CHECK_EQUAL("abcdefghijklmnopqrstuvwxyz", the_request.uri().c_str());
   BOOST_CHECK_EQUAL('1', the_request.major_version());
   BOOST_CHECK_EQUAL('0', the_request.minor_version());
+
+  the_request.clear();
+  BOOST_CHECK_EQUAL(request_method::id::EXTENSION_METHOD,
+                    the_request.method_id());
+}
+
+// An http request line with an extension method
+BOOST_AUTO_TEST_CASE(ValidExtensionMethod1)
+{
+  std::string request_data("PATCH /hello HTTP/1.1\r\n");
+  std::string::iterator next(request_data.begin());
+
+  request_line the_request(false, 8, 8, 1024);
+  BOOST_CHECK(the_request.parse(next, request_data.end()));
+  BOOST_CHECK_EQUAL("PATCH", the_request.method().c_str());
+  BOOST_CHECK_EQUAL(request_method::id::EXTENSION_METHOD,
+                    the_request.method_id());
 }
 
 // An http request line in a string without an \r
@@ -353,6 +385,7 @@ BOOST_AUTO_TEST_CASE(ValidGetId2)
 {
   request_line the_request(request_method::id::POST, "/hello", '2', '0');
   the_request.set_method("GET");
+  BOOST_CHECK_EQUAL(request_method::id::GET, the_request.method_id());
   the_request.set_uri("/hello/world");
   the_request.set_major_version('1');
   the_request.set_minor_version('1');
@@ -1152,6 +1185,39 @@ BOOST_AUTO_TEST_CASE(InValidContentLength1)
               via::http::response_status::code::LENGTH_REQUIRED);
 }
 
+BOOST_AUTO_TEST_CASE(ValidPipelined1)
+{
+  std::string request_data("GET /hello HTTP/1.1\r\n");
+  request_data += "Host: 172.16.0.126:3456\r\n\r\n";
+  request_data += "DELETE /hello/1 HTTP/1.1\r\n";
+  request_data += "Host: 172.16.0.126:3456\r\n\r\n";
+  request_data += "POST /hello HTTP/1.1\r\n";
+  request_data += "Host: 172.16.0.126:3456\r\n";
+  request_data += "Content-Length: 4\r\n\r\nabcd";
+  std::string::iterator next(request_data.begin());
+
+  // Requests without a body are followed by the next request
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 1048576, 1048576);
+  Rx rx_state(the_request_receiver.receive(next, request_data.end()));
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL("/hello", the_request_receiver.request().uri());
+  BOOST_CHECK(the_request_receiver.body().empty());
+
+  the_request_receiver.clear();
+  rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL("/hello/1", the_request_receiver.request().uri());
+  BOOST_CHECK(the_request_receiver.body().empty());
+
+  the_request_receiver.clear();
+  rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL("POST", the_request_receiver.request().method());
+  BOOST_CHECK_EQUAL("abcd", the_request_receiver.body());
+  BOOST_CHECK(request_data.end() == next);
+}
+
 BOOST_AUTO_TEST_CASE(ValidTrace1)
 {
   std::string request_data("TRACE / HTTP/1.1\r\n");
@@ -1421,5 +1487,268 @@ BOOST_AUTO_TEST_CASE(LoopbackPost2)
   BOOST_CHECK(rx_state == RX_VALID);
 }
 
+BOOST_AUTO_TEST_CASE(ValidStreamedBody1)
+{
+  // A body larger than max_body_size, received in two parts
+  std::string request_data("POST /upload HTTP/1.1\r\n");
+  request_data += "Host: localhost\r\n";
+  request_data += "Content-Length: 20\r\n\r\n";
+  request_data += "0123456789";
+  std::string body_data("abcdefghij");
+  body_data += "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 16, 1048576);
+  the_request_receiver.set_stream_body(true);
+
+  // The request is valid when its header has been received
+  std::string::const_iterator iter(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(iter, request_data.cend()));
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK(the_request_receiver.body().empty());
+  BOOST_CHECK(the_request_receiver.body_pending());
+
+  std::string::const_iterator begin(iter);
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  BOOST_CHECK_EQUAL("0123456789", std::string(begin, iter));
+  BOOST_CHECK(the_request_receiver.body_pending());
+
+  // The rest of the body, followed by the next request
+  iter = body_data.begin();
+  rx_state = the_request_receiver.receive(iter, body_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  BOOST_CHECK_EQUAL("abcdefghij", std::string(body_data.cbegin(), iter));
+  BOOST_CHECK(!the_request_receiver.body_pending());
+  BOOST_CHECK(the_request_receiver.body().empty());
+
+  the_request_receiver.clear();
+  rx_state = the_request_receiver.receive(iter, body_data.cend());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK(!the_request_receiver.body_pending());
+  BOOST_CHECK(iter == body_data.end());
+}
+
+BOOST_AUTO_TEST_CASE(ValidStreamedChunks1)
+{
+  std::string request_data("POST /upload HTTP/1.1\r\n");
+  request_data += "Host: localhost\r\n";
+  request_data += "Transfer-Encoding: Chunked\r\n\r\n";
+  request_data += "5\r\nabcde\r\n";
+  request_data += "3\r\nfgh\r\n";
+  request_data += "0\r\n\r\n";
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 4, 1048576);
+  the_request_receiver.set_stream_body(true);
+
+  std::string::const_iterator iter(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(iter, request_data.cend()));
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK(the_request_receiver.body_pending());
+
+  // The chunk data is in the received buffer, it's not copied
+  std::string::const_iterator begin(iter);
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  std::pair<std::string::const_iterator, std::string::const_iterator>
+    data(the_request_receiver.body_data(begin));
+  BOOST_CHECK_EQUAL("abcde", std::string(data.first, data.second));
+  BOOST_CHECK(data.first == request_data.cbegin() + request_data.find("abcde"));
+  BOOST_CHECK(the_request_receiver.chunk().data().empty());
+
+  begin = iter;
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  data = the_request_receiver.body_data(begin);
+  BOOST_CHECK_EQUAL("fgh", std::string(data.first, data.second));
+  BOOST_CHECK(the_request_receiver.body_pending());
+
+  begin = iter;
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  data = the_request_receiver.body_data(begin);
+  BOOST_CHECK(data.first == data.second);
+  BOOST_CHECK(the_request_receiver.chunk().is_last());
+  BOOST_CHECK(!the_request_receiver.body_pending());
+  BOOST_CHECK(the_request_receiver.body().empty());
+  BOOST_CHECK(iter == request_data.end());
+}
+
+BOOST_AUTO_TEST_CASE(ValidStreamedChunks2)
+{
+  // A chunk split across three buffers, with its CRLF split too
+  std::string const request_data("POST /upload HTTP/1.1\r\n"
+                                 "Host: localhost\r\n"
+                                 "Transfer-Encoding: Chunked\r\n\r\n"
+                                 "a\r\n01234");
+  std::string const chunk_data1("56789\r");
+  std::string const chunk_data2("\n0\r\n\r\n");
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 16, 1048576);
+  the_request_receiver.set_stream_body(true);
+
+  std::string::const_iterator iter(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(iter, request_data.cend()));
+  BOOST_CHECK(rx_state == RX_VALID);
+
+  std::string::const_iterator begin(iter);
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  std::pair<std::string::const_iterator, std::string::const_iterator>
+    data(the_request_receiver.body_data(begin));
+  BOOST_CHECK_EQUAL("01234", std::string(data.first, data.second));
+  BOOST_CHECK(the_request_receiver.body_pending());
+  BOOST_CHECK(iter == request_data.end());
+
+  iter = chunk_data1.begin();
+  rx_state = the_request_receiver.receive(iter, chunk_data1.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  data = the_request_receiver.body_data(chunk_data1.cbegin());
+  BOOST_CHECK_EQUAL("56789", std::string(data.first, data.second));
+  BOOST_CHECK(the_request_receiver.body_pending());
+  BOOST_CHECK(iter == chunk_data1.end());
+
+  iter = chunk_data2.begin();
+  rx_state = the_request_receiver.receive(iter, chunk_data2.cend());
+  BOOST_CHECK(rx_state == RX_BODY);
+  data = the_request_receiver.body_data(chunk_data2.cbegin());
+  BOOST_CHECK(data.first == data.second);
+  BOOST_CHECK(!the_request_receiver.body_pending());
+  BOOST_CHECK(iter == chunk_data2.end());
+}
+
+BOOST_AUTO_TEST_CASE(InvalidStreamedChunks1)
+{
+  // The chunk data is not followed by a CRLF
+  std::string const request_data("POST /upload HTTP/1.1\r\n"
+                                 "Host: localhost\r\n"
+                                 "Transfer-Encoding: Chunked\r\n\r\n"
+                                 "3\r\nabcd\r\n");
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 16, 1048576);
+  the_request_receiver.set_stream_body(true);
+
+  std::string::const_iterator iter(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(iter, request_data.cend()));
+  BOOST_CHECK(rx_state == RX_VALID);
+
+  rx_state = the_request_receiver.receive(iter, request_data.cend());
+  BOOST_CHECK(rx_state == RX_INVALID);
+  BOOST_CHECK(the_request_receiver.response_code() ==
+              response_status::code::BAD_REQUEST);
+}
+
+BOOST_AUTO_TEST_CASE(ValidPostGzip1)
+{
+  std::string const body_data(std::string(1000, 'a') +
+                              "bcdefghijklmnopqrstuvwxyz");
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                          body_data.data(), body_data.size()));
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 1048576, 1048576);
+  the_request_receiver.set_max_decompressed_size(2048);
+
+  std::string request_data("POST /telemetry HTTP/1.1\r\n");
+  request_data += "Content-Encoding: gzip\r\n";
+  request_data += "Content-Length: " + std::to_string(compressed.size());
+  request_data += "\r\nHost: localhost\r\n\r\n";
+  request_data += compressed.substr(0, 10);
+  std::string::iterator next(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(next, request_data.end()));
+  BOOST_CHECK(rx_state == RX_INCOMPLETE);
+
+  // The body is decompressed as it's received
+  std::string body_data2(compressed.substr(10));
+  next = body_data2.begin();
+  rx_state = the_request_receiver.receive(next, body_data2.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK(next == body_data2.end());
+  BOOST_CHECK(the_request_receiver.body_decompressed());
+  BOOST_CHECK_EQUAL(body_data, the_request_receiver.body());
+}
+
+BOOST_AUTO_TEST_CASE(ValidPostChunkDeflate1)
+{
+  std::string const body_data(std::string(1000, 'a') +
+                              "bcdefghijklmnopqrstuvwxyz");
+  std::string const compressed(encoder::compress(content_coding::DEFLATE, 6,
+                                          body_data.data(), body_data.size()));
+  std::string const part1(compressed.substr(0, compressed.size() / 2));
+  std::string const part2(compressed.substr(compressed.size() / 2));
+
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 1048576, 1048576);
+  the_request_receiver.set_max_decompressed_size(2048);
+
+  std::stringstream chunks;
+  chunks << std::hex << part1.size() << "\r\n" << part1 << "\r\n"
+         << std::hex << part2.size() << "\r\n" << part2 << "\r\n"
+         << "0\r\n\r\n";
+  std::string request_data("POST /telemetry HTTP/1.1\r\n");
+  request_data += "Content-Encoding: deflate\r\n";
+  request_data += "Transfer-Encoding: chunked\r\n";
+  request_data += "Host: localhost\r\n\r\n";
+  request_data += chunks.str();
+
+  Rx rx_state(RX_INCOMPLETE);
+  std::string::iterator next(request_data.begin());
+  while ((rx_state == RX_INCOMPLETE) && (next != request_data.end()))
+    rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL(body_data, the_request_receiver.body());
+}
+
+BOOST_AUTO_TEST_CASE(InvalidPostGzip1)
+{
+  std::string const body_data(std::string(1000, 'a'));
+  std::string const compressed(encoder::compress(content_coding::GZIP, 6,
+                                          body_data.data(), body_data.size()));
+  std::string const header("POST /telemetry HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Content-Length: "
+                           + std::to_string(compressed.size()) + "\r\n");
+
+  // The decompressed body is too large
+  request_receiver<std::string> the_request_receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 1048576, 1048576);
+  the_request_receiver.set_max_decompressed_size(999);
+  std::string request_data(header + "Content-Encoding: gzip\r\n\r\n"
+                           + compressed);
+  std::string::iterator next(request_data.begin());
+  Rx rx_state(the_request_receiver.receive(next, request_data.end()));
+  BOOST_CHECK(rx_state == RX_INVALID);
+  BOOST_CHECK(response_status::code::PAYLOAD_TOO_LARGE ==
+              the_request_receiver.response_code());
+
+  // The body is corrupt
+  the_request_receiver.set_max_decompressed_size(2048);
+  request_data = header + "Content-Encoding: deflate\r\n\r\n" + compressed;
+  next = request_data.begin();
+  rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_INVALID);
+  BOOST_CHECK(response_status::code::BAD_REQUEST ==
+              the_request_receiver.response_code());
+
+  // The content coding is not supported
+  request_data = header + "Content-Encoding: compress\r\n\r\n" + compressed;
+  next = request_data.begin();
+  rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_INVALID);
+  BOOST_CHECK(response_status::code::UNSUPPORTED_MEDIA_TYPE ==
+              the_request_receiver.response_code());
+
+  // The body is not decompressed unless it's enabled
+  the_request_receiver.set_max_decompressed_size(0);
+  next = request_data.begin();
+  rx_state = the_request_receiver.receive(next, request_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK(!the_request_receiver.body_decompressed());
+  BOOST_CHECK_EQUAL(compressed, the_request_receiver.body());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
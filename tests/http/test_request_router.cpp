@@ -8,6 +8,7 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/request_router.hpp"
 #include <boost/test/unit_test.hpp>
+#include <stdexcept>
 #include <iostream>
 
 using namespace via::http;
@@ -101,6 +102,57 @@ namespace
     return tx_response(response_status::code::NO_CONTENT);
   }
 
+  tx_response test_view_route(rx_request const&, //request,
+                              route_parameters const& parameters,
+                              std::string const&, // data,
+                              std::string &response_body)
+  {
+    auto iter(parameters.find("id"));
+    if (iter == parameters.end())
+      return tx_response(response_status::code::BAD_REQUEST);
+
+    response_body.assign(iter->second.begin(), iter->second.end());
+    return tx_response(response_status::code::OK);
+  }
+
+  // An asynchronous handler that responds before it returns.
+  void test_async_route(rx_request const&, //request,
+                        Parameters const& parameters,
+                        std::string const&, // data,
+                        string_router::SendResponseHandler send_response)
+  {
+    send_response(tx_response(response_status::code::OK),
+                  "test_async_route:" + output_parameters(parameters));
+  }
+
+  // An asynchronous handler's send_response function, stored to respond
+  // after the handler has returned.
+  string_router::SendResponseHandler deferred_response;
+
+  void test_deferred_route(rx_request const&, //request,
+                           Parameters const&, // parameters,
+                           std::string const&, // data,
+                           string_router::SendResponseHandler send_response)
+  {
+    deferred_response = send_response;
+  }
+
+  // The number of calls to test_cached_route.
+  int cached_route_calls(0);
+
+  tx_response test_cached_route(rx_request const&, //request,
+                                Parameters const&, // parameters,
+                                std::string const&, // data,
+                                std::string &response_body)
+  {
+    ++cached_route_calls;
+    response_body = "test_cached_route:" + std::to_string(cached_route_calls);
+
+    tx_response response(response_status::code::OK);
+    response.add_header(header_field::id::ETAG, "\"v1\"");
+    return response;
+  }
+
   // A boost test fixture for this test suite.
   struct RequestRouterFixture
   {
@@ -170,9 +222,37 @@ BOOST_AUTO_TEST_CASE(FailedRouteTest2)
   tx_response response(request_router_.handle_request(request, data, response_body));
   BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::METHOD_NOT_ALLOWED),
                     response.status());
+  BOOST_CHECK(response.message().find("Allow: GET, PUT\r\n")
+              != std::string::npos);
 //  std::cout << "FailedRouteTest2: "<< response.message() << std::endl;
 }
 
+BOOST_AUTO_TEST_CASE(ExtensionMethodTest1)
+{
+  // A request with an extension method
+  request_router_.add_method("PATCH", NAME, &test_route3);
+
+  std::string request_data("PATCH /name HTTP/1.1\r\nContent: text\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  std::string data;
+  std::string response_body;
+  tx_response response(request_router_.handle_request(request, data, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::NOT_IMPLEMENTED),
+                    response.status());
+
+  // The extension method is allowed after the standard methods
+  std::string post_data(post_name_request);
+  next = post_data.begin();
+  rx_request post_request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(post_request.parse(next, post_data.end()));
+  response = request_router_.handle_request(post_request, data, response_body);
+  BOOST_CHECK(response.message().find("Allow: GET, PUT, PATCH\r\n")
+              != std::string::npos);
+}
+
 BOOST_AUTO_TEST_CASE(SimpleRouteTest1)
 {
   // A simple GET request
@@ -258,5 +338,203 @@ BOOST_AUTO_TEST_CASE(ComplexRouteTest2)
 //  std::cout << "ComplexRouteTest2: "<< response_body << std::endl;
 }
 
+BOOST_AUTO_TEST_CASE(ViewRouteTest1)
+{
+  // A GET request with a query, routed to a view handler
+  request_router_.add_method(request_method::id::GET, "/order/:id",
+                             &test_view_route);
+
+  std::string request_data("GET /order/1234?detail=full HTTP/1.1\r\n"
+                           "Content: text\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  std::string data;
+  std::string response_body;
+  tx_response response(request_router_.handle_request(request, data, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    response.status());
+  BOOST_CHECK_EQUAL("1234", response_body);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncRouteTest1)
+{
+  // An asynchronous handler that responds before it returns
+  request_router_.add_method(request_method::id::GET, "/async/:id",
+                             &test_async_route);
+
+  std::string request_data("GET /async/1234 HTTP/1.1\r\n"
+                           "Content: text\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  std::string data;
+  std::string response_body;
+  tx_response response(request_router_.handle_request(request, data, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    response.status());
+  BOOST_CHECK_EQUAL("test_async_route: param: id value: 1234 ; ", response_body);
+
+  // A synchronous handler also responds through send_response
+  int status(0);
+  request_data = get_name_request;
+  next = request_data.begin();
+  request.clear();
+  BOOST_CHECK(request.parse(next, request_data.end()));
+  request_router_.handle_request(request, data,
+    [&](tx_response response, std::string body)
+  {
+    status = response.status();
+    response_body = body;
+  });
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK), status);
+  BOOST_CHECK_EQUAL("test_route1:\n", response_body);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncRouteTest2)
+{
+  // An asynchronous handler that responds after it returns
+  request_router_.add_method("GET", "/deferred", &test_deferred_route);
+
+  std::string request_data("GET /deferred HTTP/1.1\r\n"
+                           "Content: text\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  int status(0);
+  std::string data;
+  std::string response_body;
+  request_router_.handle_request(request, data,
+    [&](tx_response response, std::string body)
+  {
+    status = response.status();
+    response_body = body;
+  });
+  BOOST_CHECK_EQUAL(0, status);
+  BOOST_REQUIRE(deferred_response);
+
+  deferred_response(tx_response(response_status::code::ACCEPTED), "later");
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::ACCEPTED), status);
+  BOOST_CHECK_EQUAL("later", response_body);
+
+  // The synchronous handle_request can't wait for the response
+  BOOST_CHECK_THROW(request_router_.handle_request(request, data, response_body),
+                    std::logic_error);
+  deferred_response(tx_response(response_status::code::OK), "too late");
+  deferred_response = string_router::SendResponseHandler();
+}
+
+BOOST_AUTO_TEST_CASE(StaticBeforeParameterTest1)
+{
+  // A static route is matched before a parameter route added before it
+  request_router_.add_method(request_method::id::GET, CUSTOMER + NAME,
+                             &test_route2);
+
+  std::string request_data("GET /customer/name HTTP/1.1\r\n"
+                           "Content: text\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  std::string data;
+  std::string response_body;
+  tx_response response(request_router_.handle_request(request, data, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    response.status());
+  BOOST_CHECK_EQUAL("test_route2:\n", response_body);
+}
+
+BOOST_AUTO_TEST_CASE(CachedRouteTest1)
+{
+  request_router_.add_method(request_method::id::GET, "/cached/:id",
+                             &test_cached_route);
+  request_router_.add_method(request_method::id::PUT, "/cached/:id",
+                             &test_route2);
+  BOOST_CHECK(!request_router_.cache());
+  request_router_.cache_route("/cached/:id", 60);
+  BOOST_REQUIRE(request_router_.cache());
+  cached_route_calls = 0;
+
+  std::string request_data("GET /cached/1 HTTP/1.1\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  // The second response is sent from the cache
+  std::string data;
+  std::string response_body;
+  tx_response response(request_router_.handle_request(request, data, response_body));
+  BOOST_CHECK_EQUAL("test_cached_route:1", response_body);
+  response = request_router_.handle_request(request, data, response_body);
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    response.status());
+  BOOST_CHECK_EQUAL("test_cached_route:1", response_body);
+  BOOST_CHECK(response.header_string().find("Age: ") != std::string::npos);
+  BOOST_CHECK_EQUAL(1, cached_route_calls);
+
+  // A matching If-None-Match gets a 304 Not Modified response
+  request_data = "GET /cached/1 HTTP/1.1\r\nIf-None-Match: W/\"v1\"\r\n\r\n";
+  next = request_data.begin();
+  request.clear();
+  BOOST_CHECK(request.parse(next, request_data.end()));
+  response = request_router_.handle_request(request, data, response_body);
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::NOT_MODIFIED),
+                    response.status());
+  BOOST_CHECK(response_body.empty());
+  BOOST_CHECK_EQUAL(1, cached_route_calls);
+
+  // A PUT request removes the cached response
+  request_data = "PUT /cached/1 HTTP/1.1\r\n\r\n";
+  next = request_data.begin();
+  request.clear();
+  BOOST_CHECK(request.parse(next, request_data.end()));
+  request_router_.handle_request(request, data, response_body);
+
+  request_data = "GET /cached/1 HTTP/1.1\r\n\r\n";
+  next = request_data.begin();
+  request.clear();
+  BOOST_CHECK(request.parse(next, request_data.end()));
+  request_router_.handle_request(request, data,
+    [&](tx_response, std::string body)
+  { response_body = body; });
+  BOOST_CHECK_EQUAL("test_cached_route:2", response_body);
+  BOOST_CHECK_EQUAL(2, cached_route_calls);
+
+  BOOST_CHECK_THROW(request_router_.cache_route("/uncached", 60),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(CachedRouteTest2)
+{
+  // The response of an asynchronous handler is cached when it's sent
+  request_router_.add_method("GET", "/deferred", &test_deferred_route);
+  request_router_.cache_route("/deferred", 60);
+
+  std::string request_data("GET /deferred HTTP/1.1\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(request.parse(next, request_data.end()));
+
+  std::string data;
+  std::string response_body;
+  request_router_.handle_request(request, data,
+    [&](tx_response, std::string body)
+  { response_body = body; });
+  BOOST_REQUIRE(deferred_response);
+  deferred_response(tx_response(response_status::code::OK), "later");
+  deferred_response = string_router::SendResponseHandler();
+  BOOST_CHECK_EQUAL("later", response_body);
+
+  response_body.clear();
+  request_router_.handle_request(request, data,
+    [&](tx_response, std::string body)
+  { response_body = body; });
+  BOOST_CHECK(!deferred_response);
+  BOOST_CHECK_EQUAL("later", response_body);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/request_view.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace via::http;
+
+namespace
+{
+  /// The number of calls to operator new.
+  size_t allocations(0);
+
+  /// Construct an rx_request_view with the default rx_request parameters.
+  rx_request_view make_request_view(bool strict_crlf = false)
+  { return rx_request_view(strict_crlf, 8, 8, 1024, 1024, 100, 8190); }
+
+  /// Parse a request from a string.
+  Rx parse(rx_request_view& the_request, std::string const& data)
+  {
+    const char* next(data.data());
+    return the_request.parse(next, next + data.size());
+  }
+}
+
+// Count the allocations to check that parsing doesn't allocate memory.
+void* operator new(size_t size)
+{
+  ++allocations;
+  void* memory(std::malloc(size ? size : 1));
+  if (!memory)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) NOEXCEPT
+{ std::free(memory); }
+
+void operator delete(void* memory, size_t) NOEXCEPT
+{ std::free(memory); }
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestRequestView)
+
+BOOST_AUTO_TEST_CASE(ValidGetRequest1)
+{
+  std::string request_data("GET /hello/world HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Content-Length: 4\r\n"
+                           "\r\nabcd");
+  const char* next(request_data.data());
+  const char* end(next + request_data.size());
+
+  rx_request_view the_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_VALID, the_request.parse(next, end));
+  BOOST_CHECK_EQUAL(4, end - next);
+  BOOST_CHECK_EQUAL("GET", the_request.method());
+  BOOST_CHECK_EQUAL("/hello/world", the_request.uri());
+  BOOST_CHECK_EQUAL('1', the_request.major_version());
+  BOOST_CHECK_EQUAL('1', the_request.minor_version());
+  BOOST_CHECK_EQUAL(2u, the_request.fields().size());
+  BOOST_CHECK_EQUAL("localhost", the_request.find("host"));
+  BOOST_CHECK_EQUAL("localhost", the_request.find(header_field::id::HOST));
+  BOOST_CHECK_EQUAL(4, the_request.content_length());
+  BOOST_CHECK(the_request.keep_alive());
+  BOOST_CHECK(!the_request.missing_host_header());
+  BOOST_CHECK(!the_request.is_chunked());
+  BOOST_CHECK(!the_request.copied());
+
+  // The views refer to the received data
+  BOOST_CHECK(the_request.uri().data() == request_data.data() + 4);
+}
+
+BOOST_AUTO_TEST_CASE(ZeroAllocations1)
+{
+  std::string request_data("GET /index.html HTTP/1.1\r\n"
+                           "Host: www.example.com\r\n"
+                           "User-Agent: test\r\n"
+                           "Accept: */*\r\n"
+                           "Connection: close\r\n"
+                           "\r\n");
+  rx_request_view the_request(make_request_view());
+
+  size_t const before(allocations);
+  for (int i(0); i < 10; ++i)
+  {
+    the_request.clear();
+    BOOST_CHECK_EQUAL(RX_VALID, parse(the_request, request_data));
+  }
+  BOOST_CHECK(!the_request.keep_alive());
+  BOOST_CHECK_EQUAL(0u, allocations - before);
+}
+
+BOOST_AUTO_TEST_CASE(LenientLf1)
+{
+  std::string request_data("GET / HTTP/1.0\nAccept: */*\n\n");
+
+  rx_request_view the_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_VALID, parse(the_request, request_data));
+  BOOST_CHECK(the_request.is_http_1_0_or_earlier());
+  BOOST_CHECK(!the_request.keep_alive());
+
+  rx_request_view strict_request(make_request_view(true));
+  BOOST_CHECK_EQUAL(RX_INVALID, parse(strict_request, request_data));
+}
+
+BOOST_AUTO_TEST_CASE(SplitRequest1)
+{
+  // Parse a request split at every position
+  std::string request_data("POST /a/long/uri HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Transfer-Encoding: Chunked\r\n"
+                           "\r\nbody");
+  for (size_t i(1); i < request_data.size() - 4; ++i)
+  {
+    std::string part1(request_data.substr(0, i));
+    std::string part2(request_data.substr(i));
+
+    rx_request_view the_request(make_request_view());
+    BOOST_CHECK_EQUAL(RX_INCOMPLETE, parse(the_request, part1));
+
+    const char* next(part2.data());
+    const char* end(next + part2.size());
+    BOOST_CHECK_EQUAL(RX_VALID, the_request.parse(next, end));
+    BOOST_CHECK_EQUAL("body", std::string(next, end));
+    BOOST_CHECK(the_request.copied());
+    BOOST_CHECK_EQUAL("/a/long/uri", the_request.uri());
+    BOOST_CHECK_EQUAL("localhost", the_request.find("HOST"));
+    BOOST_CHECK(the_request.is_chunked());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FoldedField1)
+{
+  std::string request_data("GET / HTTP/1.1\r\n"
+                           "X-Folded: one\r\n"
+                           " two\r\n"
+                           "Host: localhost\r\n"
+                           "\r\n");
+  rx_request_view the_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_VALID, parse(the_request, request_data));
+  BOOST_CHECK_EQUAL("one two", the_request.find("x-folded"));
+  BOOST_CHECK_EQUAL("localhost", the_request.find("host"));
+}
+
+BOOST_AUTO_TEST_CASE(InvalidRequests1)
+{
+  const char* invalid_requests[] =
+  {
+    "get / HTTP/1.1\r\n\r\n",             // lower case method
+    "GET HTTP/1.1\r\n\r\n",               // no uri
+    "GET / HTTX/1.1\r\n\r\n",             // bad version
+    "GET / HTTP/1.1\r\nHost localhost\r\n\r\n", // no colon
+    "GET / HTTP/1.1\r\n continued\r\n\r\n", // leading continuation
+    "GET /         HTTP/1.1\r\n\r\n"      // too much whitespace
+  };
+
+  for (const char* request_data : invalid_requests)
+  {
+    rx_request_view the_request(make_request_view());
+    BOOST_CHECK_EQUAL(RX_INVALID, parse(the_request, request_data));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Limits1)
+{
+  std::string long_uri("GET /");
+  long_uri += std::string(1024, 'a');
+  long_uri += " HTTP/1.1\r\n\r\n";
+  rx_request_view uri_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_INVALID, parse(uri_request, long_uri));
+
+  std::string long_line("GET / HTTP/1.1\r\nX-Value: ");
+  long_line += std::string(2000, 'v');
+  long_line += "\r\n\r\n";
+  rx_request_view line_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_INVALID, parse(line_request, long_line));
+
+  std::string many_fields("GET / HTTP/1.1\r\n");
+  for (int i(0); i < 101; ++i)
+    many_fields += "X-Field: value\r\n";
+  many_fields += "\r\n";
+  rx_request_view fields_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_INVALID, parse(fields_request, many_fields));
+}
+
+BOOST_AUTO_TEST_CASE(UnterminatedHeader1)
+{
+  // A header that never ends is rejected when it exceeds the maximum size
+  rx_request_view the_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_INCOMPLETE, parse(the_request, "GET / HTTP/1.1\r\n"));
+
+  std::string field_lines;
+  for (int i(0); i < 20; ++i)
+    field_lines += "X-" + std::string(1000, 'a') + ": value\r\n";
+
+  Rx rx_state(RX_INCOMPLETE);
+  for (int i(0); (i < 100) && (RX_INCOMPLETE == rx_state); ++i)
+    rx_state = parse(the_request, field_lines);
+  BOOST_CHECK_EQUAL(RX_INVALID, rx_state);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidMethod1)
+{
+  // A method must only contain uppercase ASCII letters
+  rx_request_view the_request(make_request_view());
+  BOOST_CHECK_EQUAL(RX_INVALID,
+                    parse(the_request, "G\xC9T / HTTP/1.1\r\n\r\n"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "via/http/response.hpp"
 #include <boost/test/unit_test.hpp>
+#include <stdexcept>
 #include <vector>
 #include <iostream>
 
@@ -671,9 +672,105 @@ BOOST_AUTO_TEST_CASE(ResponseEncode5)
 BOOST_AUTO_TEST_SUITE_END()
 //////////////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestResponseTemplate)
+
+BOOST_AUTO_TEST_CASE(ResponseTemplate1)
+{
+  tx_response the_response(response_status::code::OK);
+  the_response.add_server_header();
+  the_response.add_header(header_field::id::CONTENT_TYPE, "text/plain");
+  response_template the_template(the_response, false);
+
+  std::string correct_header("HTTP/1.1 200 OK\r\n");
+  correct_header += header_field::server_header();
+  correct_header += "Content-Type: text/plain\r\n";
+  BOOST_CHECK_EQUAL(correct_header, the_template.header());
+  BOOST_CHECK_EQUAL(correct_header, the_template.header('1', '1'));
+  BOOST_CHECK_EQUAL(correct_header, the_template.header('2', '0'));
+
+  correct_header[7] = '0';
+  BOOST_CHECK_EQUAL(correct_header, the_template.header('1', '0'));
+  BOOST_CHECK_EQUAL(correct_header, the_template.header('0', '9'));
+
+  BOOST_CHECK_EQUAL("Content-Length: 15\r\n\r\n",
+                    the_template.dynamic_header(15));
+  BOOST_CHECK_EQUAL("Connection: close\r\nContent-Length: 0\r\n\r\n",
+                    the_template.dynamic_header(0, "Connection: close\r\n"));
+
+  // The same message as the tx_response
+  BOOST_CHECK_EQUAL(the_response.message(15), the_template.message(15));
+}
+
+BOOST_AUTO_TEST_CASE(ResponseTemplate2)
+{
+  // No Content-Length with a transfer encoding or with no content
+  tx_response chunked_response(response_status::code::OK);
+  chunked_response.add_header(header_field::id::TRANSFER_ENCODING, "Chunked");
+  response_template chunked_template(chunked_response, false);
+  BOOST_CHECK_EQUAL("\r\n", chunked_template.dynamic_header(15));
+
+  tx_response no_content_response(response_status::code::NO_CONTENT);
+  response_template no_content_template(no_content_response, false);
+  BOOST_CHECK_EQUAL("HTTP/1.1 204 No Content\r\n\r\n",
+                    no_content_template.message());
+
+  // A Date header is added by default
+  response_template dated_template(no_content_response);
+  std::string const dynamic_header(dated_template.dynamic_header(0));
+  BOOST_CHECK_EQUAL(0u, dynamic_header.find("Date: "));
+  BOOST_CHECK_EQUAL(6u + header_field::DATE_LENGTH + 4u, dynamic_header.size());
+}
+
+BOOST_AUTO_TEST_CASE(ResponseTemplate3)
+{
+  tx_response the_response(response_status::code::OK);
+  the_response.add_header("Split", "one\r\n\r\ntwo");
+  BOOST_CHECK_THROW(response_template the_template(the_response),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_SUITE(TestResponseReceiver)
 
+BOOST_AUTO_TEST_CASE(ValidNoBody1)
+{
+  // Responses without a body followed by the next response
+  std::string response_data("HTTP/1.1 100 Continue\r\n\r\n");
+  response_data += "HTTP/1.1 204 No Content\r\n\r\n";
+  response_data += "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n";
+  response_data += "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nabcd";
+  std::string::iterator next(response_data.begin());
+
+  response_receiver<std::string> the_response_receiver;
+  Rx rx_state(the_response_receiver.receive(next, response_data.end()));
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL(100, the_response_receiver.response().status());
+
+  the_response_receiver.clear();
+  rx_state = the_response_receiver.receive(next, response_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL(204, the_response_receiver.response().status());
+
+  // The response to a HEAD request
+  the_response_receiver.clear();
+  the_response_receiver.set_is_head(true);
+  rx_state = the_response_receiver.receive(next, response_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL(4, the_response_receiver.response().content_length());
+  BOOST_CHECK(the_response_receiver.body().empty());
+
+  the_response_receiver.clear();
+  the_response_receiver.set_is_head(false);
+  rx_state = the_response_receiver.receive(next, response_data.end());
+  BOOST_CHECK(rx_state == RX_VALID);
+  BOOST_CHECK_EQUAL("abcd", the_response_receiver.body());
+  BOOST_CHECK(response_data.end() == next);
+}
+
 BOOST_AUTO_TEST_CASE(ValidOK1)
 {
   std::string response_data("HTTP/1.0 200 OK\r\nC");
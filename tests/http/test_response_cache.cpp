@@ -0,0 +1,264 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/response_cache.hpp"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace via::http;
+
+namespace
+{
+  typedef response_cache<std::string> string_cache;
+
+  /// Parse a request from a string.
+  void parse_request(std::string const& request_data, rx_request& request)
+  {
+    std::string::const_iterator next(request_data.begin());
+    request.clear();
+    BOOST_REQUIRE(request.parse(next, request_data.end()));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestCacheControl)
+
+BOOST_AUTO_TEST_CASE(Parse1)
+{
+  cache_control::directives directives
+      (cache_control::parse("No-Store, private, max-age=\"60\""));
+  BOOST_CHECK(directives.no_store);
+  BOOST_CHECK(!directives.no_cache);
+  BOOST_CHECK(directives.is_private);
+  BOOST_CHECK(!directives.is_public);
+  BOOST_CHECK_EQUAL(60, directives.max_age);
+
+  directives = cache_control::parse("public, max-age=60, s-maxage=10");
+  BOOST_CHECK(directives.is_public);
+  BOOST_CHECK_EQUAL(10, directives.max_age);
+
+  directives = cache_control::parse("");
+  BOOST_CHECK(!directives.no_store);
+  BOOST_CHECK_EQUAL(-1, directives.max_age);
+}
+
+BOOST_AUTO_TEST_CASE(FindHeader1)
+{
+  tx_response response(response_status::code::OK);
+  response.add_header(header_field::id::CACHE_CONTROL, "max-age=60");
+  response.add_header("X-Set-Cookie", "no");
+  BOOST_CHECK_EQUAL("max-age=60", cache_control::find_header
+                      (response, header_field::id::CACHE_CONTROL));
+  BOOST_CHECK_EQUAL("", cache_control::find_header(response, "Set-Cookie"));
+}
+
+BOOST_AUTO_TEST_CASE(EtagMatches1)
+{
+  BOOST_CHECK(cache_control::etag_matches("\"v1\"", "\"v1\""));
+  BOOST_CHECK(cache_control::etag_matches("\"v0\", W/\"v1\"", "\"v1\""));
+  BOOST_CHECK(cache_control::etag_matches("*", "\"v1\""));
+  BOOST_CHECK(!cache_control::etag_matches("\"v2\"", "\"v1\""));
+  BOOST_CHECK(!cache_control::etag_matches("", "\"v1\""));
+}
+
+BOOST_AUTO_TEST_CASE(VaryFields1)
+{
+  std::vector<std::string> fields
+      (cache_control::vary_fields("Accept-Encoding, Accept-Language"));
+  BOOST_REQUIRE_EQUAL(2u, fields.size());
+  BOOST_CHECK_EQUAL("accept-encoding", fields[0]);
+  BOOST_CHECK_EQUAL("accept-language", fields[1]);
+
+  fields = cache_control::vary_fields("Accept, *");
+  BOOST_REQUIRE_EQUAL(1u, fields.size());
+  BOOST_CHECK_EQUAL("*", fields[0]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestResponseCache)
+
+BOOST_AUTO_TEST_CASE(StoreRespond1)
+{
+  string_cache cache;
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  parse_request("GET /hello HTTP/1.1\r\n\r\n", request);
+
+  tx_response response(response_status::code::OK);
+  std::string response_body;
+  BOOST_CHECK(!cache.respond(request, response, response_body));
+
+  response.add_header(header_field::id::ETAG, "\"v1\"");
+  cache.store(request, response, "Hello", 60);
+  BOOST_CHECK_EQUAL(1u, cache.size());
+  BOOST_CHECK(cache.bytes() > 0u);
+
+  tx_response cached(response_status::code::NO_CONTENT);
+  BOOST_CHECK(cache.respond(request, cached, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    cached.status());
+  BOOST_CHECK_EQUAL("Hello", response_body);
+  BOOST_CHECK_EQUAL("0", cache_control::find_header
+                      (cached, header_field::id::AGE));
+
+  // A matching If-None-Match gets a 304 Not Modified response
+  parse_request("GET /hello HTTP/1.1\r\nIf-None-Match: \"v1\"\r\n\r\n",
+                request);
+  BOOST_CHECK(cache.respond(request, cached, response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::NOT_MODIFIED),
+                    cached.status());
+  BOOST_CHECK_EQUAL("\"v1\"", cache_control::find_header
+                      (cached, header_field::id::ETAG));
+  BOOST_CHECK(response_body.empty());
+
+  // A request with no-cache requires a new response
+  parse_request("GET /hello HTTP/1.1\r\nCache-Control: no-cache\r\n\r\n",
+                request);
+  BOOST_CHECK(!cache.respond(request, cached, response_body));
+  parse_request("GET /hello HTTP/1.1\r\nPragma: no-cache\r\n\r\n",
+                request);
+  BOOST_CHECK(!cache.respond(request, cached, response_body));
+
+  // A successful POST request removes the response
+  parse_request("POST /hello HTTP/1.1\r\nContent-Length: 0\r\n\r\n",
+                request);
+  cache.store(request, response, "", 60);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  BOOST_CHECK_EQUAL(0u, cache.bytes());
+}
+
+BOOST_AUTO_TEST_CASE(StoreVary1)
+{
+  string_cache cache;
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  tx_response response(response_status::code::OK);
+  response.add_header(header_field::id::VARY, "Accept-Language");
+
+  parse_request("GET /hello HTTP/1.1\r\nAccept-Language: en\r\n\r\n",
+                request);
+  cache.store(request, response, "Hello", 60);
+  parse_request("GET /hello HTTP/1.1\r\nAccept-Language: fr\r\n\r\n",
+                request);
+  cache.store(request, response, "Bonjour", 60);
+  BOOST_CHECK_EQUAL(2u, cache.size());
+
+  std::string response_body;
+  tx_response cached(response_status::code::OK);
+  BOOST_CHECK(cache.respond(request, cached, response_body));
+  BOOST_CHECK_EQUAL("Bonjour", response_body);
+
+  parse_request("GET /hello HTTP/1.1\r\nAccept-Language: en\r\n\r\n",
+                request);
+  BOOST_CHECK(cache.respond(request, cached, response_body));
+  BOOST_CHECK_EQUAL("Hello", response_body);
+
+  parse_request("GET /hello HTTP/1.1\r\n\r\n", request);
+  BOOST_CHECK(!cache.respond(request, cached, response_body));
+
+  cache.clear();
+  BOOST_CHECK_EQUAL(0u, cache.size());
+}
+
+BOOST_AUTO_TEST_CASE(StoreInvalid1)
+{
+  string_cache cache;
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  parse_request("GET /hello HTTP/1.1\r\n\r\n", request);
+
+  // Responses that must not be stored
+  tx_response response(response_status::code::OK);
+  response.add_header(header_field::id::CACHE_CONTROL, "no-store");
+  cache.store(request, response, "Hello", 60);
+
+  response = tx_response(response_status::code::OK);
+  response.add_header(header_field::id::CACHE_CONTROL, "private");
+  cache.store(request, response, "Hello", 60);
+
+  response = tx_response(response_status::code::OK);
+  response.add_header("Set-Cookie", "id=1");
+  cache.store(request, response, "Hello", 60);
+
+  response = tx_response(response_status::code::OK);
+  response.add_header(header_field::id::VARY, "*");
+  cache.store(request, response, "Hello", 60);
+
+  cache.store(request, tx_response(response_status::code::NOT_FOUND),
+              "Hello", 60);
+  cache.store(request, tx_response(response_status::code::OK), "Hello", 0);
+
+  // A response to an authorized request must be public
+  parse_request("GET /hello HTTP/1.1\r\nAuthorization: Basic dXNlcg==\r\n\r\n",
+                request);
+  cache.store(request, tx_response(response_status::code::OK), "Hello", 60);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+
+  response = tx_response(response_status::code::OK);
+  response.add_header(header_field::id::CACHE_CONTROL, "public");
+  cache.store(request, response, "Hello", 60);
+  BOOST_CHECK_EQUAL(1u, cache.size());
+
+  // A zero maximum size disables the cache
+  cache.set_max_size(0);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+  cache.store(request, response, "Hello", 60);
+  BOOST_CHECK_EQUAL(0u, cache.size());
+}
+
+BOOST_AUTO_TEST_CASE(StoreRespondThreads1)
+{
+  // Threads storing and responding to requests for the same uris
+  string_cache cache;
+  std::atomic<int> failures(0);
+  std::vector<std::string> bodies;
+  std::vector<std::string> requests;
+  for (int i(0); i < 10; ++i)
+  {
+    bodies.push_back(std::to_string(i));
+    requests.push_back("GET /" + bodies.back() + " HTTP/1.1\r\n\r\n");
+  }
+
+  std::vector<std::thread> threads;
+  for (int t(0); t < 4; ++t)
+    threads.push_back(std::thread([&cache, &failures, &bodies, &requests, t]
+    {
+      rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+      tx_response response(response_status::code::OK);
+      for (int i(0); i < 200; ++i)
+      {
+        // Note: Boost.Test assertions are not thread safe
+        size_t const index(i % requests.size());
+        std::string::const_iterator next(requests[index].begin());
+        request.clear();
+        if (!request.parse(next, requests[index].cend()))
+          ++failures;
+        if (t % 2)
+          cache.store(request, response, bodies[index], 60);
+        else
+        {
+          std::string response_body;
+          tx_response cached(response_status::code::OK);
+          if (cache.respond(request, cached, response_body) &&
+              (response_body != bodies[index]))
+            ++failures;
+        }
+      }
+    }));
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(0, failures.load());
+  BOOST_CHECK_EQUAL(10u, cache.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/route_tree.hpp"
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+
+using namespace via::http;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestRouteTree)
+
+BOOST_AUTO_TEST_CASE(StaticRoutes1)
+{
+  route_tree tree;
+  BOOST_CHECK_EQUAL(0u, tree.insert("/", 0));
+  BOOST_CHECK_EQUAL(1u, tree.insert("/name", 1));
+  BOOST_CHECK_EQUAL(2u, tree.insert("/names", 2));
+  BOOST_CHECK_EQUAL(3u, tree.insert("/nation", 3));
+  BOOST_CHECK_EQUAL(1u, tree.insert("/name", 4)); // an existing route
+
+  route_parameters parameters;
+  BOOST_CHECK_EQUAL(0u, tree.find("/", parameters));
+  BOOST_CHECK_EQUAL(1u, tree.find("/name", parameters));
+  BOOST_CHECK_EQUAL(2u, tree.find("/names", parameters));
+  BOOST_CHECK_EQUAL(3u, tree.find("/nation", parameters));
+  BOOST_CHECK(parameters.empty());
+
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("", parameters));
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("/nam", parameters));
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("/named", parameters));
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("/x/name", parameters));
+}
+
+BOOST_AUTO_TEST_CASE(ParameterRoutes1)
+{
+  route_tree tree;
+  tree.insert("/customer", 0);
+  tree.insert("/customer/:id", 1);
+  tree.insert("/customer/:id/:address", 2);
+
+  std::string const uri_path("/customer/JohnSmith/London");
+  route_parameters parameters;
+  BOOST_CHECK_EQUAL(2u, tree.find(uri_path, parameters));
+  BOOST_REQUIRE_EQUAL(2u, parameters.size());
+  BOOST_CHECK_EQUAL("id", parameters[0].first);
+  BOOST_CHECK_EQUAL("JohnSmith", parameters[0].second);
+  BOOST_CHECK_EQUAL("address", parameters[1].first);
+  BOOST_CHECK_EQUAL("London", parameters[1].second);
+
+  // The values are views into the uri path
+  BOOST_CHECK(parameters[0].second.data() == uri_path.data() + 10);
+  BOOST_CHECK(parameters.find("address") != parameters.end());
+  BOOST_CHECK(parameters.find("name") == parameters.end());
+
+  Parameters const map(parameters.to_map());
+  BOOST_CHECK_EQUAL(2u, map.size());
+  BOOST_CHECK_EQUAL("London", map.find("address")->second);
+
+  BOOST_CHECK_EQUAL(1u, tree.find("/customer/JohnSmith", parameters));
+  BOOST_CHECK_EQUAL(1u, parameters.size());
+  BOOST_CHECK_EQUAL(0u, tree.find("/customer", parameters));
+  BOOST_CHECK(parameters.empty());
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND,
+                    tree.find("/customer/JohnSmith/London/UK", parameters));
+  BOOST_CHECK(parameters.empty());
+}
+
+BOOST_AUTO_TEST_CASE(EmptyParameters1)
+{
+  // A parameter doesn't match an empty segment
+  route_tree tree;
+  tree.insert("/order/:id", 0);
+  tree.insert("/order/:id/:item", 1);
+
+  route_parameters parameters;
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("/order/", parameters));
+  BOOST_CHECK(parameters.empty());
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND, tree.find("/order//1", parameters));
+  BOOST_CHECK(parameters.empty());
+  BOOST_CHECK_EQUAL(route_tree::NOT_FOUND,
+                    tree.find("/order/42/", parameters));
+  BOOST_CHECK(parameters.empty());
+
+  BOOST_CHECK_EQUAL(1u, tree.find("/order/42/1", parameters));
+  BOOST_REQUIRE_EQUAL(2u, parameters.size());
+  BOOST_CHECK_EQUAL("42", parameters[0].second);
+  BOOST_CHECK_EQUAL("1", parameters[1].second);
+}
+
+BOOST_AUTO_TEST_CASE(StaticBeforeParameter1)
+{
+  // Static segments match before parameters, irrespective of insertion order
+  route_tree tree;
+  tree.insert("/user/:id/orders", 0);
+  tree.insert("/user/new", 1);
+  tree.insert("/user/new/orders/:order", 2);
+
+  route_parameters parameters;
+  BOOST_CHECK_EQUAL(1u, tree.find("/user/new", parameters));
+  BOOST_CHECK(parameters.empty());
+
+  // backtracks to the parameter when the static route doesn't match
+  BOOST_CHECK_EQUAL(0u, tree.find("/user/new/orders", parameters));
+  BOOST_REQUIRE_EQUAL(1u, parameters.size());
+  BOOST_CHECK_EQUAL("new", parameters[0].second);
+
+  BOOST_CHECK_EQUAL(2u, tree.find("/user/new/orders/42", parameters));
+  BOOST_REQUIRE_EQUAL(1u, parameters.size());
+  BOOST_CHECK_EQUAL("order", parameters[0].first);
+  BOOST_CHECK_EQUAL("42", parameters[0].second);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidRoutes1)
+{
+  route_tree tree;
+  tree.insert("/customer/:id", 0);
+  BOOST_CHECK_THROW(tree.insert("/customer/:name", 1), std::invalid_argument);
+
+  std::string many_parameters;
+  for (size_t i(0); i <= route_parameters::MAX_PARAMETERS; ++i)
+    many_parameters += "/:p" + boost::lexical_cast<std::string>(i);
+  BOOST_CHECK_THROW(tree.insert(many_parameters, 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ManyRoutes1)
+{
+  route_tree tree;
+  for (size_t i(0); i < 2000; ++i)
+  {
+    std::string const number(boost::lexical_cast<std::string>(i));
+    BOOST_CHECK_EQUAL(2 * i, tree.insert("/api/v1/resource" + number, 2 * i));
+    BOOST_CHECK_EQUAL(2 * i + 1,
+      tree.insert("/api/v1/resource" + number + "/:id", 2 * i + 1));
+  }
+
+  route_parameters parameters;
+  for (size_t i(0); i < 2000; ++i)
+  {
+    std::string const number(boost::lexical_cast<std::string>(i));
+    BOOST_CHECK_EQUAL(2 * i, tree.find("/api/v1/resource" + number, parameters));
+    std::string const uri_path("/api/v1/resource" + number + "/" + number);
+    BOOST_CHECK_EQUAL(2 * i + 1, tree.find(uri_path, parameters));
+    BOOST_CHECK_EQUAL(number, parameters[0].second);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
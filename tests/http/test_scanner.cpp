@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/scanner.hpp"
+#include "via/http/request.hpp"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using namespace via::http;
+
+namespace
+{
+  /// The simd_levels supported by this processor.
+  std::vector<simd_level> supported_levels()
+  {
+    std::vector<simd_level> levels(1, simd_level::SCALAR);
+    if (supported_simd_level() >= simd_level::SSE4_2)
+      levels.push_back(simd_level::SSE4_2);
+    if (supported_simd_level() >= simd_level::AVX2)
+      levels.push_back(simd_level::AVX2);
+    return levels;
+  }
+
+  /// Find the position of a delimiter with each supported scanner.
+  /// @return true if all of the scanners found the expected position.
+  bool check_all(scanner::scan_function scanner::* function,
+                 std::string const& data, size_t expected)
+  {
+    bool ok(true);
+    for (auto level : supported_levels())
+    {
+      const char* begin(data.data());
+      const char* end(begin + data.size());
+      size_t found((scanner::instance(level).*function)(begin, end) - begin);
+      if (found != expected)
+      {
+        BOOST_TEST_MESSAGE("level " << static_cast<int>(level)
+                           << " found " << found << " expected " << expected);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestScanner)
+
+BOOST_AUTO_TEST_CASE(FindEolEveryPosition1)
+{
+  // Put the delimiter at every position across the vector widths
+  for (size_t i(0); i < 80; ++i)
+  {
+    std::string data(80, 'x');
+    data[i] = (i % 2) ? '\r' : '\n';
+    BOOST_CHECK(check_all(&scanner::find_eol, data, i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FindEolNotFound1)
+{
+  for (size_t i(0); i < 80; ++i)
+  {
+    std::string data(i, 'x');
+    BOOST_CHECK(check_all(&scanner::find_eol, data, i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FindWsOrEol1)
+{
+  const char delimiters[] = { ' ', '\t', '\r', '\n' };
+  for (size_t i(0); i < 70; ++i)
+  {
+    std::string data("/a/long/uri/path/with/no/delimiters/at/all/"
+                     "until/somewhere/in/the/string?query=value");
+    data.resize(70, 'x');
+    data[i] = delimiters[i % 4];
+    BOOST_CHECK(check_all(&scanner::find_ws_or_eol, data, i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FindNotName1)
+{
+  for (size_t i(0); i < 70; ++i)
+  {
+    std::string data("Content-Type-And-Some-Other-Long-Header-Field-Name-abcXYZ");
+    data.resize(70, 'a');
+    data[i] = ':';
+    BOOST_CHECK(check_all(&scanner::find_not_name, data, i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FindNotNameBoundaries1)
+{
+  // Characters either side of the letter ranges and high bit characters
+  const char others[] = { '@', '[', '`', '{', ' ', '0', '_',
+                          static_cast<char>(0xC1), static_cast<char>(0xE1) };
+  for (char c : others)
+  {
+    std::string data(40, 'Z');
+    data[35] = c;
+    BOOST_CHECK(check_all(&scanner::find_not_name, data, 35));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LongUriLimit1)
+{
+  // A uri longer than max_uri_length must fail with the length error
+  std::string request_data("GET /");
+  request_data += std::string(request_receiver<std::string>::
+                              DEFAULT_MAX_URI_LENGTH, 'a');
+  request_data += " HTTP/1.1\r\n";
+  std::string::const_iterator next(request_data.begin());
+
+  request_line the_request(false, 8, 8, 1024);
+  BOOST_CHECK(!the_request.parse(next, request_data.cend()));
+  BOOST_CHECK_EQUAL(request_line::REQ_ERROR_URI_LENGTH, the_request.state());
+}
+
+BOOST_AUTO_TEST_CASE(UriAtLimit1)
+{
+  std::string uri("/");
+  uri += std::string(1023, 'a');
+  std::string request_data("GET " + uri + " HTTP/1.1\r\n");
+  std::string::const_iterator next(request_data.begin());
+
+  request_line the_request(false, 8, 8, 1024);
+  BOOST_CHECK(the_request.parse(next, request_data.cend()));
+  BOOST_CHECK_EQUAL(uri, the_request.uri());
+}
+
+BOOST_AUTO_TEST_CASE(SplitHeaders1)
+{
+  // Parse a request split at every position, to check the bulk scan
+  // resumes in the middle of a uri, field name and field value
+  std::string request_data("GET /a/long/uri/for/the/scanner HTTP/1.1\r\n"
+                           "Content-Length: 0\r\n"
+                           "X-A-Long-Header-Field-Name: a long header value\r\n"
+                           "\r\n");
+  for (size_t i(1); i < request_data.size(); ++i)
+  {
+    std::vector<char> part1(request_data.begin(), request_data.begin() + i);
+    std::vector<char> part2(request_data.begin() + i, request_data.end());
+
+    rx_request the_request(false, 8, 8, 1024, 1024, 100, 8190);
+    std::vector<char>::const_iterator next(part1.cbegin());
+    BOOST_CHECK(!the_request.parse(next, part1.cend()));
+    next = part2.cbegin();
+    BOOST_CHECK(the_request.parse(next, part2.cend()));
+    BOOST_CHECK_EQUAL("/a/long/uri/for/the/scanner", the_request.uri());
+    BOOST_CHECK_EQUAL("a long header value",
+      the_request.headers().find("x-a-long-header-field-name"));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LongHeaderLineLimit1)
+{
+  std::string request_data("GET / HTTP/1.1\r\nX-Value: ");
+  request_data += std::string(2000, 'v');
+  request_data += "\r\n\r\n";
+  std::string::const_iterator next(request_data.begin());
+
+  rx_request the_request(false, 8, 8, 1024, 1024, 100, 8190);
+  BOOST_CHECK(!the_request.parse(next, request_data.cend()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,273 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/http/static_files.hpp"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace via::http;
+
+namespace
+{
+  /// A temporary directory containing index.html and "data.txt",
+  /// which contains the 26 lowercase letters.
+  struct files_fixture
+  {
+    std::string directory;
+
+    files_fixture() :
+      directory("/tmp/via_static_files_XXXXXX")
+    {
+      BOOST_REQUIRE(::mkdtemp(&directory[0]));
+      std::ofstream(directory + "/data.txt") << "abcdefghijklmnopqrstuvwxyz";
+      std::ofstream(directory + "/index.html") << "<html></html>";
+      std::ofstream(directory + "/.hidden") << "secret";
+    }
+
+    ~files_fixture()
+    {
+      std::remove((directory + "/data.txt").c_str());
+      std::remove((directory + "/index.html").c_str());
+      std::remove((directory + "/.hidden").c_str());
+      ::rmdir(directory.c_str());
+    }
+  };
+
+  /// Parse a request, throw if it's not valid.
+  rx_request make_request(std::string const& request_data)
+  {
+    rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+    std::string::const_iterator next(request_data.begin());
+    BOOST_REQUIRE(request.parse(next, request_data.end()));
+    return request;
+  }
+
+  /// Get a file with the given extra header lines.
+  static_files::file_response get(static_files& files, std::string const& path,
+                                  std::string const& header_lines = "")
+  {
+    rx_request const request(make_request("GET " + path + " HTTP/1.1\r\n"
+                                          "Host: h\r\n" + header_lines +
+                                          "\r\n"));
+    return files.respond(request, path);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestStaticFiles, files_fixture)
+
+BOOST_AUTO_TEST_CASE(GetFile1)
+{
+  static_files files(directory);
+  static_files::file_response result(get(files, "/data.txt"));
+  BOOST_CHECK_EQUAL(200, result.response.status());
+  BOOST_REQUIRE(result.body.file);
+  BOOST_CHECK_EQUAL(0u, result.body.offset);
+  BOOST_CHECK_EQUAL(26u, result.body.length);
+
+  std::string const& headers(result.response.header_string());
+  BOOST_CHECK(headers.find("Content-Type: text/plain; charset=utf-8\r\n")
+                != std::string::npos);
+  BOOST_CHECK(headers.find("Accept-Ranges: bytes\r\n") != std::string::npos);
+  BOOST_CHECK(headers.find("Last-Modified: ") != std::string::npos);
+
+  // The open file is cached
+  BOOST_CHECK_EQUAL(1u, files.cache().size());
+  BOOST_CHECK(get(files, "/data.txt").body.file == result.body.file);
+}
+
+BOOST_AUTO_TEST_CASE(GetIndexFile1)
+{
+  static_files files(directory);
+  static_files::file_response result(get(files, "/"));
+  BOOST_CHECK_EQUAL(200, result.response.status());
+  BOOST_CHECK_EQUAL(13u, result.body.length);
+  BOOST_CHECK(result.response.header_string().find("text/html")
+                != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(NotFound1)
+{
+  static_files files(directory);
+  BOOST_CHECK_EQUAL(404, get(files, "/missing.txt").response.status());
+  BOOST_CHECK_EQUAL(404, get(files, "/../etc/passwd").response.status());
+  BOOST_CHECK_EQUAL(404, get(files, "/%2e%2e/etc/passwd").response.status());
+  BOOST_CHECK_EQUAL(404, get(files, "/.hidden").response.status());
+  BOOST_CHECK_EQUAL(404, get(files, "/data%00.txt").response.status());
+  BOOST_CHECK(!get(files, "/missing.txt").body.file);
+}
+
+BOOST_AUTO_TEST_CASE(MethodNotAllowed1)
+{
+  static_files files(directory);
+  rx_request const request(make_request("POST /data.txt HTTP/1.1\r\n"
+                                        "Host: h\r\n"
+                                        "Content-Length: 0\r\n\r\n"));
+  static_files::file_response result(files.respond(request, "/data.txt"));
+  BOOST_CHECK_EQUAL(405, result.response.status());
+  BOOST_CHECK(result.response.header_string().find("Allow: GET, HEAD\r\n")
+                != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(IfModifiedSince1)
+{
+  static_files files(directory);
+  std::time_t const modified(get(files, "/data.txt").body.file->last_modified());
+  char date[header_field::DATE_LENGTH + 1] = { 0 };
+
+  header_field::format_date(modified, date);
+  static_files::file_response result
+    (get(files, "/data.txt", std::string("If-Modified-Since: ") + date + "\r\n"));
+  BOOST_CHECK_EQUAL(304, result.response.status());
+  BOOST_CHECK(!result.body.file);
+
+  header_field::format_date(modified - 1, date);
+  result = get(files, "/data.txt",
+               std::string("If-Modified-Since: ") + date + "\r\n");
+  BOOST_CHECK_EQUAL(200, result.response.status());
+  BOOST_CHECK_EQUAL(26u, result.body.length);
+}
+
+BOOST_AUTO_TEST_CASE(Range1)
+{
+  static_files files(directory);
+  static_files::file_response result
+    (get(files, "/data.txt", "Range: bytes=2-5\r\n"));
+  BOOST_CHECK_EQUAL(206, result.response.status());
+  BOOST_CHECK_EQUAL(2u, result.body.offset);
+  BOOST_CHECK_EQUAL(4u, result.body.length);
+  BOOST_CHECK(result.response.header_string().find
+                ("Content-Range: bytes 2-5/26\r\n") != std::string::npos);
+
+  result = get(files, "/data.txt", "Range: bytes=20-\r\n");
+  BOOST_CHECK_EQUAL(206, result.response.status());
+  BOOST_CHECK_EQUAL(20u, result.body.offset);
+  BOOST_CHECK_EQUAL(6u, result.body.length);
+
+  result = get(files, "/data.txt", "Range: bytes=-3\r\n");
+  BOOST_CHECK_EQUAL(206, result.response.status());
+  BOOST_CHECK_EQUAL(23u, result.body.offset);
+  BOOST_CHECK_EQUAL(3u, result.body.length);
+
+  result = get(files, "/data.txt", "Range: bytes=10-100\r\n");
+  BOOST_CHECK_EQUAL(206, result.response.status());
+  BOOST_CHECK_EQUAL(16u, result.body.length);
+}
+
+BOOST_AUTO_TEST_CASE(RangeNotSatisfiable1)
+{
+  static_files files(directory);
+  static_files::file_response result
+    (get(files, "/data.txt", "Range: bytes=26-\r\n"));
+  BOOST_CHECK_EQUAL(416, result.response.status());
+  BOOST_CHECK(!result.body.file);
+  BOOST_CHECK(result.response.header_string().find
+                ("Content-Range: bytes */26\r\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(RangeIgnored1)
+{
+  static_files files(directory);
+
+  // Multiple ranges and invalid ranges get the whole file
+  BOOST_CHECK_EQUAL(200, get(files, "/data.txt",
+                             "Range: bytes=0-1,4-5\r\n").response.status());
+  BOOST_CHECK_EQUAL(200, get(files, "/data.txt",
+                             "Range: bytes=5-2\r\n").response.status());
+  BOOST_CHECK_EQUAL(200, get(files, "/data.txt",
+                             "Range: lines=1-2\r\n").response.status());
+
+  // An If-Range date that doesn't match gets the whole file
+  BOOST_CHECK_EQUAL(200, get(files, "/data.txt",
+                             "Range: bytes=0-1\r\n"
+                             "If-Range: Thu, 01 Jan 1970 00:00:00 GMT\r\n")
+                               .response.status());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestFileCache, files_fixture)
+
+BOOST_AUTO_TEST_CASE(FileCacheLru1)
+{
+  via::comms::file_cache cache(1);
+  boost::system::error_code error;
+  auto data(cache.open(directory + "/data.txt", error));
+  BOOST_REQUIRE(data);
+  BOOST_CHECK_EQUAL(26u, data->size());
+  BOOST_CHECK(cache.open(directory + "/data.txt", error) == data);
+
+  // The least recently used file is closed when the cache is full
+  BOOST_CHECK(cache.open(directory + "/index.html", error));
+  BOOST_CHECK_EQUAL(1u, cache.size());
+  BOOST_CHECK(cache.open(directory + "/data.txt", error) != data);
+
+  BOOST_CHECK(!cache.open(directory + "/missing.txt", error));
+  BOOST_CHECK(error == boost::system::errc::no_such_file_or_directory);
+  BOOST_CHECK(!cache.open(directory, error));
+  BOOST_CHECK(error == boost::system::errc::is_a_directory);
+}
+
+BOOST_AUTO_TEST_CASE(FileCacheRevalidate1)
+{
+  via::comms::file_cache cache;
+  cache.set_revalidate_interval(0);
+  boost::system::error_code error;
+  auto data(cache.open(directory + "/data.txt", error));
+  BOOST_REQUIRE(data);
+
+  // A replaced file is reopened
+  std::remove((directory + "/data.txt").c_str());
+  std::ofstream(directory + "/data.txt") << "abc";
+  auto replaced(cache.open(directory + "/data.txt", error));
+  BOOST_REQUIRE(replaced);
+  BOOST_CHECK(replaced != data);
+  BOOST_CHECK_EQUAL(3u, replaced->size());
+
+  char buffer[4] = { 0 };
+  BOOST_CHECK_EQUAL(2u, replaced->read(buffer, sizeof(buffer), 1, error));
+  BOOST_CHECK_EQUAL("bc", buffer);
+}
+
+BOOST_AUTO_TEST_CASE(FileCacheRevalidate2)
+{
+  // A file that's opened more often than the revalidation interval is
+  // still checked once the interval has passed
+  via::comms::file_cache cache;
+  cache.set_revalidate_interval(100);
+  boost::system::error_code error;
+  auto data(cache.open(directory + "/data.txt", error));
+  BOOST_REQUIRE(data);
+
+  std::remove((directory + "/data.txt").c_str());
+  std::ofstream(directory + "/data.txt") << "abc";
+  BOOST_CHECK(cache.open(directory + "/data.txt", error) == data);
+
+  auto const start(std::chrono::steady_clock::now());
+  std::shared_ptr<via::comms::file_handle const> replaced(data);
+  while (std::chrono::steady_clock::now() - start <
+         std::chrono::milliseconds(300))
+  {
+    replaced = cache.open(directory + "/data.txt", error);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  BOOST_REQUIRE(replaced);
+  BOOST_CHECK(replaced != data);
+  BOOST_CHECK_EQUAL(3u, replaced->size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
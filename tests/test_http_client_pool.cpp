@@ -0,0 +1,347 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/tcp_adaptor.hpp"
+#include "via/http_client_pool.hpp"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace via;
+
+namespace
+{
+  typedef http_client_pool<comms::tcp_adaptor, std::string> pool_type;
+
+  const unsigned short PORT = 18404;        ///< The server's port.
+  const unsigned short CLOSED_PORT = 18405; ///< A port without a server.
+  const long SLOW_RESPONSE_MS = 50;         ///< The delay of "/slow".
+  const long TEST_TIMEOUT_MS = 5000;        ///< The maximum test duration.
+
+  /// A scripted HTTP server and a client pool, running in the test thread.
+  /// The server responds to "/slow" after SLOW_RESPONSE_MS, drops the
+  /// connection without responding to the first drops requests for
+  /// "/drop" and closes the connection after responding to "/close".
+  struct pool_fixture
+  {
+    /// A connection to the server.
+    struct server_connection
+    {
+      boost::asio::ip::tcp::socket socket;
+      boost::asio::deadline_timer timer;
+      std::string rx_buffer;          ///< The data received.
+      std::deque<std::string> paths;  ///< The requests to respond to.
+      bool waiting;                   ///< Waiting to respond to "/slow".
+      size_t number;                  ///< The number of the connection.
+      char buffer[1024];
+
+      server_connection(boost::asio::io_service& io_service, size_t n) :
+        socket(io_service),
+        timer(io_service),
+        rx_buffer(),
+        paths(),
+        waiting(false),
+        number(n)
+      {}
+    };
+
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor;
+    boost::asio::deadline_timer test_timer;
+    pool_type::shared_pointer pool;
+    std::vector<std::string> requests; ///< "<connection> <method> <path>"
+    size_t accepted;                   ///< The connections accepted.
+    size_t max_outstanding;            ///< The most requests awaiting a
+                                       ///< response on a connection.
+    int drops;                         ///< The "/drop" requests to drop.
+    int expected;                      ///< The responses to wait for.
+    std::vector<std::string> bodies;   ///< The response bodies, in order.
+    std::vector<boost::system::error_code> errors; ///< The response errors.
+
+    pool_fixture() :
+      io_service(),
+      acceptor(io_service, boost::asio::ip::tcp::endpoint
+                 (boost::asio::ip::address_v4::loopback(), PORT)),
+      test_timer(io_service),
+      pool(pool_type::create(io_service, "127.0.0.1",
+                             std::to_string(PORT), 1)),
+      requests(),
+      accepted(0),
+      max_outstanding(0),
+      drops(0),
+      expected(0),
+      bodies(),
+      errors()
+    {
+      accept();
+    }
+
+    void accept()
+    {
+      std::shared_ptr<server_connection> connection
+        (std::make_shared<server_connection>(io_service, accepted + 1));
+      acceptor.async_accept(connection->socket, [this, connection]
+        (boost::system::error_code const& error)
+      {
+        if (!error)
+        {
+          ++accepted;
+          receive(connection);
+          accept();
+        }
+      });
+    }
+
+    void receive(std::shared_ptr<server_connection> connection)
+    {
+      connection->socket.async_read_some
+          (boost::asio::buffer(connection->buffer),
+           [this, connection](boost::system::error_code const& error,
+                              size_t size)
+      {
+        if (error)
+          return;
+
+        connection->rx_buffer.append(connection->buffer, size);
+        size_t end(connection->rx_buffer.find("\r\n\r\n"));
+        while (end != std::string::npos)
+        {
+          std::string const line(connection->rx_buffer.substr
+              (0, connection->rx_buffer.find("\r\n")));
+          connection->rx_buffer.erase(0, end + 4);
+          std::string const method(line.substr(0, line.find(' ')));
+          std::string const path(line.substr(method.size() + 1,
+                                   line.find(' ', method.size() + 1)
+                                     - method.size() - 1));
+          requests.push_back(std::to_string(connection->number) + " "
+                             + method + " " + path);
+          connection->paths.push_back(path);
+          end = connection->rx_buffer.find("\r\n\r\n");
+        }
+        max_outstanding = std::max(max_outstanding, connection->paths.size());
+
+        if (respond(connection))
+          receive(connection);
+      });
+    }
+
+    /// Respond to the requests on a connection, in order.
+    /// @return false if the connection was closed, true otherwise.
+    bool respond(std::shared_ptr<server_connection> connection)
+    {
+      while (!connection->paths.empty() && !connection->waiting)
+      {
+        std::string const path(connection->paths.front());
+        if ((path == "/drop") && (drops > 0))
+        {
+          --drops;
+          connection->socket.close();
+          return false;
+        }
+
+        if (path == "/slow")
+        {
+          connection->waiting = true;
+          connection->timer.expires_from_now
+              (boost::posix_time::milliseconds(SLOW_RESPONSE_MS));
+          connection->timer.async_wait([this, connection, path]
+            (boost::system::error_code const&)
+          {
+            connection->waiting = false;
+            send_response(connection, path, false);
+            if (connection->socket.is_open())
+              respond(connection);
+          });
+          return true;
+        }
+
+        bool const close(path == "/close");
+        send_response(connection, path, close);
+        if (close)
+          return false;
+      }
+      return true;
+    }
+
+    /// Send a response with the path as its body.
+    void send_response(std::shared_ptr<server_connection> connection,
+                       std::string const& path, bool close)
+    {
+      connection->paths.pop_front();
+      std::string response("HTTP/1.1 200 OK\r\nContent-Length: "
+                           + std::to_string(path.size()) + "\r\n");
+      if (close)
+        response += "Connection: close\r\n";
+      response += "\r\n" + path;
+
+      boost::system::error_code error;
+      boost::asio::write(connection->socket, boost::asio::buffer(response),
+                         error);
+      if (close)
+        connection->socket.close(error);
+    }
+
+    /// Send a request with the pool, recording its response.
+    void send(http::request_method::id method, std::string const& path)
+    {
+      ++expected;
+      pool->send(http::tx_request(method, path),
+        [this](boost::system::error_code const& error,
+               http::rx_response const&, std::string const& body)
+      {
+        errors.push_back(error);
+        bodies.push_back(error ? std::string() : body);
+        if (static_cast<int>(bodies.size()) == expected)
+          io_service.stop();
+      });
+    }
+
+    /// Run until all of the responses have been received, or the test
+    /// times out.
+    void run()
+    {
+      test_timer.expires_from_now
+          (boost::posix_time::milliseconds(TEST_TIMEOUT_MS));
+      test_timer.async_wait([this](boost::system::error_code const& error)
+        { if (!error) io_service.stop(); });
+      io_service.run();
+    }
+
+    /// The number of requests for a path that the server received.
+    size_t received(std::string const& method_path) const
+    {
+      size_t count(0);
+      for (auto const& request : requests)
+        if (request.substr(request.find(' ') + 1) == method_path)
+          ++count;
+      return count;
+    }
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestHttpClientPool, pool_fixture)
+
+// Requests are queued and sent in order on a single connection.
+BOOST_AUTO_TEST_CASE(Queue1)
+{
+  send(http::request_method::id::GET, "/a");
+  send(http::request_method::id::POST, "/b");
+  send(http::request_method::id::GET, "/c");
+  run();
+
+  BOOST_REQUIRE_EQUAL(3u, bodies.size());
+  BOOST_CHECK_EQUAL("/a", bodies[0]);
+  BOOST_CHECK_EQUAL("/b", bodies[1]);
+  BOOST_CHECK_EQUAL("/c", bodies[2]);
+  BOOST_CHECK_EQUAL(1u, accepted);
+  BOOST_CHECK_EQUAL(1u, max_outstanding);
+}
+
+// Idempotent requests are pipelined behind idempotent requests.
+BOOST_AUTO_TEST_CASE(Pipeline1)
+{
+  pool->set_max_pipeline(4);
+  send(http::request_method::id::GET, "/slow");
+  send(http::request_method::id::GET, "/a");
+  send(http::request_method::id::HEAD, "/b");
+  run();
+
+  BOOST_REQUIRE_EQUAL(3u, bodies.size());
+  BOOST_CHECK_EQUAL("/slow", bodies[0]);
+  BOOST_CHECK_EQUAL("/a", bodies[1]);
+  BOOST_CHECK(!errors[2]);
+  BOOST_CHECK_EQUAL(1u, accepted);
+  BOOST_CHECK_EQUAL(3u, max_outstanding);
+}
+
+// Requests are not pipelined behind a non-idempotent request, and a
+// non-idempotent request is not pipelined.
+BOOST_AUTO_TEST_CASE(Pipeline2)
+{
+  pool->set_max_pipeline(4);
+  send(http::request_method::id::POST, "/slow");
+  send(http::request_method::id::GET, "/a");
+  send(http::request_method::id::POST, "/b");
+  run();
+
+  BOOST_REQUIRE_EQUAL(3u, bodies.size());
+  BOOST_CHECK_EQUAL("/slow", bodies[0]);
+  BOOST_CHECK_EQUAL("/a", bodies[1]);
+  BOOST_CHECK_EQUAL("/b", bodies[2]);
+  BOOST_CHECK_EQUAL(1u, max_outstanding);
+}
+
+// An idempotent request is resent once after its connection is dropped.
+BOOST_AUTO_TEST_CASE(Resend1)
+{
+  drops = 1;
+  send(http::request_method::id::GET, "/drop");
+  run();
+
+  BOOST_REQUIRE_EQUAL(1u, bodies.size());
+  BOOST_CHECK(!errors[0]);
+  BOOST_CHECK_EQUAL("/drop", bodies[0]);
+  BOOST_CHECK_EQUAL(2u, received("GET /drop"));
+  BOOST_CHECK_EQUAL(2u, accepted);
+}
+
+// An idempotent request fails if it's dropped again, a non-idempotent
+// request fails the first time that it's dropped.
+BOOST_AUTO_TEST_CASE(Resend2)
+{
+  drops = 3;
+  send(http::request_method::id::GET, "/drop");
+  send(http::request_method::id::POST, "/drop");
+  run();
+
+  BOOST_REQUIRE_EQUAL(2u, errors.size());
+  BOOST_CHECK(errors[0]);
+  BOOST_CHECK(errors[1]);
+  BOOST_CHECK_EQUAL(2u, received("GET /drop"));
+  BOOST_CHECK_EQUAL(1u, received("POST /drop"));
+}
+
+// A connection closed by a response's "Connection: close" is replaced.
+BOOST_AUTO_TEST_CASE(ConnectionClose1)
+{
+  send(http::request_method::id::GET, "/close");
+  send(http::request_method::id::POST, "/a");
+  run();
+
+  BOOST_REQUIRE_EQUAL(2u, bodies.size());
+  BOOST_CHECK(!errors[0]);
+  BOOST_CHECK_EQUAL("/close", bodies[0]);
+  BOOST_CHECK(!errors[1]);
+  BOOST_CHECK_EQUAL("/a", bodies[1]);
+  BOOST_CHECK_EQUAL(2u, accepted);
+  BOOST_REQUIRE_EQUAL(2u, requests.size());
+  BOOST_CHECK_EQUAL("2 POST /a", requests[1]);
+}
+
+// The queued requests fail if the host can't be connected to.
+BOOST_AUTO_TEST_CASE(Unreachable1)
+{
+  pool = pool_type::create(io_service, "127.0.0.1",
+                           std::to_string(CLOSED_PORT), 2);
+  send(http::request_method::id::GET, "/a");
+  send(http::request_method::id::POST, "/b");
+  send(http::request_method::id::GET, "/c");
+  run();
+
+  BOOST_REQUIRE_EQUAL(3u, errors.size());
+  for (auto const& error : errors)
+    BOOST_CHECK(error);
+  BOOST_CHECK(requests.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/comms/tcp_adaptor.hpp"
+#include "via/http_server.hpp"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+
+using namespace via;
+
+namespace
+{
+  typedef http_server<comms::tcp_adaptor, std::string> http_server_type;
+  typedef http_server_type::http_connection_type http_connection;
+
+  const unsigned short PORT = 18402; ///< The server's port.
+
+  /// An http_server running in its own thread, that responds to the
+  /// requests on a connection in the reverse order that they are received.
+  struct http_server_fixture
+  {
+    boost::asio::io_service io_service;
+    http_server_type server;
+    std::thread thread;
+    http_connection::response_id first_id;   ///< The first response.
+    bool first_sent;                         ///< The first response result.
+    bool first_resent;                       ///< The repeated response result.
+
+    http_server_fixture() :
+      io_service(),
+      server(io_service),
+      thread(),
+      first_id(0),
+      first_sent(false),
+      first_resent(true)
+    {
+      server.request_received_event([this]
+        (http_connection::weak_pointer weak_ptr,
+         http::rx_request const& request, std::string const&)
+        { request_handler(weak_ptr, request); });
+    }
+
+    ~http_server_fixture()
+    {
+      io_service.stop();
+      if (thread.joinable())
+        thread.join();
+    }
+
+    /// Store the first request's response, respond to the second request,
+    /// then to the first.
+    void request_handler(http_connection::weak_pointer weak_ptr,
+                         http::rx_request const& request)
+    {
+      http_connection::shared_pointer connection(weak_ptr.lock());
+      if (!connection)
+        return;
+
+      if (request.uri() == "/first")
+        first_id = connection->current_response();
+      else
+      {
+        http::tx_response response(http::response_status::code::OK);
+        connection->send(response, std::string("second"));
+        first_sent = connection->send(first_id, response,
+                                      std::string("first"));
+        first_resent = connection->send(first_id, response,
+                                        std::string("again"));
+      }
+    }
+
+    void run()
+    {
+      BOOST_REQUIRE(!server.accept_connections(PORT, true));
+      thread = std::thread([this]{ io_service.run(); });
+    }
+
+    /// Send some requests to the server in a single write and read the
+    /// responses until the connection is closed or the last response
+    /// body has been received.
+    /// @return the responses.
+    std::string send_requests(std::string const& requests,
+                              std::string const& last_body)
+    {
+      boost::asio::io_service client_io_service;
+      boost::asio::ip::tcp::socket socket(client_io_service);
+      socket.connect(boost::asio::ip::tcp::endpoint
+                       (boost::asio::ip::address_v4::loopback(), PORT));
+      boost::asio::write(socket, boost::asio::buffer(requests));
+
+      std::string responses;
+      char buffer[1024];
+      boost::system::error_code error;
+      while (!error && (responses.find(last_body) == std::string::npos))
+      {
+        size_t const size(socket.read_some(boost::asio::buffer(buffer),
+                                           error));
+        responses.append(buffer, size);
+      }
+      return responses;
+    }
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_FIXTURE_TEST_SUITE(TestHttpServer, http_server_fixture)
+
+// Pipelined responses completed in reverse order are sent in request order.
+BOOST_AUTO_TEST_CASE(PipelinedResponses1)
+{
+  run();
+  std::string const responses(send_requests
+    ("GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+     "GET /second HTTP/1.1\r\nHost: localhost\r\n\r\n", "second"));
+
+  size_t const first(responses.find("\r\n\r\nfirst"));
+  size_t const second(responses.find("\r\n\r\nsecond"));
+  BOOST_REQUIRE(first != std::string::npos);
+  BOOST_REQUIRE(second != std::string::npos);
+  BOOST_CHECK(first < second);
+  BOOST_CHECK_EQUAL(0u, responses.find("HTTP/1.1 200 OK\r\n"));
+
+  io_service.stop();
+  thread.join();
+  BOOST_CHECK(first_sent);
+  BOOST_CHECK_NE(0u, first_id);
+
+  // A response can't be sent again
+  BOOST_CHECK(!first_resent);
+  BOOST_CHECK_EQUAL(std::string::npos, responses.find("again"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
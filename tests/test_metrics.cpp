@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2015 Via Technology Ltd. All Rights Reserved.
+// (ken dot barker at via-technology dot co dot uk)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//////////////////////////////////////////////////////////////////////////////
+#include "via/metrics.hpp"
+#include "via/http/request_router.hpp"
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+using namespace via;
+
+//////////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_SUITE(TestMetricsRegistry)
+
+BOOST_AUTO_TEST_CASE(Counters1)
+{
+  metrics_registry registry;
+  size_t const requests(registry.counter("requests_total"));
+  size_t const active(registry.gauge("active"));
+  BOOST_CHECK(requests != active);
+  BOOST_CHECK_EQUAL(requests, registry.counter("requests_total"));
+
+  registry.add(requests);
+  registry.add(requests, 2);
+  registry.add(active, 5);
+  registry.add(active, -2);
+  BOOST_CHECK_EQUAL(3, registry.counter_value(requests));
+  BOOST_CHECK_EQUAL(3, registry.counter_value(active));
+
+  // Updates of an unregistered metric are ignored
+  size_t const none(metrics_registry::NONE);
+  registry.add(none);
+  BOOST_CHECK_EQUAL(0, registry.counter_value(none));
+}
+
+BOOST_AUTO_TEST_CASE(CountersMergeThreads1)
+{
+  metrics_registry registry;
+  size_t const id(registry.counter("requests_total"));
+
+  std::vector<std::thread> threads;
+  for (int i(0); i < 4; ++i)
+    threads.push_back(std::thread([&registry, id]
+    {
+      for (int j(0); j < 1000; ++j)
+        registry.add(id);
+    }));
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(4000, registry.counter_value(id));
+}
+
+BOOST_AUTO_TEST_CASE(Histograms1)
+{
+  metrics_registry registry;
+  size_t const id(registry.histogram("latency_us"));
+  registry.observe(id, 0);
+  registry.observe(id, 1);
+  registry.observe(id, 3);
+  registry.observe(id, 4);
+  registry.observe(id, 1ULL << 40);
+
+  metrics_registry::histogram_values values(registry.histogram_value(id));
+  BOOST_CHECK_EQUAL(5u, values.count);
+  BOOST_CHECK_EQUAL(8u + (1ULL << 40), values.sum);
+  BOOST_CHECK_EQUAL(2u, values.buckets[0]); // <= 1
+  BOOST_CHECK_EQUAL(0u, values.buckets[1]); // <= 2
+  BOOST_CHECK_EQUAL(2u, values.buckets[2]); // <= 4
+  BOOST_CHECK_EQUAL(1u, values.buckets[metrics_registry::HISTOGRAM_BUCKETS]);
+}
+
+BOOST_AUTO_TEST_CASE(Text1)
+{
+  metrics_registry registry;
+  registry.add(registry.counter("errors_total{code=\"400\"}"), 2);
+  registry.add(registry.counter("errors_total{code=\"404\"}"));
+  registry.add(registry.gauge("active"), 3);
+  registry.histogram("unused_us");
+  size_t const id(registry.histogram("latency_us{route=\"/a\"}"));
+  registry.observe(id, 3);
+
+  std::string const text(registry.text());
+  BOOST_CHECK(text.find("# TYPE errors_total counter\n"
+                        "errors_total{code=\"400\"} 2\n"
+                        "errors_total{code=\"404\"} 1\n") != std::string::npos);
+  BOOST_CHECK(text.find("# TYPE active gauge\nactive 3\n") != std::string::npos);
+  BOOST_CHECK(text.find("# TYPE latency_us histogram\n") != std::string::npos);
+  BOOST_CHECK(text.find("latency_us_bucket{route=\"/a\",le=\"2\"} 0\n")
+                != std::string::npos);
+  BOOST_CHECK(text.find("latency_us_bucket{route=\"/a\",le=\"4\"} 1\n")
+                != std::string::npos);
+  BOOST_CHECK(text.find("latency_us_bucket{route=\"/a\",le=\"+Inf\"} 1\n")
+                != std::string::npos);
+  BOOST_CHECK(text.find("latency_us_sum{route=\"/a\"} 3\n") != std::string::npos);
+  BOOST_CHECK(text.find("latency_us_count{route=\"/a\"} 1\n") != std::string::npos);
+  BOOST_CHECK(text.find("unused_us") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(LabelValue1)
+{
+  BOOST_CHECK_EQUAL("/a\\\"b\\\\c\\n",
+                    metrics_registry::label_value("/a\"b\\c\n"));
+}
+
+BOOST_AUTO_TEST_CASE(InvalidRequests1)
+{
+  using namespace via::http;
+  metrics_registry& registry(metrics_registry::instance());
+
+  // The invalid requests counters are registered before any are invalid
+  request_receiver<std::string> receiver
+      (true, 8, 8, 1024, 1024, 100, 8190, 1048576, 1048576);
+  std::string request_data("GET / HTTP/1.1\r\nHost: h\r\n\r\n");
+  std::string::iterator next(request_data.begin());
+  BOOST_CHECK(receiver.receive(next, request_data.end()) == RX_VALID);
+  BOOST_CHECK(registry.text().find
+    ("via_http_requests_invalid_total{code=\"405\"}") != std::string::npos);
+
+  size_t const id(registry.counter
+    ("via_http_requests_invalid_total{code=\"501\"}"));
+  long long const invalid(registry.counter_value(id));
+  receiver.clear();
+  request_data = "GETTINGLONG / HTTP/1.1\r\n\r\n";
+  next = request_data.begin();
+  BOOST_CHECK(receiver.receive(next, request_data.end()) == RX_INVALID);
+  BOOST_CHECK_EQUAL(invalid + 1, registry.counter_value(id));
+}
+
+BOOST_AUTO_TEST_CASE(MetricsRoute1)
+{
+  using namespace via::http;
+  request_router<std::string> router;
+  router.add_metrics_route();
+
+  std::string const request_data("GET /metrics HTTP/1.1\r\nHost: h\r\n\r\n");
+  rx_request request(false, 8, 8, 1024, 1024, 100, 8190);
+  std::string::const_iterator next(request_data.begin());
+  BOOST_REQUIRE(request.parse(next, request_data.end()));
+
+  // The second response contains the latency of the first
+  std::string response_body;
+  router.handle_request(request, std::string(), response_body);
+  tx_response response(router.handle_request(request, std::string(),
+                                             response_body));
+  BOOST_CHECK_EQUAL(static_cast<int>(response_status::code::OK),
+                    response.status());
+  BOOST_CHECK(response_body.find
+    ("via_http_route_duration_us_count{route=\"/metrics\"} 1\n")
+      != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+//////////////////////////////////////////////////////////////////////////////
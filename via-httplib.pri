@@ -30,6 +30,17 @@ HEADERS += $${INC_DIR}/via/comms/ssl/*.hpp
 release: LIBS += -L$${VIAHTTPLIB}/release
 debug:   LIBS += -L$${VIAHTTPLIB}/debug
 
+# zlib compresses the response bodies, unless CONFIG += via_no_zlib
+!via_no_zlib {
+  DEFINES *= HTTP_ZLIB
+  LIBS += -lz
+}
+
+# The metrics are not updated if CONFIG += via_no_metrics
+via_no_metrics {
+  DEFINES *= VIA_NO_METRICS
+}
+
 # Ensure that the dubug library has a different name
 VIA_HTTPLIB_NAME = via-httplib
 CONFIG(debug, debug|release) {
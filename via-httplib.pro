@@ -77,7 +77,14 @@ SOURCES += $${SRC_DIR}/via/http/request_method.cpp
 SOURCES += $${SRC_DIR}/via/http/request.cpp
 SOURCES += $${SRC_DIR}/via/http/response_status.cpp
 SOURCES += $${SRC_DIR}/via/http/response.cpp
+SOURCES += $${SRC_DIR}/via/http/scanner.cpp
+SOURCES += $${SRC_DIR}/via/http/request_view.cpp
 SOURCES += $${SRC_DIR}/via/http/request_router.cpp
+SOURCES += $${SRC_DIR}/via/http/route_tree.cpp
+SOURCES += $${SRC_DIR}/via/http/static_files.cpp
+SOURCES += $${SRC_DIR}/via/http/response_cache.cpp
+SOURCES += $${SRC_DIR}/via/http/content_coding.cpp
+SOURCES += $${SRC_DIR}/via/http/compression.cpp
 SOURCES += $${SRC_DIR}/via/http/authentication/base64.cpp
 SOURCES += $${SRC_DIR}/via/http/authentication/basic.cpp
 